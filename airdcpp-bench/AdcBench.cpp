@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include "BenchUtil.h"
+
+#include <airdcpp/core/classes/Exception.h>
+#include <airdcpp/protocol/AdcCommand.h>
+#include <airdcpp/util/Util.h>
+
+#include <iostream>
+#include <random>
+
+using namespace bench;
+
+static const string TOOL_NAME = "airdcpp-bench-adc";
+
+static string randomString(std::mt19937& gen_, size_t aLength, const string& aChars) noexcept {
+	string ret;
+	ret.reserve(aLength);
+	for (size_t i = 0; i < aLength; ++i) {
+		ret += aChars[gen_() % aChars.size()];
+	}
+
+	return ret;
+}
+
+static string randomSID(std::mt19937& gen_) noexcept {
+	return randomString(gen_, 4, "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567");
+}
+
+static string randomBase32(std::mt19937& gen_) noexcept {
+	return randomString(gen_, 39, "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567");
+}
+
+// Commands with a similar structure as the ones received from the hubs and other clients
+static StringList createINF(size_t aCount) noexcept {
+	std::mt19937 gen(1);
+	StringList ret;
+	for (size_t i = 0; i < aCount; ++i) {
+		ret.push_back(
+			"BINF " + randomSID(gen) + " ID" + randomBase32(gen) + " PD" + randomBase32(gen) +
+			" NI" + randomString(gen, 12, "abcdefghijklmnopqrstuvwxyz_-") +
+			" DEsome\\sdescription\\swith\\sspaces SL" + Util::toString(gen() % 20) + " FS" + Util::toString(gen() % 20) +
+			" SS" + Util::toString(static_cast<int64_t>(gen()) * 1000) + " SF" + Util::toString(gen() % 100000) +
+			" HN" + Util::toString(gen() % 30) + " HR0 HO1 VEAirDC++\\s4.21 US" + Util::toString(gen() % 100000000) +
+			" DS" + Util::toString(gen() % 100000000) + " I4" + Util::toString(gen() % 256) + ".0.0.1 U4" + Util::toString(gen() % 65536) +
+			" SUSEGA,ADC0,TCP4,UDP4,CCPM,ASCH,KEYP CT0 AW1 LC" + randomString(gen, 2, "abcdefghijklmnopqrstuvwxyz")
+		);
+	}
+
+	return ret;
+}
+
+static StringList createSCH(size_t aCount) noexcept {
+	std::mt19937 gen(2);
+	StringList ret;
+	for (size_t i = 0; i < aCount; ++i) {
+		string cmd = "BSCH " + randomSID(gen);
+		if (i % 4 == 0) {
+			cmd += " TR" + randomBase32(gen);
+		} else {
+			for (size_t j = 0; j < 1 + gen() % 3; ++j) {
+				cmd += " AN" + randomString(gen, 3 + gen() % 8, "abcdefghijklmnopqrstuvwxyz");
+			}
+
+			cmd += " NOsample EXmkv EXavi GE" + Util::toString(gen() % 1000000);
+		}
+
+		cmd += " TO" + Util::toString(gen()) + " TY1";
+		ret.push_back(cmd);
+	}
+
+	return ret;
+}
+
+static StringList createRES(size_t aCount) noexcept {
+	std::mt19937 gen(3);
+	StringList ret;
+	for (size_t i = 0; i < aCount; ++i) {
+		ret.push_back(
+			"URES " + randomBase32(gen) + " FN/Share/" + randomString(gen, 10, "abcdefghijklmnopqrstuvwxyz") +
+			"\\sfolder/" + randomString(gen, 16, "abcdefghijklmnopqrstuvwxyz") + ".mkv SI" + Util::toString(static_cast<int64_t>(gen()) * 100) +
+			" SL" + Util::toString(gen() % 10) + " TR" + randomBase32(gen) + " TO" + Util::toString(gen()) + " DM" + Util::toString(gen())
+		);
+	}
+
+	return ret;
+}
+
+template<class F>
+static void benchCommands(const string& aGroup, const string& aName, const StringList& aLines, const BenchOptions& aOptions, BenchResults& results_, F&& aHandler) {
+	size_t errors = 0;
+	auto seconds = measureBest(aOptions.iterations, [&] {
+		for (const auto& line: aLines) {
+			try {
+				AdcCommand c(line);
+				aHandler(c);
+			} catch (const ParseException&) {
+				errors++;
+			}
+		}
+	});
+
+	if (errors > 0) {
+		std::cerr << aGroup << " " << aName << ": " << errors << " parsing errors" << std::endl;
+	}
+
+	results_.addRate(aGroup, aName, static_cast<int64_t>(aLines.size()), seconds);
+}
+
+int main(int argc, char* argv[]) {
+	BenchOptions options;
+	if (!options.parse(argc, argv, TOOL_NAME, {
+		{ "commands", "Number of commands per type (default: 200000)" },
+	})) {
+		return 1;
+	}
+
+	const auto count = static_cast<size_t>(max(options.getInt("commands", 200000), static_cast<int64_t>(1)));
+
+	BenchResults results(TOOL_NAME);
+
+	// Results are accumulated so that the work isn't optimized away
+	size_t total = 0;
+
+	{
+		auto lines = createINF(count);
+		benchCommands("INF", "parse", lines, options, results, [&](const AdcCommand& c) {
+			total += c.getParamCount();
+		});
+
+		// AdcHub::updateInfUserProperties
+		benchCommands("INF", "fields", lines, options, results, [&](const AdcCommand& c) {
+			string cid;
+			c.getParam("ID", 0, cid);
+			for (size_t i = 0; i < c.getParamCount(); ++i) {
+				total += c.getParamView(i).size();
+			}
+		});
+
+		benchCommands("INF", "parameter copies", lines, options, results, [&](const AdcCommand& c) {
+			for (size_t i = 0; i < c.getParamCount(); ++i) {
+				total += c.getParam(i).size();
+			}
+		});
+	}
+
+	{
+		auto lines = createSCH(count);
+		benchCommands("SCH", "parse", lines, options, results, [&](const AdcCommand& c) {
+			total += c.getParamCount();
+		});
+
+		// SearchManager::respond
+		benchCommands("SCH", "named lookups", lines, options, results, [&](const AdcCommand& c) {
+			string token, path, tmp;
+			c.getParam("TO", 0, token);
+			c.getParam("PA", 0, path);
+			c.getParam("MR", 0, tmp);
+			total += token.size() + c.hasFlag("RE", 0);
+		});
+	}
+
+	{
+		auto lines = createRES(count);
+		benchCommands("RES", "parse", lines, options, results, [&](const AdcCommand& c) {
+			total += c.getParamCount();
+		});
+
+		// UDPServer + SearchManager::onRES
+		benchCommands("RES", "fields", lines, options, results, [&](AdcCommand& c) {
+			total += c.getParamView(0).size();
+			c.removeParam(0);
+
+			string tth;
+			c.getParam("TR", 0, tth);
+			total += tth.size();
+		});
+	}
+
+	std::cout << std::endl << "Checksum: " << total << std::endl;
+
+	if (!results.save(options.outputPath)) {
+		return 1;
+	}
+
+	std::cout << std::endl << "Results were written to " << options.outputPath << std::endl;
+	return 0;
+}
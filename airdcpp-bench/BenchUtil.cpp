@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include "BenchUtil.h"
+
+#include <airdcpp/core/classes/Exception.h>
+#include <airdcpp/core/io/File.h>
+#include <airdcpp/core/version.h>
+#include <airdcpp/util/PathUtil.h>
+#include <airdcpp/util/Util.h>
+
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <thread>
+
+namespace bench {
+
+int64_t BenchOptions::getInt(const string& aName, int64_t aDefault) const noexcept {
+	auto i = extra.find(aName);
+	if (i == extra.end()) {
+		return aDefault;
+	}
+
+	return Util::toInt64(i->second);
+}
+
+bool BenchOptions::parse(int argc, char* argv[], const string& aToolName, const vector<pair<string, string>>& aExtraOptions) noexcept {
+	outputPath = aToolName + ".json";
+
+	auto printHelp = [&] {
+		std::cout << "Usage: " << aToolName << " [options]" << std::endl << std::endl;
+		std::cout << "  --output <path>      Result file (default: " << outputPath << ")" << std::endl;
+		std::cout << "  --dir <path>         Directory for temporary files (default: system temp directory)" << std::endl;
+		std::cout << "  --iterations <n>     Number of runs per test, the fastest one is reported (default: " << iterations << ")" << std::endl;
+		for (const auto& [name, description]: aExtraOptions) {
+			std::cout << "  --" << name << " <value>" << string(max(0, 15 - static_cast<int>(name.size())), ' ') << description << std::endl;
+		}
+	};
+
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			printHelp();
+			return false;
+		}
+
+		if (arg.size() <= 2 || arg.compare(0, 2, "--") != 0 || i + 1 >= argc) {
+			std::cerr << "Invalid argument " << arg << std::endl << std::endl;
+			printHelp();
+			return false;
+		}
+
+		auto name = arg.substr(2);
+		string value = argv[++i];
+		if (name == "output") {
+			outputPath = value;
+		} else if (name == "dir") {
+			workPath = value;
+		} else if (name == "iterations") {
+			iterations = max(Util::toInt(value), 1);
+		} else if (ranges::any_of(aExtraOptions, [&name](const auto& o) { return o.first == name; })) {
+			extra[name] = value;
+		} else {
+			std::cerr << "Unknown option " << arg << std::endl << std::endl;
+			printHelp();
+			return false;
+		}
+	}
+
+	if (!workPath.empty()) {
+		workPath = PathUtil::validateDirectoryPath(workPath);
+	}
+
+	return true;
+}
+
+void BenchResults::addThroughput(const string& aGroup, const string& aName, int64_t aBytes, double aSeconds) noexcept {
+	add({ aGroup, aName, "MiB/s", aSeconds > 0 ? static_cast<double>(aBytes) / (1024 * 1024) / aSeconds : 0, aBytes, aSeconds });
+}
+
+void BenchResults::addRate(const string& aGroup, const string& aName, int64_t aOperations, double aSeconds) noexcept {
+	add({ aGroup, aName, "ops/s", aSeconds > 0 ? static_cast<double>(aOperations) / aSeconds : 0, aOperations, aSeconds });
+}
+
+void BenchResults::addSize(const string& aGroup, const string& aName, int64_t aBytes) noexcept {
+	add({ aGroup, aName, "MiB", static_cast<double>(aBytes) / (1024 * 1024), aBytes, 0 });
+}
+
+void BenchResults::add(Result&& aResult) noexcept {
+	printf("%-16s %-28s %12.1f %s\n", aResult.group.c_str(), aResult.name.c_str(), aResult.value, aResult.unit.c_str());
+	fflush(stdout);
+
+	results.push_back(std::move(aResult));
+}
+
+static string escapeJson(const string& aStr) noexcept {
+	string ret;
+	for (auto c: aStr) {
+		switch (c) {
+			case '"': ret += "\\\""; break;
+			case '\\': ret += "\\\\"; break;
+			case '\n': ret += "\\n"; break;
+			default: ret += c;
+		}
+	}
+
+	return ret;
+}
+
+bool BenchResults::save(const string& aPath) const noexcept {
+	string json = "{\n";
+	json += "  \"tool\": \"" + escapeJson(toolName) + "\",\n";
+	json += "  \"version\": \"" + escapeJson(shortVersionString) + "\",\n";
+	json += "  \"timestamp\": " + Util::toString(static_cast<int64_t>(time(nullptr))) + ",\n";
+	json += "  \"threads\": " + Util::toString(std::thread::hardware_concurrency()) + ",\n";
+	json += "  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		const auto& r = results[i];
+
+		char value[64];
+		snprintf(value, sizeof(value), "%.3f", r.value);
+
+		char seconds[64];
+		snprintf(seconds, sizeof(seconds), "%.6f", r.seconds);
+
+		json += "    { \"group\": \"" + escapeJson(r.group) + "\", \"name\": \"" + escapeJson(r.name) + "\", ";
+		json += "\"value\": " + string(value) + ", \"unit\": \"" + r.unit + "\", ";
+		json += "\"amount\": " + Util::toString(r.amount) + ", \"seconds\": " + string(seconds) + " }";
+		json += i + 1 < results.size() ? ",\n" : "\n";
+	}
+
+	json += "  ]\n}\n";
+
+	try {
+		File f(aPath, File::WRITE, File::CREATE | File::TRUNCATE);
+		f.write(json);
+	} catch (const FileException& e) {
+		std::cerr << "Failed to write " << aPath << ": " << e.getError() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+} // namespace bench
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef AIRDCPP_BENCH_UTIL_H
+#define AIRDCPP_BENCH_UTIL_H
+
+#include "stdinc.h"
+
+#include <chrono>
+
+namespace bench {
+
+// Command line options shared by all benchmark tools
+struct BenchOptions {
+	string outputPath;
+	// Empty if the tool should use the default temp directory
+	string workPath;
+	int iterations = 3;
+
+	// Tool-specific options (name -> value)
+	map<string, string> extra;
+
+	int64_t getInt(const string& aName, int64_t aDefault) const noexcept;
+
+	// Returns false if the tool should exit (invalid options or help was requested)
+	bool parse(int argc, char* argv[], const string& aToolName, const vector<pair<string, string>>& aExtraOptions) noexcept;
+};
+
+class BenchResults {
+public:
+	explicit BenchResults(const string& aToolName) noexcept : toolName(aToolName) { }
+
+	// Data processing speed
+	void addThroughput(const string& aGroup, const string& aName, int64_t aBytes, double aSeconds) noexcept;
+
+	// Operations per second
+	void addRate(const string& aGroup, const string& aName, int64_t aOperations, double aSeconds) noexcept;
+
+	// Memory usage
+	void addSize(const string& aGroup, const string& aName, int64_t aBytes) noexcept;
+
+	// Write the results in JSON format
+	bool save(const string& aPath) const noexcept;
+private:
+	struct Result {
+		string group;
+		string name;
+		string unit;
+		double value;
+		int64_t amount;
+		double seconds;
+	};
+
+	void add(Result&& aResult) noexcept;
+
+	const string toolName;
+	vector<Result> results;
+};
+
+class Stopwatch {
+public:
+	Stopwatch() noexcept : start(std::chrono::steady_clock::now()) { }
+
+	double getSeconds() const noexcept {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+private:
+	const std::chrono::steady_clock::time_point start;
+};
+
+// Run the function for the wanted number of times and return the fastest duration in seconds
+template<class F>
+double measureBest(int aIterations, F&& aFunc) {
+	double best = 0;
+	for (int i = 0; i < aIterations; ++i) {
+		Stopwatch stopwatch;
+		aFunc();
+		auto seconds = stopwatch.getSeconds();
+		if (i == 0 || seconds < best) {
+			best = seconds;
+		}
+	}
+
+	return best;
+}
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include "BenchUtil.h"
+
+#include <airdcpp/filelist/DirectoryListing.h>
+#include <airdcpp/filelist/DirectoryListingDirectory.h>
+#include <airdcpp/util/Util.h>
+
+#include <iostream>
+#include <random>
+
+using namespace bench;
+
+using Directory = DirectoryListing::Directory;
+using ItemStorage = DirectoryListing::ItemStorage;
+
+static const string TOOL_NAME = "airdcpp-bench-filelist";
+
+static const StringList names = { "Album", "Disc", "Season", "Extras", "Sample", "Subs", "Covers", "Proof" };
+
+struct ListShape {
+	size_t directories = 0;
+	size_t subdirectories = 0;
+	size_t files = 0;
+};
+
+// Adds the content of a top-level directory in the same way as loading a partial list does
+// Files are added without a size so that no dupe checks are performed (the storage uses the same amount of memory)
+static size_t loadDirectory(Directory& aDirectory, const ListShape& aShape, std::mt19937& gen_) {
+	size_t itemCount = 0;
+	auto addFiles = [&](Directory& aParent) {
+		for (size_t i = 0; i < aShape.files; ++i) {
+			TTHValue tth;
+			for (auto& b : tth.data) {
+				b = static_cast<uint8_t>(gen_());
+			}
+
+			aParent.addFile(names[gen_() % names.size()] + " " + Util::toString(i) + ".flac", 0, tth, 0);
+			itemCount++;
+		}
+	};
+
+	addFiles(aDirectory);
+	for (size_t i = 0; i < aShape.subdirectories; ++i) {
+		auto subdirectory = Directory::create(&aDirectory, names[i % names.size()] + " " + Util::toString(i), Directory::TYPE_NORMAL, 0);
+		itemCount++;
+
+		addFiles(*subdirectory);
+	}
+
+	aDirectory.getStorage()->clearNameIndex();
+	return itemCount;
+}
+
+static string getDirectoryName(size_t aIndex) noexcept {
+	return "Directory " + Util::toString(aIndex);
+}
+
+using ItemList = vector<pair<string, DirectoryListingItemToken>>;
+
+// Returns the paths and tokens of all items in the tree
+static ItemList listItems(const Directory& aDirectory) {
+	ItemList ret;
+	for (const auto& f : aDirectory.getFiles()) {
+		ret.emplace_back(f->getAdcPathUnsafe(), f->getToken());
+	}
+
+	for (const auto& d : aDirectory.getDirectories()) {
+		ret.emplace_back(d->getAdcPathUnsafe(), d->getToken());
+
+		auto children = listItems(*d);
+		ret.insert(ret.end(), children.begin(), children.end());
+	}
+
+	return ret;
+}
+
+struct ReloadStats {
+	size_t loadedItems = 0;
+	size_t compactions = 0;
+	size_t peakMemory = 0;
+	size_t finalMemory = 0;
+	size_t errors = 0;
+};
+
+// Reloads random top-level directories of a partial list
+// When verifying, the tree must stay unchanged when the storage is compacted
+static ReloadStats runReloads(const ListShape& aShape, size_t aReloads, bool aCompact, bool aVerify) {
+	ReloadStats stats;
+	std::mt19937 gen(1);
+
+	auto storage = ItemStorage::create();
+	auto root = Directory::createRoot(storage.get());
+	for (size_t i = 0; i < aShape.directories; ++i) {
+		auto directory = Directory::create(root.get(), getDirectoryName(i), Directory::TYPE_NORMAL, 0);
+		stats.loadedItems += 1 + loadDirectory(*directory, aShape, gen);
+	}
+
+	for (size_t i = 0; i < aReloads; ++i) {
+		auto directory = root->findDirectory(getDirectoryName(gen() % aShape.directories));
+		directory->clearAll();
+		stats.loadedItems += loadDirectory(*directory, aShape, gen);
+
+		stats.peakMemory = max(stats.peakMemory, storage->getMemoryUsage());
+		if (aCompact && storage->needsCompaction()) {
+			ItemList itemsBefore;
+			if (aVerify) {
+				itemsBefore = listItems(*root);
+			}
+
+			auto newStorage = ItemStorage::create();
+			root->moveToStorage(*newStorage);
+			newStorage->clearNameIndex();
+			storage = std::move(newStorage);
+			stats.compactions++;
+
+			if (aVerify && (listItems(*root) != itemsBefore || storage->getItemCount() != itemsBefore.size() || storage->getRemovedItemCount() != 0)) {
+				stats.errors++;
+			}
+		}
+	}
+
+	stats.finalMemory = storage->getMemoryUsage();
+
+	// Clear the children before the storage is released
+	root->clearAll();
+	return stats;
+}
+
+int main(int argc, char* argv[]) {
+	BenchOptions options;
+	if (!options.parse(argc, argv, TOOL_NAME, {
+		{ "directories", "Number of top-level directories (default: 200)" },
+		{ "subdirectories", "Number of subdirectories per top-level directory (default: 20)" },
+		{ "files", "Number of files per directory (default: 20)" },
+		{ "reloads", "Number of top-level directory reloads (default: 2000)" },
+	})) {
+		return 1;
+	}
+
+	ListShape shape;
+	shape.directories = static_cast<size_t>(max(options.getInt("directories", 200), static_cast<int64_t>(1)));
+	shape.subdirectories = static_cast<size_t>(max(options.getInt("subdirectories", 20), static_cast<int64_t>(0)));
+	shape.files = static_cast<size_t>(max(options.getInt("files", 20), static_cast<int64_t>(0)));
+	const auto reloads = static_cast<size_t>(max(options.getInt("reloads", 2000), static_cast<int64_t>(0)));
+
+	BenchResults results(TOOL_NAME);
+
+	// Verify the compacted tree separately so that it won't affect the results
+	auto errors = runReloads(shape, reloads, true, true).errors;
+	if (errors > 0) {
+		std::cerr << errors << " compactions changed the content of the tree" << std::endl;
+	}
+
+	size_t checksum = 0;
+	for (auto compact : { false, true }) {
+		ReloadStats stats;
+		auto seconds = measureBest(options.iterations, [&] {
+			stats = runReloads(shape, reloads, compact, false);
+		});
+
+		const auto name = compact ? "compacted" : "not compacted";
+		results.addRate("reload", name, static_cast<int64_t>(stats.loadedItems), seconds);
+		results.addSize("peak memory", name, static_cast<int64_t>(stats.peakMemory));
+		results.addSize("final memory", name, static_cast<int64_t>(stats.finalMemory));
+
+		if (compact) {
+			std::cout << stats.compactions << " compactions" << std::endl;
+		}
+
+		checksum += stats.loadedItems;
+	}
+
+	std::cout << std::endl << "Checksum: " << checksum << std::endl;
+
+	if (!results.save(options.outputPath)) {
+		return 1;
+	}
+
+	std::cout << std::endl << "Results were written to " << options.outputPath << std::endl;
+	return errors > 0 ? 1 : 0;
+}
@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include "BenchUtil.h"
+
+#include <airdcpp/DCPlusPlus.h>
+#include <airdcpp/core/classes/Exception.h>
+#include <airdcpp/core/classes/ScopedFunctor.h>
+#include <airdcpp/core/io/File.h>
+#include <airdcpp/core/io/FileReader.h>
+#include <airdcpp/core/io/compress/ZUtils.h>
+#include <airdcpp/core/localization/ResourceManager.h>
+#include <airdcpp/events/LogManager.h>
+#include <airdcpp/hash/HashStore.h>
+#include <airdcpp/hash/HashedFile.h>
+#include <airdcpp/hash/value/MerkleTree.h>
+#include <airdcpp/hash/value/TigerHash.h>
+#include <airdcpp/settings/SettingsManager.h>
+#include <airdcpp/util/AppUtil.h>
+#include <airdcpp/util/Util.h>
+#include <airdcpp/util/ValueGenerator.h>
+
+#include <iostream>
+#include <random>
+
+using namespace bench;
+
+static const string TOOL_NAME = "airdcpp-bench-hash";
+
+// Size of the chunks that are passed to the hashers (same as the default FileReader block size)
+static const size_t CHUNK_SIZE = 1024 * 1024;
+
+static ByteVector createData(size_t aSize) noexcept {
+	ByteVector data(aSize);
+
+	std::mt19937_64 gen(aSize);
+	for (size_t i = 0; i + sizeof(uint64_t) <= aSize; i += sizeof(uint64_t)) {
+		auto value = gen();
+		memcpy(&data[i], &value, sizeof(uint64_t));
+	}
+
+	return data;
+}
+
+static void benchTiger(const ByteVector& aData, const BenchOptions& aOptions, BenchResults& results_) {
+	const auto size = static_cast<int64_t>(aData.size());
+
+	{
+		auto seconds = measureBest(aOptions.iterations, [&] {
+			TigerHash h;
+			h.update(aData.data(), aData.size());
+			h.finalize();
+		});
+
+		results_.addThroughput("tiger", "single stream", size, seconds);
+	}
+
+	{
+		// Leaf hashes of the tree with the minimum block size
+		const auto blocks = aData.size() / TigerTree::BASE_BLOCK_SIZE;
+		ByteVector leaves(blocks * TigerHash::BYTES);
+
+		auto seconds = measureBest(aOptions.iterations, [&] {
+			TigerHash::hashBlocks(aData.data(), blocks, TigerTree::BASE_BLOCK_SIZE, 0, leaves.data());
+		});
+
+		results_.addThroughput("tiger", "leaf blocks", static_cast<int64_t>(blocks * TigerTree::BASE_BLOCK_SIZE), seconds);
+	}
+}
+
+static void benchTree(const ByteVector& aData, const BenchOptions& aOptions, BenchResults& results_) {
+	const auto size = static_cast<int64_t>(aData.size());
+
+	for (auto blockSize: { 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 }) {
+		auto seconds = measureBest(aOptions.iterations, [&] {
+			TigerTree tree(blockSize);
+			for (size_t pos = 0; pos < aData.size(); pos += CHUNK_SIZE) {
+				tree.update(&aData[pos], min(CHUNK_SIZE, aData.size() - pos));
+			}
+
+			tree.finalize();
+		});
+
+		results_.addThroughput("tree", "block size " + Util::formatBytes(blockSize), size, seconds);
+	}
+}
+
+static void benchCRC(const ByteVector& aData, const BenchOptions& aOptions, BenchResults& results_) {
+	auto seconds = measureBest(aOptions.iterations, [&] {
+		CRC32Filter crc;
+		for (size_t pos = 0; pos < aData.size(); pos += CHUNK_SIZE) {
+			crc(&aData[pos], min(CHUNK_SIZE, aData.size() - pos));
+		}
+	});
+
+	results_.addThroughput("crc32", "filter", static_cast<int64_t>(aData.size()), seconds);
+}
+
+// Remove the file from the page cache so that the data will be read from the disk
+static bool dropCache(const string& aPath) noexcept {
+#ifdef HAVE_POSIX_FADVISE
+	try {
+		File f(aPath, File::READ, File::OPEN);
+		return posix_fadvise(f.getNativeHandle(), 0, 0, POSIX_FADV_DONTNEED) == 0;
+	} catch (const FileException&) {
+		//...
+	}
+#endif
+
+	return false;
+}
+
+static void benchFileReader(const ByteVector& aData, const BenchOptions& aOptions, BenchResults& results_) {
+	const auto path = aOptions.workPath + "readtest.dat";
+	ScopedFunctor([&path] { File::deleteFile(path); });
+
+	try {
+		File f(path, File::WRITE, File::CREATE | File::TRUNCATE);
+		f.write(aData.data(), aData.size());
+	} catch (const FileException& e) {
+		std::cerr << "Failed to create the test file " << path << ": " << e.getError() << std::endl;
+		return;
+	}
+
+	for (auto strategy: { FileReader::SYNC, FileReader::ASYNC }) {
+		const auto name = strategy == FileReader::SYNC ? "sync" : "async";
+
+		bool cold = true;
+		size_t total = 0;
+		auto seconds = measureBest(aOptions.iterations, [&] {
+			// Clearing the cache should be done outside of the measured time but it's fast enough to not matter
+			if (!dropCache(path)) {
+				cold = false;
+			}
+
+			total = 0;
+			FileReader(strategy).read(path, [&](const void*, size_t aLen) {
+				total += aLen;
+				return true;
+			});
+		});
+
+		if (total != aData.size()) {
+			std::cerr << "FileReader (" << name << ") returned " << total << " bytes instead of " << aData.size() << std::endl;
+			continue;
+		}
+
+		results_.addThroughput("filereader", string(name) + (cold ? " (cold)" : " (cached)"), static_cast<int64_t>(total), seconds);
+	}
+}
+
+class HashStoreBench {
+public:
+	HashStoreBench(const BenchOptions& aOptions, BenchResults& aResults) : options(aOptions), results(aResults) {
+		const auto entries = static_cast<int>(options.getInt("entries", 20000));
+
+		// Trees for 16 MiB files with 1 MiB leaves
+		std::mt19937_64 gen(entries);
+		for (int i = 0; i < entries; ++i) {
+			ByteVector leaves(16 * TigerHash::BYTES);
+			for (auto& b: leaves) {
+				b = static_cast<uint8_t>(gen());
+			}
+
+			const auto path = "/share/directory " + Util::toString(i / 100) + "/file " + Util::toString(i) + ".bin";
+			files.emplace_back(path, TigerTree(16 * 1024 * 1024, 1024 * 1024, leaves.data()));
+		}
+	}
+
+	void run(StartupLoader& aLoader) {
+		{
+			// Uncached database access
+			SettingsManager::getInstance()->set(SettingsManager::HASH_CACHE_SIZE, 0);
+			store.openDb(aLoader);
+			ScopedFunctor([this] { store.closeDb(); });
+
+			benchWrite();
+			benchReadFiles("get file (db)");
+			benchReadTrees("get tree (db)");
+		}
+
+		{
+			// Populate the memory cache with the first pass
+			SettingsManager::getInstance()->set(SettingsManager::HASH_CACHE_SIZE, 128);
+			store.openDb(aLoader);
+			ScopedFunctor([this] { store.closeDb(); });
+
+			benchReadTrees("get tree (db, cache miss)");
+			benchReadTrees("get tree (cached)");
+			benchReadFiles("get file (cached)");
+		}
+	}
+private:
+	void benchWrite() {
+		Stopwatch stopwatch;
+		for (const auto& [path, tree]: files) {
+			store.addHashedFile(path, tree, HashedFile(tree.getRoot(), 1, tree.getFileSize()));
+		}
+
+		// Include the time that it takes to commit the data
+		store.flush();
+
+		results.addRate("hashstore", "add", static_cast<int64_t>(files.size()), stopwatch.getSeconds());
+	}
+
+	void benchReadFiles(const string& aName) {
+		int found = 0;
+
+		Stopwatch stopwatch;
+		for (const auto& f: files) {
+			HashedFile fi;
+			if (store.getFileInfo(f.first, fi)) {
+				found++;
+			}
+		}
+
+		auto seconds = stopwatch.getSeconds();
+		if (!validateCount(aName, found)) {
+			return;
+		}
+
+		results.addRate("hashstore", aName, found, seconds);
+	}
+
+	void benchReadTrees(const string& aName) {
+		int found = 0;
+
+		Stopwatch stopwatch;
+		for (const auto& f: files) {
+			TigerTree tree;
+			if (store.getTree(f.second.getRoot(), tree)) {
+				found++;
+			}
+		}
+
+		auto seconds = stopwatch.getSeconds();
+		if (!validateCount(aName, found)) {
+			return;
+		}
+
+		results.addRate("hashstore", aName, found, seconds);
+	}
+
+	bool validateCount(const string& aName, int aFound) const noexcept {
+		if (aFound != static_cast<int>(files.size())) {
+			std::cerr << aName << ": " << aFound << " out of " << files.size() << " entries were found" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	const BenchOptions& options;
+	BenchResults& results;
+
+	HashStore store;
+	vector<pair<string, TigerTree>> files;
+};
+
+static void benchHashStore(const BenchOptions& aOptions, BenchResults& results_) {
+	StepFunction stepF = [](const string&) { };
+	ProgressFunction progressF = [](float) { };
+	MessageFunction messageF = [](const string& aMessage, bool, bool) {
+		std::cerr << aMessage << std::endl;
+		return false;
+	};
+
+	StartupLoader loader(stepF, progressF, messageF);
+
+	try {
+		HashStoreBench bench(aOptions, results_);
+		bench.run(loader);
+	} catch (const Exception& e) {
+		std::cerr << "Hash database benchmark failed: " << e.getError() << std::endl;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	BenchOptions options;
+	if (!options.parse(argc, argv, TOOL_NAME, {
+		{ "size", "Size of the hashed data in MiB (default: 256)" },
+		{ "entries", "Number of hash database entries (default: 20000)" },
+	})) {
+		return 1;
+	}
+
+	const auto size = static_cast<size_t>(max(options.getInt("size", 256), static_cast<int64_t>(1))) * 1024 * 1024;
+
+	// Keep the database files and settings separate from the real application data
+	const auto rootPath = (options.workPath.empty() ? string("/tmp/") : options.workPath) + TOOL_NAME + "-" + Util::toString(ValueGenerator::rand()) + PATH_SEPARATOR;
+	File::ensureDirectory(rootPath);
+
+	AppUtil::initialize(rootPath + "config" + PATH_SEPARATOR);
+	if (options.workPath.empty()) {
+		options.workPath = rootPath;
+	}
+
+	ResourceManager::newInstance();
+	SettingsManager::newInstance();
+	LogManager::newInstance();
+
+	BenchResults results(TOOL_NAME);
+
+	{
+		auto data = createData(size);
+
+		benchTiger(data, options, results);
+		benchTree(data, options, results);
+		benchCRC(data, options, results);
+		benchFileReader(data, options, results);
+	}
+
+	benchHashStore(options, results);
+
+	LogManager::deleteInstance();
+	SettingsManager::deleteInstance();
+	ResourceManager::deleteInstance();
+
+	try {
+		File::removeDirectoryForced(rootPath);
+	} catch (const FileException& e) {
+		std::cerr << "Failed to remove " << rootPath << ": " << e.getError() << std::endl;
+	}
+
+	if (!results.save(options.outputPath)) {
+		return 1;
+	}
+
+	std::cout << std::endl << "Results were written to " << options.outputPath << std::endl;
+	return 0;
+}
@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include "BenchUtil.h"
+
+#include <airdcpp/core/classes/Exception.h>
+#include <airdcpp/core/io/File.h>
+#include <airdcpp/core/localization/ResourceManager.h>
+#include <airdcpp/events/LogManager.h>
+#include <airdcpp/hash/HashedFile.h>
+#include <airdcpp/search/SearchQuery.h>
+#include <airdcpp/settings/SettingsManager.h>
+#include <airdcpp/share/ShareRefreshInfo.h>
+#include <airdcpp/share/ShareSearchInfo.h>
+#include <airdcpp/share/ShareTree.h>
+#include <airdcpp/util/AppUtil.h>
+#include <airdcpp/util/Util.h>
+#include <airdcpp/util/ValueGenerator.h>
+
+#include <iostream>
+#include <random>
+
+using namespace bench;
+
+static const string TOOL_NAME = "airdcpp-bench-share-search";
+static const ProfileToken BENCH_PROFILE = 0;
+
+static string randomString(std::mt19937& gen_, size_t aLength, const string& aChars) noexcept {
+	string ret;
+	ret.reserve(aLength);
+	for (size_t i = 0; i < aLength; ++i) {
+		ret += aChars[gen_() % aChars.size()];
+	}
+
+	return ret;
+}
+
+// A limited alphabet so that the words share trigrams with each other
+static StringList createWords(size_t aCount) noexcept {
+	std::mt19937 gen(1);
+	StringList ret;
+	for (size_t i = 0; i < aCount; ++i) {
+		ret.push_back(randomString(gen, 3 + gen() % 7, "abcdeilmnorstu"));
+	}
+
+	return ret;
+}
+
+static string randomName(std::mt19937& gen_, const StringList& aWords, const string& aSeparators) noexcept {
+	string ret;
+	auto wordCount = 1 + gen_() % 4;
+	for (size_t i = 0; i < wordCount; ++i) {
+		if (i > 0) {
+			ret += aSeparators[gen_() % aSeparators.size()];
+		}
+
+		auto word = aWords[gen_() % aWords.size()];
+		if (gen_() % 4 == 0) {
+			word[0] = static_cast<char>(toupper(word[0]));
+		}
+
+		ret += word;
+	}
+
+	return ret;
+}
+
+static TTHValue randomTTH(std::mt19937& gen_) noexcept {
+	TTHValue ret;
+	for (auto& b : ret.data) {
+		b = static_cast<uint8_t>(gen_());
+	}
+
+	return ret;
+}
+
+// Builds the root in the same way as the share refresh does
+static size_t addRoot(ShareTree& tree_, const string& aPath, const string& aVirtualName, size_t aDirectoryCount, size_t aFilesPerDirectory, const StringList& aWords, std::mt19937& gen_) {
+	static const StringList extensions = { "mp3", "flac", "avi", "mkv", "jpg", "nfo", "txt", "iso" };
+
+	tree_.addShareRoot(aPath, aVirtualName, { BENCH_PROFILE }, false, 0, 0);
+	auto root = tree_.getRootPaths().at(aPath);
+
+	ShareRefreshInfo ri(aPath, root, 0, *tree_.getBloom());
+
+	size_t itemCount = 0;
+	ShareDirectory::List directories{ ri.newDirectory };
+	for (size_t i = 0; i < aDirectoryCount; ++i) {
+		// Random parents produce branches of varying depths
+		auto parent = directories[gen_() % directories.size()];
+		auto directory = ShareDirectory::createNormal(DualString(randomName(gen_, aWords, " ._-") + " " + Util::toString(i)), parent, 0, ri);
+		directories.push_back(directory);
+		itemCount++;
+
+		for (size_t j = 0; j < aFilesPerDirectory; ++j) {
+			auto name = randomName(gen_, aWords, " ._-") + "-" + Util::toString(j) + "." + extensions[gen_() % extensions.size()];
+			directory->addFile(DualString(name), HashedFile(randomTTH(gen_), 0, gen_() % (1024 * 1024 * 1024)), ri, ri.stats.addedSize);
+			itemCount++;
+		}
+	}
+
+	tree_.applyRefreshChanges(ri, nullptr);
+	return itemCount;
+}
+
+struct BenchSearch {
+	string query;
+	StringList excluded;
+	StringList extensions;
+	Search::MatchType matchType = Search::MATCH_PATH_PARTIAL;
+	SearchQuery::ItemType itemType = SearchQuery::ItemType::ANY;
+};
+
+static vector<BenchSearch> createSearches(size_t aCount, const StringList& aWords) noexcept {
+	std::mt19937 gen(2);
+	vector<BenchSearch> ret;
+	for (size_t i = 0; i < aCount; ++i) {
+		BenchSearch search;
+
+		auto patternCount = 1 + gen() % 3;
+		for (size_t j = 0; j < patternCount; ++j) {
+			auto word = aWords[gen() % aWords.size()];
+			switch (gen() % 4) {
+				// Parts of words and patterns that are too short for the index
+				case 0: word = word.substr(gen() % (word.size() - 2), 3); break;
+				case 1: word = word.substr(0, 2); break;
+				default: break;
+			}
+
+			search.query += (j > 0 ? " " : "") + word;
+		}
+
+		if (gen() % 10 == 0) {
+			search.excluded.push_back(aWords[gen() % aWords.size()]);
+		}
+
+		if (gen() % 10 == 0) {
+			search.extensions.push_back(gen() % 2 == 0 ? "mp3" : "nfo");
+		}
+
+		search.matchType = static_cast<Search::MatchType>(gen() % 3);
+		search.itemType = static_cast<SearchQuery::ItemType>(gen() % 3);
+		ret.push_back(std::move(search));
+	}
+
+	return ret;
+}
+
+// Returns the matching items in a comparable form
+static vector<const void*> match(const ShareTree& aTree, const BenchSearch& aSearch, bool aUseIndex) {
+	SearchQuery query(aSearch.query, aSearch.excluded, aSearch.extensions, aSearch.matchType);
+	query.itemType = aSearch.itemType;
+
+	UserPtr noUser;
+	ShareSearch search(query, BENCH_PROFILE, noUser, ADC_ROOT_STR);
+
+	ShareDirectory::SearchResultInfo::Set results;
+	aTree.matchText(results, search, aUseIndex);
+
+	vector<const void*> ret;
+	for (const auto& r : results) {
+		if (r.getType() == ShareDirectory::SearchResultInfo::DIRECTORY) {
+			ret.push_back(r.directory);
+		} else {
+			ret.push_back(r.file);
+		}
+	}
+
+	ranges::sort(ret);
+	return ret;
+}
+
+// The indexed searches must return exactly the same items as walking through the whole tree
+static size_t verifySearches(const ShareTree& aTree, const vector<BenchSearch>& aSearches, size_t& matches_) {
+	size_t errors = 0;
+	for (const auto& search : aSearches) {
+		auto indexed = match(aTree, search, true);
+		auto walked = match(aTree, search, false);
+		if (indexed != walked) {
+			if (errors < 10) {
+				std::cerr << "Search \"" << search.query << "\" (match type " << static_cast<int>(search.matchType) << ", item type " << static_cast<int>(search.itemType) <<
+					"): " << indexed.size() << " indexed results, " << walked.size() << " results from the full tree" << std::endl;
+			}
+
+			errors++;
+		}
+
+		matches_ += walked.size();
+	}
+
+	return errors;
+}
+
+static void benchSearches(const ShareTree& aTree, const vector<BenchSearch>& aSearches, const BenchOptions& aOptions, BenchResults& results_, size_t& matches_) {
+	for (auto useIndex : { true, false }) {
+		auto seconds = measureBest(aOptions.iterations, [&] {
+			for (const auto& search : aSearches) {
+				matches_ += match(aTree, search, useIndex).size();
+			}
+		});
+
+		results_.addRate("search", useIndex ? "indexed" : "full tree", static_cast<int64_t>(aSearches.size()), seconds);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	BenchOptions options;
+	if (!options.parse(argc, argv, TOOL_NAME, {
+		{ "roots", "Number of share roots (default: 4)" },
+		{ "directories", "Number of directories per root (default: 20000)" },
+		{ "files", "Number of files per directory (default: 10)" },
+		{ "searches", "Number of searches (default: 2000)" },
+	})) {
+		return 1;
+	}
+
+	const auto rootCount = static_cast<size_t>(max(options.getInt("roots", 4), static_cast<int64_t>(1)));
+	const auto directoryCount = static_cast<size_t>(max(options.getInt("directories", 20000), static_cast<int64_t>(1)));
+	const auto fileCount = static_cast<size_t>(max(options.getInt("files", 10), static_cast<int64_t>(0)));
+	const auto searchCount = static_cast<size_t>(max(options.getInt("searches", 2000), static_cast<int64_t>(1)));
+
+	// Keep the settings separate from the real application data
+	const auto rootPath = (options.workPath.empty() ? string("/tmp/") : options.workPath) + TOOL_NAME + "-" + Util::toString(ValueGenerator::rand()) + PATH_SEPARATOR;
+	File::ensureDirectory(rootPath);
+	AppUtil::initialize(rootPath + "config" + PATH_SEPARATOR);
+
+	ResourceManager::newInstance();
+	SettingsManager::newInstance();
+	LogManager::newInstance();
+
+	BenchResults results(TOOL_NAME);
+
+	size_t errors = 0;
+	size_t matches = 0;
+
+	{
+		auto words = createWords(2000);
+
+		ShareTree tree;
+		{
+			std::mt19937 gen(3);
+			size_t itemCount = 0;
+			Stopwatch stopwatch;
+			for (size_t i = 0; i < rootCount; ++i) {
+				auto name = "Root" + Util::toString(i);
+				itemCount += addRoot(tree, rootPath + name + PATH_SEPARATOR, name, directoryCount, fileCount, words, gen);
+			}
+
+			results.addRate("tree", "build and index", static_cast<int64_t>(itemCount), stopwatch.getSeconds());
+			results.addSize("tree", "search index", static_cast<int64_t>(tree.getSearchIndexSize()));
+		}
+
+		auto searches = createSearches(searchCount, words);
+		errors = verifySearches(tree, searches, matches);
+		if (errors > 0) {
+			std::cerr << errors << " of " << searches.size() << " indexed searches returned different results than the full tree search" << std::endl;
+		}
+
+		benchSearches(tree, searches, options, results, matches);
+	}
+
+	LogManager::deleteInstance();
+	SettingsManager::deleteInstance();
+	ResourceManager::deleteInstance();
+
+	try {
+		File::removeDirectoryForced(rootPath);
+	} catch (const FileException& e) {
+		std::cerr << "Failed to remove " << rootPath << ": " << e.getError() << std::endl;
+	}
+
+	std::cout << std::endl << "Checksum: " << matches << std::endl;
+
+	if (!results.save(options.outputPath)) {
+		return 1;
+	}
+
+	std::cout << std::endl << "Results were written to " << options.outputPath << std::endl;
+	return errors > 0 ? 1 : 0;
+}
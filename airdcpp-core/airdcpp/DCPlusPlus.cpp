@@ -92,8 +92,8 @@ void startup(StepFunction aStepF, MessageFunction aMessageF, Callback aRunWizard
 	TimerManager::newInstance();
 	HashManager::newInstance();
 	CryptoManager::newInstance();
-	SearchManager::newInstance();
 	ShareManager::newInstance();
+	SearchManager::newInstance();
 	ClientManager::newInstance();
 	ConnectionManager::newInstance();
 	PrivateChatManager::newInstance();
@@ -195,6 +195,7 @@ void shutdown(StepFunction stepF, ProgressFunction progressF, ShutdownUnloadCall
 	};
 
 	ShareManager::getInstance()->abortRefresh();
+	SearchManager::getInstance()->shutdown();
 
 	announce(STRING(SAVING_HASH_DATA));
 	HashManager::getInstance()->shutdown(progressF);
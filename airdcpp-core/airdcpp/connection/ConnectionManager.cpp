@@ -721,9 +721,10 @@ void ConnectionManager::on(AdcCommand::SUP, UserConnection* aSource, const AdcCo
 	bool tigrOk = false;
 
 	StringList supports;
-	for(auto& i: cmd.getParameters()) {
+	for (size_t n = 0; n < cmd.getParamCount(); ++n) {
+		auto i = cmd.getParamView(n);
 		if(i.compare(0, 2, "AD") == 0) {
-			string feat = i.substr(2);
+			string feat(i.substr(2));
 			if(feat == UserConnection::FEATURE_ADC_BASE || feat == UserConnection::FEATURE_ADC_BAS0) {
 				baseOk = true;
 				// For bas0 tiger is implicit
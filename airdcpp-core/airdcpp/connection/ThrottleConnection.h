@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_THROTTLE_CONNECTION_H
+#define DCPLUSPLUS_DCPP_THROTTLE_CONNECTION_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace dcpp {
+
+// Bandwidth is shared between the classes based on their weight (see ThrottleManager)
+enum class ThrottleClass : uint8_t {
+	FILE_LIST,
+	SMALL_FILE,
+	FILE,
+	OTHER,
+	LAST
+};
+
+// Limiter state of a single connection
+class ThrottleConnection {
+public:
+	enum Direction {
+		DOWN,
+		UP,
+		DIRECTION_LAST
+	};
+
+	ThrottleClass getClass() const noexcept { return throttleClass.load(std::memory_order_relaxed); }
+	void setClass(ThrottleClass aClass) noexcept { throttleClass.store(aClass, std::memory_order_relaxed); }
+private:
+	friend class ThrottleManager;
+
+	// May be changed from other threads
+	std::atomic<ThrottleClass> throttleClass { ThrottleClass::OTHER };
+
+	// The rest is only accessed from the socket thread
+	struct Window {
+		uint64_t window = 0;
+		int64_t bytes = 0;
+		uint64_t activeSecond = 0;
+	};
+
+	Window windows[DIRECTION_LAST];
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_THROTTLE_CONNECTION_H)
@@ -19,20 +19,71 @@
 #include "stdinc.h"
 #include <airdcpp/connection/ThrottleManager.h>
 
-#include <airdcpp/transfer/download/DownloadManager.h>
 #include <airdcpp/connection/socket/Socket.h>
 #include <airdcpp/core/timer/TimerManager.h>
-#include <airdcpp/transfer/upload/UploadManager.h>
+#include <airdcpp/transfer/Transfer.h>
 
 namespace dcpp {
 	// The actual limiting code is from StrongDC++
 	// Bandwidth limiting in DC++ is broken: https://www.airdcpp.net/forum/viewtopic.php?f=7&t=4485&p=8856#p8856
 
-constexpr auto CONDWAIT_TIMEOUT = 250;
+// Bucket capacity
+constexpr int64_t BURST_MS = 100;
+constexpr int64_t MIN_BURST = 16 * 1024;
+
+// Length of the period for sharing the class bandwidth evenly between the connections
+constexpr uint64_t FAIRNESS_WINDOW_MS = 100;
+constexpr int64_t MIN_WINDOW_QUOTA = 4 * 1024;
+
+// Maximum time to wait for tokens before retrying (the limits may have changed meanwhile)
+constexpr int64_t CONDWAIT_TIMEOUT = 250;
+
+// File lists and small files shouldn't need to wait behind bulk transfers
+constexpr int CLASS_WEIGHTS[] = { 4, 4, 1, 1 };
+
+static int64_t getBurst(int64_t aRate) noexcept {
+	return max(aRate * BURST_MS / 1000, MIN_BURST);
+}
+
+	void TokenBucket::refill(uint64_t aTick, int64_t aRate, int64_t aBurst) noexcept {
+		auto last = lastRefill.load(std::memory_order_relaxed);
+		if (aTick <= last || !lastRefill.compare_exchange_strong(last, aTick, std::memory_order_relaxed)) {
+			// Refilled by someone else
+			return;
+		}
+
+		auto add = last == 0 ? aBurst : static_cast<int64_t>(aTick - last) * aRate / 1000;
+		auto cur = tokens.load(std::memory_order_relaxed);
+		while (!tokens.compare_exchange_weak(cur, min(cur + add, aBurst), std::memory_order_relaxed)) {
+			// Retry
+		}
+	}
+
+	int64_t TokenBucket::take(int64_t aWanted) noexcept {
+		auto cur = tokens.load(std::memory_order_relaxed);
+		while (cur > 0) {
+			auto taken = min(cur, aWanted);
+			if (tokens.compare_exchange_weak(cur, cur - taken, std::memory_order_relaxed)) {
+				return taken;
+			}
+		}
+
+		return 0;
+	}
+
+	void TokenBucket::giveBack(int64_t aTokens, int64_t aBurst) noexcept {
+		auto cur = tokens.load(std::memory_order_relaxed);
+		while (!tokens.compare_exchange_weak(cur, max(cur, min(cur + aTokens, aBurst)), std::memory_order_relaxed)) {
+			// Retry
+		}
+	}
 
 	// constructor
 	ThrottleManager::ThrottleManager(void)
 	{
+		updateRates(limiters[ThrottleConnection::DOWN], static_cast<int64_t>(getDownLimit()) * 1024);
+		updateRates(limiters[ThrottleConnection::UP], static_cast<int64_t>(getUpLimit()) * 1024);
+
 		TimerManager::getInstance()->addListener(this);
 	}
 
@@ -41,44 +92,95 @@ constexpr auto CONDWAIT_TIMEOUT = 250;
 	{
 		TimerManager::getInstance()->removeListener(this);
 
-		// release conditional variables on exit
-		downCond.notify_all();
-		upCond.notify_all();
+		// release the waiting connections on exit
+		for (auto& limiter: limiters) {
+			notifyWaiters(limiter);
+		}
+	}
+
+	int64_t ThrottleManager::take(ThrottleConnection& aConn, ThrottleConnection::Direction aDirection, int64_t aWanted) noexcept {
+		auto& limiter = limiters[aDirection];
+		auto& cl = limiter.classes[static_cast<size_t>(aConn.getClass())];
+		auto& window = aConn.windows[aDirection];
+
+		auto second = currentSecond.load(std::memory_order_relaxed);
+		if (window.activeSecond != second) {
+			window.activeSecond = second;
+			cl.activeCurrent.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		auto rate = limiter.rate.load(std::memory_order_relaxed);
+		if (rate == 0) {
+			return aWanted;
+		}
+
+		auto classRate = cl.rate.load(std::memory_order_relaxed);
+		auto tick = GET_TICK();
+		limiter.bucket.refill(tick, rate, getBurst(rate));
+		cl.bucket.refill(tick, classRate, getBurst(classRate));
+
+		auto currentWindow = tick / FAIRNESS_WINDOW_MS;
+		if (window.window != currentWindow) {
+			window.window = currentWindow;
+			window.bytes = 0;
+		}
+
+		// Connections that have used their share may only continue if there are spare tokens
+		auto quota = max(classRate * static_cast<int64_t>(FAIRNESS_WINDOW_MS) / 1000 / max(cl.active.load(std::memory_order_relaxed), 1), MIN_WINDOW_QUOTA);
+		if (window.bytes >= quota && cl.bucket.getTokens() < getBurst(classRate) / 2) {
+			cl.throttled.fetch_add(1, std::memory_order_relaxed);
+			return 0;
+		}
+
+		auto allowed = min(aWanted, window.bytes < quota ? quota - window.bytes : quota);
+
+		// Borrow the bandwidth that isn't used by the other classes
+		auto fromClass = cl.bucket.take(allowed);
+		auto borrowed = fromClass < allowed && limiter.bucket.getTokens() > getBurst(rate) / 2 ? allowed - fromClass : 0;
+
+		auto taken = limiter.bucket.take(fromClass + borrowed);
+		if (taken < fromClass) {
+			cl.bucket.giveBack(fromClass - taken, getBurst(classRate));
+		}
+
+		if (taken == 0) {
+			cl.throttled.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		return taken;
+	}
+
+	void ThrottleManager::consumed(ThrottleConnection& aConn, ThrottleConnection::Direction aDirection, int64_t aTaken, int64_t aUsed) noexcept {
+		auto& limiter = limiters[aDirection];
+		auto& cl = limiter.classes[static_cast<size_t>(aConn.getClass())];
+		auto rate = limiter.rate.load(std::memory_order_relaxed);
+		if (aUsed < aTaken && rate > 0) {
+			limiter.bucket.giveBack(aTaken - aUsed, getBurst(rate));
+			cl.bucket.giveBack(aTaken - aUsed, getBurst(cl.rate.load(std::memory_order_relaxed)));
+			notifyWaiters(limiter);
+		}
+
+		aConn.windows[aDirection].bytes += aUsed;
+		cl.bytes.fetch_add(aUsed, std::memory_order_relaxed);
 	}
 
 	/*
 	 * Limits a traffic and reads a packet from the network
 	 */
-	int ThrottleManager::read(Socket* sock, void* buffer, size_t len)
+	int ThrottleManager::read(Socket* sock, ThrottleConnection& aConn, void* buffer, size_t len, bool aWait)
 	{
-		size_t downs = DownloadManager::getInstance()->getTotalDownloadConnectionCount();
-		if (getDownLimit() == 0 || downs == 0)
-			return sock->read(buffer, len);
-
-		unique_lock<mutex> lock(downMutex);
-
-
-		if(downTokens > 0)
-		{
-			size_t slice = (getDownLimit() * 1024) / downs;
-			auto readSize = static_cast<int>(min(slice, min(len, downTokens)));
-				
-			// read from socket
-			readSize = sock->read(buffer, readSize);
-				
-			if(readSize > 0)
-				downTokens -= readSize;
-
-			// next code can't be in critical section, so we must unlock here
-			lock.unlock();
-
-			// give a chance to other transfers to get a token
-			Thread::yield();
+		auto taken = take(aConn, ThrottleConnection::DOWN, static_cast<int64_t>(len));
+		if (taken > 0) {
+			auto readSize = sock->read(buffer, static_cast<size_t>(taken));
+			consumed(aConn, ThrottleConnection::DOWN, taken, max(readSize, 0));
 			return readSize;
 		}
 
+		if (!aWait)
+			return THROTTLED;
+
 		// no tokens, wait for them
-		downCond.wait_for(lock, std::chrono::milliseconds(CONDWAIT_TIMEOUT));
+		waitTokens(ThrottleConnection::DOWN);
 		return -1;	// from BufferedSocket: -1 = retry, 0 = connection close
 	}
 	
@@ -86,36 +188,133 @@ constexpr auto CONDWAIT_TIMEOUT = 250;
 	 * Limits a traffic and writes a packet to the network
 	 * We must handle this a little bit differently than downloads, because of that stupidity in OpenSSL
 	 */		
-	int ThrottleManager::write(Socket* sock, void* buffer, size_t& len)
+	int ThrottleManager::write(Socket* sock, ThrottleConnection& aConn, void* buffer, size_t& len, bool aWait)
 	{
-		size_t ups = UploadManager::getInstance()->getUploadCount();
-		if(getUpLimit() == 0 || ups == 0)
-			return sock->write(buffer, len);
-		
-		unique_lock<mutex> lock(upMutex);
-		
-		if(upTokens > 0)
-		{
-			size_t slice = (getUpLimit() * 1024) / ups;
-			len = min(slice, min(len, upTokens));
-			upTokens -= len;
+		return limitWrite(aConn, len, [&] { return sock->write(buffer, len); }, aWait);
+	}
 
-			// next code can't be in critical section, so we must unlock here
-			lock.unlock();
+	int ThrottleManager::sendFile(Socket* sock, ThrottleConnection& aConn, const File& aFile, int64_t aPos, size_t& len, bool aWait)
+	{
+		return limitWrite(aConn, len, [&] { return sock->sendFile(aFile, aPos, len); }, aWait);
+	}
 
-			// write to socket			
-			int sent = sock->write(buffer, len);
+	int ThrottleManager::limitWrite(ThrottleConnection& aConn, size_t& len, const function<int ()>& aWriteF, bool aWait)
+	{
+		auto taken = take(aConn, ThrottleConnection::UP, static_cast<int64_t>(len));
+		if (taken > 0) {
+			len = static_cast<size_t>(taken);
 
-			// give a chance to other transfers to get a token
-			Thread::yield();
+			auto sent = aWriteF();
+			consumed(aConn, ThrottleConnection::UP, taken, max(sent, 0));
 			return sent;
 		}
-		
+
+		if (!aWait)
+			return 0;
+
 		// no tokens, wait for them
-		upCond.wait_for(lock, std::chrono::milliseconds(CONDWAIT_TIMEOUT));
+		waitTokens(ThrottleConnection::UP);
 		return 0;	// from BufferedSocket: -1 = failed, 0 = retry
 	}
 
+	int64_t ThrottleManager::getRetryDelay(ThrottleConnection::Direction aDirection) const noexcept {
+		const auto& limiter = limiters[aDirection];
+		auto rate = limiter.rate.load(std::memory_order_relaxed);
+		if (rate == 0) {
+			return 0;
+		}
+
+		// Tokens are added continuously, wait until there's enough for a reasonable write
+		// (or until the next fairness window if that's sooner)
+		auto tick = GET_TICK();
+		auto missing = max(MIN_WINDOW_QUOTA - limiter.bucket.getTokens(), static_cast<int64_t>(1));
+		auto waitMs = min(missing * 1000 / rate + 1, static_cast<int64_t>(FAIRNESS_WINDOW_MS - tick % FAIRNESS_WINDOW_MS));
+		return min(waitMs, CONDWAIT_TIMEOUT);
+	}
+
+	void ThrottleManager::waitTokens(ThrottleConnection::Direction aDirection) noexcept {
+		auto waitMs = getRetryDelay(aDirection);
+		if (waitMs == 0) {
+			return;
+		}
+
+		auto& limiter = limiters[aDirection];
+		unique_lock<mutex> lock(limiter.waitMutex);
+		limiter.waiters.fetch_add(1, std::memory_order_relaxed);
+		limiter.waitCond.wait_for(lock, std::chrono::milliseconds(waitMs));
+		limiter.waiters.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	void ThrottleManager::notifyWaiters(DirectionLimiter& aLimiter) noexcept {
+		if (aLimiter.waiters.load(std::memory_order_relaxed) == 0) {
+			return;
+		}
+
+		{
+			// Don't notify between the waiter registering itself and starting to wait
+			lock_guard<mutex> lock(aLimiter.waitMutex);
+		}
+
+		aLimiter.waitCond.notify_all();
+	}
+
+	void ThrottleManager::updateRates(DirectionLimiter& aLimiter, int64_t aRate) noexcept {
+		aLimiter.rate.store(aRate, std::memory_order_relaxed);
+
+		// Classes without connections are counted in so that new connections get their share immediately
+		int activeWeight = 0;
+		for (size_t i = 0; i < CLASS_COUNT; ++i) {
+			if (aLimiter.classes[i].active.load(std::memory_order_relaxed) > 0) {
+				activeWeight += CLASS_WEIGHTS[i];
+			}
+		}
+
+		for (size_t i = 0; i < CLASS_COUNT; ++i) {
+			auto& cl = aLimiter.classes[i];
+			auto weight = activeWeight + (cl.active.load(std::memory_order_relaxed) > 0 ? 0 : CLASS_WEIGHTS[i]);
+			cl.rate.store(aRate * CLASS_WEIGHTS[i] / weight, std::memory_order_relaxed);
+		}
+	}
+
+	ThrottleManager::ClassStats ThrottleManager::getClassStats(ThrottleConnection::Direction aDirection, ThrottleClass aClass) const noexcept {
+		const auto& cl = limiters[aDirection].classes[static_cast<size_t>(aClass)];
+
+		ClassStats ret;
+		ret.bytes = cl.bytes.load(std::memory_order_relaxed);
+		ret.throttled = cl.throttled.load(std::memory_order_relaxed);
+		ret.connections = cl.active.load(std::memory_order_relaxed);
+		ret.rate = limiters[aDirection].rate.load(std::memory_order_relaxed) > 0 ? cl.rate.load(std::memory_order_relaxed) : 0;
+		return ret;
+	}
+
+	ThrottleClass ThrottleManager::getTransferClass(const Transfer& aTransfer) noexcept {
+		switch (aTransfer.getType()) {
+			case Transfer::TYPE_FULL_LIST:
+			case Transfer::TYPE_PARTIAL_LIST:
+			case Transfer::TYPE_TTH_LIST:
+				return ThrottleClass::FILE_LIST;
+			case Transfer::TYPE_TREE:
+				return ThrottleClass::SMALL_FILE;
+			default:
+				break;
+		}
+
+		if (aTransfer.getSegmentSize() <= static_cast<int64_t>(SETTING(SET_MINISLOT_SIZE)) * 1024) {
+			return ThrottleClass::SMALL_FILE;
+		}
+
+		return ThrottleClass::FILE;
+	}
+
+	const char* ThrottleManager::getClassName(ThrottleClass aClass) noexcept {
+		switch (aClass) {
+			case ThrottleClass::FILE_LIST: return "file_list";
+			case ThrottleClass::SMALL_FILE: return "small_file";
+			case ThrottleClass::FILE: return "file";
+			default: return "other";
+		}
+	}
+
 	void ThrottleManager::setSetting(SettingsManager::IntSetting setting, int value) noexcept {
 		if (value < 0 || value > MAX_LIMIT)
 			value = 0;
@@ -161,24 +360,22 @@ constexpr auto CONDWAIT_TIMEOUT = 250;
 
 	// TimerManagerListener
 	void ThrottleManager::on(TimerManagerListener::Second, uint64_t /*aTick*/) noexcept {
-		auto downLimit = getDownLimit() * 1024;
-		auto upLimit = getUpLimit() * 1024;
-		
-		// readd tokens
-		if(downLimit > 0)
-		{
-			lock_guard<mutex> lock(downMutex);
-			downTokens = downLimit;
-			downCond.notify_all();
+		// Tokens are refilled when they are taken, only the active connections and bandwidth shares are updated here
+		currentSecond.fetch_add(1, std::memory_order_relaxed);
+		for (auto& limiter: limiters) {
+			for (auto& cl: limiter.classes) {
+				cl.active.store(cl.activeCurrent.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+			}
 		}
-			
-		if(upLimit > 0)
-		{
-			lock_guard<mutex> lock(upMutex);
-			upTokens = upLimit;
-			upCond.notify_all();
+
+		updateRates(limiters[ThrottleConnection::DOWN], static_cast<int64_t>(getDownLimit()) * 1024);
+		updateRates(limiters[ThrottleConnection::UP], static_cast<int64_t>(getUpLimit()) * 1024);
+
+		// The limits may have changed
+		for (auto& limiter: limiters) {
+			notifyWaiters(limiter);
 		}
 	}
 
 
-}	// namespace dcpp
\ No newline at end of file
+}	// namespace dcpp
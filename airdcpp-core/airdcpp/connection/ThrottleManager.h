@@ -19,6 +19,7 @@
 #ifndef DCPLUSPLUS_DCPP_THROTTLEMANAGER_H
 #define DCPLUSPLUS_DCPP_THROTTLEMANAGER_H
 
+#include <airdcpp/connection/ThrottleConnection.h>
 #include <airdcpp/core/Singleton.h>
 #include <airdcpp/settings/SettingsManager.h>
 #include <airdcpp/core/timer/TimerManagerListener.h>
@@ -26,13 +27,38 @@
 #include <condition_variable>
 #include <mutex>
 
-
 namespace dcpp
 {
-	
+	class Transfer;
+
+	/*
+	 * Lock-free token bucket that is refilled based on the elapsed milliseconds
+	 */
+	class TokenBucket
+	{
+	public:
+		// Adds the tokens for the time passed since the previous refill (aRate is in bytes per second)
+		void refill(uint64_t aTick, int64_t aRate, int64_t aBurst) noexcept;
+
+		// Returns the number of tokens that were taken (may be less than wanted)
+		int64_t take(int64_t aWanted) noexcept;
+
+		// Returns unused tokens (the bucket won't exceed aBurst)
+		void giveBack(int64_t aTokens, int64_t aBurst) noexcept;
+
+		int64_t getTokens() const noexcept { return tokens.load(std::memory_order_relaxed); }
+	private:
+		atomic<int64_t> tokens { 0 };
+		atomic<uint64_t> lastRefill { 0 };
+	};
+
 	/**
 	 * Manager for throttling traffic flow speed.
 	 * Inspired by Token Bucket algorithm: http://en.wikipedia.org/wiki/Token_bucket
+	 *
+	 * The limiter is hierarchical: the global limit is shared between the connection classes based on their weights
+	 * (only the classes with active connections are counted) and the class bandwidth is shared evenly between its connections.
+	 * Bandwidth that isn't used by other classes or connections may be borrowed.
 	 */
 	class ThrottleManager :
 		public Singleton<ThrottleManager>, private TimerManagerListener
@@ -41,14 +67,27 @@ namespace dcpp
 
 		/*
 		 * Limits a traffic and reads a packet from the network
+		 * If there are no tokens left, waits for them (aWait) or returns THROTTLED
 		 */
-		int read(Socket* sock, void* buffer, size_t len);
+		int read(Socket* sock, ThrottleConnection& aConn, void* buffer, size_t len, bool aWait = true);
 		
 		/*
 		 * Limits a traffic and writes a packet to the network
 		 * We must handle this a little bit differently than downloads, because of that stupidity in OpenSSL
+		 * Returns 0 if there are no tokens left (after waiting for them if aWait is set)
 		 */		
-		int write(Socket* sock, void* buffer, size_t& len);
+		int write(Socket* sock, ThrottleConnection& aConn, void* buffer, size_t& len, bool aWait = true);
+
+		/*
+		 * Limits a traffic and sends data from a file to the network without copying it via user space
+		 */
+		int sendFile(Socket* sock, ThrottleConnection& aConn, const File& aFile, int64_t aPos, size_t& len, bool aWait = true);
+
+		// Returned by read if there are no tokens left and waiting wasn't allowed
+		static constexpr int THROTTLED = -2;
+
+		// Milliseconds until new tokens should be available after a throttled transfer
+		int64_t getRetryDelay(ThrottleConnection::Direction aDirection) const noexcept;
 
 		/*
 		 * Returns current download limit.
@@ -64,18 +103,71 @@ namespace dcpp
 		static void setSetting(SettingsManager::IntSetting setting, int value) noexcept;
 
 		static const int MAX_LIMIT = 1024 * 1024; // 1 GiB/s
+
+		// Class for a transfer that is about to be started
+		static ThrottleClass getTransferClass(const Transfer& aTransfer) noexcept;
+		static const char* getClassName(ThrottleClass aClass) noexcept;
+
+		struct ClassStats {
+			int64_t bytes = 0;
+
+			// Number of times when a connection had to wait for tokens
+			int64_t throttled = 0;
+
+			// Connections that have transferred data during the previous second
+			int connections = 0;
+
+			// Current bandwidth share (bytes per second, 0 if unlimited)
+			int64_t rate = 0;
+		};
+
+		ClassStats getClassStats(ThrottleConnection::Direction aDirection, ThrottleClass aClass) const noexcept;
 	private:
-		
-		// download limiter
-		size_t				downTokens = 0;
-		condition_variable	downCond;
-		mutex				downMutex;
-		
-		// upload limiter
-		size_t				upTokens = 0;
-		condition_variable	upCond;
-		mutex				upMutex;
-			
+		static constexpr auto CLASS_COUNT = static_cast<size_t>(ThrottleClass::LAST);
+
+		struct ClassLimiter {
+			TokenBucket bucket;
+			atomic<int64_t> rate { 0 };
+
+			// Connections that have transferred data during the current/previous second
+			atomic<int> activeCurrent { 0 };
+			atomic<int> active { 0 };
+
+			atomic<int64_t> bytes { 0 };
+			atomic<int64_t> throttled { 0 };
+		};
+
+		struct DirectionLimiter {
+			TokenBucket bucket;
+
+			// Bytes per second, 0 if unlimited
+			atomic<int64_t> rate { 0 };
+			ClassLimiter classes[CLASS_COUNT];
+
+			// Connections waiting for tokens
+			condition_variable waitCond;
+			mutex waitMutex;
+			atomic<int> waiters { 0 };
+		};
+
+		// Returns the number of bytes that may be transferred (0 if the connection should wait)
+		int64_t take(ThrottleConnection& aConn, ThrottleConnection::Direction aDirection, int64_t aWanted) noexcept;
+
+		// Returns the tokens that weren't used and updates the statistics
+		void consumed(ThrottleConnection& aConn, ThrottleConnection::Direction aDirection, int64_t aTaken, int64_t aUsed) noexcept;
+
+		// Takes the upload tokens for the next write (len is adjusted accordingly) and performs the write
+		int limitWrite(ThrottleConnection& aConn, size_t& len, const function<int ()>& aWriteF, bool aWait);
+
+		// Waits until new tokens should be available (or until someone returns tokens)
+		void waitTokens(ThrottleConnection::Direction aDirection) noexcept;
+		static void notifyWaiters(DirectionLimiter& aLimiter) noexcept;
+
+		void updateRates(DirectionLimiter& aLimiter, int64_t aRate) noexcept;
+
+		DirectionLimiter limiters[ThrottleConnection::DIRECTION_LAST];
+		atomic<uint64_t> currentSecond { 1 };
+
 		friend class Singleton<ThrottleManager>;
 		
 		// constructor
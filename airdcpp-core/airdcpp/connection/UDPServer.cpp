@@ -73,9 +73,38 @@ void UDPServer::addTask(Callback&& aTask) noexcept {
 }
 
 constexpr auto BUFSIZE = 8192;
+constexpr size_t READ_BATCH_SIZE = 32;
+constexpr size_t MAX_POOLED_BUFFERS = 256;
+
+void UDPServer::allocateBuffers(DatagramList& aPackets) noexcept {
+	Lock l(poolCS);
+	for (auto& packet: aPackets) {
+		if (!packet.buffer.empty()) {
+			continue;
+		}
+
+		if (!bufferPool.empty()) {
+			packet.buffer = std::move(bufferPool.back());
+			bufferPool.pop_back();
+		} else {
+			packet.buffer.resize(BUFSIZE);
+		}
+	}
+}
+
+void UDPServer::releaseBuffers(DatagramList& aPackets) noexcept {
+	Lock l(poolCS);
+	for (auto& packet: aPackets) {
+		if (bufferPool.size() >= MAX_POOLED_BUFFERS) {
+			break;
+		}
+
+		bufferPool.push_back(std::move(packet.buffer));
+	}
+}
+
 int UDPServer::run() {
-	int len;
-	string remoteAddr;
+	DatagramList packets(READ_BATCH_SIZE);
 
 	while(!stop) {
 		try {
@@ -83,9 +112,22 @@ int UDPServer::run() {
 				continue;
 			}
 
-			auto buffer = vector<uint8_t>(BUFSIZE);
-			if((len = socket->read(buffer.data(), BUFSIZE, remoteAddr)) > 0) {
-				pp.addTask([buf = std::move(buffer), len, remoteAddr, this] { handlePacket(buf, len, remoteAddr); });
+			allocateBuffers(packets);
+
+			auto count = socket->readBatch(packets.data(), packets.size());
+			if (count > 0) {
+				// Handle the whole batch with a single task
+				DatagramList received(std::make_move_iterator(packets.begin()), std::make_move_iterator(packets.begin() + count));
+				pp.addTask([received = std::move(received), this]() mutable {
+					for (const auto& packet: received) {
+						if (packet.length > 0) {
+							handlePacket(packet.buffer, packet.length, packet.ip);
+						}
+					}
+
+					releaseBuffers(received);
+				});
+
 				continue;
 			}
 		} catch(const SocketException& e) {
@@ -159,16 +201,16 @@ void UDPServer::handlePacket(const ByteVector& aBuf, size_t aLen, const string&
 	}
 
 	// Dispatch without newline
-	dispatch(x.substr(0, x.length() - 1), false, [&aRemoteIp](const AdcCommand& aCmd) {
+	dispatch(string_view(x).substr(0, x.length() - 1), false, [&aRemoteIp](const AdcCommand& aCmd) {
 		ProtocolCommandManager::getInstance()->fire(ProtocolCommandManagerListener::IncomingUDPCommand(), aCmd, aRemoteIp);
 	}, aRemoteIp);
 }
 
 void UDPServer::handle(AdcCommand::RES, AdcCommand& c, const string& aRemoteIp) noexcept {
-	if (c.getParameters().empty())
+	if (c.getParamCount() == 0)
 		return;
 
-	string cid = c.getParam(0);
+	auto cid = string(c.getParamView(0));
 	if (cid.size() != 39)
 		return;
 
@@ -177,8 +219,7 @@ void UDPServer::handle(AdcCommand::RES, AdcCommand& c, const string& aRemoteIp)
 		return;
 
 	// Remove the CID
-	// This should be handled by AdcCommand really...
-	c.getParameters().erase(c.getParameters().begin());
+	c.removeParam(0);
 
 	SearchManager::getInstance()->onRES(c, user, aRemoteIp);
 }
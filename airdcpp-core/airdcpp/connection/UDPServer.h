@@ -20,7 +20,9 @@
 #define DCPLUSPLUS_DCPP_UDP_SERVER_H
 
 #include <airdcpp/protocol/AdcCommand.h>
+#include <airdcpp/connection/socket/Socket.h>
 #include <airdcpp/core/queue/DispatcherQueue.h>
+#include <airdcpp/core/thread/CriticalSection.h>
 
 namespace dcpp {
 
@@ -47,6 +49,15 @@ private:
 	DispatcherQueue pp;
 	void handlePacket(const ByteVector& aBuf, size_t aLen, const string& aRemoteIp);
 
+	using DatagramList = vector<Socket::Datagram>;
+
+	// Packets are read in batches into pooled buffers
+	void allocateBuffers(DatagramList& aPackets) noexcept;
+	void releaseBuffers(DatagramList& aPackets) noexcept;
+
+	CriticalSection poolCS;
+	vector<ByteVector> bufferPool;
+
 	// Search results
 	void handle(AdcCommand::RES, AdcCommand& c, const string& aRemoteIp) noexcept;
 
@@ -55,7 +55,7 @@ const string UserConnection::FILE_NOT_AVAILABLE = "File Not Available";
 const string UserConnection::UPLOAD = "Upload";
 const string UserConnection::DOWNLOAD = "Download";
 
-void UserConnection::on(BufferedSocketListener::Line, const string& aLine) noexcept {
+void UserConnection::on(BufferedSocketListener::Line, string_view aLine) noexcept {
 
 	COMMAND_DEBUG(aLine, ProtocolCommandManager::TYPE_CLIENT, ProtocolCommandManager::INCOMING, getRemoteIp());
 	
@@ -74,7 +74,7 @@ void UserConnection::on(BufferedSocketListener::Line, const string& aLine) noexc
 		});
 		return;
 	} else if(aLine[0] == '$') {
-		onNmdcLine(aLine);
+		onNmdcLine(string(aLine));
 		setFlag(FLAG_NMDC);
 	} else {
 		// We shouldn't be here?
@@ -189,6 +189,12 @@ void UserConnection::setUseLimiter(bool aEnabled) noexcept {
 	}
 }
 
+void UserConnection::setThrottleClass(ThrottleClass aClass) noexcept {
+	if (socket) {
+		socket->setThrottleClass(aClass);
+	}
+}
+
 void UserConnection::setState(States aNewState) noexcept {
 	if (aNewState == state) {
 		return;
@@ -410,7 +416,7 @@ void UserConnection::sendSupports(const StringList& feat) {
 }
 
 void UserConnection::handle(AdcCommand::STA t, const AdcCommand& c) {
-	if(c.getParameters().size() >= 2) {
+	if(c.getParamCount() >= 2) {
 		const string& code = c.getParam(0);
 		if(!code.empty() && code[0] - '0' == AdcCommand::SEV_FATAL) {
 			fire(UserConnectionListener::ProtocolError(), this, c.getParam(1));
@@ -222,6 +222,7 @@ public:
 	}
 
 	void setUseLimiter(bool aEnabled) noexcept;
+	void setThrottleClass(ThrottleClass aClass) noexcept;
 	void setState(States aNewState) noexcept;
 	UserConnectionToken getToken() const noexcept { return token; }
 private:
@@ -249,7 +250,7 @@ private:
 	void send(const string& aString);
 
 	void on(BufferedSocketListener::Connected) noexcept override;
-	void on(BufferedSocketListener::Line, const string&) noexcept override;
+	void on(BufferedSocketListener::Line, string_view) noexcept override;
 	void on(BufferedSocketListener::Data, uint8_t* data, size_t len) noexcept override;
 	void on(BufferedSocketListener::BytesSent, size_t bytes, size_t actual) noexcept override;
 	void on(BufferedSocketListener::ModeChange) noexcept override;
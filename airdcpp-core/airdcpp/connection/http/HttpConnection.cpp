@@ -170,13 +170,15 @@ void HttpConnection::on(BufferedSocketListener::Connected) noexcept {
 	if (connType == TYPE_POST) socket->write(requestBody);
 }
 
-void HttpConnection::on(BufferedSocketListener::Line, const string& aLine) noexcept {
-	if(connState == CONN_CHUNKED && aLine.size() > 1) {
+void HttpConnection::on(BufferedSocketListener::Line, string_view aLine) noexcept {
+	const string line(aLine);
+
+	if(connState == CONN_CHUNKED && line.size() > 1) {
 		string::size_type i;
 		string chunkSizeStr;
-		if((i = aLine.find(';')) == string::npos) {
-			chunkSizeStr = aLine.substr(0, aLine.length() - 1);
-		} else chunkSizeStr = aLine.substr(0, i);
+		if((i = line.find(';')) == string::npos) {
+			chunkSizeStr = line.substr(0, line.length() - 1);
+		} else chunkSizeStr = line.substr(0, i);
 
 		unsigned long chunkSize = strtoul(chunkSizeStr.c_str(), NULL, 16);
 		if(chunkSize == 0 || chunkSize == ULONG_MAX) {
@@ -193,14 +195,14 @@ void HttpConnection::on(BufferedSocketListener::Line, const string& aLine) noexc
 			if (isUnique) { delete this; return; }
 		} else socket->setDataMode(chunkSize);
 	} else if(connState == CONN_UNKNOWN) {
-		if(aLine.find("200") != string::npos) {
+		if(line.find("200") != string::npos) {
 			connState = CONN_OK;
-		} else if(aLine.find("301") != string::npos || aLine.find("302") != string::npos) {
+		} else if(line.find("301") != string::npos || line.find("302") != string::npos) {
 			connState = CONN_MOVED; 
 		} else {
 			abortRequest(true);
 		
-			auto error = aLine;
+			auto error = line;
 			if (error.length() > 1 && error.back() == '\r') {
 				error.pop_back(); // These would cause issues in HTTP messages
 			}
@@ -209,10 +211,10 @@ void HttpConnection::on(BufferedSocketListener::Line, const string& aLine) noexc
 			if (isUnique) { delete this; return; }
 			connState = CONN_FAILED;
 		}
-	} else if(connState == CONN_MOVED && Util::findSubString(aLine, "Location") != string::npos) {
+	} else if(connState == CONN_MOVED && Util::findSubString(line, "Location") != string::npos) {
 		abortRequest(true);
 
-		string location = aLine.substr(10, aLine.length() - 10);
+		string location = line.substr(10, line.length() - 10);
 		LinkUtil::sanitizeUrl(location);
 
 		// make sure we can also handle redirects with relative paths
@@ -244,19 +246,19 @@ void HttpConnection::on(BufferedSocketListener::Line, const string& aLine) noexc
 		fire(HttpConnectionListener::Redirected(), this, location);
 
 		downloadFile(location);
-	} else if(aLine[0] == 0x0d) {
+	} else if(line[0] == 0x0d) {
 		if(size != -1) {
 			socket->setDataMode(size);
 		} else connState = CONN_CHUNKED;
-	} else if (aLine.length() > 2) {
+	} else if (line.length() > 2) {
 		// Header
-		auto separator = aLine.find_first_of(':');
+		auto separator = line.find_first_of(':');
 		if (separator <= 1) {
 			return;
 		}
 
-		auto name = boost::algorithm::trim_copy(aLine.substr(0, separator));
-		auto value = boost::algorithm::trim_copy(aLine.substr(separator + 1));
+		auto name = boost::algorithm::trim_copy(line.substr(0, separator));
+		auto value = boost::algorithm::trim_copy(line.substr(separator + 1));
 
 		if (name == "Content-Length") {
 			size = Util::toInt(value);
@@ -81,7 +81,7 @@ private:
 
 	// BufferedSocketListener
 	void on(BufferedSocketListener::Connected) noexcept override;
-	void on(BufferedSocketListener::Line, const string&) noexcept override;
+	void on(BufferedSocketListener::Line, string_view) noexcept override;
 	void on(BufferedSocketListener::Data, uint8_t*, size_t) noexcept override;
 	void on(BufferedSocketListener::ModeChange) noexcept override;
 	void on(BufferedSocketListener::Failed, const string&) noexcept override;
@@ -20,12 +20,13 @@
 #include <airdcpp/connection/socket/BufferedSocket.h>
 
 #include <algorithm>
-
-#include <boost/scoped_array.hpp>
+#include <cstring>
 
 #include <airdcpp/connectivity/ConnectivityManager.h>
 #include <airdcpp/settings/SettingsManager.h>
+#include <airdcpp/connection/socket/SocketReactor.h>
 #include <airdcpp/connection/socket/SSLSocket.h>
+#include <airdcpp/core/io/File.h>
 #include <airdcpp/core/io/stream/StreamBase.h>
 #include <airdcpp/connection/ThrottleManager.h>
 #include <airdcpp/core/timer/TimerManager.h>
@@ -38,9 +39,65 @@ using std::max;
 
 // Polling is used for tasks...should be fixed...
 constexpr auto POLL_TIMEOUT = 250;
+constexpr auto SEND_RETRY_DELAY = 10;
+
+// Reactor mode limits, other sockets are served before continuing
+constexpr int MAX_READS_PER_EVENT = 16;
+constexpr size_t MAX_SEND_PER_EVENT = 512 * 1024;
+
+// Decompression buffer for MODE_ZPIPE
+constexpr size_t INFLATE_BUF_SIZE = 64 * 1024;
+
+struct BufferedSocket::ReactorState {
+	SocketReactor* reactor = nullptr;
+	bool registered = false;
+
+	// Current epoll interest
+	bool readInterest = true;
+	bool writeInterest = false;
+
+	// Waiting for tokens from ThrottleManager
+	bool readThrottled = false;
+	bool writeThrottled = false;
+
+	// The blocked write can continue only after the socket is readable (TLS)
+	bool writeWaitingRead = false;
+
+	// Work waiting for the strand (protected by cs)
+	int pendingWork = 0;
+	bool strandQueued = false;
+
+	// Graceful disconnect after the queued data has been sent
+	bool disconnectPending = false;
+
+	// Position in sendBuf
+	size_t sendPos = 0;
+
+	// Number of bytes in writeBuf that were queued before the file
+	size_t preFileBytes = 0;
+
+	// File being sent
+	InputStream* fileStream = nullptr;
+	size_t sockSize = 0;
+	size_t bufSize = 0;
+
+	// Zero-copy
+	const File* directFile = nullptr;
+	int64_t filePos = 0;
+	int64_t fileBytesLeft = 0;
+
+	// Buffered
+	ByteVector fileBuf;
+	size_t fileBufPos = 0;
+	size_t retryWriteSize = 0;
+};
 
 BufferedSocket::BufferedSocket(char aSeparator, bool v4only) :
-separator(aSeparator), v4only(v4only) {
+separator(aSeparator), v4only(v4only), reactorMode(SETTING(USE_SOCKET_REACTOR) && SocketReactor::isSupported()) {
+	if (reactorMode) {
+		reactorState = make_unique<ReactorState>();
+	}
+
 	++sockets;
 }
 
@@ -50,6 +107,13 @@ BufferedSocket::~BufferedSocket() {
 	--sockets;
 }
 
+void BufferedSocket::waitShutdown() noexcept {
+	while(sockets > 0)
+		Thread::sleep(100);
+
+	SocketReactor::shutdown();
+}
+
 void BufferedSocket::disconnect(bool graceless) noexcept {
 	Lock l(cs); 
 	if (graceless) 
@@ -208,38 +272,33 @@ void BufferedSocket::threadAccept() {
 	}
 }
 
-void BufferedSocket::threadRead() {
+int BufferedSocket::threadRead() {
 	if(state != RUNNING)
-		return;
+		return -1;
 
-	int left = (mode == MODE_DATA && useLimiter) ? ThrottleManager::getInstance()->read(sock.get(), &inbuf[0], inbuf.size()) : sock->read(&inbuf[0], inbuf.size());
-	if(left == -1) {
+	// The event loop can't wait for download tokens
+	int left = (mode == MODE_DATA && useLimiter) ? ThrottleManager::getInstance()->read(sock.get(), throttle, &inbuf[0], inbuf.size(), !reactorMode) : sock->read(&inbuf[0], inbuf.size());
+	if(left == -1 || left == ThrottleManager::THROTTLED) {
 		// EWOULDBLOCK, no data received...
-		return;
+		return left;
 	} else if(left == 0) {
 		// This socket has been closed...
 		throw SocketException(STRING(CONNECTION_CLOSED));
 	}
 
-	string::size_type pos = 0;
-	// always uncompressed data
-	string l;
 	int bufpos = 0, total = left;
 
 	while (left > 0) {
 		switch (mode) {
 			case MODE_ZPIPE: {
-					const int BUF_SIZE = 1024;
-					// Special to autodetect nmdc connections...
-					boost::scoped_array<char> buffer(new char[BUF_SIZE]);
-					l = line;
-					// decompress all input data and store in l.
+					// decompress all input data and split it into lines
+					inflateBuf.resize(INFLATE_BUF_SIZE);
 					while (left) {
-						size_t in = BUF_SIZE;
+						size_t in = inflateBuf.size();
 						size_t used = left;
-						bool ret = (*filterIn) (&inbuf[0] + total - left, used, &buffer[0], in);
+						bool ret = (*filterIn) (&inbuf[0] + total - left, used, &inflateBuf[0], in);
 						left -= used;
-						l.append (&buffer[0], in);
+						splitLines(reinterpret_cast<const char*>(&inflateBuf[0]), in, false);
 						// if the stream ends before the data runs out, keep remainder of data in inbuf
 						if (!ret) {
 							bufpos = total-left;
@@ -247,43 +306,24 @@ void BufferedSocket::threadRead() {
 							break;
 						}
 					}
-					// process all lines
-					while ((pos = l.find(separator)) != string::npos) {
-                       	if(pos > 0) // check empty (only pipe) command and don't waste cpu with it ;o)
-							fire(BufferedSocketListener::Line(), l.substr(0, pos));
-						l.erase (0, pos + 1 /* separator char */);
-					}
-					// store remainder
-					line = l;
-
 					break;
 				}
-			case MODE_LINE:
-				// Special to autodetect nmdc connections...
-				if(separator == 0) {
-					if(inbuf[0] == '$') {
-						separator = '|';
-					} else {
-						separator = '\n';
-					}
-				}
-				l = line + string ((char*)&inbuf[bufpos], left);
-				while ((pos = l.find(separator)) != string::npos) {
-	                if(pos > 0) // check empty (only pipe) command and don't waste cpu with it ;o)
-						fire(BufferedSocketListener::Line(), l.substr(0, pos));
-					l.erase (0, pos + 1 /* separator char */);
-					if (l.length() < (size_t)left) left = l.length();
-					if (mode != MODE_LINE) {
-						// we changed mode; remainder of l is invalid.
-						l.clear();
-						bufpos = total - left;
-						break;
+			case MODE_LINE: {
+					// Special to autodetect nmdc connections...
+					if(separator == 0) {
+						if(inbuf[0] == '$') {
+							separator = '|';
+						} else {
+							separator = '\n';
+						}
 					}
+
+					// the remainder is processed in the new mode if a listener changes it
+					auto processed = splitLines(reinterpret_cast<const char*>(&inbuf[bufpos]), left, true);
+					bufpos += static_cast<int>(processed);
+					left -= static_cast<int>(processed);
+					break;
 				}
-				if (pos == string::npos) 
-					left = 0;
-				line = l;
-				break;
 			case MODE_DATA:
 				while(left > 0) {
 					if(dataBytes == -1) {
@@ -312,6 +352,37 @@ void BufferedSocket::threadRead() {
 	if(mode == MODE_LINE && line.size() > static_cast<size_t>(SETTING(MAX_COMMAND_LENGTH))) {
 		throw SocketException(STRING(COMMAND_TOO_LONG));
 	}
+
+	return total;
+}
+
+size_t BufferedSocket::splitLines(const char* aData, size_t aLen, bool aStopOnModeChange) {
+	auto start = aData;
+	const auto end = aData + aLen;
+	while (start < end) {
+		auto sep = static_cast<const char*>(memchr(start, separator, end - start));
+		if (!sep) {
+			// Keep the incomplete line
+			line.append(start, end);
+			break;
+		}
+
+		if (!line.empty()) {
+			line.append(start, sep);
+			fire(BufferedSocketListener::Line(), string_view(line));
+			line.clear();
+		} else if (sep != start) { // check empty (only pipe) command and don't waste cpu with it ;o)
+			// Complete lines are passed directly from the receive buffer
+			fire(BufferedSocketListener::Line(), string_view(start, sep - start));
+		}
+
+		start = sep + 1;
+		if (aStopOnModeChange && mode != MODE_LINE) {
+			return start - aData;
+		}
+	}
+
+	return aLen;
 }
 
 void BufferedSocket::threadSendFile(InputStream* file) {
@@ -324,6 +395,15 @@ void BufferedSocket::threadSendFile(InputStream* file) {
 	auto sockSize = (size_t)sock->getSocketOptInt(SO_SNDBUF);
 	size_t bufSize = max(sockSize, (size_t)64*1024);
 
+	if (sock->isSendFileSupported()) {
+		int64_t pos = 0, bytesLeft = 0;
+		auto directFile = file->getDirectFile(pos, bytesLeft);
+		if (directFile) {
+			threadSendFileDirect(file, *directFile, pos, bytesLeft, bufSize);
+			return;
+		}
+	}
+
 	ByteVector readBuf(bufSize);
 	ByteVector writeBufTmp(bufSize);
 
@@ -375,8 +455,8 @@ void BufferedSocket::threadSendFile(InputStream* file) {
 			} else {
 				writeSize = min(sockSize / 2, writeBufTmp.size() - writePos);
 				written = useLimiter ? 
-					ThrottleManager::getInstance()->write(sock.get(), &writeBufTmp[writePos], writeSize) : 
-					sock->read(&inbuf[0], inbuf.size());
+					ThrottleManager::getInstance()->write(sock.get(), throttle, &writeBufTmp[writePos], writeSize) : 
+					sock->write(&writeBufTmp[writePos], writeSize);
 			}
 			
 			if(written > 0) {
@@ -415,6 +495,61 @@ void BufferedSocket::threadSendFile(InputStream* file) {
 	}
 }
 
+void BufferedSocket::threadSendFileDirect(InputStream* aStream, const File& aFile, int64_t aPos, int64_t aBytes, size_t aSliceSize) {
+	int64_t sent = 0;
+	while(!disconnecting) {
+		if(sent == aBytes) {
+			fire(BufferedSocketListener::TransmitDone());
+			return;
+		}
+
+		// Process possible async calls 
+		checkEvents();
+
+		auto writeSize = static_cast<size_t>(min(static_cast<int64_t>(aSliceSize), aBytes - sent));
+		int written = useLimiter ?
+			ThrottleManager::getInstance()->sendFile(sock.get(), throttle, aFile, aPos + sent, writeSize) :
+			sock->sendFile(aFile, aPos + sent, writeSize);
+
+		if(written > 0) {
+			sent += written;
+			aStream->skip(written);
+
+			// The data is read from the file and sent at the same time
+			fire(BufferedSocketListener::BytesSent(), written, written);
+			continue;
+		}
+		
+		if(written == 0 && aFile.getSize() <= aPos + sent) {
+			// The file was truncated, finish in the same way as when reading the data
+			fire(BufferedSocketListener::TransmitDone());
+			return;
+		}
+
+		if(written == 0) {
+			// Throttled or nothing could be read from the file, back off instead of spinning
+			// (tokens keep accumulating for the limiter meanwhile)
+			auto [read, write] = sock->wait(SEND_RETRY_DELAY, true, false);
+			if (read) {
+				threadRead();
+			}
+
+			continue;
+		}
+
+		// Wait until the socket is writable again
+		while(!disconnecting) {
+			auto [read, write] = sock->wait(POLL_TIMEOUT, true, true);
+			if (read) {
+				threadRead();
+			}
+			if (write) {
+				break;
+			}
+		}
+	}
+}
+
 void BufferedSocket::write(const char* aBuf, size_t aLen) noexcept {
 	if(!sock.get())
 		return;
@@ -522,6 +657,12 @@ int BufferedSocket::run() {
 				break;
 			}
 			if(state == RUNNING) {
+				if(reactorMode) {
+					// Connected, the socket is owned by the event loop from now on
+					attachReactor();
+					return 0;
+				}
+
 				checkSocket();
 			}
 		} catch(const Exception& e) {
@@ -539,6 +680,12 @@ void BufferedSocket::fail(const string& aError) {
 		fire(BufferedSocketListener::Failed(), aError);
 	}
 	//fire listener before deleting socket to be able to retrieve information from it.. does it cause any problems?? 
+	if (reactorMode && reactorState->registered) {
+		// The descriptor must be removed before it gets closed
+		reactorState->reactor->remove(this, sock->getSock());
+		reactorState->registered = false;
+	}
+
 	if (sock.get()) {
 		sock->disconnect();
 	}
@@ -552,7 +699,397 @@ void BufferedSocket::shutdown(const Callback& f) {
 
 void BufferedSocket::addTask(Tasks task, unique_ptr<TaskData>&& data) {
 	dcassert(task == DISCONNECT || task == SHUTDOWN || task == ASYNC_CALL || sock.get());
-	tasks.emplace_back(task, std::move(data)); taskSem.signal();
+	tasks.emplace_back(task, std::move(data));
+	if (reactorMode && reactorState->reactor) {
+		queueReactorWork(WORK_TASKS);
+	} else {
+		taskSem.signal();
+	}
+}
+
+void BufferedSocket::attachReactor() {
+	auto reactor = SocketReactor::acquire();
+
+	Lock l(cs);
+	reactorState->reactor = reactor;
+	try {
+		reactor->add(this, sock->getSock());
+	} catch (const SocketException&) {
+		reactorState->reactor = nullptr;
+		throw;
+	}
+
+	reactorState->registered = true;
+
+	// Tasks added after the last check
+	queueReactorWork(WORK_TASKS);
+}
+
+void BufferedSocket::detachReactor() noexcept {
+	auto& rs = *reactorState;
+	if (rs.registered) {
+		rs.reactor->remove(this, sock->getSock());
+		rs.registered = false;
+	}
+
+	rs.reactor->cancel(this);
+}
+
+void BufferedSocket::queueReactorWork(int aWork) noexcept {
+	Lock l(cs);
+	auto& rs = *reactorState;
+	rs.pendingWork |= aWork;
+	if (rs.strandQueued)
+		return;
+
+	rs.strandQueued = true;
+	SocketReactor::submit([this] { runReactorStrand(); });
+}
+
+void BufferedSocket::runReactorStrand() noexcept {
+	auto& rs = *reactorState;
+
+	int work;
+	{
+		Lock l(cs);
+		work = rs.pendingWork;
+		rs.pendingWork = 0;
+	}
+
+	if (work & WORK_RESUME) {
+		onReactorResume();
+	}
+
+	if (work & WORK_IO) {
+		onReactorEvent((work & WORK_READ) != 0, (work & WORK_WRITE) != 0, (work & WORK_HANGUP) != 0);
+
+		// The events are disabled after each dispatch
+		rearmReactor();
+	}
+
+	if ((work & WORK_TASKS) && runReactorTasks()) {
+		// Keep the strand marked as queued, the loop will delete the socket
+		rs.reactor->retire(this);
+		return;
+	}
+
+	Lock l(cs);
+	if (rs.pendingWork == 0) {
+		rs.strandQueued = false;
+		return;
+	}
+
+	// Let the other sockets run before continuing
+	SocketReactor::submit([this] { runReactorStrand(); });
+}
+
+void BufferedSocket::onReactorEvent(bool aRead, bool aWrite, bool aHangup) noexcept {
+	try {
+		if (aRead) {
+			reactorRead(aHangup);
+		}
+
+		if (aWrite || (aRead && reactorState->writeWaitingRead)) {
+			reactorSend();
+		}
+	} catch (const Exception& e) {
+		fail(e.getError());
+	}
+}
+
+void BufferedSocket::onReactorResume() noexcept {
+	if (state != RUNNING)
+		return;
+
+	auto& rs = *reactorState;
+	rs.readThrottled = false;
+	rs.writeThrottled = false;
+
+	// Continue sending and restore the read interest
+	onReactorEvent(false, true, false);
+}
+
+bool BufferedSocket::runReactorTasks() noexcept {
+	auto& rs = *reactorState;
+	while (true) {
+		TaskPair p;
+		{
+			Lock l(cs);
+			if (tasks.empty())
+				return false;
+
+			p = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		if (p.first == SHUTDOWN) {
+			if (p.second)
+				static_cast<CallData*>(p.second.get())->f();
+
+			detachReactor();
+			return true;
+		}
+
+		if (state != RUNNING)
+			continue;
+
+		try {
+			if (p.first == SEND_DATA) {
+				reactorSend();
+			} else if (p.first == SEND_FILE) {
+				reactorStartFile(static_cast<SendFileInfo*>(p.second.get())->stream);
+			} else if (p.first == DISCONNECT) {
+				if (!disconnecting && !rs.fileStream && reactorHasPendingData()) {
+					// Send the queued data first
+					rs.disconnectPending = true;
+				} else {
+					fail(STRING(DISCONNECTED));
+				}
+			} else if (p.first == ASYNC_CALL) {
+				static_cast<CallData*>(p.second.get())->f();
+			} else {
+				dcdebug("%d unexpected in RUNNING state\n", p.first);
+			}
+		} catch (const Exception& e) {
+			fail(e.getError());
+		}
+	}
+}
+
+void BufferedSocket::reactorRead(bool aHangup) {
+	auto& rs = *reactorState;
+	if (rs.readThrottled && aHangup) {
+		// Errors are reported even when the read interest is disabled
+		throw SocketException(STRING(CONNECTION_CLOSED));
+	}
+
+	for (int i = 0; i < MAX_READS_PER_EVENT; ++i) {
+		if (state != RUNNING || rs.readThrottled)
+			return;
+
+		auto ret = threadRead();
+		if (ret == ThrottleManager::THROTTLED) {
+			rs.readThrottled = true;
+			updateReactorInterest(rs.writeInterest);
+
+			// Continue when the bucket has been refilled
+			rs.reactor->resumeAt(this, GET_TICK() + ThrottleManager::getInstance()->getRetryDelay(ThrottleConnection::DOWN));
+			return;
+		}
+
+		if (ret == -1)
+			return;
+	}
+
+	// Continue after the other sockets have been served (OpenSSL may also have buffered data that epoll doesn't know about)
+	queueReactorWork(WORK_READ);
+}
+
+bool BufferedSocket::reactorHasPendingData() noexcept {
+	if (reactorState->sendPos < sendBuf.size())
+		return true;
+
+	Lock l(cs);
+	return !writeBuf.empty();
+}
+
+void BufferedSocket::updateReactorInterest(bool aWrite) noexcept {
+	auto& rs = *reactorState;
+
+	// Reading must be enabled also when throttled if the write is waiting for it
+	auto read = !rs.readThrottled || rs.writeWaitingRead;
+	aWrite = aWrite && !rs.writeWaitingRead;
+	if (!rs.registered || (rs.readInterest == read && rs.writeInterest == aWrite))
+		return;
+
+	rs.readInterest = read;
+	rs.writeInterest = aWrite;
+	rs.reactor->setInterest(this, sock->getSock(), read, aWrite);
+}
+
+void BufferedSocket::rearmReactor() noexcept {
+	auto& rs = *reactorState;
+	if (!rs.registered)
+		return;
+
+	rs.reactor->setInterest(this, sock->getSock(), rs.readInterest, rs.writeInterest);
+}
+
+void BufferedSocket::reactorSend() {
+	if (state != RUNNING || disconnecting)
+		return;
+
+	auto& rs = *reactorState;
+	auto budget = MAX_SEND_PER_EVENT;
+	auto blocked = false;
+	while (budget > 0) {
+		if (rs.sendPos == sendBuf.size()) {
+			sendBuf.clear();
+			rs.sendPos = 0;
+
+			Lock l(cs);
+			if (!rs.fileStream) {
+				writeBuf.swap(sendBuf);
+			} else if (rs.preFileBytes > 0) {
+				// Data written after the file was queued must wait
+				sendBuf.assign(writeBuf.begin(), writeBuf.begin() + rs.preFileBytes);
+				writeBuf.erase(writeBuf.begin(), writeBuf.begin() + rs.preFileBytes);
+				rs.preFileBytes = 0;
+			}
+		}
+
+		if (rs.sendPos < sendBuf.size()) {
+			// The buffer isn't modified before it has been sent, as required by OpenSSL when retrying
+			auto n = sock->write(&sendBuf[rs.sendPos], sendBuf.size() - rs.sendPos);
+			if (n <= 0) {
+				blocked = true;
+				break;
+			}
+
+			rs.sendPos += n;
+			budget -= min(budget, static_cast<size_t>(n));
+			continue;
+		}
+
+		// Only the file data is throttled
+		if (!rs.fileStream || rs.writeThrottled)
+			break;
+
+		auto result = reactorSendFile(budget);
+		if (result == SendResult::BLOCKED) {
+			blocked = true;
+			break;
+		} else if (result == SendResult::THROTTLED) {
+			rs.writeThrottled = true;
+			rs.reactor->resumeAt(this, GET_TICK() + ThrottleManager::getInstance()->getRetryDelay(ThrottleConnection::UP));
+			break;
+		}
+
+		if (state != RUNNING || disconnecting)
+			return;
+	}
+
+	if (rs.disconnectPending && !reactorHasPendingData()) {
+		fail(STRING(DISCONNECTED));
+		return;
+	}
+
+	rs.writeWaitingRead = blocked && sock->isWriteWaitingRead();
+
+	// Wait until the socket is writable again (or continue on the next round if the budget was used)
+	updateReactorInterest(!rs.writeThrottled && (blocked || budget == 0));
+}
+
+void BufferedSocket::reactorStartFile(InputStream* aStream) {
+	if (disconnecting)
+		return;
+
+	dcassert(aStream);
+	auto& rs = *reactorState;
+	dcassert(!rs.fileStream);
+
+	rs.fileStream = aStream;
+	rs.sockSize = static_cast<size_t>(sock->getSocketOptInt(SO_SNDBUF));
+	rs.bufSize = max(rs.sockSize, static_cast<size_t>(64 * 1024));
+
+	rs.directFile = nullptr;
+	if (sock->isSendFileSupported()) {
+		rs.directFile = aStream->getDirectFile(rs.filePos, rs.fileBytesLeft);
+	}
+
+	{
+		Lock l(cs);
+		rs.preFileBytes = writeBuf.size();
+	}
+
+	reactorSend();
+}
+
+void BufferedSocket::reactorFinishFile() {
+	auto& rs = *reactorState;
+	rs.fileStream = nullptr;
+	rs.directFile = nullptr;
+	rs.fileBuf.clear();
+	rs.fileBufPos = 0;
+	rs.retryWriteSize = 0;
+
+	fire(BufferedSocketListener::TransmitDone());
+}
+
+BufferedSocket::SendResult BufferedSocket::reactorSendFile(size_t& budget_) {
+	auto& rs = *reactorState;
+	if (rs.directFile) {
+		if (rs.fileBytesLeft == 0) {
+			reactorFinishFile();
+			return SendResult::DONE;
+		}
+
+		auto writeSize = static_cast<size_t>(min(static_cast<int64_t>(min(budget_, rs.bufSize)), rs.fileBytesLeft));
+		auto written = useLimiter ?
+			ThrottleManager::getInstance()->sendFile(sock.get(), throttle, *rs.directFile, rs.filePos, writeSize, false) :
+			sock->sendFile(*rs.directFile, rs.filePos, writeSize);
+
+		if (written > 0) {
+			rs.filePos += written;
+			rs.fileBytesLeft -= written;
+			rs.fileStream->skip(written);
+			budget_ -= min(budget_, static_cast<size_t>(written));
+
+			fire(BufferedSocketListener::BytesSent(), written, written);
+			return SendResult::SENT;
+		} else if (written == -1) {
+			return SendResult::BLOCKED;
+		} else if (rs.directFile->getSize() <= rs.filePos) {
+			// The file was truncated
+			reactorFinishFile();
+			return SendResult::DONE;
+		}
+
+		return SendResult::THROTTLED;
+	}
+
+	if (rs.fileBufPos == rs.fileBuf.size()) {
+		rs.fileBuf.resize(rs.bufSize);
+		rs.fileBufPos = 0;
+
+		size_t bytesRead = rs.fileBuf.size();
+		auto actual = rs.fileStream->read(&rs.fileBuf[0], bytesRead);
+		if (bytesRead > 0) {
+			fire(BufferedSocketListener::BytesSent(), bytesRead, 0);
+		}
+
+		rs.fileBuf.resize(actual);
+		if (actual == 0) {
+			reactorFinishFile();
+			return SendResult::DONE;
+		}
+	}
+
+	int written = 0;
+	auto writeSize = rs.retryWriteSize;
+	if (writeSize > 0) {
+		// workaround for OpenSSL (crashes when previous write failed and now retrying with different writeSize)
+		written = sock->write(&rs.fileBuf[rs.fileBufPos], writeSize);
+	} else {
+		writeSize = min(max(rs.sockSize / 2, static_cast<size_t>(1)), rs.fileBuf.size() - rs.fileBufPos);
+		written = useLimiter ?
+			ThrottleManager::getInstance()->write(sock.get(), throttle, &rs.fileBuf[rs.fileBufPos], writeSize, false) :
+			sock->write(&rs.fileBuf[rs.fileBufPos], writeSize);
+	}
+
+	if (written > 0) {
+		rs.retryWriteSize = 0;
+		rs.fileBufPos += written;
+		budget_ -= min(budget_, static_cast<size_t>(written));
+
+		fire(BufferedSocketListener::BytesSent(), 0, written);
+		return SendResult::SENT;
+	} else if (written == -1) {
+		rs.retryWriteSize = writeSize;
+		return SendResult::BLOCKED;
+	}
+
+	return SendResult::THROTTLED;
 }
 
 } // namespace dcpp
@@ -26,6 +26,7 @@
 
 #include <airdcpp/connection/socket/AddressInfo.h>
 #include <airdcpp/connection/socket/BufferedSocketListener.h>
+#include <airdcpp/connection/ThrottleConnection.h>
 #include <airdcpp/core/types/GetSet.h>
 #include <airdcpp/core/thread/Semaphore.h>
 #include <airdcpp/core/thread/Thread.h>
@@ -34,6 +35,8 @@
 
 namespace dcpp {
 
+class SocketReactor;
+
 using std::deque;
 using std::function;
 using std::pair;
@@ -63,10 +66,7 @@ public:
 		}
 	}
 
-	static void waitShutdown() noexcept {
-		while(sockets > 0)
-			Thread::sleep(100);
-	}
+	static void waitShutdown() noexcept;
 
 	using SocketAcceptFloodF = std::function<bool (const string &)>;
 	void accept(const Socket& srv, bool aSecure, bool aAllowUntrusted, const SocketAcceptFloodF& aFloodCheckF);
@@ -108,7 +108,11 @@ public:
 
 	GETSET(char, separator, Separator);
 	IGETSET(bool, useLimiter, UseLimiter, false);
+
+	void setThrottleClass(ThrottleClass aClass) noexcept { throttle.setClass(aClass); }
 private:
+	friend class SocketReactor;
+
 	enum Tasks {
 		CONNECT,
 		DISCONNECT,
@@ -162,22 +166,36 @@ private:
 	std::unique_ptr<UnZFilter> filterIn;
 	int64_t dataBytes = 0;
 	size_t rollback = 0;
+	// Incomplete line from the previous read
 	string line;
+	ByteVector inflateBuf;
 	ByteVector inbuf;
 	ByteVector writeBuf;
 	ByteVector sendBuf;
 
 	std::unique_ptr<Socket> sock;
+	ThrottleConnection throttle;
 	State state = STARTING;
 	bool disconnecting = false;
 	bool v4only;
 
+	// Connected sockets are handed over to a shared event loop instead of using the socket's own thread
+	const bool reactorMode;
+
+	struct ReactorState;
+	unique_ptr<ReactorState> reactorState;
+
 	int run() override;
 
 	void threadConnect(const AddressInfo& aAddr, const string& aPort, const string& localPort, NatRole natRole, bool proxy);
 	void threadAccept();
-	void threadRead();
+	// Returns the result of the socket read (-1 if no data was available, ThrottleManager::THROTTLED if out of download tokens)
+	int threadRead();
+	// Fires the complete lines and stores the remainder in 'line', returns the number of bytes processed
+	size_t splitLines(const char* aData, size_t aLen, bool aStopOnModeChange);
 	void threadSendFile(InputStream* is);
+	// Zero-copy sending for unfiltered file streams
+	void threadSendFileDirect(InputStream* aStream, const File& aFile, int64_t aPos, int64_t aBytes, size_t aSliceSize);
 	void threadSendData();
 
 	void fail(const string& aError);
@@ -190,6 +208,47 @@ private:
 	void setOptions();
 	void shutdown(const Callback& f);
 	void addTask(Tasks task, unique_ptr<TaskData>&& data);
+
+	// Reactor mode
+	enum ReactorWork {
+		WORK_READ = 0x01,
+		WORK_WRITE = 0x02,
+		WORK_HANGUP = 0x04,
+		WORK_TASKS = 0x08,
+		WORK_RESUME = 0x10,
+
+		WORK_IO = WORK_READ | WORK_WRITE | WORK_HANGUP
+	};
+
+	// Queues work for the socket's strand (may be called from any thread)
+	void queueReactorWork(int aWork) noexcept;
+
+	// The socket is processed only by one task pool thread at a time
+	void runReactorStrand() noexcept;
+
+	void attachReactor();
+	void detachReactor() noexcept;
+	void onReactorEvent(bool aRead, bool aWrite, bool aHangup) noexcept;
+	// Returns true if the socket was shut down
+	bool runReactorTasks() noexcept;
+	void onReactorResume() noexcept;
+
+	void reactorRead(bool aHangup);
+	void reactorSend();
+	void reactorStartFile(InputStream* aStream);
+	void reactorFinishFile();
+	bool reactorHasPendingData() noexcept;
+	void updateReactorInterest(bool aWrite) noexcept;
+	void rearmReactor() noexcept;
+
+	enum class SendResult {
+		SENT,
+		BLOCKED,
+		THROTTLED,
+		DONE
+	};
+
+	SendResult reactorSendFile(size_t& budget_);
 };
 
 } // namespace dcpp
@@ -20,10 +20,12 @@
 #define DCPLUSPLUS_DCPP_BUFFEREDSOCKETLISTENER_H_
 
 #include <string>
+#include <string_view>
 
 namespace dcpp {
 
 using std::string;
+using std::string_view;
 
 class BufferedSocketListener {
 public:
@@ -41,7 +43,8 @@ public:
 
 	virtual void on(Connecting) noexcept { }
 	virtual void on(Connected) noexcept { }
-	virtual void on(Line, const string&) noexcept { }
+	// The line points to the socket's receive buffer and it's valid only during the call
+	virtual void on(Line, string_view) noexcept { }
 	virtual void on(Data, uint8_t*, size_t) noexcept { }
 	virtual void on(BytesSent, size_t, size_t) noexcept { }
 	virtual void on(ModeChange) noexcept { }
@@ -25,8 +25,14 @@
 #include <airdcpp/core/header/format.h>
 #include <airdcpp/util/text/StringTokenizer.h>
 
+#include <airdcpp/core/io/File.h>
+
 #include <openssl/err.h>
 
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(OPENSSL_NO_KTLS) && !defined(_WIN32)
+#   define HAVE_SSL_SENDFILE
+#endif
+
 namespace dcpp {
 
 SSLSocket::SSLSocket(CryptoManager::SSLContext context, bool allowUntrusted, const string& expKP) : SSLSocket(context) {
@@ -158,6 +164,36 @@ int SSLSocket::write(const void* aBuffer, size_t aLen) {
 	return ret;
 }
 
+bool SSLSocket::isSendFileSupported() const noexcept {
+#ifdef HAVE_SSL_SENDFILE
+	return ssl && BIO_get_ktls_send(SSL_get_wbio(ssl)) > 0;
+#else
+	return false;
+#endif
+}
+
+bool SSLSocket::isWriteWaitingRead() const noexcept {
+	// E.g. a key update or renegotiation during SSL_write
+	return ssl && SSL_want_read(ssl);
+}
+
+int SSLSocket::sendFile(const File& aFile, int64_t aPos, size_t aLen) {
+#ifdef HAVE_SSL_SENDFILE
+	if (!ssl) {
+		return -1;
+	}
+
+	int ret = checkSSL(static_cast<int>(SSL_sendfile(ssl, aFile.getNativeHandle(), static_cast<off_t>(aPos), aLen, 0)));
+	if (ret > 0) {
+		stats.totalUp += ret;
+	}
+	return ret;
+#else
+	dcassert(0);
+	throw SSLSocketException("Sending files directly is not supported");
+#endif
+}
+
 int SSLSocket::checkSSL(int ret) {
 	if(!ssl) {
 		return -1;
@@ -51,6 +51,11 @@ public:
 
 	int read(void* aBuffer, size_t aBufLen) override;
 	int write(const void* aBuffer, size_t aLen) override;
+
+	// Available when the kernel handles the TLS record encryption (kTLS)
+	int sendFile(const File& aFile, int64_t aPos, size_t aLen) override;
+	bool isSendFileSupported() const noexcept override;
+	bool isWriteWaitingRead() const noexcept override;
 	std::pair<bool, bool> wait(uint64_t millis, bool checkRead, bool checkWrite) override;
 	void shutdown() noexcept override;
 	void close() noexcept override;
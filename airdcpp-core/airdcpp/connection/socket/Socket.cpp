@@ -20,6 +20,7 @@
 #include <airdcpp/connection/socket/Socket.h>
 
 #include <airdcpp/connectivity/ConnectivityManager.h>
+#include <airdcpp/core/io/File.h>
 #include <airdcpp/core/header/format.h>
 #include <airdcpp/settings/SettingsManager.h>
 #include <airdcpp/core/timer/TimerManager.h>
@@ -33,6 +34,10 @@
 #endif
 #endif
 
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
 #ifndef AI_ADDRCONFIG
 #define AI_ADDRCONFIG 0
 #endif
@@ -45,6 +50,11 @@
 
 namespace dcpp {
 
+#ifdef __linux__
+// Maximum number of datagrams per recvmmsg/sendmmsg call
+constexpr size_t MAX_DATAGRAM_BATCH = 64;
+#endif
+
 namespace {
 
 #ifdef _WIN32
@@ -629,6 +639,53 @@ int Socket::read(void* aBuffer, size_t aBufLen, string &aIP) {
 	return len;
 }
 
+int Socket::readBatch(Datagram* aPackets, size_t aCount) {
+	dcassert(type == TYPE_UDP);
+	if (aCount == 0) {
+		return 0;
+	}
+
+#ifdef __linux__
+	aCount = std::min(aCount, MAX_DATAGRAM_BATCH);
+
+	mmsghdr msgs[MAX_DATAGRAM_BATCH];
+	iovec iovecs[MAX_DATAGRAM_BATCH];
+	addr remoteAddrs[MAX_DATAGRAM_BATCH];
+
+	memset(msgs, 0, sizeof(mmsghdr) * aCount);
+	for (size_t i = 0; i < aCount; ++i) {
+		iovecs[i].iov_base = aPackets[i].buffer.data();
+		iovecs[i].iov_len = aPackets[i].buffer.size();
+		msgs[i].msg_hdr.msg_iov = &iovecs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &remoteAddrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(addr);
+	}
+
+	// Don't wait for the whole batch to be filled
+	auto count = check([&] {
+		return ::recvmmsg(readable(sock4, sock6), msgs, static_cast<unsigned int>(aCount), MSG_WAITFORONE, nullptr);
+	}, true);
+
+	for (int i = 0; i < count; ++i) {
+		aPackets[i].length = msgs[i].msg_len;
+		aPackets[i].ip = resolveName(&remoteAddrs[i].sa, msgs[i].msg_hdr.msg_namelen);
+		stats.totalDown += msgs[i].msg_len;
+	}
+
+	return count;
+#else
+	auto& packet = aPackets[0];
+	auto len = read(packet.buffer.data(), packet.buffer.size(), packet.ip);
+	if (len < 0) {
+		return -1;
+	}
+
+	packet.length = len;
+	return 1;
+#endif
+}
+
 int Socket::socksRead(ByteVector& aBuffer, size_t aBufLen, const SocksCompleteF& aIsComplete, uint64_t aTimeout) {
 	int i = 0;
 	while (i <= 0 || !aIsComplete(aBuffer, i)) {
@@ -681,6 +738,30 @@ int Socket::write(const void* aBuffer, size_t aLen) {
 	return sent;
 }
 
+bool Socket::isSendFileSupported() const noexcept {
+#ifdef HAVE_SYS_SENDFILE_H
+	return true;
+#else
+	return false;
+#endif
+}
+
+int Socket::sendFile(const File& aFile, int64_t aPos, size_t aLen) {
+#ifdef HAVE_SYS_SENDFILE_H
+	// The offset is passed explicitly so the file position isn't modified
+	auto offset = static_cast<off_t>(aPos);
+	auto sent = check([&] { return ::sendfile(getSock(), aFile.getNativeHandle(), &offset, aLen); }, true);
+	if (sent > 0) {
+		stats.totalUp += sent;
+	}
+
+	return static_cast<int>(sent);
+#else
+	dcassert(0);
+	throw SocketException("Sending files directly is not supported on this platform");
+#endif
+}
+
 /**
  * Sends data, will block until all data has been sent or an exception occurs
  * @param aBuffer Buffer with data
@@ -755,6 +836,59 @@ void Socket::writeTo(const string& aAddr, const string& aPort, const void* aBuff
 	stats.totalUp += sent;
 }
 
+void Socket::writeTo(const string& aAddr, const string& aPort, const StringList& aPackets) {
+	if (aPackets.empty())
+		return;
+
+#ifdef __linux__
+	if (aAddr.empty() || aPort.empty()) {
+		throw SocketException(EADDRNOTAVAIL);
+	}
+
+	if (CONNSETTING(OUTGOING_CONNECTIONS) != SettingsManager::OUTGOING_SOCKS5 || !socksUdpInitialized()) {
+		auto ai = resolveAddr(aAddr, aPort);
+		if ((ai->ai_family == AF_INET && !sock4.valid()) || (ai->ai_family == AF_INET6 && !sock6.valid())) {
+			create(*ai);
+		}
+
+		mmsghdr msgs[MAX_DATAGRAM_BATCH];
+		iovec iovecs[MAX_DATAGRAM_BATCH];
+
+		size_t pos = 0;
+		while (pos < aPackets.size()) {
+			auto count = std::min(aPackets.size() - pos, MAX_DATAGRAM_BATCH);
+
+			memset(msgs, 0, sizeof(mmsghdr) * count);
+			for (size_t i = 0; i < count; ++i) {
+				const auto& packet = aPackets[pos + i];
+				iovecs[i].iov_base = const_cast<char*>(packet.data());
+				iovecs[i].iov_len = packet.size();
+				msgs[i].msg_hdr.msg_iov = &iovecs[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+				msgs[i].msg_hdr.msg_name = ai->ai_addr;
+				msgs[i].msg_hdr.msg_namelen = static_cast<socklen_t>(ai->ai_addrlen);
+			}
+
+			auto sent = check([&] {
+				return ::sendmmsg(ai->ai_family == AF_INET ? sock4 : sock6, msgs, static_cast<unsigned int>(count), 0);
+			});
+
+			for (int i = 0; i < sent; ++i) {
+				stats.totalUp += msgs[i].msg_len;
+			}
+
+			pos += sent;
+		}
+
+		return;
+	}
+#endif
+
+	for (const auto& packet: aPackets) {
+		writeTo(aAddr, aPort, packet);
+	}
+}
+
 /**
  * Blocks until timeout is reached one of the specified conditions have been fulfilled
  * @param millis Max milliseconds to block.
@@ -113,8 +113,28 @@ public:
 
 	virtual int write(const void* aBuffer, size_t aLen);
 	int write(const string_view& aData) { return write(aData.data(), aData.length()); }
+
+	/**
+	 * Sends data directly from a file without copying it via user space buffers
+	 * Must not be called unless isSendFileSupported() returns true
+	 * @return Number of bytes sent or -1 if the call would block
+	 */
+	virtual int sendFile(const File& aFile, int64_t aPos, size_t aLen);
+	virtual bool isSendFileSupported() const noexcept;
+
+	// The previous write call would block because the (TLS) protocol needs to read data first
+	virtual bool isWriteWaitingRead() const noexcept { return false; }
+
+	// Descriptor of the connected socket (for registering it to an event loop)
+	socket_t getSock() const;
 	virtual void writeTo(const string& aIp, const string& aPort, const void* aBuffer, size_t aLen);
 	void writeTo(const string& aIp, const string& aPort, const string_view& aData) { writeTo(aIp, aPort, aData.data(), aData.length()); }
+
+	/**
+	 * Sends multiple datagrams to the same address, using a single system call per batch when supported (sendmmsg)
+	 * @throw SocketException Send failed.
+	 */
+	virtual void writeTo(const string& aIp, const string& aPort, const StringList& aPackets);
 	virtual void shutdown() noexcept;
 	virtual void close() noexcept;
 	void disconnect() noexcept;
@@ -140,6 +160,23 @@ public:
 	 */
 	virtual int read(void* aBuffer, size_t aBufLen, string &aIP);
 
+	struct Datagram {
+		// Must be allocated by the caller
+		ByteVector buffer;
+
+		size_t length = 0;
+		string ip;
+	};
+
+	/**
+	 * Reads multiple datagrams with a single system call when supported (recvmmsg)
+	 * @param aPackets Packets with allocated buffers
+	 * @param aCount Maximum number of packets to read
+	 * @return Number of packets read or -1 if the call would block.
+	 * @throw SocketException On any failure.
+	 */
+	virtual int readBatch(Datagram* aPackets, size_t aCount);
+
 	virtual std::pair<bool, bool> wait(uint64_t millis, bool checkRead, bool checkWrite);
 
 	static string resolve(const string& aDns, int af = AF_UNSPEC) noexcept;
@@ -192,7 +229,6 @@ protected:
 		sockaddr_storage sas;
 	};
 
-	socket_t getSock() const;
 	bool hasSocket() const noexcept;
 
 	mutable SocketHandle sock4;
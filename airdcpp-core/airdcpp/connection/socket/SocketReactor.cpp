@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include <airdcpp/connection/socket/SocketReactor.h>
+
+#include <airdcpp/connection/socket/BufferedSocket.h>
+#include <airdcpp/core/timer/TimerManager.h>
+
+#include <thread>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+namespace dcpp {
+
+using std::max;
+using std::min;
+
+CriticalSection SocketReactor::reactorCS;
+vector<unique_ptr<SocketReactor>> SocketReactor::reactors;
+unique_ptr<TaskPool> SocketReactor::taskPool;
+
+constexpr int MAX_EVENTS = 64;
+constexpr size_t MAX_REACTOR_THREADS = 4;
+
+// Listeners may block (disk I/O, file list generation...), a blocked strand holds one thread
+constexpr size_t MIN_STRAND_THREADS = 4;
+constexpr size_t MAX_STRAND_THREADS = 16;
+
+#ifdef __linux__
+
+bool SocketReactor::isSupported() noexcept {
+	return true;
+}
+
+SocketReactor::SocketReactor() {
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (epollFd == -1) {
+		throw SocketException(errno);
+	}
+
+	wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (wakeFd == -1) {
+		auto error = errno;
+		::close(epollFd);
+		throw SocketException(error);
+	}
+
+	// The wakeup descriptor is identified with a null pointer
+	epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.ptr = nullptr;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+}
+
+SocketReactor::~SocketReactor() {
+	::close(wakeFd);
+	::close(epollFd);
+}
+
+void SocketReactor::add(BufferedSocket* aSocket, socket_t aSock) {
+	epoll_event ev = {};
+	ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+	ev.data.ptr = aSocket;
+	if (epoll_ctl(epollFd, EPOLL_CTL_ADD, aSock, &ev) == -1) {
+		throw SocketException(errno);
+	}
+
+	socketCount++;
+}
+
+void SocketReactor::remove(BufferedSocket*, socket_t aSock) noexcept {
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, aSock, nullptr);
+	socketCount--;
+}
+
+void SocketReactor::setInterest(BufferedSocket* aSocket, socket_t aSock, bool aRead, bool aWrite) noexcept {
+	epoll_event ev = {};
+	ev.events = (aRead ? static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP) : 0U) | (aWrite ? static_cast<uint32_t>(EPOLLOUT) : 0U) | static_cast<uint32_t>(EPOLLONESHOT);
+	ev.data.ptr = aSocket;
+	epoll_ctl(epollFd, EPOLL_CTL_MOD, aSock, &ev);
+}
+
+void SocketReactor::wakeup() noexcept {
+	uint64_t value = 1;
+	[[maybe_unused]] auto ret = ::write(wakeFd, &value, sizeof(value));
+}
+
+int SocketReactor::run() {
+	epoll_event events[MAX_EVENTS];
+	while (!stopping) {
+		auto timeout = runDelayed();
+
+		auto n = epoll_wait(epollFd, events, MAX_EVENTS, timeout);
+		if (n == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			dcdebug("SocketReactor: epoll_wait failed (%d)\n", errno);
+			break;
+		}
+
+		for (int i = 0; i < n; ++i) {
+			auto socket = static_cast<BufferedSocket*>(events[i].data.ptr);
+			if (!socket) {
+				uint64_t value;
+				[[maybe_unused]] auto ret = ::read(wakeFd, &value, sizeof(value));
+				continue;
+			}
+
+			// Errors and hangups are detected when reading
+			auto flags = events[i].events;
+			auto hangup = (flags & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0;
+
+			auto work = 0;
+			if ((flags & EPOLLIN) != 0 || hangup)
+				work |= BufferedSocket::WORK_READ;
+			if ((flags & EPOLLOUT) != 0)
+				work |= BufferedSocket::WORK_WRITE;
+			if (hangup)
+				work |= BufferedSocket::WORK_HANGUP;
+
+			socket->queueReactorWork(work);
+		}
+
+		// Events of the current round may still refer to the retired sockets
+		deleteRetired();
+	}
+
+	return 0;
+}
+
+#else
+
+bool SocketReactor::isSupported() noexcept {
+	return false;
+}
+
+SocketReactor::SocketReactor() {
+	throw SocketException("Not supported");
+}
+
+SocketReactor::~SocketReactor() { }
+
+void SocketReactor::add(BufferedSocket*, socket_t) { }
+void SocketReactor::remove(BufferedSocket*, socket_t) noexcept { }
+void SocketReactor::setInterest(BufferedSocket*, socket_t, bool, bool) noexcept { }
+void SocketReactor::wakeup() noexcept { }
+
+int SocketReactor::run() {
+	return 0;
+}
+
+#endif
+
+void SocketReactor::resumeAt(BufferedSocket* aSocket, uint64_t aTick) noexcept {
+	{
+		Lock l(cs);
+		delayed.emplace_back(aTick, aSocket);
+	}
+
+	// Recalculate the wait timeout
+	wakeup();
+}
+
+int SocketReactor::runDelayed() noexcept {
+	auto tick = GET_TICK();
+
+	vector<BufferedSocket*> expired;
+	uint64_t next = UINT64_MAX;
+
+	{
+		Lock l(cs);
+		if (delayed.empty()) {
+			return -1;
+		}
+
+		for (auto i = delayed.begin(); i != delayed.end();) {
+			if (i->first <= tick) {
+				expired.push_back(i->second);
+				i = delayed.erase(i);
+			} else {
+				next = min(next, i->first);
+				++i;
+			}
+		}
+	}
+
+	// Retired sockets are deleted only from this thread so the expired ones are still valid
+	for (auto socket: expired) {
+		socket->queueReactorWork(BufferedSocket::WORK_RESUME);
+	}
+
+	if (next == UINT64_MAX) {
+		return -1;
+	}
+
+	return static_cast<int>(max(next, tick) - tick);
+}
+
+void SocketReactor::cancel(BufferedSocket* aSocket) noexcept {
+	Lock l(cs);
+	std::erase_if(delayed, [aSocket](const auto& d) { return d.second == aSocket; });
+}
+
+void SocketReactor::retire(BufferedSocket* aSocket) noexcept {
+	{
+		Lock l(cs);
+		retired.push_back(aSocket);
+	}
+
+	wakeup();
+}
+
+void SocketReactor::deleteRetired() noexcept {
+	vector<BufferedSocket*> sockets;
+
+	{
+		Lock l(cs);
+		sockets.swap(retired);
+	}
+
+	for (auto socket: sockets) {
+		delete socket;
+	}
+}
+
+void SocketReactor::submit(TaskPool::Task&& aTask) noexcept {
+	dcassert(taskPool);
+	taskPool->submit(std::move(aTask));
+}
+
+void SocketReactor::stop() noexcept {
+	stopping = true;
+	wakeup();
+	join();
+}
+
+SocketReactor* SocketReactor::acquire() {
+	Lock l(reactorCS);
+	if (reactors.empty()) {
+		taskPool = make_unique<TaskPool>(std::clamp<size_t>(std::thread::hardware_concurrency(), MIN_STRAND_THREADS, MAX_STRAND_THREADS));
+
+		auto count = std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, MAX_REACTOR_THREADS);
+		for (size_t i = 0; i < count; ++i) {
+			auto reactor = unique_ptr<SocketReactor>(new SocketReactor());
+			reactor->start();
+			reactors.push_back(std::move(reactor));
+		}
+	}
+
+	auto reactor = std::min_element(reactors.begin(), reactors.end(), [](const auto& a, const auto& b) {
+		return a->getSocketCount() < b->getSocketCount();
+	});
+
+	return reactor->get();
+}
+
+void SocketReactor::shutdown() noexcept {
+	Lock l(reactorCS);
+	for (const auto& reactor: reactors) {
+		reactor->stop();
+	}
+
+	reactors.clear();
+	taskPool.reset();
+}
+
+} // namespace dcpp
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_SOCKET_REACTOR_H
+#define DCPLUSPLUS_DCPP_SOCKET_REACTOR_H
+
+#include <airdcpp/core/header/typedefs.h>
+
+#include <airdcpp/connection/socket/Socket.h>
+#include <airdcpp/core/thread/CriticalSection.h>
+#include <airdcpp/core/thread/TaskPool.h>
+#include <airdcpp/core/thread/Thread.h>
+
+namespace dcpp {
+
+class BufferedSocket;
+
+/**
+ * Event loop that waits for the I/O events of connected BufferedSockets instead of using a thread for each socket.
+ * Sockets are assigned to a fixed number of loops when the connection has been established.
+ *
+ * The loop only dispatches the events: sockets process them (and run their listeners) in a per-socket
+ * strand that is executed by a shared task pool, so that slow listeners won't stall the other sockets.
+ * Sockets are registered in one-shot mode and the strand re-enables the events after processing them.
+ *
+ * Only available on Linux (epoll), BufferedSocket falls back to the threaded mode elsewhere.
+ */
+class SocketReactor : public Thread {
+public:
+	static bool isSupported() noexcept;
+
+	// Returns the loop with the least sockets (the loops are started on first use)
+	static SocketReactor* acquire();
+
+	// Stops all loops, no sockets may be attached anymore
+	static void shutdown() noexcept;
+
+	SocketReactor(const SocketReactor&) = delete;
+	SocketReactor& operator=(const SocketReactor&) = delete;
+
+	~SocketReactor() override;
+
+	// Start receiving read events for the socket
+	void add(BufferedSocket* aSocket, socket_t aSock);
+
+	// Stop receiving events for the socket (the descriptor must still be open)
+	// Call from the socket's strand only
+	void remove(BufferedSocket* aSocket, socket_t aSock) noexcept;
+
+	// Enables the events again after the previous one has been processed
+	// Call from the socket's strand only
+	void setInterest(BufferedSocket* aSocket, socket_t aSock, bool aRead, bool aWrite) noexcept;
+
+	// Resume the socket after the given tick (used for throttling)
+	void resumeAt(BufferedSocket* aSocket, uint64_t aTick) noexcept;
+
+	// Drop the pending resume of a socket that is being shut down
+	void cancel(BufferedSocket* aSocket) noexcept;
+
+	// Delete a socket that has been removed from the loop
+	// The socket is deleted from the loop thread after the current events have been dispatched
+	void retire(BufferedSocket* aSocket) noexcept;
+
+	// Run a socket strand in the task pool
+	static void submit(TaskPool::Task&& aTask) noexcept;
+
+	size_t getSocketCount() const noexcept { return socketCount; }
+private:
+	SocketReactor();
+
+	int run() override;
+
+	void wakeup() noexcept;
+	void stop() noexcept;
+
+	void deleteRetired() noexcept;
+	int runDelayed() noexcept;
+
+	int epollFd = -1;
+	int wakeFd = -1;
+
+	CriticalSection cs;
+	vector<pair<uint64_t, BufferedSocket*>> delayed;
+	vector<BufferedSocket*> retired;
+
+	atomic<size_t> socketCount { 0 };
+	atomic<bool> stopping { false };
+
+	static CriticalSection reactorCS;
+	static vector<unique_ptr<SocketReactor>> reactors;
+
+	// Runs the socket strands (separate from the global pool so that long-running
+	// parallel tasks and socket listeners won't delay each other)
+	static unique_ptr<TaskPool> taskPool;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_SOCKET_REACTOR_H)
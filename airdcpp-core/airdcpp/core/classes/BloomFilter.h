@@ -20,72 +20,180 @@
 #define DCPLUSPLUS_DCPP_BLOOM_FILTER_H
 
 #include <airdcpp/core/header/typedefs.h>
+#include <airdcpp/core/header/debug.h>
+
+#include <bit>
 
 namespace dcpp {
 
-template<size_t N>
+/**
+* Bloom filter for the N-grams of strings
+*
+* The bits of each N-gram are stored in a single cache line sized block and the N-gram hashes
+* are calculated with a rolling hash so that each character is only hashed once.
+*/
+template<size_t N, size_t K = 2>
 class BloomFilter {
 public:
-	BloomFilter(size_t tableSize) { table.resize(tableSize); }
+	struct Stats {
+		size_t bits = 0;
+		size_t setBits = 0;
+
+		// Probability for a random N-gram to match
+		double falsePositiveRate = 0;
+	};
+
+	// The table size is rounded up to full blocks
+	BloomFilter(size_t tableSize) : blockCount(max<size_t>((tableSize + BLOCK_BITS - 1) / BLOCK_BITS, 1)), blocks(make_unique<Block[]>(blockCount)) { }
 	~BloomFilter() { }
 
-	void add(const string& s) { xadd(s, N); }
-	bool match(const string& s) const {
-		if(s.length() >= N) {
-			string::size_type l = s.length() - N;
-			for(string::size_type i = 0; i <= l; ++i) {
-				if(!table[getPos(s, i, N)]) {
-					return false;
-				}
+	void add(const string& s) noexcept {
+		forEachGram(s, [this](uint64_t aHash) {
+			auto& block = blocks[getBlock(aHash)];
+			auto mask = getMask(aHash);
+			for (size_t i = 0; i < BLOCK_WORDS; ++i) {
+				block.words[i] |= mask.words[i];
+			}
+
+			return true;
+		});
+	}
+
+	bool match(const string& s) const noexcept {
+		return forEachGram(s, [this](uint64_t aHash) {
+			const auto& block = blocks[getBlock(aHash)];
+			auto mask = getMask(aHash);
+
+			uint64_t missing = 0;
+			for (size_t i = 0; i < BLOCK_WORDS; ++i) {
+				missing |= mask.words[i] & ~block.words[i];
+			}
+
+			return missing == 0;
+		});
+	}
+
+	void clear() noexcept {
+		fill_n(blocks.get(), blockCount, Block());
+	}
+
+	// Both filters must have the same size
+	void merge(const BloomFilter<N, K>& aBloom) noexcept {
+		dcassert(aBloom.blockCount == blockCount);
+		for (size_t b = 0; b < blockCount; ++b) {
+			auto& block = blocks[b];
+			const auto& other = aBloom.blocks[b];
+			for (size_t i = 0; i < BLOCK_WORDS; ++i) {
+				block.words[i] |= other.words[i];
 			}
 		}
-		return true;
 	}
-	void clear() {
-		size_t s = table.size();
-		table.clear();
-		table.resize(s);
+
+	size_t size() const noexcept {
+		return blockCount * BLOCK_BITS;
 	}
 
-	void merge(const BloomFilter<N>& aBloom) {
-		for (size_t i = 0; i < table.size(); ++i) {
-			if (aBloom.table[i] == true) {
-				table[i] = true;
+	Stats getStats() const noexcept {
+		Stats stats;
+		stats.bits = size();
+
+		for (size_t b = 0; b < blockCount; ++b) {
+			size_t blockBits = 0;
+			for (auto word : blocks[b].words) {
+				blockBits += std::popcount(word);
 			}
+
+			stats.setBits += blockBits;
+
+			// All bits of an N-gram are in the same block
+			stats.falsePositiveRate += pow(static_cast<double>(blockBits) / BLOCK_BITS, static_cast<double>(K));
 		}
+
+		stats.falsePositiveRate /= static_cast<double>(blockCount);
+		return stats;
 	}
+
 #ifdef TESTER
 	void print_table_status() {
-		int tot = 0;
-		for (unsigned int i = 0; i < table.size(); ++i) if (table[i] == true) ++tot;
-
-		std::cout << "table status: " << tot << " of " << table.size()
-			<< " filled, for an occupancy percentage of " << (100.*tot)/table.size()
-			<< "%" << std::endl;
+		auto stats = getStats();
+		std::cout << "table status: " << stats.setBits << " of " << stats.bits
+			<< " filled, for an occupancy percentage of " << (100.*stats.setBits)/stats.bits
+			<< "%, false positive rate " << stats.falsePositiveRate << std::endl;
 	}
 #endif
 private:
-	void xadd(const string& s, size_t n) {
-		if(s.length() >= n) {
-			string::size_type l = s.length() - n;
-			for(string::size_type i = 0; i <= l; ++i) {
-				table[getPos(s, i, n)] = true;
+	static constexpr size_t BLOCK_BITS = 512;
+	static constexpr size_t BLOCK_WORDS = BLOCK_BITS / 64;
+	static constexpr size_t BLOCK_INDEX_BITS = 9;
+	static_assert(K * BLOCK_INDEX_BITS <= 32, "Too many bits per N-gram");
+
+	struct alignas(64) Block {
+		uint64_t words[BLOCK_WORDS] = { };
+	};
+
+	static constexpr uint64_t HASH_BASE = 0x100000001b3ULL;
+	static constexpr uint64_t getHashBasePower() noexcept {
+		uint64_t ret = 1;
+		for (size_t i = 0; i < N - 1; ++i) {
+			ret *= HASH_BASE;
+		}
+
+		return ret;
+	}
+
+	// Calls the handler with the hash of each N-gram until it returns false
+	template<class HandlerT>
+	static bool forEachGram(const string& s, const HandlerT& aHandler) noexcept {
+		if (s.length() < N) {
+			return true;
+		}
+
+		constexpr auto basePower = getHashBasePower();
+
+		auto c = reinterpret_cast<const uint8_t*>(s.data());
+		uint64_t h = 0;
+		for (size_t i = 0; i < N; ++i) {
+			h = h * HASH_BASE + c[i];
+		}
+
+		for (size_t i = N;; ++i) {
+			if (!aHandler(mix(h))) {
+				return false;
+			}
+
+			if (i == s.length()) {
+				break;
 			}
-		} 
+
+			h = (h - c[i - N] * basePower) * HASH_BASE + c[i];
+		}
+
+		return true;
 	}
 
-	/* This is roughly how boost::hash does it */
-	size_t getPos(const string& s, size_t i, size_t l) const {
-		size_t h = 0;
-		const char* c = s.data() + i;
-		const char* end = s.data() + i + l;
-		for(; c < end; ++c) {
-			h ^= *c + 0x9e3779b9 + (h<<6) + (h>>2);
+	static uint64_t mix(uint64_t h) noexcept {
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+	size_t getBlock(uint64_t aHash) const noexcept {
+		return static_cast<size_t>(((aHash >> 32) * blockCount) >> 32);
+	}
+
+	static Block getMask(uint64_t aHash) noexcept {
+		Block mask;
+		for (size_t k = 0; k < K; ++k) {
+			auto bit = (aHash >> (k * BLOCK_INDEX_BITS)) & (BLOCK_BITS - 1);
+			mask.words[bit / 64] |= 1ULL << (bit % 64);
 		}
-		return (h % table.size());
+
+		return mask;
 	}
-	
-	vector<bool> table;
+
+	const size_t blockCount;
+	unique_ptr<Block[]> blocks;
 };
 
 } // namespace dcpp
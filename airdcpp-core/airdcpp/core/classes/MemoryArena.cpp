@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include "stdinc.h"
+
+#include <airdcpp/core/classes/MemoryArena.h>
+
+namespace dcpp {
+
+MemoryArena::MemoryArena(size_t aBlockSize) noexcept : blockSize(aBlockSize) {
+
+}
+
+uint8_t* MemoryArena::allocateBlock(size_t aSize) {
+	// Blocks from operator new[] are suitably aligned for all fundamental types
+	blocks.emplace_back(new uint8_t[aSize]);
+	memoryUsage += aSize;
+	return blocks.back().get();
+}
+
+void* MemoryArena::allocate(size_t aSize, size_t aAlignment) {
+	dcassert(aAlignment <= alignof(std::max_align_t));
+
+	if (pos) {
+		auto aligned = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(pos) + aAlignment - 1) & ~(static_cast<uintptr_t>(aAlignment) - 1));
+		if (aligned + aSize <= end) {
+			pos = aligned + aSize;
+			return aligned;
+		}
+	}
+
+	if (aSize > blockSize / 4) {
+		// Large items get a block of their own so that the free space in the current block won't be wasted
+		return allocateBlock(aSize);
+	}
+
+	pos = allocateBlock(blockSize);
+	end = pos + blockSize;
+
+	auto ret = pos;
+	pos += aSize;
+	return ret;
+}
+
+string_view MemoryArena::copyString(string_view aStr) {
+	auto buf = allocateArray<char>(aStr.size() + 1);
+	memcpy(buf, aStr.data(), aStr.size());
+	buf[aStr.size()] = '\0';
+	return string_view(buf, aStr.size());
+}
+
+} // namespace dcpp
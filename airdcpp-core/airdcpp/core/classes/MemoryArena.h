@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef DCPLUSPLUS_DCPP_MEMORY_ARENA_H
+#define DCPLUSPLUS_DCPP_MEMORY_ARENA_H
+
+#include <airdcpp/core/header/typedefs.h>
+
+#include <airdcpp/core/header/debug.h>
+
+#include <array>
+#include <bit>
+
+namespace dcpp {
+
+/**
+ * Monotonic (bump) allocator for large numbers of small objects that share the same lifetime
+ *
+ * Individual allocations are never freed; all memory is released at once when the arena is destroyed
+ * (destructors of the allocated objects aren't called). The class isn't thread safe.
+ */
+class MemoryArena {
+public:
+	static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+	explicit MemoryArena(size_t aBlockSize = DEFAULT_BLOCK_SIZE) noexcept;
+	~MemoryArena() = default;
+
+	// Throws std::bad_alloc
+	void* allocate(size_t aSize, size_t aAlignment);
+
+	// Throws std::bad_alloc
+	template<class T>
+	T* allocateArray(size_t aCount) {
+		static_assert(std::is_trivially_destructible_v<T>);
+		return static_cast<T*>(allocate(aCount * sizeof(T), alignof(T)));
+	}
+
+	// Copies the string in the arena (the result is null-terminated)
+	// Throws std::bad_alloc
+	string_view copyString(string_view aStr);
+
+	// Total size of the allocated blocks
+	size_t getMemoryUsage() const noexcept {
+		return memoryUsage;
+	}
+
+	MemoryArena(const MemoryArena&) = delete;
+	MemoryArena& operator=(const MemoryArena&) = delete;
+private:
+	uint8_t* allocateBlock(size_t aSize);
+
+	const size_t blockSize;
+	vector<unique_ptr<uint8_t[]>> blocks;
+
+	uint8_t* pos = nullptr;
+	uint8_t* end = nullptr;
+
+	size_t memoryUsage = 0;
+};
+
+/**
+ * Storage for trivially destructible objects that are referenced by 32 bit indices
+ *
+ * Objects are stored in segments with doubling sizes so that the objects never move and the
+ * segment table doesn't need to be reallocated. Individual objects can't be freed; all memory is
+ * released at once when the pool is destroyed. The class isn't thread safe.
+ */
+template<class T, size_t FirstSegmentBits = 8>
+class IndexedPool {
+	static_assert(std::is_trivially_destructible_v<T>, "Destructors of pooled objects won't be called");
+public:
+	using Index = uint32_t;
+
+	IndexedPool() noexcept = default;
+	~IndexedPool() {
+		for (auto segment: segments) {
+			::operator delete(segment);
+		}
+	}
+
+	// Throws std::bad_alloc
+	template<typename... ArgT>
+	Index emplace(ArgT&&... aArgs) {
+		auto index = count;
+		auto [segment, offset] = locate(index);
+		if (!segments[segment]) {
+			// Untouched pages of the large segments won't be committed by most allocators
+			segments[segment] = static_cast<T*>(::operator new(segmentSize(segment) * sizeof(T)));
+		}
+
+		new (&segments[segment][offset]) T(std::forward<ArgT>(aArgs)...);
+		count++;
+		return index;
+	}
+
+	T& operator[](Index aIndex) noexcept {
+		dcassert(aIndex < count);
+		auto [segment, offset] = locate(aIndex);
+		return segments[segment][offset];
+	}
+
+	const T& operator[](Index aIndex) const noexcept {
+		dcassert(aIndex < count);
+		auto [segment, offset] = locate(aIndex);
+		return segments[segment][offset];
+	}
+
+	size_t size() const noexcept {
+		return count;
+	}
+
+	IndexedPool(const IndexedPool&) = delete;
+	IndexedPool& operator=(const IndexedPool&) = delete;
+private:
+	// Segment N holds 2^(FirstSegmentBits + N) objects
+	static constexpr size_t MAX_SEGMENTS = 32 - FirstSegmentBits + 1;
+
+	static constexpr size_t segmentSize(size_t aSegment) noexcept {
+		return static_cast<size_t>(1) << (FirstSegmentBits + aSegment);
+	}
+
+	static pair<size_t, size_t> locate(Index aIndex) noexcept {
+		auto position = (static_cast<uint64_t>(aIndex) >> FirstSegmentBits) + 1;
+		auto segment = static_cast<size_t>(std::bit_width(position)) - 1;
+		auto offset = static_cast<size_t>(aIndex) - ((segmentSize(segment) - (static_cast<size_t>(1) << FirstSegmentBits)));
+		return { segment, offset };
+	}
+
+	array<T*, MAX_SEGMENTS> segments = {};
+	Index count = 0;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_MEMORY_ARENA_H)
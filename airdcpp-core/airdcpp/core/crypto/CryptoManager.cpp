@@ -58,6 +58,13 @@ CryptoManager::CryptoManager()
 		SSL_CTX_set_options(clientContext, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_NO_COMPRESSION);
 		SSL_CTX_set_options(serverContext, SSL_OP_SINGLE_DH_USE | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_NO_COMPRESSION);
 
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(OPENSSL_NO_KTLS)
+		// Let the kernel handle the record layer when it's supported (OpenSSL falls back to normal operation otherwise)
+		// Uploads can then be sent with SSL_sendfile without copying the data via user space
+		SSL_CTX_set_options(clientContext, SSL_OP_ENABLE_KTLS);
+		SSL_CTX_set_options(serverContext, SSL_OP_ENABLE_KTLS);
+#endif
+
 		setContextOptions(clientContext, false);
 		setContextOptions(serverContext, true);
 
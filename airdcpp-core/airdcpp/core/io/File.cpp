@@ -45,6 +45,10 @@
 #include <mntent.h>
 #endif
 
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
+
 #ifdef _DEBUG
 #include <boost/date_time/posix_time/ptime.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -150,6 +154,32 @@ void File::close() noexcept {
 	}
 }
 
+File::FileId File::getFileId() const noexcept {
+	BY_HANDLE_FILE_INFORMATION info;
+	if (!::GetFileInformationByHandle(h, &info)) {
+		return FileId();
+	}
+
+	return { info.dwVolumeSerialNumber, (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow };
+}
+
+File::FileId File::getFileId(const string& aPath) noexcept {
+	// Attributes can be queried without any access rights
+	auto handle = ::CreateFile(Text::toT(PathUtil::formatPath(aPath)).c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) {
+		return FileId();
+	}
+
+	BY_HANDLE_FILE_INFORMATION info;
+	auto success = ::GetFileInformationByHandle(handle, &info);
+	::CloseHandle(handle);
+	if (!success) {
+		return FileId();
+	}
+
+	return { info.dwVolumeSerialNumber, (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow };
+}
+
 int64_t File::getSize() const noexcept {
 	LARGE_INTEGER x;
 
@@ -203,6 +233,37 @@ size_t File::write(const void* buf, size_t len) {
 	dcassert(x == len);
 	return x;
 }
+
+size_t File::readAt(void* aBuf, size_t aLen, int64_t aPos) {
+	OVERLAPPED overlapped = { 0 };
+	overlapped.Offset = (DWORD)(aPos & 0xffffffff);
+	overlapped.OffsetHigh = (DWORD)(aPos >> 32);
+
+	DWORD x;
+	if(!::ReadFile(h, aBuf, (DWORD)aLen, &x, &overlapped)) {
+		auto error = GetLastError();
+		if (error == ERROR_HANDLE_EOF) {
+			return 0;
+		}
+
+		throw FileException(SystemUtil::translateError(error));
+	}
+	return x;
+}
+
+size_t File::writeAt(const void* aBuf, size_t aLen, int64_t aPos) {
+	OVERLAPPED overlapped = { 0 };
+	overlapped.Offset = (DWORD)(aPos & 0xffffffff);
+	overlapped.OffsetHigh = (DWORD)(aPos >> 32);
+
+	DWORD x;
+	if(!::WriteFile(h, aBuf, (DWORD)aLen, &x, &overlapped)) {
+		throw FileException(SystemUtil::translateError(GetLastError()));
+	}
+	dcassert(x == aLen);
+	return x;
+}
+
 void File::setEOF() {
 	dcassert(isOpen());
 	if(!SetEndOfFile(h)) {
@@ -250,6 +311,9 @@ size_t File::flushBuffers(bool aForce) {
 }
 
 void File::renameFile(const string& source, const string& target) {
+	onPathModified(source);
+	onPathModified(target);
+
 	if(!::MoveFileEx(Text::toT(PathUtil::formatPath(source)).c_str(), Text::toT(PathUtil::formatPath(target)).c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_COPY_ALLOWED | MOVEFILE_WRITE_THROUGH)) {
 		throw FileException(SystemUtil::translateError(GetLastError()));
 	}
@@ -286,6 +350,8 @@ bool File::isHidden(const string& aPath) noexcept {
 }
 
 void File::deleteFileThrow(const string& aFileName) {
+	onPathModified(aFileName);
+
 	if (!::DeleteFile(Text::toT(PathUtil::formatPath(aFileName)).c_str())) {
 		throw FileException(SystemUtil::translateError(GetLastError()));
 	}
@@ -341,6 +407,11 @@ int64_t File::getDeviceId(const string& aPath) noexcept {
 	return ret > 0 ? dwSerialNumber : -1;
 }
 
+bool File::isRotationalDevice(int64_t /*aDeviceId*/) noexcept {
+	// Not implemented
+	return true;
+}
+
 string File::getMountPath(const string& aPath) noexcept {
 	unique_ptr<TCHAR[]> buf(new TCHAR[aPath.length()+1]);
 	GetVolumePathName(Text::toT(PathUtil::formatPath(aPath)).c_str(), buf.get(), aPath.length());
@@ -467,6 +538,22 @@ int64_t File::getSize() const noexcept {
 	return (int64_t)s.st_size;
 }
 
+File::FileId File::getFileId() const noexcept {
+	struct stat s;
+	if (::fstat(h, &s) == -1)
+		return FileId();
+
+	return { static_cast<uint64_t>(s.st_dev), static_cast<uint64_t>(s.st_ino) };
+}
+
+File::FileId File::getFileId(const string& aPath) noexcept {
+	struct stat s;
+	if (::stat(aPath.c_str(), &s) == -1)
+		return FileId();
+
+	return { static_cast<uint64_t>(s.st_dev), static_cast<uint64_t>(s.st_ino) };
+}
+
 int64_t File::getPos() const noexcept {
 	return (int64_t)lseek(h, 0, SEEK_CUR);
 }
@@ -511,6 +598,38 @@ size_t File::write(const void* buf, size_t len) {
 	return len;
 }
 
+size_t File::readAt(void* aBuf, size_t aLen, int64_t aPos) {
+	for (;;) {
+		ssize_t result = ::pread(h, aBuf, aLen, (off_t)aPos);
+		if (result != -1) {
+			return (size_t)result;
+		}
+
+		if (errno != EINTR) {
+			throw FileException(SystemUtil::translateError(errno));
+		}
+	}
+}
+
+size_t File::writeAt(const void* aBuf, size_t aLen, int64_t aPos) {
+	auto pointer = (const char*)aBuf;
+	size_t left = aLen;
+
+	while (left > 0) {
+		ssize_t result = ::pwrite(h, pointer, left, (off_t)aPos);
+		if (result == -1) {
+			if (errno != EINTR) {
+				throw FileException(SystemUtil::translateError(errno));
+			}
+		} else {
+			pointer += result;
+			aPos += result;
+			left -= result;
+		}
+	}
+	return aLen;
+}
+
 // some ftruncate implementations can't extend files like SetEndOfFile,
 // not sure if the client code needs this...
 int File::extendFile(int64_t len) noexcept {
@@ -563,6 +682,9 @@ size_t File::flushBuffers(bool aForce) {
  * work across different mount points, even if the same filesystem is mounted on both.)
 */
 void File::renameFile(const string& source, const string& target) {
+	onPathModified(source);
+	onPathModified(target);
+
 	int ret = ::rename(source.c_str(), target.c_str());
 	if(ret != 0 && errno == EXDEV) {
 		copyFile(source, target);
@@ -592,6 +714,8 @@ void File::copyFile(const string& source, const string& target) {
 }
 
 void File::deleteFileThrow(const string& aFileName) {
+	onPathModified(aFileName);
+
 	auto result = ::unlink(aFileName.c_str());
 	if (result == -1) {
 		throw FileException(SystemUtil::translateError(result));
@@ -669,6 +793,34 @@ int64_t File::getDeviceId(const string& aPath) noexcept {
 	return (int64_t)statbuf.st_dev;
 }
 
+bool File::isRotationalDevice(int64_t aDeviceId) noexcept {
+#ifdef __linux__
+	if (aDeviceId < 0) {
+		return true;
+	}
+
+	auto devicePath = "/sys/dev/block/" + Util::toString(major(aDeviceId)) + ":" + Util::toString(minor(aDeviceId));
+
+	// Partitions don't have the queue information
+	for (const auto& queuePath: { devicePath + "/queue/rotational", devicePath + "/../queue/rotational" }) {
+		auto fd = ::open(queuePath.c_str(), O_RDONLY);
+		if (fd == -1) {
+			continue;
+		}
+
+		char value = 0;
+		auto n = ::read(fd, &value, 1);
+		::close(fd);
+
+		if (n == 1) {
+			return value != '0';
+		}
+	}
+#endif
+
+	return true;
+}
+
 time_t File::getLastModified(const string& aPath) noexcept {
 	struct stat statbuf;
 	if (stat(aPath.c_str(), &statbuf) == -1) {
@@ -722,10 +874,22 @@ std::string File::makeAbsolutePath(const std::string& aPath, const std::string&
 
 #endif // !_WIN32
 
+atomic<File::PathModifiedHook> File::pathModifiedHook { nullptr };
+
 File::~File() {
 	File::close();
 }
 
+void File::setPathModifiedHook(PathModifiedHook aHook) noexcept {
+	pathModifiedHook = aHook;
+}
+
+void File::onPathModified(const string& aPath) noexcept {
+	if (auto hook = pathModifiedHook.load(); hook) {
+		hook(aPath);
+	}
+}
+
 std::string File::makeAbsolutePath(const std::string& aFilename) {
 	if (isAbsolutePath(aFilename)) {
 		return aFilename;
@@ -820,6 +984,16 @@ string File::read() {
 	return read((size_t)sz);
 }
 
+const File* File::getDirectFile(int64_t& pos_, int64_t& bytesLeft_) noexcept {
+	pos_ = getPos();
+	bytesLeft_ = max(getSize() - pos_, static_cast<int64_t>(0));
+	return this;
+}
+
+void File::skip(int64_t aBytes) noexcept {
+	movePos(aBytes);
+}
+
 string FilesystemItem::getPath(const string& aBasePath) const noexcept {
 	if (isDirectory) {
 		return PathUtil::joinDirectory(aBasePath, name);
@@ -1094,6 +1268,7 @@ FileFindIter::FileFindIter(const string& aPath, const string& aPattern, bool aDi
 	}
 
 	data.base = aPath;
+	data.dirFd = dirfd(dir);
 	data.ent = readdir(dir);
 
 	if (aPattern != "*") {
@@ -1134,6 +1309,7 @@ FileFindIter& FileFindIter::operator++() {
 	if (!dir)
 		return *this;
 	data.ent = readdir(dir);
+	data.entryStat = DirData::EntryStat();
 	if (!data.ent) {
 		closedir(dir);
 		dir = NULL;
@@ -1155,11 +1331,29 @@ string FileFindIter::DirData::getFileName() const noexcept {
 	return ent->d_name;
 }
 
+const FileFindIter::DirData::EntryStat& FileFindIter::DirData::getStat() const noexcept {
+	if (!entryStat.loaded) {
+		entryStat.loaded = true;
+
+		struct stat inode;
+		if (fstatat(dirFd, ent->d_name, &inode, 0) == 0) {
+			entryStat.valid = true;
+			entryStat.directory = S_ISDIR(inode.st_mode);
+			entryStat.size = inode.st_size;
+			entryStat.lastWrite = inode.st_mtime;
+		}
+	}
+
+	return entryStat;
+}
+
 bool FileFindIter::DirData::isDirectory() const noexcept {
-	struct stat inode;
 	if (!ent) return false;
-	if (stat((base + PATH_SEPARATOR + ent->d_name).c_str(), &inode) == -1) return false;
-	return S_ISDIR(inode.st_mode);
+
+	// Most file systems report the type without having to stat the entry (links must be followed)
+	if (ent->d_type == DT_DIR) return true;
+	if (ent->d_type == DT_REG) return false;
+	return getStat().directory;
 }
 
 bool FileFindIter::DirData::isHidden() const noexcept {
@@ -1170,19 +1364,19 @@ bool FileFindIter::DirData::isHidden() const noexcept {
 }
 
 bool FileFindIter::DirData::isLink() const noexcept {
-	struct stat inode;
 	if (!ent) return false;
+	if (ent->d_type != DT_UNKNOWN) return ent->d_type == DT_LNK;
 	return File::isLink(base + PATH_SEPARATOR + ent->d_name);
 }
 
 int64_t FileFindIter::DirData::getSize() const noexcept {
 	if (!ent) return 0;
-	return File::getSize(base + PATH_SEPARATOR + ent->d_name);
+	return getStat().size;
 }
 
 time_t FileFindIter::DirData::getLastWriteTime() const noexcept {
 	if (!ent) return 0;
-	return File::getLastWriteTime(base + PATH_SEPARATOR + ent->d_name);
+	return getStat().lastWrite;
 }
 
 FileItem::FileItem(const string& aPath) : path(aPath) {
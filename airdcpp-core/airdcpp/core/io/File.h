@@ -125,12 +125,36 @@ public:
 	size_t read(void* buf, size_t& len) override;
 	size_t write(const void* buf, size_t len) override;
 
+	// Positional I/O, the file position is not used (or modified on Unix) so these may be called concurrently
+	size_t readAt(void* aBuf, size_t aLen, int64_t aPos);
+	size_t writeAt(const void* aBuf, size_t aLen, int64_t aPos);
+
 	// This has no effect if aForce is false
 	// Generally the operating system should decide when the buffered data is written on disk
 	size_t flushBuffers(bool aForce = true) override;
 
+	const File* getDirectFile(int64_t& pos_, int64_t& bytesLeft_) noexcept override;
+	void skip(int64_t aBytes) noexcept override;
+
 	time_t getLastModified() const noexcept;
 
+	// Identifies a file on the system (device and file index/inode)
+	struct FileId {
+		uint64_t device = 0;
+		uint64_t index = 0;
+
+		bool operator==(const FileId&) const noexcept = default;
+	};
+
+	// Returns an empty ID on errors
+	FileId getFileId() const noexcept;
+	static FileId getFileId(const string& aPath) noexcept;
+
+	// Called before a file is renamed or deleted via this class
+	// (allows other layers to release their handles to the file)
+	using PathModifiedHook = void (*)(const string& aPath) noexcept;
+	static void setPathModifiedHook(PathModifiedHook aHook) noexcept;
+
 	static bool createFile(const string& aPath, const string& aContent = Util::emptyString) noexcept;
 	static void copyFile(const string& src, const string& target);
 	static void renameFile(const string& source, const string& target);
@@ -169,6 +193,10 @@ public:
 	static string getMountPath(const string& aPath) noexcept;
 	static int64_t getDeviceId(const string& aPath) noexcept;
 
+	// Check whether the device ID (as returned by getDeviceId) belongs to a rotational disk
+	// Returns true if the type can't be detected
+	static bool isRotationalDevice(int64_t aDeviceId) noexcept;
+
 	// Parse mount point from the supplied volumes (avoids disk access)
 	static string getMountPath(const string& aPath, const VolumeSet& aVolumes, bool aIgnoreNetworkPaths) noexcept;
 
@@ -226,6 +254,10 @@ protected:
 	void close() noexcept;
 
 	FileHandleType h;
+private:
+	static void onPathModified(const string& aPath) noexcept;
+
+	static atomic<PathModifiedHook> pathModifiedHook;
 };
 
 class FileFindIter {
@@ -255,6 +287,21 @@ public:
 		#ifndef _WIN32
 			dirent *ent;
 			string base;
+			int dirFd = -1;
+		private:
+			friend class FileFindIter;
+
+			// Each entry is stat'ed only once (relative to the open directory)
+			struct EntryStat {
+				bool loaded = false;
+				bool valid = false;
+				bool directory = false;
+				int64_t size = -1;
+				time_t lastWrite = 0;
+			};
+
+			const EntryStat& getStat() const noexcept;
+			mutable EntryStat entryStat;
 		#else
 			WIN32_FIND_DATA fd;
 		#endif
@@ -28,6 +28,14 @@
 #include <airdcpp/util/Util.h>
 #include <airdcpp/util/SystemUtil.h>
 
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#ifdef HAVE_POSIX_AIO
+#include <aio.h>
+#endif
+
 namespace dcpp {
 
 using std::make_pair;
@@ -41,21 +49,25 @@ static const size_t READ_FAILED = static_cast<size_t>(-1);
 const size_t FileReader::DEFAULT_BLOCK_SIZE = 1024 * 1024;
 
 size_t FileReader::read(const string& aPath, const DataCallback& callback) {
+	return read(aPath, 0, -1, callback);
+}
+
+size_t FileReader::read(const string& aPath, int64_t aStart, int64_t aLength, const DataCallback& callback) {
 	size_t ret = READ_FAILED;
 
 	if (preferredStrategy == ASYNC) {
-		ret = readAsync(aPath, callback);
+		ret = readAsync(aPath, aStart, aLength, callback);
 	}
 
 	if (ret == READ_FAILED) {
-		ret = readSync(aPath, callback);
+		ret = readSync(aPath, aStart, aLength, callback);
 	}
 
 	return ret;
 }
 
-/** Read entire file, never returns READ_FAILED */
-size_t FileReader::readSync(const string& aPath, const DataCallback& callback) {
+/** Read entire file (or the wanted part of it), never returns READ_FAILED */
+size_t FileReader::readSync(const string& aPath, int64_t aStart, int64_t aLength, const DataCallback& callback) {
 	buffer.resize(getBlockSize(0));
 
 	auto buf = &buffer[0];
@@ -67,21 +79,29 @@ size_t FileReader::readSync(const string& aPath, const DataCallback& callback) {
 	fcntl(f.getNativeHandle(), F_NOCACHE, 1);
 #endif
 
+	if (aStart > 0) {
+		f.setPos(aStart);
+	}
+
+	auto bytesLeft = aLength < 0 ? numeric_limits<int64_t>::max() : aLength;
+	auto nextBlockSize = [&] { return static_cast<size_t>(min(static_cast<int64_t>(buffer.size()), bytesLeft)); };
+
 	size_t total = 0;
-	size_t n = buffer.size();
+	size_t n = nextBlockSize();
 	bool go = true;
-	while (f.read(buf, n) > 0 && go) {
+	while (n > 0 && f.read(buf, n) > 0 && go) {
 		go = callback(buf, n);
 
 #ifdef POSIX_FADV_DONTNEED
 		// Allow read bytes to be purged from the memory cache
-		if (posix_fadvise(f.getNativeHandle(), total, n, POSIX_FADV_DONTNEED) != 0) {
+		if (posix_fadvise(f.getNativeHandle(), aStart + total, n, POSIX_FADV_DONTNEED) != 0) {
 			throw FileException(SystemUtil::translateError(errno));
 		}
 #endif
 
 		total += n;
-		n = buffer.size();
+		bytesLeft -= n;
+		n = nextBlockSize();
 	}
 
 	return total;
@@ -112,7 +132,12 @@ struct Handle : boost::noncopyable {
 	HANDLE h;
 };
 
-size_t FileReader::readAsync(const string& aPath, const DataCallback& callback) {
+size_t FileReader::readAsync(const string& aPath, int64_t aStart, int64_t aLength, const DataCallback& callback) {
+	if (aStart != 0 || aLength >= 0) {
+		// Partial reads aren't supported
+		return READ_FAILED;
+	}
+
 	DWORD sector = 0, y;
 
 	auto tfile = Text::toT(aPath);
@@ -207,11 +232,363 @@ size_t FileReader::readAsync(const string& aPath, const DataCallback& callback)
 	return *((size_t*)&over.Offset);
 }
 
+#elif defined(HAVE_LIBURING) || defined(HAVE_POSIX_AIO)
+
+namespace {
+
+// Default number of blocks that are being read while the previous block is being processed
+static const size_t ASYNC_QUEUE_DEPTH = 4;
+
+// Offset, length and memory alignment that is valid for O_DIRECT reads with all common block devices
+static const size_t DIRECT_IO_ALIGNMENT = 4096;
+
+struct AsyncSlot {
+	uint8_t* buf = nullptr;
+	int64_t pos = 0;
+	size_t len = 0;
+	ssize_t result = 0;
+	bool pending = false;
+};
+
+#ifdef HAVE_LIBURING
+
+class UringReadQueue : boost::noncopyable {
+public:
+	UringReadQueue(int aFd, void* aBuffers, size_t aBufferBytes, unsigned aDepth) : fd(aFd) {
+		if (io_uring_queue_init(aDepth, &ring, 0) < 0) {
+			// Not supported by the kernel or blocked by seccomp/container policies
+			return;
+		}
+
+		initialized = true;
+
+		// Registered buffers avoid pinning the pages again for each read (may fail because of RLIMIT_MEMLOCK)
+		iovec iov = { aBuffers, aBufferBytes };
+		fixedBuffers = io_uring_register_buffers(&ring, &iov, 1) == 0;
+	}
+
+	~UringReadQueue() {
+		if (!initialized) {
+			return;
+		}
+
+		// The kernel may still be writing to our buffers
+		while (inFlight > 0) {
+			if (waitNext() < 0) {
+				break;
+			}
+		}
+
+		io_uring_queue_exit(&ring);
+	}
+
+	bool isInitialized() const noexcept {
+		return initialized;
+	}
+
+	bool submit(AsyncSlot& aSlot) noexcept {
+		auto sqe = io_uring_get_sqe(&ring);
+		if (!sqe) {
+			return false;
+		}
+
+		if (fixedBuffers) {
+			io_uring_prep_read_fixed(sqe, fd, aSlot.buf, static_cast<unsigned>(aSlot.len), aSlot.pos, 0);
+		} else {
+			io_uring_prep_read(sqe, fd, aSlot.buf, static_cast<unsigned>(aSlot.len), aSlot.pos);
+		}
+
+		io_uring_sqe_set_data(sqe, &aSlot);
+		if (io_uring_submit(&ring) < 0) {
+			return false;
+		}
+
+		aSlot.pending = true;
+		inFlight++;
+		return true;
+	}
+
+	ssize_t wait(AsyncSlot& aSlot) noexcept {
+		while (aSlot.pending) {
+			auto ret = waitNext();
+			if (ret < 0) {
+				return ret;
+			}
+		}
+
+		return aSlot.result;
+	}
+private:
+	// Completions may arrive in any order
+	int waitNext() noexcept {
+		io_uring_cqe* cqe = nullptr;
+
+		int ret;
+		do {
+			ret = io_uring_wait_cqe(&ring, &cqe);
+		} while (ret == -EINTR);
+
+		if (ret < 0) {
+			return ret;
+		}
+
+		auto slot = static_cast<AsyncSlot*>(io_uring_cqe_get_data(cqe));
+		slot->result = cqe->res;
+		slot->pending = false;
+		inFlight--;
+
+		io_uring_cqe_seen(&ring, cqe);
+		return 0;
+	}
+
+	io_uring ring;
+	const int fd;
+	size_t inFlight = 0;
+	bool initialized = false;
+	bool fixedBuffers = false;
+};
+
+#endif
+
+#ifdef HAVE_POSIX_AIO
+
+class PosixAioReadQueue : boost::noncopyable {
+public:
+	PosixAioReadQueue(int aFd, size_t aDepth) : fd(aFd), requests(aDepth) { }
+
+	~PosixAioReadQueue() {
+		for (auto& r : requests) {
+			if (!r.slot || !r.slot->pending) {
+				continue;
+			}
+
+			aio_cancel(fd, &r.cb);
+			waitRequest(r);
+		}
+	}
+
+	bool submit(AsyncSlot& aSlot) noexcept {
+		auto r = find_if(requests.begin(), requests.end(), [](const Request& aRequest) { return !aRequest.slot || !aRequest.slot->pending; });
+		if (r == requests.end()) {
+			return false;
+		}
+
+		memset(&r->cb, 0, sizeof(aiocb));
+		r->cb.aio_fildes = fd;
+		r->cb.aio_buf = aSlot.buf;
+		r->cb.aio_nbytes = aSlot.len;
+		r->cb.aio_offset = aSlot.pos;
+		r->cb.aio_sigevent.sigev_notify = SIGEV_NONE;
+
+		if (aio_read(&r->cb) != 0) {
+			return false;
+		}
+
+		r->slot = &aSlot;
+		aSlot.pending = true;
+		return true;
+	}
+
+	ssize_t wait(AsyncSlot& aSlot) noexcept {
+		auto r = find_if(requests.begin(), requests.end(), [&](const Request& aRequest) { return aRequest.slot == &aSlot; });
+		dcassert(r != requests.end());
+
+		waitRequest(*r);
+		return aSlot.result;
+	}
+private:
+	struct Request {
+		aiocb cb;
+		AsyncSlot* slot = nullptr;
+	};
+
+	static void waitRequest(Request& aRequest) noexcept {
+		int err;
+		while ((err = aio_error(&aRequest.cb)) == EINPROGRESS) {
+			const aiocb* list[1] = { &aRequest.cb };
+			aio_suspend(list, 1, nullptr);
+		}
+
+		auto ret = aio_return(&aRequest.cb);
+		aRequest.slot->result = err == 0 ? ret : -err;
+		aRequest.slot->pending = false;
+	}
+
+	const int fd;
+	vector<Request> requests;
+};
+
+#endif
+
+// Keeps all slots in flight and passes the blocks to the callback in file order
+template<class QueueT>
+size_t readQueued(QueueT& aQueue, File& aFile, int64_t aStart, int64_t aEnd, vector<AsyncSlot>& aSlots, bool aDirect, const FileReader::DataCallback& aCallback) {
+	auto nextPos = aStart;
+	auto submitNext = [&](AsyncSlot& aSlot) {
+		aSlot.pos = nextPos;
+		if (!aQueue.submit(aSlot)) {
+			return false;
+		}
+
+		nextPos += aSlot.len;
+		return true;
+	};
+
+	size_t queued = 0;
+	for (; queued < aSlots.size() && nextPos < aEnd; ++queued) {
+		if (!submitNext(aSlots[queued])) {
+			break;
+		}
+	}
+
+	if (queued == 0) {
+		dcdebug("Failed to queue the first asynchronous read\n");
+		return READ_FAILED;
+	}
+
+	// The slots are processed in a circular order
+	aSlots.resize(queued);
+
+	size_t total = 0;
+	for (size_t i = 0; aSlots[i].pending; i = (i + 1) % aSlots.size()) {
+		auto& slot = aSlots[i];
+		auto res = aQueue.wait(slot);
+		if (res < 0) {
+			if (total == 0) {
+				// Possibly O_DIRECT not being supported for reading after all, let the synchronous reader handle it
+				dcdebug("First asynchronous read failed: %s\n", SystemUtil::translateError(static_cast<int>(-res)).c_str());
+				return READ_FAILED;
+			}
+
+			throw FileException(SystemUtil::translateError(static_cast<int>(-res)));
+		}
+
+		// The range may end in the middle of the block
+		auto wanted = static_cast<size_t>(min(static_cast<int64_t>(slot.len), aEnd - slot.pos));
+
+		auto n = min(static_cast<size_t>(res), wanted);
+		if (aDirect && n < wanted) {
+			// O_DIRECT reads must stay aligned (the slot buffer and position are), re-read the partial block
+			n -= n % DIRECT_IO_ALIGNMENT;
+		}
+
+		while (n < wanted) {
+			// Short read in the middle of the file, fill the rest synchronously
+			auto ret = ::pread(aFile.getNativeHandle(), slot.buf + n, slot.len - n, slot.pos + n);
+			if (ret < 0) {
+				throw FileException(SystemUtil::translateError(errno));
+			}
+
+			if (ret == 0) {
+				break;
+			}
+
+			auto readStart = n;
+			n += static_cast<size_t>(ret);
+			if (aDirect && n < wanted) {
+				auto aligned = n - n % DIRECT_IO_ALIGNMENT;
+				if (aligned <= readStart) {
+					// Not even a full block was read (truncated file?), keep what we got
+					break;
+				}
+
+				n = aligned;
+			}
+		}
+
+		n = min(n, wanted);
+		if (n == 0) {
+			// The file was truncated
+			break;
+		}
+
+		auto go = aCallback(slot.buf, n);
+
+#ifdef POSIX_FADV_DONTNEED
+		// Allow read bytes to be purged from the memory cache (not cached in the first place with O_DIRECT)
+		if (!aDirect && posix_fadvise(aFile.getNativeHandle(), slot.pos, n, POSIX_FADV_DONTNEED) != 0) {
+			throw FileException(SystemUtil::translateError(errno));
+		}
+#endif
+
+		total += n;
+		if (!go) {
+			break;
+		}
+
+		if (nextPos < aEnd && !submitNext(slot)) {
+			throw FileException("Failed to queue an asynchronous read");
+		}
+	}
+
+	return total;
+}
+
+}
+
+size_t FileReader::readAsync(const string& aPath, int64_t aStart, int64_t aLength, const DataCallback& callback) {
+	unique_ptr<File> f;
+
+	// Direct reads must start from an aligned position
+	auto direct = aStart % DIRECT_IO_ALIGNMENT == 0;
+	if (direct) {
+		try {
+			f = make_unique<File>(aPath, File::READ, File::OPEN | File::SHARED_WRITE, File::BUFFER_NONE);
+		} catch (const FileException& e) {
+			// O_DIRECT isn't supported by all filesystems (such as tmpfs)
+			dcdebug("Failed to open unbuffered file: %s\n", e.getError().c_str());
+			direct = false;
+		}
+	}
+
+	if (!direct) {
+		f = make_unique<File>(aPath, File::READ, File::OPEN | File::SHARED_WRITE, File::BUFFER_SEQUENTIAL);
+	}
+
+	auto end = f->getSize();
+	if (aLength >= 0) {
+		end = min(end, aStart + aLength);
+	}
+
+	if (end <= aStart) {
+		return 0;
+	}
+
+	auto bufSize = getBlockSize(DIRECT_IO_ALIGNMENT);
+	auto depth = min(queueDepth > 0 ? queueDepth : ASYNC_QUEUE_DEPTH, static_cast<size_t>((end - aStart + bufSize - 1) / bufSize));
+
+	buffer.resize(bufSize * depth + DIRECT_IO_ALIGNMENT);
+	auto buf = static_cast<uint8_t*>(align(&buffer[0], DIRECT_IO_ALIGNMENT));
+
+	vector<AsyncSlot> slots(depth);
+	for (size_t i = 0; i < depth; ++i) {
+		slots[i].buf = buf + i * bufSize;
+		slots[i].len = bufSize;
+	}
+
+	auto fd = f->getNativeHandle();
+
+#ifdef HAVE_LIBURING
+	{
+		UringReadQueue queue(fd, buf, bufSize * depth, static_cast<unsigned>(depth));
+		if (queue.isInitialized()) {
+			return readQueued(queue, *f, aStart, end, slots, direct, callback);
+		}
+	}
+#endif
+
+#ifdef HAVE_POSIX_AIO
+	PosixAioReadQueue queue(fd, depth);
+	return readQueued(queue, *f, aStart, end, slots, direct, callback);
+#else
+	return READ_FAILED;
+#endif
+}
+
 #else
 
-size_t FileReader::readAsync(const string& file, const DataCallback& callback) {
-	// Not implemented yet
-	// https://bugs.launchpad.net/dcplusplus/+bug/1909861
+size_t FileReader::readAsync(const string& /*aPath*/, int64_t /*aStart*/, int64_t /*aLength*/, const DataCallback& /*callback*/) {
+	// No asynchronous I/O API available
 	return READ_FAILED;
 }
 
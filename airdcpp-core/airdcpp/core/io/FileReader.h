@@ -48,8 +48,9 @@ public:
 	 * Set up file reader
 	 * @param direct Bypass system caches - good for reading files which are not in the cache and should not be there (for example when hashing)
 	 * @param blockSize Read block size, 0 = use default
+	 * @param queueDepth Maximum number of blocks being read in advance with asynchronous reads (where supported), 0 = use default
 	 */
-	FileReader(Strategy preferredStrategy, size_t blockSize = 0) : preferredStrategy(preferredStrategy), blockSize(blockSize) { }
+	FileReader(Strategy preferredStrategy, size_t blockSize = 0, size_t queueDepth = 0) : preferredStrategy(preferredStrategy), blockSize(blockSize), queueDepth(queueDepth) { }
 
 	/**
 	 * Read file - callback will be called for each read chunk which may or may not be a multiple of the requested block size.
@@ -60,12 +61,22 @@ public:
 	 */
 	size_t read(const string& file, const DataCallback& callback);
 
+	/**
+	 * Read a part of the file
+	 * @param aStart Start position
+	 * @param aLength Maximum number of bytes to read, -1 = until the end of file
+	 * @return The number of bytes actually read
+	 * @throw FileException if the read fails
+	 */
+	size_t read(const string& file, int64_t aStart, int64_t aLength, const DataCallback& callback);
+
 private:
 	static const size_t DEFAULT_BLOCK_SIZE;
 
 	string file;
 	Strategy preferredStrategy;
 	size_t blockSize;
+	size_t queueDepth;
 
 	vector<uint8_t> buffer;
 
@@ -73,8 +84,8 @@ private:
 	size_t getBlockSize(size_t alignment);
 	void* align(void* buf, size_t alignment);
 
-	size_t readAsync(const string& aFile, const DataCallback& callback);
-	size_t readSync(const string& aFile, const DataCallback& callback);
+	size_t readAsync(const string& aFile, int64_t aStart, int64_t aLength, const DataCallback& callback);
+	size_t readSync(const string& aFile, int64_t aStart, int64_t aLength, const DataCallback& callback);
 };
 
 }
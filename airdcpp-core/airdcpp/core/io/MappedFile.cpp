@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include <airdcpp/core/io/MappedFile.h>
+
+#include <airdcpp/core/classes/Exception.h>
+#include <airdcpp/util/SystemUtil.h>
+
+#ifdef _WIN32
+#include <airdcpp/core/header/w.h>
+#else
+#include <sys/mman.h>
+#include <errno.h>
+#endif
+
+namespace dcpp {
+
+MappedFile::MappedFile(const string& aPath) : file(aPath, File::READ, File::OPEN | File::SHARED_WRITE, File::BUFFER_SEQUENTIAL) {
+	auto fileSize = file.getSize();
+	if (fileSize <= 0) {
+		// Empty files can't be mapped
+		return;
+	}
+
+	length = static_cast<size_t>(fileSize);
+
+#ifdef _WIN32
+	mapping = CreateFileMapping(file.getNativeHandle(), NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) {
+		throw FileException(SystemUtil::translateError(GetLastError()));
+	}
+
+	view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view) {
+		auto error = GetLastError();
+		CloseHandle(mapping);
+		throw FileException(SystemUtil::translateError(error));
+	}
+#else
+	view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file.getNativeHandle(), 0);
+	if (view == MAP_FAILED) {
+		view = nullptr;
+		throw FileException(SystemUtil::translateError(errno));
+	}
+
+	// The content is read sequentially
+	madvise(view, length, MADV_SEQUENTIAL);
+#endif
+}
+
+MappedFile::~MappedFile() noexcept {
+	if (!view) {
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(view);
+	CloseHandle(mapping);
+#else
+	munmap(view, length);
+#endif
+}
+
+} // namespace dcpp
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_MAPPED_FILE_H
+#define DCPLUSPLUS_DCPP_MAPPED_FILE_H
+
+#include <airdcpp/core/io/File.h>
+
+namespace dcpp {
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+	// Throws FileException
+	explicit MappedFile(const string& aPath);
+	~MappedFile() noexcept;
+
+	const uint8_t* data() const noexcept { return static_cast<const uint8_t*>(view); }
+	size_t size() const noexcept { return length; }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+private:
+	File file;
+	size_t length = 0;
+	void* view = nullptr;
+
+#ifdef _WIN32
+	HANDLE mapping = NULL;
+#endif
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_MAPPED_FILE_H)
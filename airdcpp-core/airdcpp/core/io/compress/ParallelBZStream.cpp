@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include <airdcpp/core/io/compress/ParallelBZStream.h>
+
+#include <airdcpp/core/classes/Exception.h>
+#include <airdcpp/core/localization/ResourceManager.h>
+#include <airdcpp/core/thread/TaskPool.h>
+
+#include <bzlib.h>
+
+namespace dcpp {
+
+// bzip2 -9 blocks fit 899981 bytes after the initial run-length encoding, which may expand the data by 25%
+// Keeping the input below that guarantees that each compressed stream contains exactly one block
+#define BLOCK_INPUT_SIZE 700000
+
+#define OUTPUT_BUFFER_SIZE 128 * 1024
+
+// Stream header, 48 bit block/end of stream magics, 32 bit CRCs
+#define STREAM_HEADER "BZh9"
+#define STREAM_HEADER_BITS 32
+#define BLOCK_CRC_POS (STREAM_HEADER_BITS + 48)
+#define TRAILER_BITS (48 + 32)
+
+static uint32_t readBits(const uint8_t* aData, size_t aPos, int aBits) noexcept {
+	uint32_t ret = 0;
+	for (int i = 0; i < aBits; ++i) {
+		auto pos = aPos + i;
+		ret = (ret << 1) | ((aData[pos / 8] >> (7 - pos % 8)) & 1);
+	}
+
+	return ret;
+}
+
+ParallelBZOutputStream::ParallelBZOutputStream(OutputStream* aStream) : s(aStream), maxQueuedBlocks((TaskPool::getInstance().getWorkerCount() + 1) * 2) {
+	input.reserve(BLOCK_INPUT_SIZE);
+	if (s) {
+		output = STREAM_HEADER;
+	}
+}
+
+ParallelBZOutputStream::ParallelBZOutputStream() : ParallelBZOutputStream(nullptr) {
+
+}
+
+ParallelBZOutputStream::~ParallelBZOutputStream() {
+	// The tasks reference us
+	for (const auto& b: blocks) {
+		waitBlock(b);
+	}
+}
+
+size_t ParallelBZOutputStream::write(const void* buf, size_t len) {
+	if (flushed)
+		throw Exception("No filtered writes after flush");
+
+	auto data = static_cast<const char*>(buf);
+	inputSize += len;
+
+	size_t written = 0;
+	while (len > 0) {
+		auto n = min(len, static_cast<size_t>(BLOCK_INPUT_SIZE) - input.size());
+		input.append(data, n);
+		data += n;
+		len -= n;
+
+		if (input.size() == BLOCK_INPUT_SIZE) {
+			queueBlock();
+			written += writeFinishedBlocks(blocks.size() >= maxQueuedBlocks);
+		}
+	}
+
+	return written;
+}
+
+size_t ParallelBZOutputStream::flushBuffers(bool aForce) {
+	if (flushed)
+		return 0;
+
+	flushed = true;
+	if (!input.empty()) {
+		queueBlock();
+	}
+
+	size_t written = 0;
+	while (!blocks.empty()) {
+		written += writeFinishedBlocks(true);
+	}
+
+	if (!s) {
+		outputBits = output.size() * 8 + bitCount;
+		if (bitCount > 0) {
+			putBits(0, 8 - bitCount);
+		}
+
+		return written;
+	}
+
+	// End of stream
+	putBits(0x177245, 24);
+	putBits(0x385090, 24);
+	putBits(combinedCRC, 32);
+	if (bitCount > 0) {
+		putBits(0, 8 - bitCount);
+	}
+
+	written += writeOutput(true);
+	return written + s->flushBuffers(aForce);
+}
+
+size_t ParallelBZOutputStream::write(const Blocks& aBlocks) {
+	if (flushed)
+		throw Exception("No filtered writes after flush");
+
+	if (!input.empty()) {
+		queueBlock();
+	}
+
+	size_t written = 0;
+	while (!blocks.empty()) {
+		written += writeFinishedBlocks(true);
+	}
+
+	putData(reinterpret_cast<const uint8_t*>(aBlocks.data.data()), 0, aBlocks.bits);
+	addBlockCRC(aBlocks.combinedCRC, aBlocks.count);
+	return written + writeOutput(false);
+}
+
+ParallelBZOutputStream::Blocks ParallelBZOutputStream::releaseBlocks() noexcept {
+	dcassert(!s && flushed);
+
+	Blocks ret;
+	ret.data.swap(output);
+	ret.bits = outputBits;
+	ret.count = blockCount;
+	ret.combinedCRC = combinedCRC;
+	return ret;
+}
+
+void ParallelBZOutputStream::queueBlock() {
+	auto block = make_shared<Block>();
+	block->data.swap(input);
+	input.reserve(BLOCK_INPUT_SIZE);
+
+	blocks.push_back(block);
+	TaskPool::getInstance().submit([this, block] {
+		compressBlock(block);
+	});
+}
+
+void ParallelBZOutputStream::compressBlock(const BlockPtr& aBlock) noexcept {
+	string compressed;
+	std::exception_ptr error;
+
+	try {
+		auto& data = aBlock->data;
+
+		// Worst case size (as per bzlib documentation)
+		auto len = static_cast<unsigned int>(data.size() + data.size() / 100 + 600);
+		compressed.resize(len);
+
+		if (BZ2_bzBuffToBuffCompress(compressed.data(), &len, data.data(), static_cast<unsigned int>(data.size()), 9, 0, 30) != BZ_OK) {
+			throw Exception(STRING(COMPRESSION_ERROR));
+		}
+
+		compressed.resize(len);
+	} catch (...) {
+		error = std::current_exception();
+	}
+
+	// Notify while holding the lock, the stream may be destroyed right after the block is done
+	std::lock_guard<std::mutex> l(cs);
+	aBlock->data.swap(compressed);
+	aBlock->error = error;
+	aBlock->done = true;
+	blockCompleted.notify_all();
+}
+
+void ParallelBZOutputStream::waitBlock(const BlockPtr& aBlock) noexcept {
+	auto& pool = TaskPool::getInstance();
+	for (;;) {
+		{
+			std::lock_guard<std::mutex> l(cs);
+			if (aBlock->done) {
+				return;
+			}
+		}
+
+		// Help with the compression instead of idling
+		if (!pool.runPendingTask()) {
+			break;
+		}
+	}
+
+	std::unique_lock<std::mutex> l(cs);
+	blockCompleted.wait(l, [&aBlock] { return aBlock->done; });
+}
+
+size_t ParallelBZOutputStream::writeFinishedBlocks(bool aWaitOldest) {
+	if (aWaitOldest && !blocks.empty()) {
+		waitBlock(blocks.front());
+	}
+
+	while (!blocks.empty()) {
+		auto block = blocks.front();
+		{
+			std::lock_guard<std::mutex> l(cs);
+			if (!block->done) {
+				break;
+			}
+		}
+
+		blocks.pop_front();
+		if (block->error) {
+			std::rethrow_exception(block->error);
+		}
+
+		appendBlock(block->data);
+	}
+
+	return writeOutput(false);
+}
+
+void ParallelBZOutputStream::appendBlock(const string& aCompressed) {
+	auto data = reinterpret_cast<const uint8_t*>(aCompressed.data());
+	auto totalBits = aCompressed.size() * 8;
+	if (totalBits < BLOCK_CRC_POS + 32 + TRAILER_BITS || aCompressed.compare(0, 4, STREAM_HEADER) != 0) {
+		throw Exception(STRING(COMPRESSION_ERROR));
+	}
+
+	auto blockCRC = readBits(data, BLOCK_CRC_POS, 32);
+
+	// The trailer may be followed by up to 7 bits of padding
+	// The combined CRC of a single block stream equals to the block CRC
+	size_t blockEnd = 0;
+	for (size_t padding = 0; padding < 8; ++padding) {
+		auto pos = totalBits - padding - TRAILER_BITS;
+		if (readBits(data, pos, 24) == 0x177245 && readBits(data, pos + 24, 24) == 0x385090 && readBits(data, pos + 48, 32) == blockCRC) {
+			blockEnd = pos;
+			break;
+		}
+	}
+
+	if (blockEnd == 0) {
+		throw Exception(STRING(COMPRESSION_ERROR));
+	}
+
+	putData(data, STREAM_HEADER_BITS, blockEnd);
+	addBlockCRC(blockCRC, 1);
+}
+
+void ParallelBZOutputStream::addBlockCRC(uint32_t aCRC, uint32_t aBlockCount) noexcept {
+	// The combined CRC is rotated by one bit for each block
+	auto rotate = aBlockCount % 32;
+	if (rotate > 0) {
+		combinedCRC = (combinedCRC << rotate) | (combinedCRC >> (32 - rotate));
+	}
+
+	combinedCRC ^= aCRC;
+	blockCount += aBlockCount;
+}
+
+void ParallelBZOutputStream::putBits(uint32_t aValue, int aBits) noexcept {
+	bitBuffer = (bitBuffer << aBits) | (aValue & ((1ULL << aBits) - 1));
+	bitCount += aBits;
+
+	while (bitCount >= 8) {
+		bitCount -= 8;
+		output.push_back(static_cast<char>((bitBuffer >> bitCount) & 0xFF));
+	}
+}
+
+void ParallelBZOutputStream::putData(const uint8_t* aData, size_t aBeginBit, size_t aEndBit) noexcept {
+	dcassert(aBeginBit % 8 == 0);
+
+	auto pos = aBeginBit;
+	if (bitCount == 0) {
+		auto bytes = (aEndBit - pos) / 8;
+		output.append(reinterpret_cast<const char*>(aData + pos / 8), bytes);
+		pos += bytes * 8;
+	} else {
+		for (; pos + 8 <= aEndBit; pos += 8) {
+			putBits(aData[pos / 8], 8);
+		}
+	}
+
+	if (pos < aEndBit) {
+		auto bits = static_cast<int>(aEndBit - pos);
+		putBits(aData[pos / 8] >> (8 - bits), bits);
+	}
+}
+
+size_t ParallelBZOutputStream::writeOutput(bool aAll) {
+	if (!s || output.empty() || (!aAll && output.size() < OUTPUT_BUFFER_SIZE)) {
+		return 0;
+	}
+
+	auto written = s->write(output);
+	output.clear();
+	return written;
+}
+
+} // namespace dcpp
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_PARALLEL_BZ_STREAM_H
+#define DCPLUSPLUS_DCPP_PARALLEL_BZ_STREAM_H
+
+#include <airdcpp/core/io/stream/StreamBase.h>
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+
+namespace dcpp {
+
+/**
+ * bzip2 compressor that compresses the blocks in parallel using the task pool
+ *
+ * Each block is compressed independently and the blocks are spliced into a single bzip2 stream
+ * (unlike with pbzip2, the output doesn't consist of concatenated streams because many decompressors,
+ * including ours, stop reading after the first stream end marker).
+ *
+ * The output is written in the original order by the thread that writes into the stream. The number
+ * of blocks being compressed at once is limited so that the memory usage won't depend on the data size.
+ *
+ * Compressed blocks can also be collected in memory and appended in other streams later without
+ * compressing the data again.
+ */
+class ParallelBZOutputStream : public OutputStream {
+public:
+	using OutputStream::write;
+
+	// Sequence of compressed blocks without the stream header/trailer (not byte-aligned)
+	struct Blocks {
+		string data;
+		size_t bits = 0;
+		uint32_t count = 0;
+		uint32_t combinedCRC = 0;
+
+		size_t getMemoryUsage() const noexcept { return data.capacity(); }
+	};
+
+	explicit ParallelBZOutputStream(OutputStream* aStream);
+
+	// Collects the compressed blocks in memory (see releaseBlocks)
+	ParallelBZOutputStream();
+	~ParallelBZOutputStream() override;
+
+	size_t write(const void* buf, size_t len) override;
+	size_t flushBuffers(bool aForce) override;
+
+	// Ends the current block and appends previously compressed blocks in the stream
+	size_t write(const Blocks& aBlocks);
+
+	// Returns the collected blocks after the stream has been flushed
+	Blocks releaseBlocks() noexcept;
+
+	// Uncompressed bytes written into the stream
+	int64_t getInputSize() const noexcept { return inputSize; }
+private:
+	struct Block {
+		string data; // Input, replaced with the compressed stream after the compression
+		bool done = false;
+		std::exception_ptr error;
+	};
+
+	using BlockPtr = shared_ptr<Block>;
+
+	void queueBlock();
+	void compressBlock(const BlockPtr& aBlock) noexcept;
+
+	// Writes the finished blocks in order, the oldest block is waited for if aWaitOldest is set
+	size_t writeFinishedBlocks(bool aWaitOldest);
+	void waitBlock(const BlockPtr& aBlock) noexcept;
+
+	// Appends the compressed block data without the stream header/trailer
+	void appendBlock(const string& aCompressed);
+
+	void addBlockCRC(uint32_t aCRC, uint32_t aBlockCount) noexcept;
+
+	void putBits(uint32_t aValue, int aBits) noexcept;
+	void putData(const uint8_t* aData, size_t aBeginBit, size_t aEndBit) noexcept;
+	size_t writeOutput(bool aAll);
+
+	// Null when collecting the blocks in memory
+	OutputStream* s;
+
+	string input;
+	std::deque<BlockPtr> blocks;
+	const size_t maxQueuedBlocks;
+
+	std::mutex cs;
+	std::condition_variable blockCompleted;
+
+	string output;
+	uint64_t bitBuffer = 0;
+	int bitCount = 0;
+	uint32_t combinedCRC = 0;
+	uint32_t blockCount = 0;
+	size_t outputBits = 0;
+
+	int64_t inputSize = 0;
+	bool flushed = false;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_PARALLEL_BZ_STREAM_H)
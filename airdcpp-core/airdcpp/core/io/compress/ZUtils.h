@@ -80,6 +80,9 @@ public:
 	// TODO 64-bits?
 	void operator()(const void* buf, size_t len) { crc = crc32(crc, (const Bytef*)buf, (uInt)len); }
 	uint32_t getValue() const { return crc; }
+
+	// Append the checksum of the data following the data processed by this filter
+	void combine(uint32_t aNextCRC, int64_t aNextLength) { crc = crc32_combine(crc, aNextCRC, (z_off_t)aNextLength); }
 private:
 	uint32_t crc;
 };
@@ -25,6 +25,7 @@
 #include <airdcpp/util/text/Text.h>
 
 #include <functional>
+#include <optional>
 
 namespace dcpp {
 
@@ -34,6 +35,23 @@ class DbSnapshot {
 
 };
 
+// A group of writes that should be committed to the database at once
+class DbWriteBatch {
+public:
+	// Value is unset for removed keys
+	using Operation = std::pair<string, std::optional<string>>;
+	using OperationList = std::vector<Operation>;
+
+	void put(string&& aKey, string&& aValue) noexcept { operations.emplace_back(std::move(aKey), std::move(aValue)); }
+	void remove(string&& aKey) noexcept { operations.emplace_back(std::move(aKey), std::nullopt); }
+
+	const OperationList& getOperations() const noexcept { return operations; }
+	size_t size() const noexcept { return operations.size(); }
+	bool empty() const noexcept { return operations.empty(); }
+private:
+	OperationList operations;
+};
+
 // Most methods throw DbException in case of errors
 class DbHandler : boost::noncopyable {
 public:
@@ -44,8 +62,32 @@ public:
 
 	virtual void put(void* key, size_t keyLen, void* value, size_t valueLen, DbSnapshot* aSnapshot = nullptr) = 0;
 	virtual bool get(void* key, size_t keyLen, size_t initialValueLen, std::function<bool(void* aValue, size_t aValueLen)> loadF, DbSnapshot* aSnapshot = nullptr) = 0;
+
+	// Reads multiple keys at once (the keys must be sorted), loadF is called for each found key
+	// Databases without native support will read the keys one by one
+	using MultiLoadF = std::function<void(size_t aKeyIndex, void* aValue, size_t aValueLen)>;
+	virtual void getMultiple(const std::vector<string>& aSortedKeys, size_t initialValueLen, const MultiLoadF& loadF, DbSnapshot* aSnapshot = nullptr) {
+		for (size_t i = 0; i < aSortedKeys.size(); ++i) {
+			const auto& key = aSortedKeys[i];
+			get((void*)key.data(), key.size(), initialValueLen, [&](void* aValue, size_t aValueLen) {
+				loadF(i, aValue, aValueLen);
+				return true;
+			}, aSnapshot);
+		}
+	}
 	virtual void remove(void* aKey, size_t keyLen, DbSnapshot* aSnapshot = nullptr) = 0;
 
+	// Databases without native batch support will apply the operations one by one
+	virtual void write(const DbWriteBatch& aBatch) {
+		for (const auto& [key, value]: aBatch.getOperations()) {
+			if (value) {
+				put((void*)key.data(), key.size(), (void*)value->data(), value->size());
+			} else {
+				remove((void*)key.data(), key.size());
+			}
+		}
+	}
+
 	virtual bool hasKey(void* key, size_t keyLen, DbSnapshot* aSnapshot = nullptr) = 0;
 
 	virtual size_t size(bool thorough, DbSnapshot* aSnapshot = nullptr) = 0;
@@ -25,6 +25,7 @@
 #include <airdcpp/util/PathUtil.h>
 #include <airdcpp/core/localization/ResourceManager.h>
 #include <airdcpp/core/thread/Thread.h>
+#include <airdcpp/core/timer/TimerManager.h>
 #include <airdcpp/util/Util.h>
 #include <airdcpp/core/version.h>
 
@@ -136,6 +137,32 @@ void LevelDB::put(void* aKey, size_t keyLen, void* aValue, size_t valueLen, DbSn
 	DBACTION(db->Put(writeoptions, key, value));
 }
 
+void LevelDB::write(const DbWriteBatch& aBatch) {
+	if (aBatch.empty())
+		return;
+
+	leveldb::WriteBatch wb;
+	for (const auto& [key, value]: aBatch.getOperations()) {
+		if (value) {
+			wb.Put(leveldb::Slice(key), leveldb::Slice(*value));
+		} else {
+			wb.Delete(leveldb::Slice(key));
+		}
+	}
+
+	// a single synced write for the whole batch
+	auto start = GET_TICK();
+	DBACTION(db->Write(writeoptions, &wb));
+	auto flushTime = GET_TICK() - start;
+
+	totalWrites += aBatch.size();
+	totalBatches++;
+	totalBatchedWrites += aBatch.size();
+	maxBatchSize = max(maxBatchSize, aBatch.size());
+	totalFlushTime += flushTime;
+	maxFlushTime = max(maxFlushTime, flushTime);
+}
+
 bool LevelDB::get(void* aKey, size_t keyLen, size_t /*initialValueLen*/, std::function<bool(void* aValue, size_t aValueLen)> loadF, DbSnapshot* /*aSnapshot*/ /*nullptr*/) {
 	totalReads++;
 	string value;
@@ -148,6 +175,34 @@ bool LevelDB::get(void* aKey, size_t keyLen, size_t /*initialValueLen*/, std::fu
 	return false;
 }
 
+void LevelDB::getMultiple(const std::vector<string>& aSortedKeys, size_t /*initialValueLen*/, const MultiLoadF& loadF, DbSnapshot* /*aSnapshot*/ /*nullptr*/) {
+	// Sorted keys with a common prefix are mostly located in the same blocks
+	// Stepping forward from the previous key is cheaper than looking up each key separately
+	const int MAX_STEPS = 8;
+
+	auto it = unique_ptr<leveldb::Iterator>(db->NewIterator(readoptions));
+	for (size_t i = 0; i < aSortedKeys.size(); ++i) {
+		totalReads++;
+		leveldb::Slice key(aSortedKeys[i]);
+
+		int steps = 0;
+		while (it->Valid() && it->key().compare(key) < 0 && steps < MAX_STEPS) {
+			it->Next();
+			steps++;
+		}
+
+		if (!it->Valid() || it->key().compare(key) < 0) {
+			it->Seek(key);
+		}
+
+		if (it->Valid() && it->key() == key) {
+			loadF(i, (void*)it->value().data(), it->value().size());
+		}
+	}
+
+	checkDbError(it->status());
+}
+
 string LevelDB::getStats() {
 	string ret;
 	string value = "leveldb.stats";
@@ -159,6 +214,11 @@ string LevelDB::getStats() {
 	ret += "\r\nTotal reads: " + Util::toString(totalReads);
 	ret += "\r\nTotal Writes: " + Util::toString(totalWrites);
 	ret += "\r\nI/O errors: " + Util::toString(ioErrors);
+	if (totalBatches > 0) {
+		ret += "\r\nWrite batches: " + Util::toString(totalBatches);
+		ret += "\r\nAverage batch size: " + Util::toString(totalBatchedWrites / totalBatches) + " (max " + Util::toString(maxBatchSize) + ")";
+		ret += "\r\nAverage flush latency: " + Util::toString(totalFlushTime / totalBatches) + " ms (max " + Util::toString(maxFlushTime) + " ms)";
+	}
 	ret += "\r\nCurrent block size: " + Util::formatBytes(defaultOptions.block_size);
 	ret += "\r\nCurrent size on disk: " + Util::formatBytes(getSizeOnDisk());
 	ret += "\r\n";
@@ -38,7 +38,9 @@ public:
 
 	void put(void* aKey, size_t keyLen, void* aValue, size_t valueLen, DbSnapshot* aSnapshot /*nullptr*/);
 	bool get(void* aKey, size_t keyLen, size_t /*initialValueLen*/, std::function<bool(void* aValue, size_t aValueLen)> loadF, DbSnapshot* aSnapshot /*nullptr*/);
+	void getMultiple(const std::vector<string>& aSortedKeys, size_t initialValueLen, const MultiLoadF& loadF, DbSnapshot* aSnapshot /*nullptr*/);
 	void remove(void* aKey, size_t keyLen, DbSnapshot* aSnapshot /*nullptr*/);
+	void write(const DbWriteBatch& aBatch);
 	bool hasKey(void* aKey, size_t keyLen, DbSnapshot* aSnapshot /*nullptr*/);
 
 	string getStats();
@@ -86,6 +88,13 @@ private:
 	uint64_t totalReads = 0;
 	uint64_t totalWrites = 0;
 	uint64_t ioErrors = 0;
+
+	// batch writes
+	uint64_t totalBatches = 0;
+	uint64_t totalBatchedWrites = 0;
+	size_t maxBatchSize = 0;
+	uint64_t totalFlushTime = 0;
+	uint64_t maxFlushTime = 0;
 	size_t lastSize = 0;
 };
 
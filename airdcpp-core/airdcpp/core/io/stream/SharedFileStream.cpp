@@ -21,6 +21,8 @@
 
 #include <airdcpp/core/io/stream/SharedFileStream.h>
 
+#include <airdcpp/core/timer/TimerManager.h>
+
 #ifdef _WIN32
 # include "Winioctl.h"
 #endif
@@ -30,21 +32,59 @@ namespace dcpp {
 CriticalSection SharedFileStream::cs;
 SharedFileStream::SharedFileHandleMap SharedFileStream::readpool;
 SharedFileStream::SharedFileHandleMap SharedFileStream::writepool;
+std::list<SharedFileHandle*> SharedFileStream::idleHandles;
+SharedFileStats SharedFileStream::stats;
 
 SharedFileHandle::SharedFileHandle(const string& aPath, int aAccess, int aMode) : 
-	File(aPath, aAccess, aMode), ref_cnt(1), path(aPath), mode(aMode)
+	File(aPath, aAccess, aMode), ref_cnt(1), path(aPath), access(aAccess), mode(aMode)
 { }
 
+bool SharedFileHandle::isCurrent() const noexcept {
+	// A file that was replaced by another one may have the same size and modification date
+	return File::getFileId(path) == getFileId() && File::getLastModified(path) == getLastModified() && File::getSize(path) == getSize();
+}
+
 SharedFileStream::SharedFileStream(const string& aFileName, int aAccess, int aMode) {
-	Lock l(cs);
 	auto& pool = aAccess == File::READ ? readpool : writepool;
-	auto p = pool.find(aFileName);
-	if (p != pool.end()) {
-		sfh = p->second.get();
-		sfh->ref_cnt++;
-	} else {
-	    sfh = new SharedFileHandle(aFileName, aAccess, aMode);
-		pool[aFileName] = unique_ptr<SharedFileHandle>(sfh);
+	for (;;) {
+		{
+			Lock l(cs);
+			auto p = pool.find(aFileName);
+			if (p == pool.end()) {
+				sfh = new SharedFileHandle(aFileName, aAccess, aMode);
+				pool[aFileName] = unique_ptr<SharedFileHandle>(sfh);
+				stats.misses++;
+
+				trimIdleHandles();
+				stats.peakHandles = max(stats.peakHandles, readpool.size() + writepool.size());
+				return;
+			}
+
+			sfh = p->second.get();
+			if (sfh->ref_cnt > 0) {
+				sfh->ref_cnt++;
+				stats.hits++;
+				return;
+			}
+
+			// Reserve the idle handle while it's being checked
+			removeIdleHandle(sfh);
+			sfh->ref_cnt++;
+		}
+
+		// The file may have been replaced or modified while the handle was idle
+		// Check it without holding the global lock
+		auto current = sfh->isCurrent();
+
+		Lock l(cs);
+		if (current || sfh->ref_cnt > 1) {
+			// Other streams that started using the handle meanwhile didn't validate it
+			stats.hits++;
+			return;
+		}
+
+		sfh->ref_cnt--;
+		pool.erase(aFileName);
 	}
 }
 
@@ -53,43 +93,82 @@ SharedFileStream::~SharedFileStream() {
 
 	sfh->ref_cnt--;
 	if(sfh->ref_cnt == 0) {
-		auto& pool = sfh->mode == File::READ ? readpool : writepool;
-		pool.erase(sfh->path);
+		if (sfh->access == File::READ) {
+			// Popular files get requested in multiple segments, keep the handle for reuse
+			sfh->idleSince = GET_TICK();
+			sfh->idlePos = idleHandles.insert(idleHandles.end(), sfh);
+			trimIdleHandles();
+		} else {
+			writepool.erase(sfh->path);
+		}
     }
 }
 
-size_t SharedFileStream::write(const void* buf, size_t len) {
-	Lock l(sfh->cs);
+void SharedFileStream::removeIdleHandle(SharedFileHandle* aHandle) noexcept {
+	dcassert(aHandle->ref_cnt == 0);
+	idleHandles.erase(aHandle->idlePos);
+}
+
+void SharedFileStream::trimIdleHandles() noexcept {
+	// Least recently used handles are in the front
+	while (!idleHandles.empty() && readpool.size() + writepool.size() > MAX_OPEN_HANDLES) {
+		auto h = idleHandles.front();
+		idleHandles.pop_front();
+		readpool.erase(h->path);
+		stats.evictions++;
+	}
+}
 
-	sfh->setPos(pos);
-	sfh->write(buf, len);
+void SharedFileStream::expireIdleHandles(uint64_t aTick) noexcept {
+	Lock l(cs);
+	while (!idleHandles.empty() && idleHandles.front()->idleSince + IDLE_TIMEOUT <= aTick) {
+		auto h = idleHandles.front();
+		idleHandles.pop_front();
+		readpool.erase(h->path);
+	}
+}
+
+void SharedFileStream::closeIdleHandle(const string& aPath) noexcept {
+	Lock l(cs);
+	auto p = readpool.find(aPath);
+	if (p != readpool.end() && p->second->ref_cnt == 0) {
+		removeIdleHandle(p->second.get());
+		readpool.erase(p);
+	}
+}
+
+SharedFileStats SharedFileStream::getStats() noexcept {
+	Lock l(cs);
+
+	auto ret = stats;
+	ret.openHandles = readpool.size() + writepool.size();
+	ret.idleHandles = idleHandles.size();
+	return ret;
+}
+
+size_t SharedFileStream::write(const void* buf, size_t len) {
+	sfh->writeAt(buf, len, pos);
 
     pos += len;
 	return len;
 }
 
 size_t SharedFileStream::read(void* buf, size_t& len) {
-	Lock l(sfh->cs);
-
-	sfh->setPos(pos);
-	len = sfh->read(buf, len);
+	len = sfh->readAt(buf, len, pos);
 
     pos += len;
 	return len;
 }
 
 int64_t SharedFileStream::getSize() const noexcept {
-	Lock l(sfh->cs);
 	return sfh->getSize();
 }
 
 void SharedFileStream::setSize(int64_t newSize) {
-	Lock l(sfh->cs);
 	sfh->setSize(newSize);
 }
 
 size_t SharedFileStream::flushBuffers(bool aForce) {
-	Lock l(sfh->cs);
 	return sfh->flushBuffers(aForce);
 }
 
@@ -97,4 +176,15 @@ void SharedFileStream::setPos(int64_t aPos) noexcept {
 	pos = aPos;
 }
 
+const File* SharedFileStream::getDirectFile(int64_t& pos_, int64_t& bytesLeft_) noexcept {
+	// Direct reads use explicit offsets as well
+	pos_ = pos;
+	bytesLeft_ = max(getSize() - pos, static_cast<int64_t>(0));
+	return sfh;
+}
+
+void SharedFileStream::skip(int64_t aBytes) noexcept {
+	pos += aBytes;
+}
+
 }
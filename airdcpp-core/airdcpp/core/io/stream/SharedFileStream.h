@@ -27,13 +27,35 @@
 namespace dcpp {
 
 struct SharedFileHandle : File {
-	SharedFileHandle(const string& aPath, int access, int mode);
+	SharedFileHandle(const string& aPath, int aAccess, int aMode);
 	~SharedFileHandle() noexcept = default;
 
-	CriticalSection cs;
+	// Returns false if the path no longer points to the opened file (or the file has been modified)
+	bool isCurrent() const noexcept;
+
 	int	ref_cnt;
 	string path;
+	int access;
 	int mode;
+
+	// Released read handles are kept open for a while
+	uint64_t idleSince = 0;
+	std::list<SharedFileHandle*>::iterator idlePos;
+};
+
+struct SharedFileStats {
+	// Handles that were reused
+	int64_t hits = 0;
+
+	// Handles that had to be opened
+	int64_t misses = 0;
+
+	// Idle handles that were closed because of the handle limit
+	int64_t evictions = 0;
+
+	size_t openHandles = 0;
+	size_t idleHandles = 0;
+	size_t peakHandles = 0;
 };
 
 class SharedFileStream : public IOStream
@@ -45,6 +67,7 @@ public:
     SharedFileStream(const string& aFileName, int access, int mode);
     ~SharedFileStream() override;
 
+	// Reads and writes use the stream position directly without locking the shared handle
 	size_t write(const void* buf, size_t len) override;
 	size_t read(void* buf, size_t& len) override;
 
@@ -58,11 +81,33 @@ public:
 	static SharedFileHandleMap writepool;
 
 	void setPos(int64_t aPos) noexcept override;
+
+	const File* getDirectFile(int64_t& pos_, int64_t& bytesLeft_) noexcept override;
+	void skip(int64_t aBytes) noexcept override;
+
+	// Close idle handles that haven't been used recently
+	static void expireIdleHandles(uint64_t aTick) noexcept;
+
+	// Close the idle handle of the file (if there is one) so that the file can be modified
+	static void closeIdleHandle(const string& aPath) noexcept;
+
+	static SharedFileStats getStats() noexcept;
+
+	// Idle handles are closed when the total number of open handles exceeds this
+	static constexpr size_t MAX_OPEN_HANDLES = 256;
+	static constexpr uint64_t IDLE_TIMEOUT = 30 * 1000;
 private:
 	SharedFileHandle* sfh;
-	int64_t pos;
+	int64_t pos = 0;
+
+	static std::list<SharedFileHandle*> idleHandles;
+	static SharedFileStats stats;
+
+	// These must be called while holding the pool lock
+	static void removeIdleHandle(SharedFileHandle* aHandle) noexcept;
+	static void trimIdleHandles() noexcept;
 };
 
 }
 
-#endif	// _SHAREDFILESTREAM_H
\ No newline at end of file
+#endif	// _SHAREDFILESTREAM_H
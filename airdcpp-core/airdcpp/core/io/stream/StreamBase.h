@@ -26,6 +26,8 @@
 
 namespace dcpp {
 
+class File;
+
 /**
 	* A simple output stream. Intended to be used for nesting streams one inside the other.
 	*/
@@ -79,6 +81,18 @@ public:
 	virtual void setPos(int64_t /*pos*/) noexcept { }
 	virtual InputStream* releaseRootStream() { return this; }
 	virtual int64_t getSize() const noexcept = 0;
+
+	/**
+		* Direct access to the file that the stream reads from (used for zero-copy transfers).
+		* Filtered streams can't be read directly.
+		* @param pos_ Current read position in the file
+		* @param bytesLeft_ Number of bytes that may still be read
+		* @return The file or nullptr if the data must be read via read()
+		*/
+	virtual const File* getDirectFile(int64_t& /*pos_*/, int64_t& /*bytesLeft_*/) noexcept { return nullptr; }
+
+	/* Advance the position after the data has been consumed directly from the file */
+	virtual void skip(int64_t /*aBytes*/) noexcept { }
 };
 
 class IOStream : public InputStream, public OutputStream {
@@ -119,6 +119,18 @@ public:
 	int64_t getSize() const noexcept override {
 		return s->getSize();
 	}
+
+	const File* getDirectFile(int64_t& pos_, int64_t& bytesLeft_) noexcept override {
+		auto f = s->getDirectFile(pos_, bytesLeft_);
+		bytesLeft_ = min(bytesLeft_, maxBytes);
+		return f;
+	}
+
+	void skip(int64_t aBytes) noexcept override {
+		dcassert(aBytes <= maxBytes);
+		maxBytes -= aBytes;
+		s->skip(aBytes);
+	}
 private:
 	unique_ptr<InputStream> s;
 	int64_t maxBytes;
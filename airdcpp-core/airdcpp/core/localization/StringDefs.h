@@ -466,6 +466,7 @@ enum Strings { // @DontAdd
 	FILE_NOT_AVAILABLE, // "File not available"
 	FILE_NOT_FOUND, // "File not found"
 	FILE_SEGMENT, // "Bundle file / Segment"
+	FILE_SIZE_CHANGED, // "The file size changed while reading the file"
 	FILE_TYPE, // "File type"
 	FILE_WITH_DIFFERENT_SIZE, // "A file with a different size already exists in the queue"
 	FILE_WITH_DIFFERENT_TTH, // "A file with different TTH root already exists in the queue"
@@ -1354,6 +1355,9 @@ enum Strings { // @DontAdd
 	SETTINGS_GENERAL, // "General"
 	SETTINGS_GET_USER_COUNTRY, // "Get user country"
 	SETTINGS_SHOW_IP_COUNTRY_CHAT, // "Show user IP and country in chat when available"
+	SETTINGS_HASH_CACHE_SIZE, // "Memory cache for hash data (0 = disabled)"
+	SETTINGS_HASH_PARALLEL_MIN_SIZE, // "Hash files larger than this with multiple threads on non-rotational disks (0 = disabled)"
+	SETTINGS_HASH_PARALLEL_THREADS, // "Maximum number of parallel reads per disk when hashing large files"
 	SETTINGS_HIGH_PRIO_FILES, // "High priority files (separate files with '|', wildcards allowed)"
 	SETTINGS_HTTP_PROXY, // "HTTP Proxy"
 	SETTINGS_HUB_USER_COMMANDS, // "Accept custom user commands from hub"
@@ -1444,6 +1448,7 @@ enum Strings { // @DontAdd
 	SETTINGS_SHARED_DIRECTORIES, // "Shared directories"
 	SETTINGS_SHARE_HIDDEN, // "Share hidden files"
 	SETTINGS_SHARE_PROFILE_NOTE, // "Note; Added share profiles can only be used in ADC hubs. NMDC hubs are forced to use the default profile."
+	SETTINGS_SHARE_SEARCH_INDEX, // "Index the shared names for faster searching (uses more memory, applies to refreshed directories)"
 	SETTINGS_SHARINGPAGE, // "Sharing"
 	SETTINGS_SHARING_OPTIONS, // "Sharing options"
 	SETTINGS_SHOW_INFO_TIPS, // "Show infotips in lists"
@@ -1454,6 +1459,7 @@ enum Strings { // @DontAdd
 	SETTINGS_SKIPPING_OPTIONS, // "Skipping options"
 	SETTINGS_SOCKET_IN_BUFFER, // "Socket read buffer (0 = system default)"
 	SETTINGS_SOCKET_OUT_BUFFER, // "Socket write buffer (0 = system default)"
+	SETTINGS_SOCKET_REACTOR, // "Handle connections with shared event-driven threads (Linux only, applies to new connections)"
 	SETTINGS_SOCKS5, // "SOCKS5"
 	SETTINGS_SOCKS5_IP, // "Socks IP"
 	SETTINGS_SOCKS5_RESOLVE, // "Use SOCKS5 server to resolve host names"
@@ -1465,6 +1471,7 @@ enum Strings { // @DontAdd
 	SETTINGS_STATUS_IN_CHAT, // "View status messages in main chat"
 	SETTINGS_ST_MATCH_TYPE, // "Match type"
 	SETTINGS_TAB_COLOR, // "Change tabcolor"
+	SETTINGS_TASK_POOL_THREADS, // "Threads for parallel loading and refresh tasks (0 = number of CPU cores, requires restart)"
 	SETTINGS_TCP_PORT, // "TCP (0 = auto)"
 	SETTINGS_TEXT_STYLES, // "Colors & fonts"
 	SETTINGS_TIME_STAMPS, // "Show timestamps in chat by default"
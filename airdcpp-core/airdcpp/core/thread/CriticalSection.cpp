@@ -19,6 +19,8 @@
 #include "stdinc.h"
 #include <airdcpp/core/thread/CriticalSection.h>
 
+#include <chrono>
+
 namespace dcpp {
 
 ConditionalRLock::ConditionalRLock(SharedMutex& aCS, bool aLock) : cs(&aCS), lock(aLock) {
@@ -41,4 +43,53 @@ ConditionalWLock::~ConditionalWLock() {
 		cs->unlock();
 }
 
-}
\ No newline at end of file
+template<class LockF>
+static uint64_t measureWait(LockF&& aLockF) noexcept {
+	auto start = std::chrono::steady_clock::now();
+	aLockF();
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+void TimedSharedMutex::lock() noexcept {
+	exclusive.locks.fetch_add(1, std::memory_order_relaxed);
+	if (!mtx.try_lock()) {
+		exclusive.addWait(measureWait([this] { mtx.lock(); }));
+	}
+}
+
+void TimedSharedMutex::lock_shared() noexcept {
+	if (mtx.try_lock_shared()) {
+		// Avoid touching the shared cache line with readers that don't have to wait
+		thread_local uint32_t uncontendedLocks = 0;
+		if (++uncontendedLocks == SHARED_LOCK_SAMPLE_INTERVAL) {
+			uncontendedLocks = 0;
+			shared.locks.fetch_add(SHARED_LOCK_SAMPLE_INTERVAL, std::memory_order_relaxed);
+		}
+
+		return;
+	}
+
+	shared.locks.fetch_add(1, std::memory_order_relaxed);
+	shared.addWait(measureWait([this] { mtx.lock_shared(); }));
+}
+
+void TimedSharedMutex::Counters::addWait(uint64_t aWaitUs) noexcept {
+	contendedLocks.fetch_add(1, std::memory_order_relaxed);
+	totalWaitUs.fetch_add(aWaitUs, std::memory_order_relaxed);
+
+	auto curMax = maxWaitUs.load(std::memory_order_relaxed);
+	while (curMax < aWaitUs && !maxWaitUs.compare_exchange_weak(curMax, aWaitUs, std::memory_order_relaxed)) {
+		// Retry
+	}
+}
+
+TimedSharedMutex::Stats TimedSharedMutex::Counters::toStats() const noexcept {
+	Stats ret;
+	ret.locks = locks.load(std::memory_order_relaxed);
+	ret.contendedLocks = contendedLocks.load(std::memory_order_relaxed);
+	ret.totalWaitUs = totalWaitUs.load(std::memory_order_relaxed);
+	ret.maxWaitUs = maxWaitUs.load(std::memory_order_relaxed);
+	return ret;
+}
+
+}
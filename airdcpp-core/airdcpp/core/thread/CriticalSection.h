@@ -19,6 +19,8 @@
 #ifndef DCPLUSPLUS_DCPP_CRITICALSECTION_H
 #define DCPLUSPLUS_DCPP_CRITICALSECTION_H
 
+#include <atomic>
+#include <cstdint>
 #include <mutex>
 #include <shared_mutex>
 
@@ -35,6 +37,50 @@ using SharedMutex = std::shared_mutex;
 using RLock = std::shared_lock<std::shared_mutex>;
 using WLock = std::unique_lock<std::shared_mutex>;
 
+// Shared mutex that keeps track of the time that the threads have to wait for the lock
+// Uncontended shared locks are counted per thread in batches of SHARED_LOCK_SAMPLE_INTERVAL,
+// so their total is approximate
+class TimedSharedMutex {
+public:
+	static constexpr uint32_t SHARED_LOCK_SAMPLE_INTERVAL = 64;
+
+	struct Stats {
+		uint64_t locks = 0;
+		uint64_t contendedLocks = 0;
+		uint64_t totalWaitUs = 0;
+		uint64_t maxWaitUs = 0;
+	};
+
+	void lock() noexcept;
+	void unlock() noexcept { mtx.unlock(); }
+	bool try_lock() noexcept { return mtx.try_lock(); }
+
+	void lock_shared() noexcept;
+	void unlock_shared() noexcept { mtx.unlock_shared(); }
+	bool try_lock_shared() noexcept { return mtx.try_lock_shared(); }
+
+	Stats getSharedStats() const noexcept { return shared.toStats(); }
+	Stats getExclusiveStats() const noexcept { return exclusive.toStats(); }
+private:
+	struct Counters {
+		std::atomic<uint64_t> locks { 0 };
+		std::atomic<uint64_t> contendedLocks { 0 };
+		std::atomic<uint64_t> totalWaitUs { 0 };
+		std::atomic<uint64_t> maxWaitUs { 0 };
+
+		void addWait(uint64_t aWaitUs) noexcept;
+		Stats toStats() const noexcept;
+	};
+
+	Counters shared;
+	Counters exclusive;
+
+	std::shared_mutex mtx;
+};
+
+using TimedRLock = std::shared_lock<TimedSharedMutex>;
+using TimedWLock = std::unique_lock<TimedSharedMutex>;
+
 #ifndef _WIN32
 
 // A custom implementation is required for Semaphore
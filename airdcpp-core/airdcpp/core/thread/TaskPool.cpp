@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include <airdcpp/core/thread/TaskPool.h>
+
+#include <airdcpp/core/classes/Exception.h>
+#include <airdcpp/settings/SettingsManager.h>
+
+namespace dcpp {
+
+thread_local TaskPool::Worker* TaskPool::currentWorker = nullptr;
+
+TaskPool& TaskPool::getInstance() noexcept {
+	static TaskPool pool([] {
+		size_t threads = SettingsManager::getInstance() ? std::clamp(SETTING(TASK_POOL_THREADS), 0, 256) : 0;
+		if (threads == 0) {
+			threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		}
+
+		// The waiting thread runs tasks as well
+		return threads - 1;
+	}());
+
+	return pool;
+}
+
+TaskPool::TaskPool(size_t aWorkerCount) noexcept {
+	for (size_t i = 0; i < aWorkerCount; ++i) {
+		workers.push_back(make_unique<Worker>(*this, i));
+	}
+
+	for (auto& w: workers) {
+		try {
+			w->start();
+		} catch (const ThreadException&) {
+			// Tasks can still be run by the waiting threads
+			dcassert(0);
+		}
+	}
+}
+
+TaskPool::~TaskPool() noexcept {
+	{
+		std::lock_guard<std::mutex> l(sleepMutex);
+		stopping = true;
+	}
+
+	sleepCond.notify_all();
+	for (auto& w: workers) {
+		w->join();
+	}
+}
+
+void TaskPool::submit(Task&& aTask) noexcept {
+	// Count the task before it becomes visible so that the worker taking it can't decrement the counter first
+	queuedTasks++;
+
+	if (currentWorker && &currentWorker->pool == this) {
+		currentWorker->push(std::move(aTask));
+	} else {
+		std::lock_guard<std::mutex> l(cs);
+		sharedTasks.push_back(std::move(aTask));
+	}
+
+	{
+		// Don't notify between the predicate check and the wait of a worker
+		std::lock_guard<std::mutex> l(sleepMutex);
+	}
+
+	sleepCond.notify_one();
+}
+
+bool TaskPool::popTask(Worker* aWorker, Task& task_) noexcept {
+	if (queuedTasks == 0) {
+		return false;
+	}
+
+	auto found = [&] {
+		// Own tasks
+		if (aWorker && aWorker->pop(task_)) {
+			return true;
+		}
+
+		// Shared queue
+		{
+			std::lock_guard<std::mutex> l(cs);
+			if (!sharedTasks.empty()) {
+				task_ = std::move(sharedTasks.front());
+				sharedTasks.pop_front();
+				return true;
+			}
+		}
+
+		// Steal from others, starting from the next worker to spread the load
+		const auto start = aWorker ? aWorker->index + 1 : 0;
+		for (size_t i = 0; i < workers.size(); ++i) {
+			auto& victim = workers[(start + i) % workers.size()];
+			if (victim.get() != aWorker && victim->steal(task_)) {
+				return true;
+			}
+		}
+
+		return false;
+	}();
+
+	if (found) {
+		queuedTasks--;
+	}
+
+	return found;
+}
+
+bool TaskPool::runPendingTask() noexcept {
+	Task task;
+	if (!popTask(currentWorker && &currentWorker->pool == this ? currentWorker : nullptr, task)) {
+		return false;
+	}
+
+	task();
+	return true;
+}
+
+void TaskPool::Worker::push(Task&& aTask) noexcept {
+	std::lock_guard<std::mutex> l(cs);
+	tasks.push_back(std::move(aTask));
+}
+
+bool TaskPool::Worker::pop(Task& task_) noexcept {
+	std::lock_guard<std::mutex> l(cs);
+	if (tasks.empty()) {
+		return false;
+	}
+
+	task_ = std::move(tasks.back());
+	tasks.pop_back();
+	return true;
+}
+
+bool TaskPool::Worker::steal(Task& task_) noexcept {
+	std::lock_guard<std::mutex> l(cs);
+	if (tasks.empty()) {
+		return false;
+	}
+
+	task_ = std::move(tasks.front());
+	tasks.pop_front();
+	return true;
+}
+
+int TaskPool::Worker::run() {
+	currentWorker = this;
+
+	while (!pool.stopping) {
+		Task task;
+		if (pool.popTask(this, task)) {
+			task();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> l(pool.sleepMutex);
+		pool.sleepCond.wait(l, [this] { return pool.stopping || pool.queuedTasks > 0; });
+	}
+
+	return 0;
+}
+
+
+task_group::~task_group() noexcept {
+	waitAll();
+}
+
+void task_group::wait() {
+	waitAll();
+
+	std::exception_ptr e;
+	{
+		std::lock_guard<std::mutex> l(cs);
+		std::swap(e, exception);
+	}
+
+	if (e) {
+		std::rethrow_exception(e);
+	}
+}
+
+void task_group::waitAll() noexcept {
+	auto& pool = TaskPool::getInstance();
+	for (;;) {
+		{
+			std::lock_guard<std::mutex> l(cs);
+			if (pending == 0) {
+				return;
+			}
+		}
+
+		// Help with the queued tasks
+		if (pool.runPendingTask()) {
+			continue;
+		}
+
+		// The remaining tasks are running in other threads
+		std::unique_lock<std::mutex> l(cs);
+		completedCond.wait(l, [this] { return pending == 0; });
+		return;
+	}
+}
+
+void task_group::onTaskCompleted(const std::exception_ptr& aException) noexcept {
+	std::lock_guard<std::mutex> l(cs);
+	if (aException && !exception) {
+		exception = aException;
+	}
+
+	pending--;
+	if (pending == 0) {
+		completedCond.notify_all();
+	}
+}
+
+} // namespace dcpp
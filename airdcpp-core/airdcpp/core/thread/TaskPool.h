@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_TASK_POOL_H
+#define DCPLUSPLUS_DCPP_TASK_POOL_H
+
+#include <airdcpp/core/header/typedefs.h>
+
+#include <airdcpp/core/thread/CriticalSection.h>
+#include <airdcpp/core/thread/Thread.h>
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+
+namespace dcpp {
+
+/**
+ * Work-stealing thread pool for running short CPU/IO bound tasks in parallel
+ *
+ * Each worker has its own deque: tasks queued from a worker are pushed to its own deque and
+ * executed in LIFO order, idle workers steal the oldest tasks from the others. Tasks queued from
+ * other threads go to a shared queue.
+ *
+ * Threads that wait for tasks to complete will run queued tasks meanwhile, which makes nested
+ * task groups safe (and the pool usable without any worker threads).
+ */
+class TaskPool {
+public:
+	using Task = std::function<void()>;
+
+	// The pool is created on first use (the size is read from the settings)
+	static TaskPool& getInstance() noexcept;
+
+	// The calling thread participates when waiting so aWorkerCount = 0 will run everything serially
+	explicit TaskPool(size_t aWorkerCount) noexcept;
+	~TaskPool() noexcept;
+
+	// The task must not throw
+	void submit(Task&& aTask) noexcept;
+
+	// Runs a single queued task from the calling thread
+	// Returns false if there was nothing to run
+	bool runPendingTask() noexcept;
+
+	size_t getWorkerCount() const noexcept { return workers.size(); }
+
+	TaskPool(const TaskPool&) = delete;
+	TaskPool& operator=(const TaskPool&) = delete;
+private:
+	class Worker : public Thread {
+	public:
+		Worker(TaskPool& aPool, size_t aIndex) noexcept : pool(aPool), index(aIndex) { }
+
+		void push(Task&& aTask) noexcept;
+
+		// Owner thread, newest task
+		bool pop(Task& task_) noexcept;
+
+		// Other threads, oldest task
+		bool steal(Task& task_) noexcept;
+
+		TaskPool& pool;
+		const size_t index;
+	private:
+		int run() override;
+
+		std::mutex cs;
+		std::deque<Task> tasks;
+	};
+
+	bool popTask(Worker* aWorker, Task& task_) noexcept;
+
+	vector<unique_ptr<Worker>> workers;
+
+	std::mutex cs;
+	std::deque<Task> sharedTasks;
+
+	atomic<size_t> queuedTasks = 0;
+	atomic<bool> stopping = false;
+
+	std::mutex sleepMutex;
+	std::condition_variable sleepCond;
+
+	static thread_local Worker* currentWorker;
+};
+
+// Group of tasks that can be waited for (compatible with the PPL/TBB task_group)
+class task_group {
+public:
+	task_group() = default;
+	~task_group() noexcept;
+
+	template<class F>
+	void run(F&& aTask) {
+		{
+			std::lock_guard<std::mutex> l(cs);
+			pending++;
+		}
+
+		TaskPool::getInstance().submit([this, task = std::forward<F>(aTask)]() mutable {
+			std::exception_ptr e;
+			try {
+				task();
+			} catch (...) {
+				e = std::current_exception();
+			}
+
+			onTaskCompleted(e);
+		});
+	}
+
+	// Waits until all tasks have completed and rethrows the first exception thrown by them
+	void wait();
+
+	task_group(const task_group&) = delete;
+	task_group& operator=(const task_group&) = delete;
+private:
+	void onTaskCompleted(const std::exception_ptr& aException) noexcept;
+	void waitAll() noexcept;
+
+	std::mutex cs;
+	std::condition_variable completedCond;
+	size_t pending = 0;
+	std::exception_ptr exception;
+};
+
+// The elements are split in chunks that are executed in parallel
+// Exceptions are rethrown after all chunks have completed
+template<class IterT, class F>
+void parallel_for_each(IterT aBegin, IterT aEnd, F&& aFunc) {
+	const auto count = static_cast<size_t>(std::distance(aBegin, aEnd));
+	const auto threads = TaskPool::getInstance().getWorkerCount() + 1;
+	if (count < 2 || threads < 2) {
+		for (; aBegin != aEnd; ++aBegin) {
+			aFunc(*aBegin);
+		}
+		return;
+	}
+
+	// A few chunks per thread so that uneven elements can be balanced
+	const auto chunkSize = std::max<size_t>(1, count / (threads * 4));
+
+	task_group tasks;
+	for (size_t pos = 0; pos < count; ) {
+		auto chunkBegin = aBegin;
+		auto len = std::min(chunkSize, count - pos);
+		std::advance(aBegin, len);
+		pos += len;
+
+		tasks.run([chunkBegin, chunkEnd = aBegin, &aFunc] {
+			for (auto i = chunkBegin; i != chunkEnd; ++i) {
+				aFunc(*i);
+			}
+		});
+	}
+
+	tasks.wait();
+}
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_TASK_POOL_H)
@@ -75,6 +75,7 @@ public:
 
 #include <deque>
 #include <airdcpp/core/thread/CriticalSection.h>
+#include <airdcpp/core/thread/TaskPool.h>
 
 namespace dcpp {
 
@@ -84,8 +85,6 @@ public:
 	~TaskScheduler() { }
 };
 
-#define parallel_for_each for_each
-
 	template <typename T>
 	class concurrent_queue {
 	public:
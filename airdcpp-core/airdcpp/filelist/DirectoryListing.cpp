@@ -23,6 +23,7 @@
 #include <airdcpp/filelist/ListLoader.h>
 
 #include <airdcpp/core/io/compress/BZUtils.h>
+#include <airdcpp/core/classes/ScopedFunctor.h>
 #include <airdcpp/hub/ClientManager.h>
 #include <airdcpp/util/DupeUtil.h>
 #include <airdcpp/core/io/stream/FilteredFile.h>
@@ -45,7 +46,7 @@ using ranges::find_if;
 DirectoryListing::DirectoryListing(const HintedUser& aUser, bool aPartial, const string& aFileName, bool aIsClientView, ValidationHooks* aLoadHooks, bool aIsOwnList) :
 	TrackableDownloadItem(aIsOwnList || (!aPartial && PathUtil::fileExists(aFileName))), // API requires the download state to be set correctly
 	partialList(aPartial), fileName(aFileName), loadHooks(aLoadHooks), isOwnList(aIsOwnList), isClientView(aIsClientView),
-	root(Directory::create(nullptr, ADC_ROOT_STR, Directory::TYPE_INCOMPLETE_NOCHILD, 0)), hintedUser(aUser),
+	itemStorage(ItemStorage::create()), root(Directory::createRoot(itemStorage.get())), hintedUser(aUser),
 	tasks(isClientView, Thread::NORMAL, std::bind_front(&DirectoryListing::dispatch, this))
 {
 	running.clear();
@@ -218,12 +219,12 @@ DirectoryListing::DirectoryPtr DirectoryListing::createBaseDirectory(const strin
 
 	const auto sl = StringTokenizer<string>(aBasePath, ADC_SEPARATOR).getTokens();
 	for (const auto& curDirName: sl) {
-		auto s = cur->directories.find(&curDirName);
-		if (s == cur->directories.end()) {
+		auto s = cur->findDirectory(curDirName);
+		if (!s) {
 			auto d = DirectoryListing::Directory::create(cur.get(), curDirName, DirectoryListing::Directory::TYPE_INCOMPLETE_CHILD, aDownloadDate);
 			cur = d;
 		} else {
-			cur = s->second;
+			cur = s;
 		}
 	}
 
@@ -255,6 +256,9 @@ int DirectoryListing::loadPartialXml(const string& aXml, const string& aBase) {
 }
 
 int DirectoryListing::loadXML(InputStream& is, bool aUpdating, const string& aBase, time_t aListDate) {
+	// The name index is only needed while loading
+	ScopedFunctor([this] { itemStorage->clearNameIndex(); });
+
 	ListLoader ll(this, aBase, aUpdating, aListDate);
 	try {
 		dcpp::SimpleXMLReader(&ll).parse(is);
@@ -311,12 +315,12 @@ DirectoryListing::Directory::Ptr DirectoryListing::findDirectoryUnsafe(const str
 	dcassert(end != string::npos);
 	string name = aName.substr(1, end - 1);
 
-	if (auto i = aCurrent->directories.find(&name); i != aCurrent->directories.end()) {
+	if (auto d = aCurrent->findDirectory(name); d) {
 		if (end == (aName.size() - 1)) {
-			return i->second;
+			return d;
 		}
 		else {
-			return findDirectoryUnsafe(aName.substr(end), i->second.get());
+			return findDirectoryUnsafe(aName.substr(end), d.get());
 		}
 	}
 
@@ -441,6 +445,33 @@ void DirectoryListing::listDiffImpl(const string& aFile, bool aOwnList) {
 	fire(DirectoryListingListener::LoadingFinished(), start, ADC_ROOT_STR, static_cast<uint8_t>(DirectoryLoadType::CHANGE_NORMAL));
 }
 
+void DirectoryListing::resetItemStorage() {
+	root->clearAll();
+
+	itemStorage = ItemStorage::create();
+	root->setStorage(itemStorage.get());
+}
+
+void DirectoryListing::compactItemStorage() noexcept {
+	if (!itemStorage->needsCompaction()) {
+		return;
+	}
+
+	auto newStorage = ItemStorage::create();
+	try {
+		root->moveToStorage(*newStorage);
+	} catch (const std::bad_alloc&) {
+		// Keep using the old storage
+		return;
+	}
+
+	newStorage->clearNameIndex();
+	dcdebug("DirectoryListing::compactItemStorage: %d of %d items were removed, memory usage %d -> %d bytes\n", 
+		static_cast<int>(itemStorage->getRemovedItemCount()), static_cast<int>(itemStorage->getItemCount()), static_cast<int>(itemStorage->getMemoryUsage()), static_cast<int>(newStorage->getMemoryUsage()));
+
+	itemStorage = std::move(newStorage);
+}
+
 void DirectoryListing::loadFileImpl(const string& aInitialDir) {
 	int64_t start = GET_TICK();
 	partialList = false;
@@ -450,7 +481,7 @@ void DirectoryListing::loadFileImpl(const string& aInitialDir) {
 	auto curDirectoryPath = !currentLocation.directory ? Util::emptyString : currentLocation.directory->getAdcPathUnsafe();
 
 	// In case we are reloading...
-	root->clearAll();
+	resetItemStorage();
 
 	loadFile();
 
@@ -495,8 +526,8 @@ void DirectoryListing::onLoadingFinished(int64_t aStartTime, const string& aLoad
 }
 
 void DirectoryListing::updateCurrentLocation(const DirectoryPtr& aCurrentDirectory) noexcept {
-	currentLocation.directories = static_cast<int>(aCurrentDirectory->directories.size());
-	currentLocation.files = static_cast<int>(aCurrentDirectory->files.size());
+	currentLocation.directories = static_cast<int>(aCurrentDirectory->getDirectories().size());
+	currentLocation.files = static_cast<int>(aCurrentDirectory->getFiles().size());
 	currentLocation.totalSize = aCurrentDirectory->getTotalSize(false);
 	currentLocation.directory = aCurrentDirectory;
 }
@@ -523,7 +554,12 @@ void DirectoryListing::loadPartialImpl(const string& aXml, const string& aBasePa
 
 		if (reloading) {
 			// Remove all existing directories inside this path
-			optionalOldDirectory->clearAll();
+			// (the old items of non-root directories are kept in the storage until the storage is compacted)
+			if (optionalOldDirectory->isRoot()) {
+				resetItemStorage();
+			} else {
+				optionalOldDirectory->clearAll();
+			}
 		}
 	}
 
@@ -542,6 +578,8 @@ void DirectoryListing::loadPartialImpl(const string& aXml, const string& aBasePa
 		throw;
 	}
 
+	compactItemStorage();
+
 	// Done
 	onLoadingFinished(0, aBasePath, curDirectoryPath, aBackgroundTask);
 
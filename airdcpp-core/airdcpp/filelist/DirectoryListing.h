@@ -57,6 +57,9 @@ public:
 	using FilePtr = std::shared_ptr<File>;
 	class VirtualDirectory;
 
+	class ItemStorage;
+	using ItemStoragePtr = shared_ptr<ItemStorage>;
+
 	enum class DirectoryLoadType;
 
 	using FileValidationHook = ActionHook<nullptr_t, const FilePtr&, const DirectoryListing&>;
@@ -200,6 +203,14 @@ private:
 
 	friend class ListLoader;
 
+	// Replace the item storage after clearing the whole list (the old items will be freed once they are no longer referenced elsewhere)
+	// Throws std::bad_alloc
+	void resetItemStorage();
+
+	// Copy the remaining items to a new storage if most of the items in the current storage are no longer in the tree
+	void compactItemStorage() noexcept;
+
+	ItemStoragePtr itemStorage;
 	DirectoryPtr root;
 
 	void dispatch(Callback& aCallback) noexcept;
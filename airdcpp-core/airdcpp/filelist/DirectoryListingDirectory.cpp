@@ -46,8 +46,8 @@ bool DirectoryListing::File::Sort::operator()(const Ptr& a, const Ptr& b) const
 	return compare(a->getName(), b->getName()) < 0;
 }
 
-DirectoryListing::File::File(Directory* aDir, const string& aName, int64_t aSize, const TTHValue& aTTH, time_t aRemoteDate) noexcept :
-	name(aName), size(aSize), parent(aDir), tthRoot(aTTH), remoteDate(aRemoteDate), token(itemIdCounter++) {
+DirectoryListing::File::File(Directory* aDir, string_view aName, int64_t aSize, const TTHValue& aTTH, time_t aRemoteDate) noexcept :
+	size(aSize), parent(aDir), tthRoot(aTTH), remoteDate(aRemoteDate), name(aName), token(itemIdCounter++) {
 
 	if (size > 0) {
 		dupe = DupeUtil::checkFileDupe(tthRoot);
@@ -56,64 +56,120 @@ DirectoryListing::File::File(Directory* aDir, const string& aName, int64_t aSize
 	//dcdebug("DirectoryListing::File (copy) %s was created\n", aName.c_str());
 }
 
+DirectoryListing::File::File(Directory* aDir, string_view aName, const File& rhs) noexcept :
+	size(rhs.size), parent(aDir), tthRoot(rhs.tthRoot), remoteDate(rhs.remoteDate), dupe(rhs.dupe), name(aName), token(itemIdCounter++)
+{
+	dcdebug("DirectoryListing::File (copy) %s was created\n", rhs.getName().data());
+}
+
+DirectoryListing::File::File(Directory* aDir, string_view aName, const File& rhs, DirectoryListingItemToken aToken) noexcept :
+	size(rhs.size), parent(aDir), tthRoot(rhs.tthRoot), remoteDate(rhs.remoteDate), dupe(rhs.dupe), name(aName), token(aToken) {
+
+}
+
 string DirectoryListing::File::getAdcPathUnsafe() const noexcept {
-	return parent->getAdcPathUnsafe() + name;
+	return parent->getAdcPathUnsafe() + string(name);
 }
 
-DirectoryListing::File::File(const File& rhs, File::Owner aOwner) noexcept : 
-	name(rhs.name), size(rhs.size), parent(rhs.parent), tthRoot(rhs.tthRoot), 
-	dupe(rhs.dupe), remoteDate(rhs.remoteDate), owner(aOwner), token(itemIdCounter++)
-{
-	dcdebug("DirectoryListing::File (copy) %s was created\n", rhs.getName().c_str());
+size_t DirectoryListing::ItemStorage::getMemoryUsage() const noexcept {
+	return arena.getMemoryUsage() + files.size() * sizeof(File) + directories.size() * sizeof(Directory) + virtualDirectories.size() * sizeof(VirtualDirectory);
 }
 
-DirectoryListing::Directory::Ptr DirectoryListing::Directory::create(Directory* aParent, const string& aName, DirType aType, time_t aUpdateDate, const DirectoryContentInfo& aContentInfo, const string& aSize, time_t aRemoteDate) {
-	dcassert(aType != TYPE_VIRTUAL);
-	auto dir = Ptr(new Directory(aParent, aName, aType, aUpdateDate, aContentInfo, aSize, aRemoteDate));
-	if (aParent) {
-		dcassert(!aParent->directories.contains(&dir->getName()));
-		auto [dp, inserted] = aParent->directories.try_emplace(&dir->getName(), dir);
-		if (!inserted) {
-			throw AbortException("The directory " + dir->getAdcPathUnsafe() + " contains items with duplicate names (" + dir->getName() + ", " + *(*dp).first + ")");
+string_view DirectoryListing::ItemStorage::internName(string_view aName) {
+	if (auto i = nameIndex.find(aName); i != nameIndex.end()) {
+		return *i;
+	}
+
+	auto name = storeName(aName);
+	nameIndex.insert(name);
+	return name;
+}
+
+void DirectoryListing::Directory::IndexList::insert(const ItemIndex* aPos, ItemIndex aIndex, MemoryArena& aArena) {
+	auto pos = static_cast<size_t>(aPos - items);
+	dcassert(pos <= count);
+
+	if (count == capacity) {
+		// Grow the array (the old one can't be freed as it may still be iterated by other threads)
+		auto newCapacity = capacity == 0 ? 4 : capacity * 2;
+		auto newItems = aArena.allocateArray<ItemIndex>(newCapacity);
+		if (count > 0) {
+			memcpy(newItems, items, count * sizeof(ItemIndex));
 		}
+
+		items = newItems;
+		capacity = newCapacity;
+	}
+
+	if (pos < count) {
+		memmove(items + pos + 1, items + pos, (count - pos) * sizeof(ItemIndex));
 	}
 
-	return dir;
+	items[pos] = aIndex;
+	count++;
+}
+
+DirectoryListing::Directory::Ptr DirectoryListing::Directory::createRoot(ItemStorage* aStorage) noexcept {
+	return Ptr(new Directory(nullptr, aStorage, ADC_ROOT_STR, TYPE_INCOMPLETE_NOCHILD, 0, DirectoryContentInfo::uninitialized(), Util::emptyString, 0));
+}
+
+DirectoryListing::Directory::Ptr DirectoryListing::Directory::create(Directory* aParent, const string& aName, DirType aType, time_t aUpdateDate, const DirectoryContentInfo& aContentInfo, const string& aSize, time_t aRemoteDate) {
+	dcassert(aParent && aType != TYPE_VIRTUAL);
+
+	auto pos = aParent->findDirectoryPosition(aName.c_str());
+	if (pos != aParent->directories.end() && Util::stricmp(aParent->getDirectory(*pos).getName().data(), aName.c_str()) == 0) {
+		throw AbortException("The directory " + aParent->getAdcPathUnsafe() + " contains items with duplicate names (" + aName + ", " + string(aParent->getDirectory(*pos).getName()) + ")");
+	}
+
+	auto& storage = *aParent->storage;
+	auto& dir = storage.createDirectory(aParent, &storage, storage.internName(aName), aType, aUpdateDate, aContentInfo, aSize, aRemoteDate);
+	aParent->directories.insert(pos, dir.index, storage.getArena());
+	return storage.toPtr(dir);
 }
 
 DirectoryListing::VirtualDirectory::Ptr DirectoryListing::VirtualDirectory::create(const string& aFullPath, Directory* aParent, const string& aName, bool aAddToParent) {
 	dcassert(aParent);
 
 	auto name = aName;
-	if (aParent->directories.contains(&name)) {
+	if (aParent->findDirectory(name)) {
 		// No duplicate file names
 		int num = 0;
 		for (;;) {
 			num++;
 			name = aName + " (" + Util::toString(num) + ")";
-			if (!aParent->directories.contains(&name)) {
+			if (!aParent->findDirectory(name)) {
 				break;
 			}
 		}
 	}
 
-	auto dir = Ptr(new VirtualDirectory(aFullPath, aParent, name));
-
+	auto& storage = *aParent->getStorage();
+	auto& dir = storage.createVirtualDirectory(storage.storeName(aFullPath), aParent, storage.internName(name));
 	if (aAddToParent) {
-		dcassert(!aParent->directories.contains(&dir->getName()));
-		aParent->directories.try_emplace(&dir->getName(), dir);
+		aParent->addDirectory(storage.toPtr<Directory>(dir));
 	}
 
-	return dir;
+	return storage.toPtr(dir);
 }
 
-DirectoryListing::VirtualDirectory::VirtualDirectory(const string& aFullAdcPath, DirectoryListing::Directory* aParent, const string& aName) :
-	Directory(aParent, aName, Directory::TYPE_VIRTUAL, GET_TIME(), DirectoryContentInfo::uninitialized(), Util::emptyString, 0), fullAdcPath(aFullAdcPath) {
+DirectoryListing::VirtualDirectory::VirtualDirectory(string_view aFullAdcPath, DirectoryListing::Directory* aParent, string_view aName) noexcept :
+	Directory(aParent, aParent->getStorage(), aName, Directory::TYPE_VIRTUAL, GET_TIME(), DirectoryContentInfo::uninitialized(), Util::emptyString, 0), fullAdcPath(aFullAdcPath) {
 
 }
 
-DirectoryListing::Directory::Directory(Directory* aParent, const string& aName, Directory::DirType aType, time_t aUpdateDate, const DirectoryContentInfo& aContentInfo, const string& aSize, time_t aRemoteDate /*0*/)
-	: parent(aParent), type(aType), remoteDate(aRemoteDate), lastUpdateDate(aUpdateDate), contentInfo(aContentInfo), name(aName), token(itemIdCounter++) {
+DirectoryListing::VirtualDirectory::VirtualDirectory(Directory* aParent, ItemStorage* aStorage, string_view aName, string_view aFullAdcPath, const VirtualDirectory& aSource) noexcept :
+	Directory(aParent, aStorage, aName, aSource), fullAdcPath(aFullAdcPath) {
+
+}
+
+DirectoryListing::Directory::Directory(Directory* aParent, ItemStorage* aStorage, string_view aName, const Directory& aSource) noexcept : 
+	partialSize(aSource.partialSize), parent(aParent), type(aSource.type), dupe(aSource.dupe), remoteDate(aSource.remoteDate), lastUpdateDate(aSource.lastUpdateDate), loading(aSource.loading), 
+	storage(aStorage), contentInfo(aSource.contentInfo), name(aName), token(aSource.token) {
+
+}
+
+DirectoryListing::Directory::Directory(Directory* aParent, ItemStorage* aStorage, string_view aName, Directory::DirType aType, time_t aUpdateDate, const DirectoryContentInfo& aContentInfo, const string& aSize, time_t aRemoteDate /*0*/) noexcept
+	: parent(aParent), type(aType), remoteDate(aRemoteDate), lastUpdateDate(aUpdateDate), storage(aStorage), contentInfo(aContentInfo), name(aName), token(itemIdCounter++) {
 
 	if (!aSize.empty()) {
 		partialSize = Util::toInt64(aSize);
@@ -122,21 +178,76 @@ DirectoryListing::Directory::Directory(Directory* aParent, const string& aName,
 	//dcdebug("DirectoryListing::Directory %s was created\n", aName.c_str());
 }
 
+DirectoryListing::Directory::DirectoryRange DirectoryListing::Directory::getDirectories() const noexcept {
+	return DirectoryRange(storage->shared_from_this(), directories);
+}
+
+DirectoryListing::Directory::FileRange DirectoryListing::Directory::getFiles() const noexcept {
+	return FileRange(storage->shared_from_this(), files);
+}
+
+const DirectoryListing::Directory::ItemIndex* DirectoryListing::Directory::findDirectoryPosition(const char* aName) const noexcept {
+	return std::lower_bound(directories.begin(), directories.end(), aName, [this](ItemIndex aIndex, const char* aCompareName) {
+		return Util::stricmp(getDirectory(aIndex).getName().data(), aCompareName) < 0;
+	});
+}
+
+DirectoryListing::Directory::Ptr DirectoryListing::Directory::findDirectory(const string& aName) const noexcept {
+	auto pos = findDirectoryPosition(aName.c_str());
+	if (pos == directories.end()) {
+		return nullptr;
+	}
+
+	auto& dir = getDirectory(*pos);
+	if (Util::stricmp(dir.getName().data(), aName.c_str()) != 0) {
+		return nullptr;
+	}
+
+	return storage->toPtr(dir);
+}
+
+void DirectoryListing::Directory::addFile(string_view aName, int64_t aSize, const TTHValue& aTTH, time_t aRemoteDate) {
+	auto index = storage->createFile(this, storage->storeName(aName), aSize, aTTH, aRemoteDate);
+	files.push_back(index, storage->getArena());
+}
+
+void DirectoryListing::Directory::addFile(const File& aSource) {
+	auto index = storage->createFile(this, storage->storeName(aSource.getName()), aSource);
+	files.push_back(index, storage->getArena());
+}
+
+bool DirectoryListing::Directory::addDirectory(const Ptr& aDirectory) {
+	dcassert(aDirectory->getParent() == this && aDirectory->storage == storage);
+
+	auto pos = findDirectoryPosition(aDirectory->getName().data());
+	if (pos != directories.end() && Util::stricmp(getDirectory(*pos).getName().data(), aDirectory->getName().data()) == 0) {
+		return false;
+	}
+
+	directories.insert(pos, aDirectory->index, storage->getArena());
+	return true;
+}
+
+void DirectoryListing::Directory::setStorage(ItemStorage* aStorage) noexcept {
+	dcassert(isRoot() && directories.empty() && files.empty());
+	storage = aStorage;
+}
+
 bool DirectoryListing::Directory::findIncomplete() const noexcept {
 	/* Recursive check for incomplete dirs */
 	if (!isComplete()) {
 		return true;
 	}
 
-	return find_if(directories | views::values, [](const Directory::Ptr& dir) { 
-		return dir->findIncomplete(); 
-	}).base() != directories.end();
+	return ranges::any_of(directories, [this](ItemIndex aIndex) { 
+		return getDirectory(aIndex).findIncomplete(); 
+	});
 }
 
 bool DirectoryListing::Directory::findCompleteChildren() const noexcept {
-	return find_if(directories | views::values, [](const Directory::Ptr& dir) {
-		return dir->isComplete();
-	}).base() != directories.end();
+	return ranges::any_of(directories, [this](ItemIndex aIndex) {
+		return getDirectory(aIndex).isComplete();
+	});
 }
 
 DirectoryContentInfo DirectoryListing::Directory::getContentInfoRecursive(bool aCountVirtual) const noexcept {
@@ -158,8 +269,8 @@ void DirectoryListing::Directory::getContentInfo(size_t& directories_, size_t& f
 		directories_ += directories.size();
 		files_ += files.size();
 
-		for (const auto& d : directories | views::values) {
-			d->getContentInfo(directories_, files_, aCountVirtual);
+		for (auto d : directories) {
+			getDirectory(d).getContentInfo(directories_, files_, aCountVirtual);
 		}
 	} else if (contentInfo.isInitialized()) {
 		directories_ += contentInfo.directories;
@@ -175,65 +286,95 @@ BundleFileAddData::List DirectoryListing::Directory::toBundleInfoList() const no
 
 void DirectoryListing::Directory::toBundleInfoList(const string& aTarget, BundleFileAddData::List& aFiles) const noexcept {
 	// First, recurse over the directories
-	for (const auto& d: directories | views::values) {
-		d->toBundleInfoList(PathUtil::joinDirectory(aTarget, d->getName()), aFiles);
+	for (auto i: directories) {
+		const auto& d = getDirectory(i);
+		d.toBundleInfoList(PathUtil::joinDirectory(aTarget, string(d.getName())), aFiles);
 	}
 
 	// Then add the files
-	for (const auto& f: files) {
-		aFiles.emplace_back(aTarget + f->getName(), f->getTTH(), f->getSize(), Priority::DEFAULT, f->getRemoteDate());
+	for (auto i: files) {
+		const auto& f = getFile(i);
+		aFiles.emplace_back(aTarget + string(f.getName()), f.getTTH(), f.getSize(), Priority::DEFAULT, f.getRemoteDate());
 	}
 }
 
-struct HashContained {
-	explicit HashContained(const DirectoryListing::Directory::TTHSet& l) : tl(l) { }
-	const DirectoryListing::Directory::TTHSet& tl;
-	bool operator()(const DirectoryListing::File::Ptr& i) const {
-		return tl.contains(i->getTTH());
-	}
-};
+void DirectoryListing::Directory::clearAll() noexcept {
+	// The items stay in the storage until the whole storage is freed
+	storage->addRemovedItems(getItemCountRecursive());
 
-struct DirectoryEmpty {
-	bool operator()(const DirectoryListing::Directory::Ptr& aDir) const {
-		return aDir->getContentInfo().isEmpty();
-	}
-};
+	directories.clear();
+	files.clear();
+}
 
-struct SizeLess {
-	bool operator()(const DirectoryListing::File::Ptr& f) const {
-		return f->getSize() < Util::convertSize(SETTING(SKIP_SUBTRACT), Util::KB);
+size_t DirectoryListing::Directory::getItemCountRecursive() const noexcept {
+	auto ret = directories.size() + files.size();
+	for (auto d : directories) {
+		ret += getDirectory(d).getItemCountRecursive();
 	}
-};
 
-DirectoryListing::Directory::~Directory() {
-	//dcdebug("DirectoryListing::Directory %s deleted\n", name.c_str());
+	return ret;
 }
 
-void DirectoryListing::Directory::clearAll() noexcept {
-	directories.clear();
-	files.clear();
+void DirectoryListing::Directory::moveToStorage(ItemStorage& aStorage) {
+	dcassert(isRoot());
+
+	// Readers may still be using the old lists so the new ones are set only after all items have been copied
+	IndexList newDirectories, newFiles;
+	copyItems(*this, aStorage, newDirectories, newFiles);
+
+	storage = &aStorage;
+	directories = newDirectories;
+	files = newFiles;
+}
+
+void DirectoryListing::Directory::copyItems(const Directory& aSource, ItemStorage& aStorage, IndexList& directories_, IndexList& files_) {
+	for (auto d : aSource.directories) {
+		const auto& source = aSource.getDirectory(d);
+
+		Directory* dir;
+		if (source.isVirtual()) {
+			const auto& virtualSource = static_cast<const VirtualDirectory&>(source);
+			dir = &aStorage.createVirtualDirectory(this, &aStorage, aStorage.internName(source.getName()), aStorage.storeName(virtualSource.getFullAdcPath()), virtualSource);
+		} else {
+			dir = &aStorage.createDirectory(this, &aStorage, aStorage.internName(source.getName()), source);
+		}
+
+		// The source lists are sorted already
+		dir->copyItems(source, aStorage, dir->directories, dir->files);
+		directories_.push_back(dir->index, aStorage.getArena());
+	}
+
+	for (auto f : aSource.files) {
+		const auto& source = aSource.getFile(f);
+		files_.push_back(aStorage.createFile(this, aStorage.storeName(source.getName()), source, source.getToken()), aStorage.getArena());
+	}
 }
 
 void DirectoryListing::Directory::filterList(DirectoryListing::Directory::TTHSet& l) noexcept {
-	std::erase_if(directories, [&l](auto& dp) {
-		auto d = dp.second.get();
-		d->filterList(l);
-		return d->directories.empty() && d->files.empty();
+	directories.erase_if([this, &l](ItemIndex aIndex) {
+		auto& d = getDirectory(aIndex);
+		d.filterList(l);
+		return d.directories.empty() && d.files.empty();
 	});
 
-	std::erase_if(files, HashContained(l));
+	files.erase_if([this, &l](ItemIndex aIndex) {
+		return l.contains(getFile(aIndex).getTTH());
+	});
 
 	if (SETTING(SKIP_SUBTRACT) > 0 && files.size() < 2) {   //setting for only skip if folder filecount under x ?
-		std::erase_if(files, SizeLess());
+		auto minSize = Util::convertSize(SETTING(SKIP_SUBTRACT), Util::KB);
+		files.erase_if([this, minSize](ItemIndex aIndex) {
+			return getFile(aIndex).getSize() < minSize;
+		});
 	}
 }
 
 void DirectoryListing::Directory::getHashList(DirectoryListing::Directory::TTHSet& l) const noexcept {
-	for(const auto& d: directories | views::values)  
-		d->getHashList(l);
+	for (auto d: directories)
+		getDirectory(d).getHashList(l);
 
-	for(const auto& f: files) 
-		l.insert(f->getTTH());
+	for (auto f: files)
+		l.insert(getFile(f).getTTH());
 }
 
 void DirectoryListing::File::getLocalPathsUnsafe(StringList& ret, const OptionalProfileToken& aShareProfileToken) const {
@@ -246,7 +387,7 @@ void DirectoryListing::File::getLocalPathsUnsafe(StringList& ret, const Optional
 			path = parent->getAdcPathUnsafe();
 		}
 
-		ShareManager::getInstance()->getRealPaths(path + name, ret, aShareProfileToken);
+		ShareManager::getInstance()->getRealPaths(path + string(name), ret, aShareProfileToken);
 	} else {
 		ret = DupeUtil::getFileDupePaths(dupe, tthRoot);
 	}
@@ -259,7 +400,7 @@ void DirectoryListing::Directory::getLocalPathsUnsafe(StringList& ret, const Opt
 	string path;
 	if (isVirtual()) {
 		auto virtualDir = static_cast<const VirtualDirectory*>(this);
-		path = virtualDir->getFullAdcPath() + name;
+		path = string(virtualDir->getFullAdcPath()) + string(name);
 	} else {
 		path = getAdcPathUnsafe();
 	}
@@ -276,30 +417,31 @@ int64_t DirectoryListing::Directory::getTotalSize(bool aCountVirtual) const noex
 		return partialSize;
 
 	int64_t x = 0;
-	for (const auto& f : files) {
-		x += f->getSize();
+	for (auto f : files) {
+		x += getFile(f).getSize();
 	}
 
-	for (const auto& d: directories | views::values) {
-		if (!aCountVirtual && d->isVirtual()) {
+	for (auto i: directories) {
+		const auto& d = getDirectory(i);
+		if (!aCountVirtual && d.isVirtual()) {
 			continue;
 		}
 
-		x += d->getTotalSize(d->isVirtual());
+		x += d.getTotalSize(d.isVirtual());
 	}
 	return x;
 }
 
 void DirectoryListing::Directory::clearVirtualDirectories() noexcept {
-	std::erase_if(directories, [](auto& dp) {
-		return dp.second->isVirtual();
+	directories.erase_if([this](ItemIndex aIndex) {
+		return getDirectory(aIndex).isVirtual();
 	});
 }
 
 string DirectoryListing::Directory::getAdcPathUnsafe() const noexcept {
 	//make sure to not try and get the name of the root dir
 	if (parent) {
-		return PathUtil::joinAdcDirectory(parent->getAdcPathUnsafe(), name);
+		return PathUtil::joinAdcDirectory(parent->getAdcPathUnsafe(), string(name));
 	}
 
 	// root
@@ -316,14 +458,15 @@ DupeType DirectoryListing::Directory::checkDupesRecursive() noexcept {
 	DupeUtil::DupeSet dupeSet;
 
 	// Children
-	for (const auto& d : directories | views::values) {
-		dupeSet.emplace(d->checkDupesRecursive());
+	for (auto d : directories) {
+		dupeSet.emplace(getDirectory(d).checkDupesRecursive());
 	}
 
 	// Files
-	for (const auto& f : files) {
-		auto fileDupe = DupeUtil::checkFileDupe(f->getTTH());
-		f->setDupe(fileDupe);
+	for (auto i : files) {
+		auto& f = getFile(i);
+		auto fileDupe = DupeUtil::checkFileDupe(f.getTTH());
+		f.setDupe(fileDupe);
 		dupeSet.emplace(fileDupe);
 	}
 
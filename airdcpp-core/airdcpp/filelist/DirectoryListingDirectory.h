@@ -23,6 +23,7 @@
 #include <airdcpp/core/header/typedefs.h>
 
 #include <airdcpp/filelist/DirectoryListing.h>
+#include <airdcpp/core/classes/MemoryArena.h>
 #include <airdcpp/core/types/DirectoryContentInfo.h>
 #include <airdcpp/core/types/DupeType.h>
 #include <airdcpp/core/types/GetSet.h>
@@ -33,42 +34,56 @@ namespace dcpp {
 
 class SearchQuery;
 
-class DirectoryListing::File: public boost::noncopyable {
+/*
+ * Items of a listing are stored in a common item storage (DirectoryListing::ItemStorage)
+ *
+ * Child items are referenced with 32 bit indexes and names are kept in a common string arena. The storage doesn't 
+ * free individual items so the memory of the whole listing is released at once when the listing (and the last item
+ * pointer referring to it) has been deleted. Item pointers (File::Ptr/Directory::Ptr) are views to the storage 
+ * and they will keep the whole storage alive.
+ *
+ * Items that are removed from the tree stay in the storage. When most of the items have been removed (e.g. after 
+ * reloading directories of a partial list), the remaining items are copied to a new storage.
+ */
 
+class DirectoryListing::File : public boost::noncopyable {
 public:
-	using Owner = const void*;
 	using Ptr = std::shared_ptr<File>;
 
 	struct Sort { bool operator()(const Ptr& a, const Ptr& b) const; };
 
 	using List = std::vector<Ptr>;
-	using Iter = List::const_iterator;
-		
-	File(Directory* aDir, const string& aName, int64_t aSize, const TTHValue& aTTH, time_t aRemoteDate) noexcept;
-	File(const File& rhs, Owner aOwner) noexcept;
-
-	~File() = default;
 
 	string getAdcPathUnsafe() const noexcept;
 
-	GETSET(string, name, Name);
-	GETSET(int64_t, size, Size);
-	GETSET(Directory*, parent, Parent);
-	GETSET(TTHValue, tthRoot, TTH);
+	// The name is null-terminated
+	string_view getName() const noexcept {
+		return name;
+	}
+
+	GETPROP(int64_t, size, Size);
+	GETPROP(Directory*, parent, Parent);
+	GETPROP(TTHValue, tthRoot, TTH);
+	GETPROP(time_t, remoteDate, RemoteDate);
 	IGETSET(DupeType, dupe, Dupe, DUPE_NONE);
-	IGETSET(time_t, remoteDate, RemoteDate, 0);
 
 	bool isInQueue() const noexcept;
 
-	Owner getOwner() const noexcept {
-		return owner;
-	}
 	DirectoryListingItemToken getToken() const noexcept {
 		return token;
 	}
 	void getLocalPathsUnsafe(StringList& ret, const OptionalProfileToken& aShareProfileToken) const;
 private:
-	Owner owner = nullptr;
+	friend class IndexedPool<File>;
+
+	// Use Directory::addFile for creating files
+	File(Directory* aDir, string_view aName, int64_t aSize, const TTHValue& aTTH, time_t aRemoteDate) noexcept;
+	File(Directory* aDir, string_view aName, const File& aSource) noexcept;
+
+	// Copy that keeps the token of the source (the item is only moved in a new storage)
+	File(Directory* aDir, string_view aName, const File& aSource, DirectoryListingItemToken aToken) noexcept;
+
+	const string_view name;
 	const DirectoryListingItemToken token;
 };
 
@@ -94,16 +109,50 @@ public:
 
 	using List = std::vector<Ptr>;
 	using TTHSet = unordered_set<TTHValue>;
-	using Map = map<const string *, Ptr, noCaseStringLess>;
-		
-	Map directories;
-	File::List files;
 
+	// Index of an item in the item storage
+	using ItemIndex = uint32_t;
+
+	// Child items of a directory
+	// Iterating creates item pointers that will keep the storage alive
+	template<class ItemT>
+	class ItemRange;
+
+	using DirectoryRange = ItemRange<Directory>;
+	using FileRange = ItemRange<File>;
+
+	// Throws AbortException if the parent contains a directory with the same name
 	static Ptr create(Directory* aParent, const string& aName, DirType aType, time_t aUpdateDate, 
 		const DirectoryContentInfo& aContentInfo = DirectoryContentInfo::uninitialized(),
 		const string& aSize = Util::emptyString, time_t aRemoteDate = 0);
 
-	virtual ~Directory();
+	// The root directory is allocated separately as the item storage is replaced when the whole list is reloaded
+	static Ptr createRoot(ItemStorage* aStorage) noexcept;
+
+	~Directory() = default;
+
+	// Directories are sorted by name (case-insensitive)
+	DirectoryRange getDirectories() const noexcept;
+	FileRange getFiles() const noexcept;
+
+	Ptr findDirectory(const string& aName) const noexcept;
+
+	// Throws std::bad_alloc
+	void addFile(string_view aName, int64_t aSize, const TTHValue& aTTH, time_t aRemoteDate);
+
+	// Adds a copy of a file from another directory
+	// Throws std::bad_alloc
+	void addFile(const File& aSource);
+
+	// Adds a child directory that was created without adding it in the parent
+	// Returns false if a directory with the same name exists already
+	bool addDirectory(const Ptr& aDirectory);
+
+	template<class PredT>
+	void removeDirectories(PredT&& aPred);
+
+	template<class PredT>
+	void removeFiles(PredT&& aPred);
 
 	int64_t getTotalSize(bool aCountVirtual) const noexcept;
 	void filterList(TTHSet& l) noexcept;
@@ -119,7 +168,7 @@ public:
 	DupeType checkDupesRecursive() noexcept;
 		
 	IGETSET(int64_t, partialSize, PartialSize, 0);
-	GETSET(Directory*, parent, Parent);
+	GETPROP(Directory*, parent, Parent);
 	GETSET(DirType, type, Type);
 	IGETSET(DupeType, dupe, Dupe, DUPE_NONE);
 	IGETSET(time_t, remoteDate, RemoteDate, 0);
@@ -134,7 +183,8 @@ public:
 	// Create recursive bundle file info listing with relative paths
 	BundleFileAddData::List toBundleInfoList() const noexcept;
 
-	const string& getName() const noexcept {
+	// The name is null-terminated
+	string_view getName() const noexcept {
 		return name;
 	}
 
@@ -158,29 +208,309 @@ public:
 	DirectoryListingItemToken getToken() const noexcept {
 		return token;
 	}
+
+	// Storage for the child items
+	ItemStorage* getStorage() const noexcept {
+		return storage;
+	}
+
+	// Used when the root directory is cleared (the existing child items won't be available via the root after this)
+	void setStorage(ItemStorage* aStorage) noexcept;
+
+	// Copy the items that are still in the tree to a new storage (the old items will be freed once they are no longer referenced elsewhere)
+	// Throws std::bad_alloc
+	void moveToStorage(ItemStorage& aStorage);
 protected:
+	friend class IndexedPool<Directory>;
+	friend class ItemStorage;
+
+	// Child item indexes
+	// Arrays are allocated from the arena of the storage and they are never freed as other threads may still be reading them
+	class IndexList {
+	public:
+		const ItemIndex* begin() const noexcept { return items; }
+		const ItemIndex* end() const noexcept { return items + count; }
+
+		size_t size() const noexcept { return count; }
+		bool empty() const noexcept { return count == 0; }
+
+		// Throws std::bad_alloc
+		void insert(const ItemIndex* aPos, ItemIndex aIndex, MemoryArena& aArena);
+		void push_back(ItemIndex aIndex, MemoryArena& aArena) { insert(end(), aIndex, aArena); }
+
+		template<class PredT>
+		void erase_if(PredT&& aPred) noexcept {
+			auto newEnd = std::remove_if(items, items + count, std::forward<PredT>(aPred));
+			count = static_cast<uint32_t>(newEnd - items);
+		}
+
+		void clear() noexcept { count = 0; }
+	private:
+		ItemIndex* items = nullptr;
+		uint32_t count = 0;
+		uint32_t capacity = 0;
+	};
+
 	void toBundleInfoList(const string& aTarget, BundleFileAddData::List& aFiles) const noexcept;
 
-	Directory(Directory* aParent, const string& aName, DirType aType, time_t aUpdateDate, const DirectoryContentInfo& aContentInfo, const string& aSize, time_t aRemoteDate);
+	Directory(Directory* aParent, ItemStorage* aStorage, string_view aName, DirType aType, time_t aUpdateDate, const DirectoryContentInfo& aContentInfo, const string& aSize, time_t aRemoteDate) noexcept;
+
+	// Copy without the child items, keeps the token of the source
+	Directory(Directory* aParent, ItemStorage* aStorage, string_view aName, const Directory& aSource) noexcept;
+
+	// Copy the child items of the source directory to the given storage
+	// Throws std::bad_alloc
+	void copyItems(const Directory& aSource, ItemStorage& aStorage, IndexList& directories_, IndexList& files_);
+
+	size_t getItemCountRecursive() const noexcept;
 
 	void getContentInfo(size_t& directories_, size_t& files_, bool aCountVirtual) const noexcept;
 
+	// Returns the position for a new directory or the position of an existing directory with the same name
+	const ItemIndex* findDirectoryPosition(const char* aName) const noexcept;
+
+	Directory& getDirectory(ItemIndex aIndex) const noexcept;
+	File& getFile(ItemIndex aIndex) const noexcept;
+
+	IndexList directories;
+	IndexList files;
+
+	ItemStorage* storage;
+
 	DirectoryContentInfo contentInfo = DirectoryContentInfo::uninitialized();
-	const string name;
+	const string_view name;
 	const DirectoryListingItemToken token;
+
+	// Index in the item storage (unused for the root)
+	ItemIndex index = 0;
 };
 
 class DirectoryListing::VirtualDirectory : public DirectoryListing::Directory {
 public:
 	using Ptr = shared_ptr<VirtualDirectory>;
-	GETSET(string, fullAdcPath, FullAdcPath);
+
+	string_view getFullAdcPath() const noexcept {
+		return fullAdcPath;
+	}
+
 	static Ptr create(const string& aFullAdcPath, Directory* aParent, const string& aName, bool aAddToParent = true);
 private:
-	VirtualDirectory(const string& aFullPath, Directory* aParent, const string& aName);
+	friend class IndexedPool<VirtualDirectory>;
+
+	VirtualDirectory(string_view aFullPath, Directory* aParent, string_view aName) noexcept;
+	VirtualDirectory(Directory* aParent, ItemStorage* aStorage, string_view aName, string_view aFullPath, const VirtualDirectory& aSource) noexcept;
+
+	const string_view fullAdcPath;
+};
+
+class DirectoryListing::ItemStorage : public std::enable_shared_from_this<ItemStorage> {
+public:
+	using ItemIndex = Directory::ItemIndex;
+
+	static ItemStoragePtr create() {
+		return std::make_shared<ItemStorage>();
+	}
+
+	ItemStorage() = default;
+
+	Directory& getDirectory(ItemIndex aIndex) noexcept {
+		return (aIndex & VIRTUAL_DIRECTORY) != 0 ? virtualDirectories[aIndex & ~VIRTUAL_DIRECTORY] : directories[aIndex];
+	}
+
+	File& getFile(ItemIndex aIndex) noexcept {
+		return files[aIndex];
+	}
+
+	// Throws std::bad_alloc
+	template<typename... ArgT>
+	Directory& createDirectory(ArgT&&... aArgs) {
+		auto index = directories.emplace(std::forward<ArgT>(aArgs)...);
+		auto& dir = directories[index];
+		dir.index = index;
+		return dir;
+	}
+
+	// Throws std::bad_alloc
+	template<typename... ArgT>
+	VirtualDirectory& createVirtualDirectory(ArgT&&... aArgs) {
+		auto index = virtualDirectories.emplace(std::forward<ArgT>(aArgs)...);
+		auto& dir = virtualDirectories[index];
+		dir.index = index | VIRTUAL_DIRECTORY;
+		return dir;
+	}
+
+	// Throws std::bad_alloc
+	template<typename... ArgT>
+	ItemIndex createFile(ArgT&&... aArgs) {
+		return files.emplace(std::forward<ArgT>(aArgs)...);
+	}
+
+	// Returns a pointer that keeps the storage alive
+	template<class ItemT>
+	shared_ptr<ItemT> toPtr(ItemT& aItem) noexcept {
+		return shared_ptr<ItemT>(shared_from_this(), &aItem);
+	}
+
+	// Copy the name in the storage
+	// Throws std::bad_alloc
+	string_view storeName(string_view aName) {
+		return arena.copyString(aName);
+	}
+
+	// Copy the name in the storage or return an existing copy (used for directory names that are commonly repeated)
+	// Throws std::bad_alloc
+	string_view internName(string_view aName);
+
+	// Release the name index used for interning (it's only needed while loading)
+	void clearNameIndex() noexcept {
+		decltype(nameIndex)().swap(nameIndex);
+	}
+
+	MemoryArena& getArena() noexcept {
+		return arena;
+	}
+
+	// Total memory allocated for the items
+	size_t getMemoryUsage() const noexcept;
+
+	size_t getItemCount() const noexcept {
+		return files.size() + directories.size() + virtualDirectories.size();
+	}
+
+	// Items that are no longer referenced by the tree (they are kept until the storage is replaced)
+	size_t getRemovedItemCount() const noexcept {
+		return removedItems;
+	}
+
+	void addRemovedItems(size_t aCount) noexcept {
+		removedItems += aCount;
+	}
+
+	// Most of the items are no longer in the tree and the remaining ones should be copied to a new storage
+	bool needsCompaction() const noexcept {
+		return removedItems >= COMPACT_MIN_REMOVED_ITEMS && removedItems * 2 >= getItemCount();
+	}
+
+	// Minimum number of removed items before the storage is compacted
+	static constexpr size_t COMPACT_MIN_REMOVED_ITEMS = 10000;
+
+	ItemStorage(const ItemStorage&) = delete;
+	ItemStorage& operator=(const ItemStorage&) = delete;
+private:
+	// Virtual directories are stored separately as they are larger
+	static constexpr ItemIndex VIRTUAL_DIRECTORY = static_cast<ItemIndex>(1) << 31;
+
+	MemoryArena arena;
+
+	IndexedPool<File> files;
+	IndexedPool<Directory> directories;
+	IndexedPool<VirtualDirectory> virtualDirectories;
+
+	unordered_set<string_view> nameIndex;
+
+	size_t removedItems = 0;
+};
+
+template<class ItemT>
+class DirectoryListing::Directory::ItemRange {
+public:
+	class Iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = shared_ptr<ItemT>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = shared_ptr<ItemT>;
+
+		Iterator() noexcept = default;
+		Iterator(const ItemRange* aRange, const ItemIndex* aPos) noexcept : range(aRange), pos(aPos) { }
+
+		shared_ptr<ItemT> operator*() const noexcept {
+			return range->toPtr(*pos);
+		}
+
+		Iterator& operator++() noexcept {
+			++pos;
+			return *this;
+		}
+
+		Iterator operator++(int) noexcept {
+			auto ret = *this;
+			++pos;
+			return ret;
+		}
+
+		bool operator==(const Iterator& aOther) const noexcept {
+			return pos == aOther.pos;
+		}
+	private:
+		const ItemRange* range = nullptr;
+		const ItemIndex* pos = nullptr;
+	};
+
+	// Indexes are read only once so the range will stay valid even if the directory is modified
+	ItemRange(ItemStoragePtr aStorage, const IndexList& aIndexes) noexcept : storage(std::move(aStorage)), first(aIndexes.begin()), last(aIndexes.end()) { }
+
+	Iterator begin() const noexcept {
+		return Iterator(this, first);
+	}
+
+	Iterator end() const noexcept {
+		return Iterator(this, last);
+	}
+
+	size_t size() const noexcept {
+		return static_cast<size_t>(last - first);
+	}
+
+	bool empty() const noexcept {
+		return first == last;
+	}
+
+	// Copy the item pointers
+	std::vector<shared_ptr<ItemT>> toList() const noexcept {
+		return std::vector<shared_ptr<ItemT>>(begin(), end());
+	}
+private:
+	shared_ptr<ItemT> toPtr(ItemIndex aIndex) const noexcept {
+		if constexpr (std::is_same_v<ItemT, File>) {
+			return shared_ptr<ItemT>(storage, &storage->getFile(aIndex));
+		} else {
+			return shared_ptr<ItemT>(storage, &storage->getDirectory(aIndex));
+		}
+	}
+
+	ItemStoragePtr storage;
+	const ItemIndex* first;
+	const ItemIndex* last;
 };
 
-inline bool operator==(const DirectoryListing::Directory::Ptr& a, const string& b) { return Util::stricmp(a->getName(), b) == 0; }
-inline bool operator==(const DirectoryListing::File::Ptr& a, const string& b) { return Util::stricmp(a->getName(), b) == 0; }
+inline DirectoryListing::Directory& DirectoryListing::Directory::getDirectory(ItemIndex aIndex) const noexcept {
+	return storage->getDirectory(aIndex);
+}
+
+inline DirectoryListing::File& DirectoryListing::Directory::getFile(ItemIndex aIndex) const noexcept {
+	return storage->getFile(aIndex);
+}
+
+template<class PredT>
+void DirectoryListing::Directory::removeDirectories(PredT&& aPred) {
+	auto owner = storage->shared_from_this();
+	directories.erase_if([&](ItemIndex aIndex) {
+		return aPred(Ptr(owner, &getDirectory(aIndex)));
+	});
+}
+
+template<class PredT>
+void DirectoryListing::Directory::removeFiles(PredT&& aPred) {
+	auto owner = storage->shared_from_this();
+	files.erase_if([&](ItemIndex aIndex) {
+		return aPred(File::Ptr(owner, &getFile(aIndex)));
+	});
+}
+
+inline bool operator==(const DirectoryListing::Directory::Ptr& a, const string& b) { return Util::stricmp(a->getName().data(), b.c_str()) == 0; }
+inline bool operator==(const DirectoryListing::File::Ptr& a, const string& b) { return Util::stricmp(a->getName().data(), b.c_str()) == 0; }
 
 } // namespace dcpp
 
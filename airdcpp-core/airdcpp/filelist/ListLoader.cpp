@@ -81,8 +81,7 @@ void ListLoader::loadFile(StringPairList& attribs, bool) {
 
 	TTHValue tth(h); /// @todo verify validity?
 
-	auto f = make_shared<DirectoryListing::File>(cur, n, size, tth, Util::parseRemoteFileItemDate(getAttrib(attribs, sDate, 3)));
-	cur->files.push_back(f);
+	cur->addFile(n, size, tth, Util::parseRemoteFileItemDate(getAttrib(attribs, sDate, 3)));
 }
 
 DirectoryListing::Directory::DirType ListLoader::parseDirectoryType(bool aIncomplete, const DirectoryContentInfo& aContentInfo) noexcept {
@@ -116,10 +115,7 @@ void ListLoader::loadDirectory(StringPairList& attribs, bool) {
 	if (updating) {
 		dirsLoaded++;
 
-		auto i = cur->directories.find(&name);
-		if (i != cur->directories.end()) {
-			d = i->second;
-		}
+		d = cur->findDirectory(name);
 	}
 
 	if (!d) {
@@ -215,17 +211,17 @@ void ListLoader::runHooksRecursive(const DirectoryListing::DirectoryPtr& aDir) n
 
 	// Directories
 
-	std::erase_if(aDir->directories, [this](auto& dp) {
-		auto error = list->loadHooks->directoryLoadHook.runHooksError(this, dp.second, *list);
+	aDir->removeDirectories([this](const auto& d) {
+		auto error = list->loadHooks->directoryLoadHook.runHooksError(this, d, *list);
 		if (error) {
-			dcdebug("Hook rejection for filelist directory %s (%s)\n", dp.second->getAdcPathUnsafe().c_str(), ActionHookRejection::formatError(error).c_str());
+			dcdebug("Hook rejection for filelist directory %s (%s)\n", d->getAdcPathUnsafe().c_str(), ActionHookRejection::formatError(error).c_str());
 		}
 
 		return error;
 	});
 
 	// Files
-	std::erase_if(aDir->files, [this](const auto& f) {
+	aDir->removeFiles([this](const auto& f) {
 		if (auto error = list->loadHooks->fileLoadHook.runHooksError(this, f, *list)) {
 			dcdebug("Hook rejection for filelist file %s (%s)\n", f->getAdcPathUnsafe().c_str(), ActionHookRejection::formatError(error).c_str());
 			return true;
@@ -236,8 +232,9 @@ void ListLoader::runHooksRecursive(const DirectoryListing::DirectoryPtr& aDir) n
 
 	// Children
 	if (aDir->findCompleteChildren()) {
-		parallel_for_each(aDir->directories.begin(), aDir->directories.end(), [this](const auto& d) {
-			runHooksRecursive(d.second);
+		auto directories = aDir->getDirectories().toList();
+		parallel_for_each(directories.begin(), directories.end(), [this](const auto& d) {
+			runHooksRecursive(d);
 		});
 	}
 }
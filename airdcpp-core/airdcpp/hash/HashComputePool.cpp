@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include <airdcpp/hash/HashComputePool.h>
+
+namespace dcpp {
+
+HashComputePool::HashComputePool(int aThreads) {
+	for (int i = 0; i < max(aThreads, 1); ++i) {
+		auto worker = make_unique<Worker>(*this);
+		worker->start();
+		workers.push_back(std::move(worker));
+	}
+}
+
+HashComputePool::~HashComputePool() {
+	stop();
+}
+
+void HashComputePool::stop() noexcept {
+	{
+		std::unique_lock l(mutex);
+		stopping = true;
+	}
+
+	readyCond.notify_all();
+	for (const auto& w: workers) {
+		w->join();
+	}
+
+	workers.clear();
+}
+
+void HashComputePool::Strand::post(Task&& aTask) noexcept {
+	{
+		std::unique_lock l(pool.mutex);
+		tasks.push_back(std::move(aTask));
+		if (scheduled) {
+			// the worker will pick it up
+			return;
+		}
+
+		scheduled = true;
+	}
+
+	pool.schedule(shared_from_this());
+}
+
+void HashComputePool::schedule(const StrandPtr& aStrand) noexcept {
+	{
+		std::unique_lock l(mutex);
+		readyStrands.push_back(aStrand);
+	}
+
+	readyCond.notify_one();
+}
+
+int HashComputePool::Worker::run() {
+	setCurrentThreadPriority(Thread::IDLE);
+	pool.work();
+	return 0;
+}
+
+void HashComputePool::work() noexcept {
+	std::unique_lock l(mutex);
+	for (;;) {
+		readyCond.wait(l, [this] { return stopping || !readyStrands.empty(); });
+		if (readyStrands.empty()) {
+			// stopping
+			break;
+		}
+
+		auto strand = std::move(readyStrands.front());
+		readyStrands.pop_front();
+
+		auto task = std::move(strand->tasks.front());
+		strand->tasks.pop_front();
+
+		l.unlock();
+		task();
+		l.lock();
+
+		// run a single task at a time so that the strands are processed evenly
+		if (strand->tasks.empty()) {
+			strand->scheduled = false;
+		} else {
+			readyStrands.push_back(std::move(strand));
+			readyCond.notify_one();
+		}
+	}
+}
+
+ByteVector* HashBufferPool::acquire(size_t aSize, size_t aMaxBuffers) noexcept {
+	std::unique_lock l(mutex);
+	releasedCond.wait(l, [&] { return inUse < aMaxBuffers; });
+	inUse++;
+
+	unique_ptr<ByteVector> buffer;
+	if (!freeBuffers.empty()) {
+		buffer = std::move(freeBuffers.back());
+		freeBuffers.pop_back();
+	} else {
+		buffer = make_unique<ByteVector>();
+	}
+
+	// keep the old content as it will be overwritten anyway
+	if (buffer->size() < aSize) {
+		buffer->resize(aSize);
+	}
+
+	return buffer.release();
+}
+
+void HashBufferPool::release(ByteVector* aBuffer) noexcept {
+	{
+		std::unique_lock l(mutex);
+		freeBuffers.emplace_back(aBuffer);
+		inUse--;
+	}
+
+	releasedCond.notify_all();
+}
+
+void HashBufferPool::waitReleased() noexcept {
+	std::unique_lock l(mutex);
+	releasedCond.wait(l, [this] { return inUse == 0; });
+}
+
+} // namespace dcpp
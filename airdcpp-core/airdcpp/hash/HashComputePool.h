@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_HASH_COMPUTE_POOL_H
+#define DCPLUSPLUS_DCPP_HASH_COMPUTE_POOL_H
+
+#include <airdcpp/core/header/typedefs.h>
+
+#include <airdcpp/core/thread/Thread.h>
+
+#include <condition_variable>
+#include <mutex>
+
+namespace dcpp {
+
+/**
+ * Worker threads that perform the CPU intensive part of hashing for all hashers.
+ *
+ * The work is posted to strands: tasks of a single strand are run in the posted order and never
+ * concurrently (e.g. the buffers of a single file) while different strands are processed in parallel.
+ */
+class HashComputePool {
+public:
+	using Task = std::function<void()>;
+
+	class Strand : public std::enable_shared_from_this<Strand> {
+	public:
+		explicit Strand(HashComputePool& aPool) noexcept : pool(aPool) { }
+
+		void post(Task&& aTask) noexcept;
+	private:
+		friend class HashComputePool;
+
+		HashComputePool& pool;
+		std::deque<Task> tasks;
+		bool scheduled = false;
+	};
+
+	using StrandPtr = shared_ptr<Strand>;
+
+	explicit HashComputePool(int aThreads);
+	~HashComputePool();
+
+	StrandPtr createStrand() noexcept { return make_shared<Strand>(*this); }
+
+	// Finish the queued tasks and stop the workers
+	void stop() noexcept;
+
+	size_t getThreadCount() const noexcept { return workers.size(); }
+
+	HashComputePool(const HashComputePool&) = delete;
+	HashComputePool& operator=(const HashComputePool&) = delete;
+private:
+	class Worker : public Thread {
+	public:
+		explicit Worker(HashComputePool& aPool) noexcept : pool(aPool) { }
+	private:
+		int run() override;
+
+		HashComputePool& pool;
+	};
+
+	void schedule(const StrandPtr& aStrand) noexcept;
+	void work() noexcept;
+
+	vector<unique_ptr<Worker>> workers;
+
+	std::deque<StrandPtr> readyStrands;
+	bool stopping = false;
+
+	std::mutex mutex;
+	std::condition_variable readyCond;
+};
+
+/**
+ * Bounded set of reusable read buffers for handing the file data to the compute pool.
+ */
+class HashBufferPool {
+public:
+	// Waits until less than aMaxBuffers buffers are in use
+	// The returned buffer is at least aSize bytes long
+	ByteVector* acquire(size_t aSize, size_t aMaxBuffers) noexcept;
+	void release(ByteVector* aBuffer) noexcept;
+
+	// Wait until all buffers have been released
+	void waitReleased() noexcept;
+private:
+	vector<unique_ptr<ByteVector>> freeBuffers;
+	size_t inUse = 0;
+
+	std::mutex mutex;
+	std::condition_variable releasedCond;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_HASH_COMPUTE_POOL_H)
@@ -24,6 +24,7 @@
 #include <airdcpp/core/io/FileReader.h>
 #include <airdcpp/events/LogManager.h>
 #include <airdcpp/hash/Hasher.h>
+#include <airdcpp/hash/HashComputePool.h>
 #include <airdcpp/hash/HashStore.h>
 #include <airdcpp/hash/HashedFile.h>
 #include <airdcpp/core/localization/ResourceManager.h>
@@ -52,6 +53,10 @@ void HashManager::log(const string& aMsg, LogMessage::Severity aSeverity) noexce
 
 
 // Hasher functions
+HashComputePool& HashManager::getComputePool() noexcept {
+	return *computePool;
+}
+
 void HashManager::onFileHashed(const string& aPath, HashedFile& aFile, const TigerTree& aTree, int aHasherId) noexcept {
 
 	HashManager::getInstance()->fire(HashManagerListener::FileHashed(), aPath, aFile, aHasherId);
@@ -93,6 +98,10 @@ string HashManager::getDbStats() noexcept {
 	return store->getDbStats();
 }
 
+HashStoreCacheStats HashManager::getCacheStats() const noexcept {
+	return store->getCacheStats();
+}
+
 void HashManager::getDbSizes(int64_t& fileDbSize_, int64_t& hashDbSize_) const noexcept {
 	return store->getDbSizes(fileDbSize_, hashDbSize_); 
 }
@@ -123,6 +132,15 @@ bool HashManager::checkTTH(const string& aFileLower, const string& aFileName, Ha
 	return true;
 }
 
+void HashManager::checkTTHs(HashedFileCheckList& files_) {
+	store->checkTTHs(files_);
+	for (const auto& f : files_) {
+		if (!f.found) {
+			hashFile(f.path, f.pathLower, f.info.getSize());
+		}
+	}
+}
+
 void HashManager::getFileInfo(const string& aFileLower, const string& aFileName, HashedFile& fi_) {
 	dcassert(Text::isLower(aFileLower));
 	auto found = store->getFileInfo(aFileLower, fi_);
@@ -368,6 +386,7 @@ int HashManager::Optimizer::run() {
 }
 
 void HashManager::startup(StartupLoader& aLoader) {
+	computePool = make_unique<HashComputePool>(static_cast<int>(std::thread::hardware_concurrency()));
 	hashers.push_back(new Hasher(false, 0, this));
 	store->load(aLoader); 
 }
@@ -392,6 +411,10 @@ void HashManager::shutdown(ProgressFunction progressF) noexcept {
 		}
 		Thread::sleep(50);
 	}
+
+	if (computePool) {
+		computePool->stop();
+	}
 }
 
 void HashManager::stop() noexcept {
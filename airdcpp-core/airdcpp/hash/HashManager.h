@@ -23,9 +23,11 @@
 #include <airdcpp/core/header/typedefs.h>
 
 #include <airdcpp/core/io/db/DbHandler.h>
+#include <airdcpp/hash/HashedFile.h>
 #include <airdcpp/hash/HasherManager.h>
 #include <airdcpp/hash/HasherStats.h>
 #include <airdcpp/hash/HashManagerListener.h>
+#include <airdcpp/hash/HashStoreCache.h>
 #include <airdcpp/hash/value/MerkleTree.h>
 #include <airdcpp/message/Message.h>
 #include <airdcpp/core/Singleton.h>
@@ -37,7 +39,6 @@ namespace dcpp {
 class Hasher;
 class HashStore;
 class HasherStats;
-class HashedFile;
 
 class HashManager : public Singleton<HashManager>, public Speaker<HashManagerListener>, public HasherManager {
 
@@ -50,6 +51,10 @@ public:
 	 */
 	bool checkTTH(const string& aFileLower, const string& aFileName, HashedFile& fi_);
 
+	// Check multiple files at once (preferably from the same directory)
+	// Files that aren't current are queued for hashing
+	void checkTTHs(HashedFileCheckList& files_);
+
 	void stopHashing(const string& aBaseDir) noexcept;
 	void setPriority(Thread::Priority p) noexcept;
 
@@ -118,6 +123,7 @@ public:
 	bool isHashingPaused(bool lock = true) const noexcept;
 
 	string getDbStats() noexcept;
+	HashStoreCacheStats getCacheStats() const noexcept;
 	void compact() noexcept;
 
 	void close() noexcept;
@@ -136,6 +142,7 @@ private:
 
 	friend class Hasher;
 
+	HashComputePool& getComputePool() noexcept override;
 	void onFileHashed(const string& aPath, HashedFile& aFile, const TigerTree& aTree, int aHasherId) noexcept override;
 	void onFileFailed(const string& aPath, const string& aErrorId, const string& aMessage, int aHasherId) noexcept override;
 	void onDirectoryHashed(const string& aPath, const HasherStats&, int aHasherId) noexcept override;
@@ -157,6 +164,9 @@ private:
 
 	unique_ptr<HashStore> store;
 
+	// Shared by all hashers
+	unique_ptr<HashComputePool> computePool;
+
 	/** Single node tree where node = root, no storage in HashData.dat */
 	static const int64_t SMALL_TREE = -1;
 
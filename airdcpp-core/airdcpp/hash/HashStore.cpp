@@ -20,8 +20,11 @@
 
 #include <airdcpp/hash/HashStore.h>
 #include <airdcpp/DCPlusPlus.h>
+#include <airdcpp/core/classes/ScopedFunctor.h>
 #include <airdcpp/core/io/File.h>
 #include <airdcpp/hash/HashedFile.h>
+#include <airdcpp/hash/HashStoreCache.h>
+#include <airdcpp/hash/HashStoreWriter.h>
 #include <airdcpp/core/io/db/LevelDB.h>
 #include <airdcpp/events/LogManager.h>
 #include <airdcpp/util/PathUtil.h>
@@ -62,6 +65,11 @@ void HashStore::openDb(StartupLoader& aLoader) {
 	auto cacheSize = static_cast<uint32_t>(Util::convertSize(max(SETTING(DB_CACHE_SIZE), 1), Util::MB));
 	auto blockSize = File::getBlockSize(AppUtil::getPath(AppUtil::PATH_USER_CONFIG));
 
+	// Most of the memory cache is reserved for trees as the file entries are small
+	auto memoryCacheSize = static_cast<size_t>(Util::convertSize(SETTING(HASH_CACHE_SIZE), Util::MB));
+	treeCache = make_unique<TreeCache>(memoryCacheSize / 4 * 3);
+	fileCache = make_unique<FileCache>(memoryCacheSize / 4);
+
 	try {
 		// Use the file system block size in here. Using a block size smaller than that reduces the performance significantly especially when writing a lot of data (e.g. when migrating the data)
 		// The default cache size of 8 MB is able to hold approximately 256-512 trees with the block size of 16KB which should be enough for most common transfers (should the size be increased with larger block size?)
@@ -74,13 +82,24 @@ void HashStore::openDb(StartupLoader& aLoader) {
 
 		hashDb->open(aLoader.stepF, aLoader.messageF);
 		fileDb->open(aLoader.stepF, aLoader.messageF);
+
+		writer = make_unique<HashStoreWriter>(*fileDb, *hashDb);
+		writer->start();
 	} catch (const DbException& e) {
 		// Can't continue without hash database, abort startup
 		throw AbortException(e.getError());
+	} catch (const ThreadException& e) {
+		throw AbortException(e.getError());
 	}
 }
 
 void HashStore::closeDb() noexcept {
+	// write everything that is still queued
+	if (writer) {
+		writer->stop();
+		writer.reset(nullptr);
+	}
+
 	hashDb.reset(nullptr);
 	fileDb.reset(nullptr);
 }
@@ -95,25 +114,17 @@ void HashStore::addHashedFile(const string& aFileLower, const TigerTree& tt, con
 }
 
 void HashStore::addFile(const string& aFileLower, const HashedFile& fi_) {
-	auto sz = getFileInfoSize(fi_);
-	void* buf = malloc(sz);
-	saveFileInfo(buf, fi_);
+	string value(getFileInfoSize(fi_), '\0');
+	saveFileInfo(value.data(), fi_);
 
-	try {
-		fileDb->put((void*)aFileLower.c_str(), aFileLower.length(), (void*)buf, sz);
-	} catch (const DbException& e) {
-		throw HashException(STRING_F(WRITE_FAILED_X, fileDb->getNameLower() % e.getError()));
-	}
-
-	free(buf);
+	// invalidate after queueing so that pending lookups won't cache the old entry
+	writer->putFile(aFileLower, std::move(value));
+	fileCache->remove(aFileLower);
 }
 
 void HashStore::removeFile(const string& aFilePathLower) {
-	try {
-		fileDb->remove((void*)aFilePathLower.c_str(), aFilePathLower.length());
-	} catch (const DbException& e) {
-		throw HashException(STRING_F(WRITE_FAILED_X, fileDb->getNameLower() % e.getError()));
-	}
+	writer->removeFile(aFilePathLower);
+	fileCache->remove(aFilePathLower);
 }
 
 
@@ -151,11 +162,10 @@ void HashStore::addTree(const TigerTree& tt) {
 	auto sz = sizeof(uint8_t) + sizeof(int64_t) + sizeof(int64_t) + treelen;
 
 	//allocate the memory
-	void* buf = malloc(sz);
-
+	string value(sz, '\0');
 
 	//set the data
-	char* p = (char*)buf;
+	char* p = value.data();
 
 	uint8_t version = HASHDATA_VERSION;
 	memcpy(p, &version, sizeof(uint8_t));
@@ -172,22 +182,32 @@ void HashStore::addTree(const TigerTree& tt) {
 	if (treelen > 0)
 		memcpy(p, tt.getLeaves()[0].data, treelen);
 
-	//throw HashException(STRING_F(WRITE_FAILED_X, hashDb->getNameLower() % "TEST"));
-	try {
-		hashDb->put((void*)tt.getRoot().data, sizeof(TTHValue), buf, sz);
-	} catch (const DbException& e) {
-		free(buf);
-		throw HashException(STRING_F(WRITE_FAILED_X, hashDb->getNameLower() % e.getError()));
-	}
-
-	free(buf);
+	writer->putTree(tt.getRoot(), std::move(value));
+	treeCache->remove(tt.getRoot());
 }
 
 bool HashStore::getTree(const TTHValue& aRoot, TigerTree& tt_) {
+	if (treeCache->get(aRoot, tt_)) {
+		return true;
+	}
+
+	auto cacheVersion = treeCache->getVersion(aRoot);
+
+	string queued;
+	if (writer->getTree(aRoot, queued)) {
+		return loadTree(queued.data(), queued.size(), aRoot, tt_, true);
+	}
+
 	try {
-		return hashDb->get((void*)aRoot.data, sizeof(TTHValue), 100 * 1024, [&](void* aValue, size_t valueLen) {
+		auto found = hashDb->get((void*)aRoot.data, sizeof(TTHValue), 100 * 1024, [&](void* aValue, size_t valueLen) {
 			return loadTree(aValue, valueLen, aRoot, tt_, true);
 		});
+
+		if (found) {
+			treeCache->put(aRoot, tt_, sizeof(TigerTree) + tt_.getLeaves().size() * sizeof(TTHValue), cacheVersion);
+		}
+
+		return found;
 	} catch (const DbException& e) {
 		log(STRING_F(READ_FAILED_X, hashDb->getNameLower() % e.getError()), LogMessage::SEV_ERROR);
 	}
@@ -196,6 +216,15 @@ bool HashStore::getTree(const TTHValue& aRoot, TigerTree& tt_) {
 }
 
 bool HashStore::hasTree(const TTHValue& aRoot) {
+	if (treeCache->contains(aRoot)) {
+		return true;
+	}
+
+	string queued;
+	if (writer->getTree(aRoot, queued)) {
+		return true;
+	}
+
 	bool ret = false;
 	try {
 		ret = hashDb->hasKey((void*)aRoot.data, sizeof(TTHValue));
@@ -300,24 +329,39 @@ uint32_t HashStore::getFileInfoSize(const HashedFile& /*aTree*/) {
 	return sizeof(uint8_t) + sizeof(uint64_t) + sizeof(TTHValue) + sizeof(int64_t);
 }
 
-int64_t HashStore::getRootInfo(const TTHValue& root, InfoType aType) noexcept {
-	int64_t ret = 0;
-	try {
-		hashDb->get((void*)root.data, sizeof(TTHValue), 100 * 1024, [&](void* aValue, size_t /*valueLen*/) {
-			char* p = (char*)aValue;
+bool HashStore::loadRootInfo(const void* src, size_t len, InfoType aType, int64_t& value_) {
+	// Only the fixed header fields are needed (the leaves aren't decoded)
+	if (len < sizeof(uint8_t) + sizeof(int64_t) + sizeof(int64_t))
+		return false;
 
-			uint8_t version;
-			memcpy(&version, p, sizeof(uint8_t));
-			p += sizeof(uint8_t);
+	char* p = (char*)src;
 
-			if (version > FILEINDEX_VERSION) {
-				return false;
-			}
+	uint8_t version;
+	memcpy(&version, p, sizeof(uint8_t));
+	p += sizeof(uint8_t);
 
-			p += (aType == TYPE_FILESIZE ? 0 : sizeof(int64_t));
+	if (version > HASHDATA_VERSION) {
+		return false;
+	}
 
-			memcpy(&ret, p, sizeof(ret));
-			return true;
+	p += (aType == TYPE_FILESIZE ? 0 : sizeof(int64_t));
+
+	memcpy(&value_, p, sizeof(value_));
+	return true;
+}
+
+int64_t HashStore::getRootInfo(const TTHValue& root, InfoType aType) noexcept {
+	int64_t ret = 0;
+
+	string queued;
+	if (writer->getTree(root, queued)) {
+		loadRootInfo(queued.data(), queued.size(), aType, ret);
+		return ret;
+	}
+
+	try {
+		hashDb->get((void*)root.data, sizeof(TTHValue), 100 * 1024, [&](void* aValue, size_t valueLen) {
+			return loadRootInfo(aValue, valueLen, aType, ret);
 		});
 	} catch (const DbException& e) {
 		log(STRING_F(READ_FAILED_X, hashDb->getNameLower() % e.getError()), LogMessage::SEV_ERROR);
@@ -338,11 +382,96 @@ bool HashStore::checkTTH(const string& aFileLower, HashedFile& fi_) noexcept {
 	return false;
 }
 
+void HashStore::checkFileInfo(HashedFileCheck& aFile, const HashedFile& aStoredInfo) noexcept {
+	if (aStoredInfo.getTimeStamp() == aFile.info.getTimeStamp() && aStoredInfo.getSize() == aFile.info.getSize()) {
+		aFile.info = aStoredInfo;
+		aFile.found = true;
+	}
+}
+
+void HashStore::checkTTHs(HashedFileCheckList& files_) noexcept {
+	// File index and cache version of entries that need to be read from the database
+	vector<pair<size_t, uint64_t>> dbFiles;
+	for (size_t i = 0; i < files_.size(); ++i) {
+		auto& file = files_[i];
+
+		HashedFile fi;
+		if (fileCache->get(file.pathLower, fi)) {
+			checkFileInfo(file, fi);
+			continue;
+		}
+
+		auto cacheVersion = fileCache->getVersion(file.pathLower);
+
+		// entries that haven't been written yet
+		string queued;
+		switch (writer->getFile(file.pathLower, queued)) {
+			case HashStoreWriter::LookupResult::FOUND: {
+				if (loadFileInfo(queued.data(), queued.size(), fi)) {
+					checkFileInfo(file, fi);
+				}
+				continue;
+			}
+			case HashStoreWriter::LookupResult::REMOVED: continue;
+			case HashStoreWriter::LookupResult::NOT_QUEUED: break;
+		}
+
+		dbFiles.emplace_back(i, cacheVersion);
+	}
+
+	if (dbFiles.empty()) {
+		return;
+	}
+
+	ranges::sort(dbFiles, [&files_](const auto& a, const auto& b) { return files_[a.first].pathLower < files_[b.first].pathLower; });
+
+	StringList keys;
+	keys.reserve(dbFiles.size());
+	for (const auto& [i, version] : dbFiles) {
+		keys.push_back(files_[i].pathLower);
+	}
+
+	try {
+		fileDb->getMultiple(keys, sizeof(HashedFile), [&](size_t aKeyIndex, void* aValue, size_t aValueLen) {
+			const auto& [i, cacheVersion] = dbFiles[aKeyIndex];
+			auto& file = files_[i];
+
+			HashedFile fi;
+			if (loadFileInfo(aValue, aValueLen, fi)) {
+				fileCache->put(file.pathLower, fi, sizeof(HashedFile) + file.pathLower.size(), cacheVersion);
+				checkFileInfo(file, fi);
+			}
+		});
+	} catch (const DbException& e) {
+		log(STRING_F(READ_FAILED_X, fileDb->getNameLower() % e.getError()), LogMessage::SEV_ERROR);
+	}
+}
+
 bool HashStore::getFileInfo(const string& aFileLower, HashedFile& fi_) noexcept {
+	if (fileCache->get(aFileLower, fi_)) {
+		return true;
+	}
+
+	auto cacheVersion = fileCache->getVersion(aFileLower);
+
+	// entries that haven't been written yet
+	string queued;
+	switch (writer->getFile(aFileLower, queued)) {
+		case HashStoreWriter::LookupResult::FOUND: return loadFileInfo(queued.data(), queued.size(), fi_);
+		case HashStoreWriter::LookupResult::REMOVED: return false;
+		case HashStoreWriter::LookupResult::NOT_QUEUED: break;
+	}
+
 	try {
-		return fileDb->get((void*)aFileLower.c_str(), aFileLower.length(), sizeof(HashedFile), [&](void* aValue, size_t valueLen) {
+		auto found = fileDb->get((void*)aFileLower.c_str(), aFileLower.length(), sizeof(HashedFile), [&](void* aValue, size_t valueLen) {
 			return loadFileInfo(aValue, valueLen, fi_);
 		});
+
+		if (found) {
+			fileCache->put(aFileLower, fi_, sizeof(HashedFile) + aFileLower.size(), cacheVersion);
+		}
+
+		return found;
 	} catch (const DbException& e) {
 		log(STRING_F(READ_FAILED_X, fileDb->getNameLower() % e.getError()), LogMessage::SEV_ERROR);
 	}
@@ -363,7 +492,16 @@ void HashStore::optimize(bool doVerify) noexcept {
 
 	log(STRING(HASHDB_MAINTENANCE_STARTED), LogMessage::SEV_INFO);
 
+	// the snapshots must contain all the queued entries
+	flush();
+
 	{
+		// entries may be removed from the databases
+		ScopedFunctor([this] {
+			treeCache->clear();
+			fileCache->clear();
+		});
+
 		unordered_set<TTHValue> usedRoots;
 
 		//make sure that the databases stay in sync so that trees added during this operation won't get removed
@@ -485,7 +623,13 @@ void HashStore::optimize(bool doVerify) noexcept {
 	}
 }
 
+void HashStore::flush() noexcept {
+	writer->flush();
+}
+
 void HashStore::compact() noexcept {
+	flush();
+
 	log(STRING_F(COMPACTING_X, fileDb->getNameLower()), LogMessage::SEV_INFO);
 	fileDb->compact();
 	log(STRING_F(COMPACTING_X, hashDb->getNameLower()), LogMessage::SEV_INFO);
@@ -503,10 +647,28 @@ string HashStore::getDbStats() noexcept {
 	statMsg += hashDb->getStats();
 	statMsg += "Deleted entries since last compaction: " + Util::toString(SETTING(CUR_REMOVED_TREES)) + " (" + Util::toString(((double)SETTING(CUR_REMOVED_TREES) / (double)hashDb->size(false)) * 100) + "%)";
 	statMsg += "\r\n\r\n";
+	statMsg += "Queued writes: " + Util::toString(writer->getQueueSize());
+
+	auto cacheStats = getCacheStats();
+	statMsg += "\r\nMemory cache: " + Util::formatBytes(cacheStats.treeBytes + cacheStats.fileBytes) + " / " + Util::formatBytes(cacheStats.maxBytes);
+	statMsg += "\r\nTree cache hits: " + Util::toString(cacheStats.treeHits) + ", misses: " + Util::toString(cacheStats.treeMisses);
+	statMsg += "\r\nFile cache hits: " + Util::toString(cacheStats.fileHits) + ", misses: " + Util::toString(cacheStats.fileMisses);
 	statMsg += "\n\nDisk block size: " + Util::formatBytes(File::getBlockSize(hashDb->getPath())) + "\n\n";
 	return statMsg;
 }
 
+HashStoreCacheStats HashStore::getCacheStats() const noexcept {
+	HashStoreCacheStats stats;
+	stats.treeHits = treeCache->getHits();
+	stats.treeMisses = treeCache->getMisses();
+	stats.treeBytes = treeCache->getBytes();
+	stats.fileHits = fileCache->getHits();
+	stats.fileMisses = fileCache->getMisses();
+	stats.fileBytes = fileCache->getBytes();
+	stats.maxBytes = treeCache->getMaxBytes() + fileCache->getMaxBytes();
+	return stats;
+}
+
 void HashStore::onScheduleRepair(bool aSchedule) {
 	if (aSchedule) {
 		File::createFile(hashDb->getRepairFlag());
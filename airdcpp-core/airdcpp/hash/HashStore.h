@@ -23,18 +23,22 @@
 #include <airdcpp/core/header/typedefs.h>
 
 #include <airdcpp/core/io/db/DbHandler.h>
+#include <airdcpp/hash/HashedFile.h>
+#include <airdcpp/hash/HashStoreCache.h>
 #include <airdcpp/hash/value/MerkleTree.h>
 #include <airdcpp/message/Message.h>
 
 namespace dcpp {
 
-class HashedFile;
+class HashStoreWriter;
 
 class HashStore {
 public:
 	HashStore();
 	~HashStore();
 
+	// Writes are queued and committed to the database in batches
+	// Throws HashException if the database has been closed or writing a previous batch has failed
 	void addHashedFile(const string& aFilePathLower, const TigerTree& tt, const HashedFile& fi_);
 	void addFile(const string& aFilePathLower, const HashedFile& fi_);
 	void removeFile(const string& aFilePathLower);
@@ -49,6 +53,10 @@ public:
 
 	bool checkTTH(const string& aFileNameLower, HashedFile& fi_) noexcept;
 
+	// Checks multiple files at once, reading the database in key order
+	// Works best with files located in the same directory
+	void checkTTHs(HashedFileCheckList& files_) noexcept;
+
 	void addTree(const TigerTree& tt);
 	bool getFileInfo(const string& aFileLower, HashedFile& aFile) noexcept;
 	bool getTree(const TTHValue& root, TigerTree& tth);
@@ -61,6 +69,7 @@ public:
 	int64_t getRootInfo(const TTHValue& aRoot, InfoType aType) noexcept;
 
 	string getDbStats() noexcept;
+	HashStoreCacheStats getCacheStats() const noexcept;
 
 	void openDb(StartupLoader& aLoader);
 	void closeDb() noexcept;
@@ -71,14 +80,27 @@ public:
 	void getDbSizes(int64_t& fileDbSize_, int64_t& hashDbSize_) const noexcept;
 	void compact() noexcept;
 
+	// Wait until all queued writes have been committed to the database
+	void flush() noexcept;
+
 	static void log(const string& aMsg, LogMessage::Severity aSeverity) noexcept;
 private:
 	std::unique_ptr<DbHandler> fileDb;
 	std::unique_ptr<DbHandler> hashDb;
+	std::unique_ptr<HashStoreWriter> writer;
+
+	// Decoded entries that have been read from the databases
+	using TreeCache = ShardedLruCache<TTHValue, TigerTree>;
+	using FileCache = ShardedLruCache<string, HashedFile>;
+
+	std::unique_ptr<TreeCache> treeCache;
+	std::unique_ptr<FileCache> fileCache;
 
 	static bool loadTree(const void* src, size_t len, const TTHValue& aRoot, TigerTree& aTree, bool aReportCorruption);
+	static bool loadRootInfo(const void* src, size_t len, InfoType aType, int64_t& value_);
 
 	static bool loadFileInfo(const void* src, size_t len, HashedFile& aFile);
+	static void checkFileInfo(HashedFileCheck& aFile, const HashedFile& aStoredInfo) noexcept;
 	static void saveFileInfo(void* dest, const HashedFile& aTree);
 	static uint32_t getFileInfoSize(const HashedFile& aTree);
 };
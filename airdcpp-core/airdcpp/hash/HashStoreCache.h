@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_HASH_STORE_CACHE_H
+#define DCPLUSPLUS_DCPP_HASH_STORE_CACHE_H
+
+#include <airdcpp/core/header/typedefs.h>
+
+#include <airdcpp/core/thread/CriticalSection.h>
+
+#include <list>
+
+namespace dcpp {
+
+struct HashStoreCacheStats {
+	uint64_t treeHits = 0;
+	uint64_t treeMisses = 0;
+	uint64_t fileHits = 0;
+	uint64_t fileMisses = 0;
+
+	size_t treeBytes = 0;
+	size_t fileBytes = 0;
+	size_t maxBytes = 0;
+};
+
+/**
+ * Size-bounded LRU cache that is split into independently locked shards.
+ *
+ * Callers that load values from a slower source should take the version of the key before loading
+ * and pass it to put, which will discard the value if the key has been invalidated in the meantime.
+ */
+template<class KeyT, class ValueT, size_t ShardCount = 16>
+class ShardedLruCache {
+public:
+	using Version = uint64_t;
+
+	explicit ShardedLruCache(size_t aMaxBytes) noexcept : shardMaxBytes(aMaxBytes / ShardCount) { }
+
+	bool get(const KeyT& aKey, ValueT& value_) noexcept {
+		auto& shard = getShard(aKey);
+
+		Lock l(shard.cs);
+		auto i = shard.index.find(aKey);
+		if (i == shard.index.end()) {
+			misses++;
+			return false;
+		}
+
+		// move to the front
+		shard.items.splice(shard.items.begin(), shard.items, i->second);
+		value_ = i->second->value;
+		hits++;
+		return true;
+	}
+
+	bool contains(const KeyT& aKey) const noexcept {
+		auto& shard = getShard(aKey);
+
+		Lock l(shard.cs);
+		return shard.index.contains(aKey);
+	}
+
+	Version getVersion(const KeyT& aKey) const noexcept {
+		auto& shard = getShard(aKey);
+
+		Lock l(shard.cs);
+		return shard.version;
+	}
+
+	void put(const KeyT& aKey, const ValueT& aValue, size_t aBytes, Version aVersion) noexcept {
+		if (aBytes > shardMaxBytes) {
+			return;
+		}
+
+		auto& shard = getShard(aKey);
+
+		Lock l(shard.cs);
+		if (shard.version != aVersion) {
+			// invalidated while the value was being loaded
+			return;
+		}
+
+		removeUnsafe(shard, aKey);
+
+		shard.items.emplace_front(aKey, aValue, aBytes);
+		shard.index.emplace(aKey, shard.items.begin());
+		shard.bytes += aBytes;
+
+		while (shard.bytes > shardMaxBytes) {
+			auto& last = shard.items.back();
+			shard.bytes -= last.bytes;
+			shard.index.erase(last.key);
+			shard.items.pop_back();
+		}
+	}
+
+	void remove(const KeyT& aKey) noexcept {
+		auto& shard = getShard(aKey);
+
+		Lock l(shard.cs);
+		shard.version++;
+		removeUnsafe(shard, aKey);
+	}
+
+	void clear() noexcept {
+		for (auto& shard: shards) {
+			Lock l(shard.cs);
+			shard.version++;
+			shard.index.clear();
+			shard.items.clear();
+			shard.bytes = 0;
+		}
+	}
+
+	size_t getBytes() const noexcept {
+		size_t ret = 0;
+		for (const auto& shard: shards) {
+			Lock l(shard.cs);
+			ret += shard.bytes;
+		}
+
+		return ret;
+	}
+
+	size_t getMaxBytes() const noexcept { return shardMaxBytes * ShardCount; }
+	uint64_t getHits() const noexcept { return hits; }
+	uint64_t getMisses() const noexcept { return misses; }
+
+	ShardedLruCache(const ShardedLruCache&) = delete;
+	ShardedLruCache& operator=(const ShardedLruCache&) = delete;
+private:
+	struct Item {
+		Item(const KeyT& aKey, const ValueT& aValue, size_t aBytes) : key(aKey), value(aValue), bytes(aBytes) { }
+
+		const KeyT key;
+		ValueT value;
+		const size_t bytes;
+	};
+
+	using ItemList = std::list<Item>;
+
+	struct Shard {
+		mutable CriticalSection cs;
+		ItemList items;
+		unordered_map<KeyT, typename ItemList::iterator> index;
+		size_t bytes = 0;
+		Version version = 0;
+	};
+
+	static void removeUnsafe(Shard& aShard, const KeyT& aKey) noexcept {
+		auto i = aShard.index.find(aKey);
+		if (i != aShard.index.end()) {
+			aShard.bytes -= i->second->bytes;
+			aShard.items.erase(i->second);
+			aShard.index.erase(i);
+		}
+	}
+
+	Shard& getShard(const KeyT& aKey) noexcept { return shards[std::hash<KeyT>()(aKey) % ShardCount]; }
+	const Shard& getShard(const KeyT& aKey) const noexcept { return shards[std::hash<KeyT>()(aKey) % ShardCount]; }
+
+	const size_t shardMaxBytes;
+	Shard shards[ShardCount];
+
+	atomic<uint64_t> hits = 0;
+	atomic<uint64_t> misses = 0;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_HASH_STORE_CACHE_H)
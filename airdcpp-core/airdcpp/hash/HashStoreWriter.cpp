@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include <airdcpp/hash/HashStoreWriter.h>
+
+#include <airdcpp/core/classes/Exception.h>
+#include <airdcpp/core/io/db/DbHandler.h>
+#include <airdcpp/core/localization/ResourceManager.h>
+#include <airdcpp/core/timer/TimerManager.h>
+#include <airdcpp/hash/HashStore.h>
+#include <airdcpp/util/Util.h>
+
+namespace dcpp {
+
+HashStoreWriter::HashStoreWriter(DbHandler& aFileDb, DbHandler& aHashDb) noexcept : fileDb(aFileDb), hashDb(aHashDb) {
+
+}
+
+HashStoreWriter::~HashStoreWriter() {
+	dcassert(pending.empty() && writing.empty());
+}
+
+void HashStoreWriter::putFile(const string& aPathLower, string&& aValue) {
+	WLock l(cs);
+	waitQueueSpace(l);
+	pending.files.insert_or_assign(aPathLower, optional<string>(std::move(aValue)));
+	onQueued();
+}
+
+void HashStoreWriter::removeFile(const string& aPathLower) {
+	WLock l(cs);
+	waitQueueSpace(l);
+	pending.files.insert_or_assign(aPathLower, nullopt);
+	onQueued();
+}
+
+void HashStoreWriter::putTree(const TTHValue& aRoot, string&& aValue) {
+	WLock l(cs);
+	waitQueueSpace(l);
+	pending.trees.insert_or_assign(aRoot, std::move(aValue));
+	onQueued();
+}
+
+void HashStoreWriter::waitQueueSpace(WLock& l) {
+	// don't let the hashers get too far ahead of the database
+	writtenCond.wait(l, [this] { return pending.size() < MAX_PENDING || stopping || !writeError.empty(); });
+
+	if (!writeError.empty()) {
+		throw HashException(writeError);
+	}
+
+	if (stopping) {
+		throw HashException("The hash database is being closed");
+	}
+}
+
+void HashStoreWriter::onQueued() noexcept {
+	auto queued = pending.size();
+	if (queued == 1) {
+		firstPendingTick = GET_TICK();
+		queuedCond.notify_one();
+	} else if (queued >= BATCH_SIZE) {
+		queuedCond.notify_one();
+	}
+}
+
+HashStoreWriter::LookupResult HashStoreWriter::getFile(const string& aPathLower, string& value_) const noexcept {
+	RLock l(cs);
+
+	// newest entries first
+	for (const auto q: { &pending, &writing }) {
+		auto i = q->files.find(aPathLower);
+		if (i != q->files.end()) {
+			if (!i->second) {
+				return LookupResult::REMOVED;
+			}
+
+			value_ = *i->second;
+			return LookupResult::FOUND;
+		}
+	}
+
+	return LookupResult::NOT_QUEUED;
+}
+
+bool HashStoreWriter::getTree(const TTHValue& aRoot, string& value_) const noexcept {
+	RLock l(cs);
+	for (const auto q: { &pending, &writing }) {
+		auto i = q->trees.find(aRoot);
+		if (i != q->trees.end()) {
+			value_ = i->second;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+size_t HashStoreWriter::getQueueSize() const noexcept {
+	RLock l(cs);
+	return pending.size() + writing.size();
+}
+
+void HashStoreWriter::flush() noexcept {
+	WLock l(cs);
+	if (pending.empty() && writing.empty()) {
+		return;
+	}
+
+	flushRequested = true;
+	queuedCond.notify_one();
+	writtenCond.wait(l, [this] { return pending.empty() && writing.empty(); });
+}
+
+void HashStoreWriter::stop() noexcept {
+	{
+		WLock l(cs);
+		stopping = true;
+	}
+
+	queuedCond.notify_one();
+	join();
+}
+
+int HashStoreWriter::run() {
+	for (;;) {
+		{
+			WLock l(cs);
+			for (;;) {
+				if (stopping || flushRequested || pending.size() >= BATCH_SIZE) {
+					break;
+				}
+
+				if (pending.empty()) {
+					queuedCond.wait(l);
+					continue;
+				}
+
+				auto elapsed = GET_TICK() - firstPendingTick;
+				if (elapsed >= FLUSH_INTERVAL) {
+					break;
+				}
+
+				queuedCond.wait_for(l, std::chrono::milliseconds(FLUSH_INTERVAL - elapsed));
+			}
+
+			if (pending.empty()) {
+				flushRequested = false;
+				if (stopping) {
+					break;
+				}
+
+				continue;
+			}
+
+			// the entries remain visible for lookups until they have been written
+			writing = std::move(pending);
+			pending = Queue();
+		}
+
+		auto error = commit(writing);
+
+		{
+			WLock l(cs);
+			writing = Queue();
+			if (!error.empty() && writeError.empty()) {
+				writeError = error;
+			}
+		}
+
+		writtenCond.notify_all();
+	}
+
+	writtenCond.notify_all();
+	return 0;
+}
+
+string HashStoreWriter::commit(Queue& aQueue) noexcept {
+	// write the trees first so that file entries won't point to missing trees
+	if (!aQueue.trees.empty()) {
+		DbWriteBatch batch;
+		for (const auto& [root, value]: aQueue.trees) {
+			batch.put(string(reinterpret_cast<const char*>(root.data), sizeof(TTHValue)), string(value));
+		}
+
+		if (auto error = commit(hashDb, batch); !error.empty()) {
+			// don't add file entries without trees
+			return error;
+		}
+	}
+
+	if (!aQueue.files.empty()) {
+		DbWriteBatch batch;
+		for (const auto& [path, value]: aQueue.files) {
+			if (value) {
+				batch.put(string(path), string(*value));
+			} else {
+				batch.remove(string(path));
+			}
+		}
+
+		return commit(fileDb, batch);
+	}
+
+	return Util::emptyString;
+}
+
+string HashStoreWriter::commit(DbHandler& aDb, DbWriteBatch& aBatch) noexcept {
+	try {
+		aDb.write(aBatch);
+	} catch (const DbException& e) {
+		auto error = STRING_F(WRITE_FAILED_X, aDb.getNameLower() % e.getError());
+		HashStore::log(error, LogMessage::SEV_ERROR);
+		return error;
+	}
+
+	return Util::emptyString;
+}
+
+} // namespace dcpp
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_HASH_STORE_WRITER_H
+#define DCPLUSPLUS_DCPP_HASH_STORE_WRITER_H
+
+#include <airdcpp/core/header/typedefs.h>
+
+#include <airdcpp/core/thread/CriticalSection.h>
+#include <airdcpp/core/thread/Thread.h>
+#include <airdcpp/hash/value/MerkleTree.h>
+
+#include <condition_variable>
+
+namespace dcpp {
+
+class DbHandler;
+class DbWriteBatch;
+
+/**
+ * Write-behind queue for the hash databases. Entries are committed in batches by a dedicated thread
+ * either when enough of them have been queued or when the oldest one has waited long enough.
+ * Queued entries can be looked up until they have been written.
+ */
+class HashStoreWriter : public Thread {
+public:
+	// Commit after this many queued entries...
+	static const size_t BATCH_SIZE = 512;
+
+	// ...or when the oldest entry has waited for this long (ms)
+	static const uint64_t FLUSH_INTERVAL = 1000;
+
+	// Block the writers when this many entries are waiting for the database
+	static const size_t MAX_PENDING = 8 * BATCH_SIZE;
+
+	HashStoreWriter(DbHandler& aFileDb, DbHandler& aHashDb) noexcept;
+	~HashStoreWriter() override;
+
+	// Writes are refused after the writer has been stopped or when a batch couldn't be written
+	// Throws HashException
+	void putFile(const string& aPathLower, string&& aValue);
+	void removeFile(const string& aPathLower);
+	void putTree(const TTHValue& aRoot, string&& aValue);
+
+	enum class LookupResult {
+		NOT_QUEUED,
+		FOUND,
+		REMOVED
+	};
+
+	LookupResult getFile(const string& aPathLower, string& value_) const noexcept;
+	bool getTree(const TTHValue& aRoot, string& value_) const noexcept;
+
+	// Wait until all queued entries have been written
+	void flush() noexcept;
+
+	// Write the remaining entries and stop the thread
+	void stop() noexcept;
+
+	size_t getQueueSize() const noexcept;
+
+	HashStoreWriter(const HashStoreWriter&) = delete;
+	HashStoreWriter& operator=(const HashStoreWriter&) = delete;
+private:
+	struct Queue {
+		// Value is unset for removed files
+		unordered_map<string, optional<string>> files;
+		unordered_map<TTHValue, string> trees;
+
+		size_t size() const noexcept { return files.size() + trees.size(); }
+		bool empty() const noexcept { return files.empty() && trees.empty(); }
+	};
+
+	int run() override;
+
+	// Throws HashException
+	void waitQueueSpace(WLock& l);
+	void onQueued() noexcept;
+
+	// Returns the error if the batch couldn't be written
+	string commit(Queue& aQueue) noexcept;
+	static string commit(DbHandler& aDb, DbWriteBatch& aBatch) noexcept;
+
+	DbHandler& fileDb;
+	DbHandler& hashDb;
+
+	// Entries that are waiting for the next batch
+	Queue pending;
+
+	// Entries of the batch that is being written
+	Queue writing;
+
+	uint64_t firstPendingTick = 0;
+	bool flushRequested = false;
+	bool stopping = false;
+
+	// Set when writing a batch has failed, no more entries are accepted after that
+	string writeError;
+
+	mutable SharedMutex cs;
+	std::condition_variable_any queuedCond;
+	std::condition_variable_any writtenCond;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_HASH_STORE_WRITER_H)
@@ -40,6 +40,19 @@ public:
 
 using RenameList = std::vector<pair<std::string, HashedFile>>;
 
+// A file whose information is checked from the hash store
+// The provided info is replaced with the stored one if the timestamp and size match
+struct HashedFileCheck {
+	HashedFileCheck(std::string&& aPath, std::string&& aPathLower, const HashedFile& aInfo) : path(std::move(aPath)), pathLower(std::move(aPathLower)), info(aInfo) {}
+
+	std::string path;
+	std::string pathLower;
+	HashedFile info;
+	bool found = false;
+};
+
+using HashedFileCheckList = std::vector<HashedFileCheck>;
+
 }
 
 #endif // !defined(DCPLUSPLUS_DCPP_HASHEDFILEINFO_H)
\ No newline at end of file
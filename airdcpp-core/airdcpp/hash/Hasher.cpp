@@ -23,9 +23,11 @@
 #include <airdcpp/core/classes/Exception.h>
 #include <airdcpp/core/io/File.h>
 #include <airdcpp/core/io/FileReader.h>
+#include <airdcpp/core/classes/ScopedFunctor.h>
 #include <airdcpp/hash/HasherStats.h>
 #include <airdcpp/hash/HashedFile.h>
 #include <airdcpp/hash/value/MerkleTree.h>
+#include <airdcpp/hash/ParallelTreeHasher.h>
 #include <airdcpp/util/PathUtil.h>
 #include <airdcpp/core/localization/ResourceManager.h>
 #include <airdcpp/settings/SettingsManager.h>
@@ -41,6 +43,10 @@ namespace dcpp {
 SharedMutex Hasher::hcs;
 const int64_t Hasher::MIN_BLOCK_SIZE = 64 * 1024;
 
+CriticalSection Hasher::deviceThreadCS;
+map<devid, int> Hasher::deviceThreads;
+map<devid, bool> Hasher::rotationalDevices;
+
 
 Hasher::Hasher(bool aIsPaused, int aHasherID, HasherManager* aManager) : hasherID(aHasherID), manager(aManager), paused(aIsPaused) {
 	start();
@@ -225,7 +231,28 @@ void Hasher::instantPause() {
 	}
 }
 
-optional<HashedFile> Hasher::hashFile(const WorkItem& aItem, HasherStats& stats_, const DirSFVReader& aSFV) noexcept {
+struct Hasher::FileJob {
+	FileJob(const string& aPath, int64_t aSize, uint64_t aTimeStamp, int64_t aBlockSize, const optional<uint32_t>& aExpectedCRC, HasherStats& aStats, uint64_t aStart) noexcept :
+		filePath(aPath), size(aSize), timeStamp(aTimeStamp), start(aStart), tree(aBlockSize), expectedCRC(aExpectedCRC), stats(aStats) { }
+
+	const string filePath;
+	const int64_t size;
+	const uint64_t timeStamp;
+	const uint64_t start;
+
+	TigerTree tree;
+
+	CRC32Filter crc32;
+	uint32_t crcValue = 0;
+	const optional<uint32_t> expectedCRC;
+
+	HasherStats& stats;
+
+	// Reading failed (already reported)
+	bool failed = false;
+};
+
+void Hasher::hashFile(const WorkItem& aItem, HasherStats& stats_, const DirSFVReader& aSFV) noexcept {
 	auto start = GET_TICK();
 	auto sizeLeft = aItem.fileSize;
 	try {
@@ -243,69 +270,102 @@ optional<HashedFile> Hasher::hashFile(const WorkItem& aItem, HasherStats& stats_
 			throw FileException(STRING(INVALID_MODIFICATION_DATE));
 		}
 
-		TigerTree tt(blockSize);
-
-		CRC32Filter crc32;
-
 		auto fileCRC = aSFV.hasFile(Text::toLower(PathUtil::getFileName(aItem.filePath)));
+		auto job = make_shared<FileJob>(aItem.filePath, size, timestamp, blockSize, fileCRC, stats_, start);
 
 		uint64_t lastRead = GET_TICK();
 
-		FileReader fr(FileReader::ASYNC);
-		fr.read(aItem.filePath, [&](const void* buf, size_t n) {
-			if (SETTING(MAX_HASH_SPEED) > 0) {
-				uint64_t now = GET_TICK();
-				uint64_t minTime = n * 1000LL / Util::convertSize(SETTING(MAX_HASH_SPEED), Util::MB);
+		// Called concurrently when the file is hashed with multiple threads
+		CriticalSection readCS;
+		auto onRead = [&](size_t n) {
+			uint64_t sleepTime = 0;
 
-				if (lastRead + minTime > now) {
-					Thread::sleep(minTime - (now - lastRead));
+			{
+				Lock l(readCS);
+				if (SETTING(MAX_HASH_SPEED) > 0) {
+					uint64_t now = GET_TICK();
+					uint64_t minTime = n * 1000LL / Util::convertSize(SETTING(MAX_HASH_SPEED), Util::MB);
+
+					if (lastRead + minTime > now) {
+						sleepTime = minTime - (now - lastRead);
+					}
+					lastRead = lastRead + minTime;
+				} else {
+					lastRead = GET_TICK();
 				}
-				lastRead = lastRead + minTime;
-			} else {
-				lastRead = GET_TICK();
-			}
 
-			tt.update(buf, n);
+				sizeLeft -= n;
+				uint64_t end = GET_TICK();
 
-			if (fileCRC) {
-				crc32(buf, n);
+				if (totalBytesLeft > 0)
+					totalBytesLeft -= n;
+				if (end > start)
+					lastSpeed = (size - sizeLeft) * 1000 / (end - start);
 			}
 
-			sizeLeft -= n;
-			uint64_t end = GET_TICK();
-
-			if (totalBytesLeft > 0)
-				totalBytesLeft -= n;
-			if (end > start)
-				lastSpeed = (size - sizeLeft) * 1000 / (end - start);
+			if (sleepTime > 0) {
+				Thread::sleep(sleepTime);
+			}
 
 			return !stopping;
-		});
+		};
 
-		tt.finalize();
+		auto threads = reserveFileThreads(aItem.deviceId, size, blockSize);
+		if (threads > 1) {
+			ScopedFunctor([&] { releaseFileThreads(aItem.deviceId, threads); });
 
-		auto failed = (fileCRC && crc32.getValue() != *fileCRC) || stopping;
+			ParallelTreeHasher treeHasher(aItem.filePath, size, blockSize, fileCRC.has_value());
+			treeHasher.hash(threads, job->tree, onRead);
+			job->crcValue = treeHasher.getCRC();
 
-		auto end = GET_TICK();
-		auto duration = end - start;
-		if (!failed) {
-			stats_.addFile(size, duration);
-		}
+			onFileHashed(*job);
+		} else {
+			// Read the file in this thread and let the compute pool hash the data
+			// The next file can be read while the previous one is still being hashed
+			auto options = getReadOptions(aItem.deviceId);
+			auto strand = manager->getComputePool().createStrand();
+
+			{
+				std::lock_guard l(pendingMutex);
+				pendingFiles++;
+			}
 
-		if (!stopping) {
-			if (failed) {
-				logFailedFile(aItem.filePath, STRING(ERROR_HASHING_CRC32));
-				manager->onFileFailed(aItem.filePath, HASH_ERROR_CRC, STRING(ERROR_HASHING_CRC32), hasherID);
-			} else {
-				// Log
-				auto averageSpeed = duration > 0 ? size * 1000 / duration : 0;
-				logHashedFile(aItem.filePath, averageSpeed);
-
-				// Save the tree
-				auto fi = HashedFile(tt.getRoot(), timestamp, size);
-				manager->onFileHashed(aItem.filePath, fi, tt, hasherID);
-				return fi;
+			auto finish = [&] {
+				strand->post([this, job] {
+					if (!job->failed) {
+						job->tree.finalize();
+						job->crcValue = job->crc32.getValue();
+						onFileHashed(*job);
+					}
+
+					onPendingFileFinished();
+				});
+			};
+
+			try {
+				FileReader fr(FileReader::ASYNC, options.blockSize, options.queueDepth);
+				fr.read(aItem.filePath, [&](const void* buf, size_t n) {
+					auto buffer = readBuffers.acquire(n, options.maxBuffers);
+					memcpy(buffer->data(), buf, n);
+
+					strand->post([this, job, buffer, n] {
+						job->tree.update(buffer->data(), n);
+						if (job->expectedCRC) {
+							job->crc32(buffer->data(), n);
+						}
+
+						readBuffers.release(buffer);
+					});
+
+					return onRead(n);
+				});
+			} catch (const FileException&) {
+				job->failed = true;
+				finish();
+				throw;
 			}
+
+			finish();
 		}
 	} catch (const FileException& e) {
 		totalBytesLeft -= sizeLeft;
@@ -313,9 +373,109 @@ optional<HashedFile> Hasher::hashFile(const WorkItem& aItem, HasherStats& stats_
 		logFailedFile(aItem.filePath, e.getError());
 		manager->onFileFailed(aItem.filePath, HASH_ERROR_IO, e.getError(), hasherID);
 	}
+}
 
-	return nullopt;
+void Hasher::onFileHashed(FileJob& aJob) noexcept {
+	auto failed = (aJob.expectedCRC && aJob.crcValue != *aJob.expectedCRC) || stopping;
+
+	auto end = GET_TICK();
+	auto duration = end - aJob.start;
+	if (!failed) {
+		Lock l(statsCS);
+		aJob.stats.addFile(aJob.size, duration);
+	}
+
+	if (stopping) {
+		return;
+	}
+
+	if (failed) {
+		logFailedFile(aJob.filePath, STRING(ERROR_HASHING_CRC32));
+		manager->onFileFailed(aJob.filePath, HASH_ERROR_CRC, STRING(ERROR_HASHING_CRC32), hasherID);
+	} else {
+		// Log
+		auto averageSpeed = duration > 0 ? aJob.size * 1000 / duration : 0;
+		logHashedFile(aJob.filePath, averageSpeed);
+
+		// Save the tree
+		auto fi = HashedFile(aJob.tree.getRoot(), aJob.timeStamp, aJob.size);
+		manager->onFileHashed(aJob.filePath, fi, aJob.tree, hasherID);
+	}
 }
+
+void Hasher::onPendingFileFinished() noexcept {
+	// the hasher may be deleted right after the lock has been released
+	std::lock_guard l(pendingMutex);
+	pendingFiles--;
+	pendingCond.notify_all();
+}
+
+void Hasher::waitPendingFiles() noexcept {
+	std::unique_lock l(pendingMutex);
+	pendingCond.wait(l, [this] { return pendingFiles == 0; });
+}
+
+bool Hasher::isRotationalDevice(devid aDeviceId) noexcept {
+	Lock l(deviceThreadCS);
+	auto i = rotationalDevices.find(aDeviceId);
+	if (i == rotationalDevices.end()) {
+		i = rotationalDevices.emplace(aDeviceId, File::isRotationalDevice(aDeviceId)).first;
+	}
+
+	return i->second;
+}
+
+Hasher::DeviceReadOptions Hasher::getReadOptions(devid aDeviceId) noexcept {
+	if (isRotationalDevice(aDeviceId)) {
+		// Large requests with a short queue to minimize seeking
+		return { 4 * 1024 * 1024, 2, 4 };
+	}
+
+	// Flash devices need more concurrent requests to reach their full throughput
+	return { 1024 * 1024, 8, 16 };
+}
+
+int Hasher::reserveFileThreads(devid aDeviceId, int64_t aFileSize, int64_t aBlockSize) noexcept {
+	if (SETTING(HASH_PARALLEL_MIN_SIZE) == 0 || aFileSize < Util::convertSize(SETTING(HASH_PARALLEL_MIN_SIZE), Util::MB)) {
+		return 1;
+	}
+
+	// Parallel reads would only cause seeking with spinning disks
+	if (isRotationalDevice(aDeviceId)) {
+		return 1;
+	}
+
+	auto wanted = static_cast<int>(min(static_cast<size_t>(SETTING(HASH_PARALLEL_THREADS)), ParallelTreeHasher::getChunkCount(aFileSize, aBlockSize)));
+
+	Lock l(deviceThreadCS);
+	auto& reserved = deviceThreads[aDeviceId];
+	auto threads = min(wanted, SETTING(HASH_PARALLEL_THREADS) - reserved);
+	if (threads <= 1) {
+		if (reserved == 0) {
+			deviceThreads.erase(aDeviceId);
+		}
+
+		return 1;
+	}
+
+	reserved += threads;
+	return threads;
+}
+
+void Hasher::releaseFileThreads(devid aDeviceId, int aThreads) noexcept {
+	Lock l(deviceThreadCS);
+	auto i = deviceThreads.find(aDeviceId);
+	if (i == deviceThreads.end()) {
+		dcassert(0);
+		return;
+	}
+
+	i->second -= aThreads;
+	if (i->second <= 0) {
+		deviceThreads.erase(i);
+	}
+}
+
 void Hasher::processQueue() noexcept {
 	int totalDirsHashed = 0;
 	string initialDir;
@@ -325,6 +485,9 @@ void Hasher::processQueue() noexcept {
 
 	string fname;
 	DirSFVReader sfv;
+	// files that are still being processed by the compute pool must not be left behind
+	ScopedFunctor([this] { waitPendingFiles(); });
+
 	for (;;) {
 		instantPause(); //suspend the thread...
 		if (stopping) {
@@ -354,7 +517,7 @@ void Hasher::processQueue() noexcept {
 			initialDir = PathUtil::getFilePath(wi.filePath);
 		}
 
-		auto fi = hashFile(wi, dirStats, sfv);
+		hashFile(wi, dirStats, sfv);
 
 		auto onDirHashed = [&]() {
 			manager->onDirectoryHashed(initialDir, dirStats, hasherID);
@@ -366,10 +529,22 @@ void Hasher::processQueue() noexcept {
 			initialDir.clear();
 		};
 
+		auto isDirFinished = [&] {
+			return w.empty() || !PathUtil::isParentOrExactLocal(initialDir, w.front().filePath);
+		};
+
 		{
 			WLock l(hcs);
 			removeDevice(wi.deviceId);
 
+			if (isDirFinished()) {
+				// The directory statistics are complete only after the compute pool has finished with the files
+				// (wait without holding the lock as the compute threads need it for reporting)
+				l.unlock();
+				waitPendingFiles();
+				l.lock();
+			}
+
 			if (w.empty()) {
 				// Finished hashing
 				running = false;
@@ -396,7 +571,7 @@ void Hasher::processQueue() noexcept {
 
 				clearStats();
 				manager->onHasherFinished(totalDirsHashed, totalStats, hasherID);
-			} else if (!PathUtil::isParentOrExactLocal(initialDir, w.front().filePath)) {
+			} else if (isDirFinished()) {
 				onDirHashed();
 			}
 
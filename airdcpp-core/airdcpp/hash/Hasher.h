@@ -22,6 +22,7 @@
 #include <airdcpp/core/header/typedefs.h>
 
 #include <airdcpp/core/thread/CriticalSection.h>
+#include <airdcpp/hash/HashComputePool.h>
 #include <airdcpp/hash/HasherManager.h>
 #include <airdcpp/util/PathUtil.h>
 #include <airdcpp/core/thread/Semaphore.h>
@@ -95,8 +96,52 @@ namespace dcpp {
 			};
 		};
 
+		// State of a file whose data is being processed by the compute pool
+		struct FileJob;
+
 		void processQueue() noexcept;
-		optional<HashedFile> hashFile(const WorkItem& aItem, HasherStats& stats_, const DirSFVReader& aSFV) noexcept;
+
+		// Reads the file and passes the data to the compute pool (the file may still be processed after returning)
+		void hashFile(const WorkItem& aItem, HasherStats& stats_, const DirSFVReader& aSFV) noexcept;
+
+		// Called after the whole file has been hashed
+		void onFileHashed(FileJob& aJob) noexcept;
+
+		// Wait until the compute pool has processed all files read by this hasher
+		void waitPendingFiles() noexcept;
+		void onPendingFileFinished() noexcept;
+
+		int pendingFiles = 0;
+		std::mutex pendingMutex;
+		std::condition_variable pendingCond;
+
+		HashBufferPool readBuffers;
+
+		// Protects the directory statistics that are updated from the compute threads
+		CriticalSection statsCS;
+
+		struct DeviceReadOptions {
+			// Size of a single read request
+			size_t blockSize;
+
+			// Number of read requests that are queued in advance
+			size_t queueDepth;
+
+			// Number of read blocks that may wait for the compute pool
+			size_t maxBuffers;
+		};
+
+		static DeviceReadOptions getReadOptions(devid aDeviceId) noexcept;
+		static bool isRotationalDevice(devid aDeviceId) noexcept;
+
+		// Reserve threads for hashing a large file in parallel (shared per device between all hashers)
+		// Returns the number of threads that the file should be hashed with
+		static int reserveFileThreads(devid aDeviceId, int64_t aFileSize, int64_t aBlockSize) noexcept;
+		static void releaseFileThreads(devid aDeviceId, int aThreads) noexcept;
+
+		static CriticalSection deviceThreadCS;
+		static map<devid, int> deviceThreads;
+		static map<devid, bool> rotationalDevices;
 
 		SortedVector<WorkItem, std::deque, string, PathUtil::PathSortOrderInt, WorkItem::NameLower> w;
 
@@ -25,8 +25,10 @@
 #include <airdcpp/message/Message.h>
 
 namespace dcpp {
+	class HashComputePool;
 	class HasherStats;
 	struct HasherManager {
+		virtual HashComputePool& getComputePool() noexcept = 0;
 		virtual void onFileHashed(const string& aPath, HashedFile& aFile, const TigerTree& aTree, int aHasherId) noexcept = 0;
 		virtual void onFileFailed(const string& aPath, const string& aErrorId, const string& aMessage, int aHasherId) noexcept = 0;
 		virtual void onDirectoryHashed(const string& aPath, const HasherStats&, int aHasherId) noexcept = 0;
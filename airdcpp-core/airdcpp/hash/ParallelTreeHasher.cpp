@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+
+#include <airdcpp/hash/ParallelTreeHasher.h>
+
+#include <airdcpp/core/classes/Exception.h>
+#include <airdcpp/core/io/FileReader.h>
+#include <airdcpp/core/io/compress/ZUtils.h>
+#include <airdcpp/core/localization/ResourceManager.h>
+#include <airdcpp/core/thread/Thread.h>
+
+namespace dcpp {
+
+// Each thread should read large enough sequential ranges
+static const int64_t MIN_CHUNK_SIZE = 64 * 1024 * 1024;
+
+namespace {
+
+class ChunkWorker : public Thread {
+public:
+	explicit ChunkWorker(std::function<void ()>&& aF) : f(std::move(aF)) {
+		start();
+	}
+
+	~ChunkWorker() override {
+		join();
+	}
+protected:
+	int run() override {
+		f();
+		return 0;
+	}
+private:
+	const std::function<void ()> f;
+};
+
+}
+
+ParallelTreeHasher::ParallelTreeHasher(const string& aPath, int64_t aFileSize, int64_t aBlockSize, bool aCalculateCRC) noexcept :
+	path(aPath), fileSize(aFileSize), blockSize(aBlockSize), chunkSize(getChunkSize(aBlockSize)), calculateCRC(aCalculateCRC) {
+
+}
+
+int64_t ParallelTreeHasher::getChunkSize(int64_t aBlockSize) noexcept {
+	// The chunks must start from a leaf boundary so that the leaves can be combined as such
+	return max(MIN_CHUNK_SIZE / aBlockSize, static_cast<int64_t>(1)) * aBlockSize;
+}
+
+size_t ParallelTreeHasher::getChunkCount(int64_t aFileSize, int64_t aBlockSize) noexcept {
+	auto chunkSize = getChunkSize(aBlockSize);
+	return static_cast<size_t>(max((aFileSize + chunkSize - 1) / chunkSize, static_cast<int64_t>(1)));
+}
+
+void ParallelTreeHasher::hash(int aThreads, TigerTree& tree_, const ProgressF& aProgressF) {
+	dcassert(tree_.getBlockSize() == blockSize && tree_.getLeaves().empty());
+
+	progressF = aProgressF;
+	chunks.resize(getChunkCount(fileSize, blockSize));
+
+	{
+		vector<unique_ptr<ChunkWorker>> workers;
+		auto threads = min(static_cast<size_t>(max(aThreads, 1)), chunks.size());
+		for (size_t i = 1; i < threads; ++i) {
+			try {
+				workers.push_back(make_unique<ChunkWorker>([this] { hashChunks(); }));
+			} catch (const ThreadException& e) {
+				dcdebug("ParallelTreeHasher: failed to create a worker thread (%s)\n", e.getError().c_str());
+				break;
+			}
+		}
+
+		hashChunks();
+
+		// The workers are joined here
+	}
+
+	if (!error.empty()) {
+		throw FileException(error);
+	}
+
+	if (aborted) {
+		return;
+	}
+
+	CRC32Filter crc32;
+	for (const auto& c: chunks) {
+		tree_.append(*c.tree);
+		if (calculateCRC) {
+			crc32.combine(c.crc, c.tree->getFileSize());
+		}
+	}
+
+	tree_.calcRoot();
+	crc = crc32.getValue();
+}
+
+void ParallelTreeHasher::hashChunks() noexcept {
+	for (;;) {
+		auto index = nextChunk++;
+		if (index >= chunks.size() || aborted) {
+			return;
+		}
+
+		try {
+			hashChunk(index, chunks[index]);
+		} catch (const FileException& e) {
+			setError(e.getError());
+			return;
+		} catch (const std::exception& e) {
+			setError(e.what());
+			return;
+		} catch (...) {
+			setError("Unknown error");
+			return;
+		}
+	}
+}
+
+void ParallelTreeHasher::setError(const string& aError) noexcept {
+	{
+		Lock l(cs);
+		if (error.empty()) {
+			error = aError;
+		}
+	}
+
+	aborted = true;
+}
+
+void ParallelTreeHasher::hashChunk(size_t aIndex, Chunk& chunk_) {
+	auto start = static_cast<int64_t>(aIndex) * chunkSize;
+	auto length = min(chunkSize, fileSize - start);
+
+	auto tree = make_unique<TigerTree>(blockSize);
+	CRC32Filter crc32;
+
+	FileReader reader(FileReader::ASYNC);
+	auto bytesRead = reader.read(path, start, length, [&](const void* aBuf, size_t aLen) {
+		tree->update(aBuf, aLen);
+		if (calculateCRC) {
+			crc32(aBuf, aLen);
+		}
+
+		if (aborted) {
+			return false;
+		}
+
+		if (!progressF(aLen)) {
+			aborted = true;
+			return false;
+		}
+
+		return true;
+	});
+
+	if (aborted) {
+		return;
+	}
+
+	if (static_cast<int64_t>(bytesRead) != length) {
+		throw FileException(STRING(FILE_SIZE_CHANGED));
+	}
+
+	tree->finalize();
+
+	chunk_.tree = std::move(tree);
+	chunk_.crc = crc32.getValue();
+}
+
+} // namespace dcpp
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_PARALLEL_TREE_HASHER_H
+#define DCPLUSPLUS_DCPP_PARALLEL_TREE_HASHER_H
+
+#include <airdcpp/core/header/typedefs.h>
+
+#include <airdcpp/core/thread/CriticalSection.h>
+#include <airdcpp/hash/value/MerkleTree.h>
+
+namespace dcpp {
+
+/**
+ * Hashes a single file with multiple threads by splitting it into chunks that are aligned to the
+ * block size of the tree. The produced tree is identical to the one from a sequential update.
+ */
+class ParallelTreeHasher {
+public:
+	// Called after each read block (concurrently from all hashing threads), return false to abort hashing
+	using ProgressF = std::function<bool (size_t aBytes)>;
+
+	ParallelTreeHasher(const string& aPath, int64_t aFileSize, int64_t aBlockSize, bool aCalculateCRC) noexcept;
+
+	/**
+	 * Hash the file using the wanted number of threads (including the calling thread)
+	 * @throw FileException if reading fails
+	 */
+	void hash(int aThreads, TigerTree& tree_, const ProgressF& aProgressF);
+
+	uint32_t getCRC() const noexcept { return crc; }
+
+	// Return the chunk size for the tree block size
+	static int64_t getChunkSize(int64_t aBlockSize) noexcept;
+	static size_t getChunkCount(int64_t aFileSize, int64_t aBlockSize) noexcept;
+
+	ParallelTreeHasher(const ParallelTreeHasher&) = delete;
+	ParallelTreeHasher& operator=(const ParallelTreeHasher&) = delete;
+private:
+	struct Chunk {
+		unique_ptr<TigerTree> tree;
+		uint32_t crc = 0;
+	};
+
+	void hashChunks() noexcept;
+	void hashChunk(size_t aIndex, Chunk& chunk_);
+	void setError(const string& aError) noexcept;
+
+	const string path;
+	const int64_t fileSize;
+	const int64_t blockSize;
+	const int64_t chunkSize;
+	const bool calculateCRC;
+
+	vector<Chunk> chunks;
+	atomic<size_t> nextChunk = 0;
+	atomic<bool> aborted = false;
+
+	ProgressF progressF;
+
+	CriticalSection cs;
+	string error;
+
+	uint32_t crc = 0;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_PARALLEL_TREE_HASHER_H)
@@ -104,20 +104,31 @@ public:
 		// Skip empty data sets if we already added at least one of them...
 		if(len == 0 && !(leaves.empty() && blocks.empty()))
 			return;
-		
-		do {
-			size_t n = min(baseBlockSize, len-i);
-			Hasher h;
-			h.update(&zero, 1);
-			h.update(buf + i, n);
-			if((int64_t)baseBlockSize < blockSize) {
-				blocks.emplace_back(MerkleValue(h.finalize()), baseBlockSize);
-				reduceBlocks();
-			} else {
-				leaves.emplace_back(h.finalize());
+
+		if constexpr (requires(const void* d, size_t n, uint8_t* r) { Hasher::hashBlocks(d, n, n, zero, r); }) {
+			// Full base blocks can be hashed in parallel
+			uint8_t hashes[BLOCK_BATCH_SIZE * BYTES];
+			while(len - i >= baseBlockSize) {
+				size_t n = min((len - i) / baseBlockSize, BLOCK_BATCH_SIZE);
+				Hasher::hashBlocks(buf + i, n, baseBlockSize, zero, hashes);
+				for(size_t j = 0; j < n; ++j) {
+					addBaseBlock(MerkleValue(hashes + j * BYTES));
+				}
+				i += n * baseBlockSize;
 			}
-			i += n;
-		} while(i < len);
+		}
+
+		// Remaining partial block (or the empty block of a 0-length file)
+		if(i < len || len == 0) {
+			do {
+				size_t n = min(baseBlockSize, len-i);
+				Hasher h;
+				h.update(&zero, 1);
+				h.update(buf + i, n);
+				addBaseBlock(MerkleValue(h.finalize()));
+				i += n;
+			} while(i < len);
+		}
 		fileSize += len;
 	}
 
@@ -159,6 +170,16 @@ public:
 		root = getHash(0, fileSize);
 	}
 
+	/**
+	 * Append the leaves of a finalized tree that was calculated for the data following the data of this tree.
+	 * The size of the data in this tree must be a multiple of the block size (calcRoot must be called afterwards).
+	 */
+	void append(const MerkleTree& aTree) {
+		dcassert(aTree.blockSize == blockSize && (fileSize % blockSize) == 0 && blocks.empty());
+		leaves.insert(leaves.end(), aTree.leaves.begin(), aTree.leaves.end());
+		fileSize += aTree.fileSize;
+	}
+
 	ByteVector getLeafData() {
 		ByteVector buf(getLeaves().size() * BYTES);
 		uint8_t* p = &buf[0];
@@ -170,6 +191,9 @@ public:
 
 
 private:	
+	/** Number of base blocks to pass to the hasher at once */
+	static constexpr size_t BLOCK_BATCH_SIZE = 64;
+
 	typedef pair<MerkleValue, int64_t> MerkleBlock;
 	typedef vector<MerkleBlock> MBList;
 
@@ -205,6 +229,15 @@ private:
 		return MerkleValue(h.finalize());
 	}
 
+	void addBaseBlock(const MerkleValue& aHash) {
+		if((int64_t)baseBlockSize < blockSize) {
+			blocks.emplace_back(aHash, baseBlockSize);
+			reduceBlocks();
+		} else {
+			leaves.push_back(aHash);
+		}
+	}
+
 	void reduceBlocks() {
 		while(blocks.size() > 1) {
 			MerkleBlock& a = blocks[blocks.size()-2];
@@ -232,10 +265,47 @@ typedef TigerTree::MerkleValue TTHValue;
 template<int64_t aBlockSize>
 struct TTFilter {
 	TTFilter() : tt(aBlockSize) { }
-	void operator()(const void* data, size_t len) { tt.update(data, len); }
-	TigerTree& getTree() { return tt; }
+
+	// The tree may only be updated with full base blocks (apart from the last one), buffer the rest
+	void operator()(const void* data, size_t len) {
+		auto buf = static_cast<const uint8_t*>(data);
+		if (!pending.empty()) {
+			auto n = min(len, TigerTree::BASE_BLOCK_SIZE - pending.size());
+			pending.insert(pending.end(), buf, buf + n);
+			buf += n;
+			len -= n;
+
+			if (pending.size() < TigerTree::BASE_BLOCK_SIZE) {
+				return;
+			}
+
+			tt.update(pending.data(), pending.size());
+			pending.clear();
+		}
+
+		auto fullBlocks = len - len % TigerTree::BASE_BLOCK_SIZE;
+		if (fullBlocks > 0) {
+			tt.update(buf, fullBlocks);
+		}
+
+		pending.assign(buf + fullBlocks, buf + len);
+	}
+
+	// Size of all data passed to the filter
+	int64_t getSize() const { return tt.getFileSize() + pending.size(); }
+
+	// Adds the buffered data in the tree, no more data may be passed after this
+	TigerTree& getTree() {
+		if (!pending.empty()) {
+			tt.update(pending.data(), pending.size());
+			pending.clear();
+		}
+
+		return tt;
+	}
 private:
 	TigerTree tt;
+	ByteVector pending;
 };
 
 } // namespace dcpp
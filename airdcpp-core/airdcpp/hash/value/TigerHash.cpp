@@ -34,6 +34,10 @@
 
 #include <airdcpp/core/header/debug.h>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#endif
+
 #ifdef BOOST_BIG_ENDIAN
 #define TIGER_BIG_ENDIAN
 #endif
@@ -249,6 +253,219 @@ uint8_t* TigerHash::finalize() {
 	return getResult();
 }
 
+// MULTI-BUFFER HASHING
+//
+// The S-box lookups make Tiger impossible to vectorize within a single message but 
+// independent messages (such as the leaves of a Merkle tree) can be processed in
+// parallel SIMD lanes by using gather instructions for the lookups
+
+#if !defined(TIGER_BIG_ENDIAN) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TIGER_SIMD
+#endif
+
+namespace {
+
+static const size_t MAX_LANES = 8;
+
+typedef uint64_t LaneBlocks[MAX_LANES][8];
+typedef uint64_t LaneStates[MAX_LANES][3];
+typedef void (*LaneCompressF)(const uint64_t* table, const LaneBlocks& aBlocks, LaneStates& aStates_);
+
+#ifdef TIGER_SIMD
+
+typedef uint64_t u64x4 __attribute__((vector_size(32)));
+typedef uint64_t u64x8 __attribute__((vector_size(64)));
+
+#undef round
+#define round(a,b,c,x,mul) \
+	c ^= x; \
+	a -= gather(t1, (c) & 0xFF) ^ gather(t2, ((c)>>(2*8)) & 0xFF) ^ \
+	     gather(t3, ((c)>>(4*8)) & 0xFF) ^ gather(t4, ((c)>>(6*8)) & 0xFF); \
+	b += gather(t4, ((c)>>(1*8)) & 0xFF) ^ gather(t3, ((c)>>(3*8)) & 0xFF) ^ \
+	     gather(t2, ((c)>>(5*8)) & 0xFF) ^ gather(t1, ((c)>>(7*8)) & 0xFF); \
+	b *= mul;
+
+#define tiger_compress_lanes(vector_type, lanes, blocks, states) \
+{ \
+	vector_type a, b, c, tmpa; \
+	vector_type aa, bb, cc; \
+	vector_type x0, x1, x2, x3, x4, x5, x6, x7; \
+	int pass_no; \
+	\
+	for (size_t l = 0; l < lanes; ++l) { \
+		a[l] = states[l][0]; b[l] = states[l][1]; c[l] = states[l][2]; \
+		x0[l] = blocks[l][0]; x1[l] = blocks[l][1]; x2[l] = blocks[l][2]; x3[l] = blocks[l][3]; \
+		x4[l] = blocks[l][4]; x5[l] = blocks[l][5]; x6[l] = blocks[l][6]; x7[l] = blocks[l][7]; \
+	} \
+	\
+	compress; \
+	\
+	for (size_t l = 0; l < lanes; ++l) { \
+		states[l][0] = a[l]; states[l][1] = b[l]; states[l][2] = c[l]; \
+	} \
+}
+
+__attribute__((target("avx2")))
+void tigerCompressAvx2(const uint64_t* table, const LaneBlocks& aBlocks, LaneStates& aStates_) {
+#define gather(t, idx) (u64x4)_mm256_i64gather_epi64((const long long*)(t), (__m256i)(idx), 8)
+	tiger_compress_lanes(u64x4, 4, aBlocks, aStates_);
+#undef gather
+}
+
+__attribute__((target("avx512f")))
+void tigerCompressAvx512(const uint64_t* table, const LaneBlocks& aBlocks, LaneStates& aStates_) {
+#define gather(t, idx) (u64x8)_mm512_i64gather_epi64((__m512i)(idx), (const long long*)(t), 8)
+	tiger_compress_lanes(u64x8, 8, aBlocks, aStates_);
+#undef gather
+}
+
+#endif
+
+// Produces the padded 64-byte blocks of a message consisting of the prefix byte and the data
+void getMessageBlock(const uint8_t* aData, size_t aDataLen, uint8_t aPrefix, size_t aBlockIndex, size_t aBlockCount, uint64_t* block_) noexcept {
+	auto dst = reinterpret_cast<uint8_t*>(block_);
+
+	const auto messageLen = aDataLen + 1;
+	auto pos = aBlockIndex * 64;
+	size_t o = 0;
+
+	if (pos == 0) {
+		dst[o++] = aPrefix;
+		pos++;
+	}
+
+	if (pos < messageLen) {
+		auto n = min(64 - o, messageLen - pos);
+		memcpy(dst + o, aData + pos - 1, n);
+		o += n;
+		pos += n;
+	}
+
+	if (o < 64) {
+		if (pos == messageLen) {
+			dst[o++] = 0x01;
+		}
+
+		memzero(dst + o, 64 - o);
+		if (aBlockIndex == aBlockCount - 1) {
+			block_[7] = static_cast<uint64_t>(messageLen) << 3;
+		}
+	}
+}
+
+}
+
+struct TigerHash::LaneKernel {
+	LaneCompressF compressF;
+	size_t lanes;
+};
+
+void TigerHash::hashBlocks(const void* aData, size_t aCount, size_t aBlockSize, uint8_t aPrefix, uint8_t* aResults) noexcept {
+	static const auto kernel = selectKernel();
+	hashBlocks(kernel, aData, aCount, aBlockSize, aPrefix, aResults);
+}
+
+void TigerHash::hashBlocksScalar(const void* aData, size_t aCount, size_t aBlockSize, uint8_t aPrefix, uint8_t* aResults) noexcept {
+	auto data = static_cast<const uint8_t*>(aData);
+	for (size_t i = 0; i < aCount; ++i) {
+		TigerHash h;
+		h.update(&aPrefix, 1);
+		h.update(data + i * aBlockSize, aBlockSize);
+		memcpy(aResults + i * BYTES, h.finalize(), BYTES);
+	}
+}
+
+void TigerHash::hashBlocks(const LaneKernel& aKernel, const void* aData, size_t aCount, size_t aBlockSize, uint8_t aPrefix, uint8_t* aResults) noexcept {
+	if (!aKernel.compressF) {
+		hashBlocksScalar(aData, aCount, aBlockSize, aPrefix, aResults);
+		return;
+	}
+
+	auto data = static_cast<const uint8_t*>(aData);
+
+	// Prefix, data, 0x01 padding and the 64-bit length
+	const auto blockCount = (aBlockSize + 1 + 1 + sizeof(uint64_t) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+	alignas(64) LaneBlocks blocks;
+	alignas(64) LaneStates states;
+	const uint8_t* laneData[MAX_LANES];
+
+	for (size_t i = 0; i < aCount; i += aKernel.lanes) {
+		auto n = min(aKernel.lanes, aCount - i);
+		for (size_t l = 0; l < aKernel.lanes; ++l) {
+			// Unused lanes will process the last block again
+			laneData[l] = data + (i + min(l, n - 1)) * aBlockSize;
+
+			states[l][0] = _ULL(0x0123456789ABCDEF);
+			states[l][1] = _ULL(0xFEDCBA9876543210);
+			states[l][2] = _ULL(0xF096A5B4C3B2E187);
+		}
+
+		for (size_t b = 0; b < blockCount; ++b) {
+			for (size_t l = 0; l < aKernel.lanes; ++l) {
+				getMessageBlock(laneData[l], aBlockSize, aPrefix, b, blockCount, blocks[l]);
+			}
+
+			aKernel.compressF(table, blocks, states);
+		}
+
+		for (size_t l = 0; l < n; ++l) {
+			memcpy(aResults + (i + l) * BYTES, states[l], BYTES);
+		}
+	}
+}
+
+// Compare the SIMD output against the scalar implementation with odd sizes and lane counts before taking the kernel in use
+bool TigerHash::verifyKernel(const LaneKernel& aKernel) noexcept {
+	const size_t counts[] = { 1, aKernel.lanes - 1, aKernel.lanes + 3 };
+	const size_t blockSizes[] = { 0, 55, 1024 };
+
+	vector<uint8_t> data(1024 * (aKernel.lanes + 3));
+	uint32_t seed = 0x9E3779B9;
+	for (auto& b: data) {
+		seed = seed * 1664525 + 1013904223;
+		b = static_cast<uint8_t>(seed >> 24);
+	}
+
+	for (auto blockSize: blockSizes) {
+		for (auto count: counts) {
+			if (count == 0) {
+				continue;
+			}
+
+			vector<uint8_t> expected(count * BYTES), result(count * BYTES);
+			hashBlocksScalar(data.data(), count, blockSize, 0x00, expected.data());
+			hashBlocks(aKernel, data.data(), count, blockSize, 0x00, result.data());
+			if (expected != result) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+TigerHash::LaneKernel TigerHash::selectKernel() noexcept {
+	LaneKernel kernel = { nullptr, 1 };
+
+#ifdef TIGER_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		kernel = { tigerCompressAvx512, 8 };
+	} else if (__builtin_cpu_supports("avx2")) {
+		kernel = { tigerCompressAvx2, 4 };
+	}
+#endif
+
+	if (kernel.compressF && !verifyKernel(kernel)) {
+		dcassert(0);
+		dcdebug("TigerHash: the output of the " SIZET_FMT " lane SIMD kernel doesn't match with the scalar hash, using the scalar implementation\n", kernel.lanes);
+		kernel = { nullptr, 1 };
+	}
+
+	return kernel;
+}
+
 uint64_t TigerHash::table[4*256] = {
 	_ULL(0x02AAB17CF7E90C5E)   /*    0 */,    _ULL(0xAC424B03E243A8EC)   /*    1 */,
 		_ULL(0x72CD5BE30DD5FCD3)   /*    2 */,    _ULL(0x6D019B93F6F97F3A)   /*    3 */,
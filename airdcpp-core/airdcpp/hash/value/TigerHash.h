@@ -56,6 +56,13 @@ public:
 	/** Call once all data has been processed. */
 	uint8_t* finalize();
 
+	/**
+	 * Calculates the hashes of consecutive equally sized data blocks (each prefixed with aPrefix) 
+	 * in parallel, using the best SIMD instruction set supported by the CPU.
+	 * @param aResults Receives aCount * BYTES bytes
+	 */
+	static void hashBlocks(const void* aData, size_t aCount, size_t aBlockSize, uint8_t aPrefix, uint8_t* aResults) noexcept;
+
 	uint8_t* getResult() const noexcept { return (uint8_t*) res; }
 private:
 	enum { BLOCK_SIZE = 512/8 };
@@ -69,6 +76,14 @@ private:
 	static uint64_t table[];
 
 	void tigerCompress(const uint64_t* data, uint64_t state[3]);
+
+	/** Multi-buffer kernel for the current CPU */
+	struct LaneKernel;
+	static LaneKernel selectKernel() noexcept;
+	static bool verifyKernel(const LaneKernel& aKernel) noexcept;
+
+	static void hashBlocks(const LaneKernel& aKernel, const void* aData, size_t aCount, size_t aBlockSize, uint8_t aPrefix, uint8_t* aResults) noexcept;
+	static void hashBlocksScalar(const void* aData, size_t aCount, size_t aBlockSize, uint8_t aPrefix, uint8_t* aResults) noexcept;
 };
 
 } // namespace dcpp
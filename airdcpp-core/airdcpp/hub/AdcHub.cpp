@@ -202,19 +202,20 @@ pair<OnlineUser*, bool> AdcHub::parseInfUser(const AdcCommand& c) noexcept {
 	return { u, newUser };
 }
 
-void AdcHub::updateInfUserProperties(OnlineUser* u, const StringList& aParams) noexcept {
-	for (const auto& p: aParams) {
+void AdcHub::updateInfUserProperties(OnlineUser* u, const AdcCommand& aCmd) noexcept {
+	for (size_t i = 0; i < aCmd.getParamCount(); ++i) {
+		auto p = aCmd.getParamView(i);
 		if(p.length() < 2)
 			continue;
 
 		if(p.starts_with("SS")) {
 			availableBytes -= u->getIdentity().getBytesShared();
-			u->getIdentity().setBytesShared(p.substr(2));
+			u->getIdentity().setBytesShared(string(p.substr(2)));
 			availableBytes += u->getIdentity().getBytesShared();
 		} else if (p.starts_with("SU")) {
-			u->getIdentity().setSupports(p.substr(2));
+			u->getIdentity().setSupports(string(p.substr(2)));
 		} else {
-			u->getIdentity().set(p.c_str(), p.substr(2));
+			u->getIdentity().set(p.data(), string(p.substr(2)));
 		}
 	}
 
@@ -254,7 +255,7 @@ void AdcHub::recalculateConnectModes() noexcept {
 }
 
 void AdcHub::handle(AdcCommand::INF, AdcCommand& c) noexcept {
-	if(c.getParameters().empty())
+	if(c.getParamCount() == 0)
 		return;
 
 	auto [u, newUser] = parseInfUser(c);
@@ -263,7 +264,7 @@ void AdcHub::handle(AdcCommand::INF, AdcCommand& c) noexcept {
 		return;
 	}
 
-	updateInfUserProperties(u, c.getParameters());
+	updateInfUserProperties(u, c);
 
 	if (u->getUser() == getMyIdentity().getUser()) {
 		auto oldState = getConnectState();
@@ -281,7 +282,16 @@ void AdcHub::handle(AdcCommand::INF, AdcCommand& c) noexcept {
 		updateCounts(false);
 
 		// We have to update the modes in case our connectivity changed
-		if (oldState != STATE_NORMAL || ranges::any_of(c.getParameters(), Identity::isConnectModeParam)) {
+		auto connectModeChanged = [&c] {
+			for (size_t i = 0; i < c.getParamCount(); ++i) {
+				if (Identity::isConnectModeParam(c.getParamView(i))) {
+					return true;
+				}
+			}
+			return false;
+		};
+
+		if (oldState != STATE_NORMAL || connectModeChanged()) {
 			resetHBRI();
 			recalculateConnectModes();
 		}
@@ -300,9 +310,10 @@ void AdcHub::handle(AdcCommand::INF, AdcCommand& c) noexcept {
 }
 
 void AdcHub::handle(AdcCommand::SUP, AdcCommand& c) noexcept {
-	for (const auto& param: c.getParameters()) {
+	for (size_t i = 0; i < c.getParamCount(); ++i) {
+		auto param = c.getParamView(i);
 		if (param.size() != 6) {
-			statusMessage("Invalid support " + param + " received from the hub", LogMessage::SEV_WARNING);
+			statusMessage("Invalid support " + string(param) + " received from the hub", LogMessage::SEV_WARNING);
 			continue;
 		}
 
@@ -312,7 +323,7 @@ void AdcHub::handle(AdcCommand::SUP, AdcCommand& c) noexcept {
 			continue;
 		}
 
-		auto support = param.substr(2);
+		auto support = string(param.substr(2));
 		if (adding) {
 			supports.add(support);
 		} else if (removing) {
@@ -341,7 +352,7 @@ void AdcHub::handle(AdcCommand::SID, AdcCommand& c) noexcept {
 		return;
 	}
 
-	if(c.getParameters().empty())
+	if(c.getParamCount() == 0)
 		return;
 
 	mySID = AdcCommand::toSID(c.getParam(0));
@@ -351,7 +362,7 @@ void AdcHub::handle(AdcCommand::SID, AdcCommand& c) noexcept {
 }
 
 void AdcHub::handle(AdcCommand::MSG, AdcCommand& c) noexcept {
-	if(c.getParameters().empty())
+	if(c.getParamCount() == 0)
 		return;
 
 	auto message = std::make_shared<ChatMessage>(c.getParam(0), findUser(c.getFrom()));
@@ -381,7 +392,7 @@ void AdcHub::handle(AdcCommand::MSG, AdcCommand& c) noexcept {
 }
 
 void AdcHub::handle(AdcCommand::GPA, AdcCommand& c) noexcept {
-	if(c.getParameters().empty() || c.getFrom() != AdcCommand::HUB_SID)
+	if(c.getParamCount() == 0 || c.getFrom() != AdcCommand::HUB_SID)
 		return;
 	salt = c.getParam(0);
 
@@ -446,7 +457,7 @@ void AdcHub::handle(AdcCommand::QUI, AdcCommand& c) noexcept {
 
 void AdcHub::handle(AdcCommand::CTM, AdcCommand& c) noexcept {
 	auto ou = findUser(c.getFrom());
-	if(c.getParameters().size() < 3)
+	if(c.getParamCount() < 3)
 		return;
 
 	ASSERT_DIRECT_TO_ME(c)
@@ -485,7 +496,7 @@ void AdcHub::handle(AdcCommand::ZOF, AdcCommand& c) noexcept {
 }
 
 void AdcHub::handle(AdcCommand::RCM, AdcCommand& c) noexcept {
-	if(c.getParameters().size() < 2) {
+	if(c.getParamCount() < 2) {
 		return;
 	}
 
@@ -518,7 +529,7 @@ void AdcHub::handle(AdcCommand::RCM, AdcCommand& c) noexcept {
 }
 
 void AdcHub::handle(AdcCommand::CMD, AdcCommand& c) noexcept {
-	if(c.getParameters().size() < 1)
+	if(c.getParamCount() < 1)
 		return;
 	const string& name = c.getParam(0);
 	bool rem = c.hasFlag("RM", 1);
@@ -545,7 +556,7 @@ void AdcHub::handle(AdcCommand::CMD, AdcCommand& c) noexcept {
 }
 
 void AdcHub::handle(AdcCommand::STA, AdcCommand& c) noexcept {
-	if(c.getParameters().size() < 2)
+	if(c.getParamCount() < 2)
 		return;
 
 	OnlineUser* u = c.getFrom() == AdcCommand::HUB_SID ? &getUser(c.getFrom(), CID()) : findUser(c.getFrom());
@@ -683,8 +694,8 @@ void AdcHub::handle(AdcCommand::RES, AdcCommand& c) noexcept {
 }
 
 void AdcHub::handle(AdcCommand::GET, AdcCommand& c) noexcept {
-	if(c.getParameters().size() < 5) {
-		if(c.getParameters().size() > 0) {
+	if(c.getParamCount() < 5) {
+		if(c.getParamCount() > 0) {
 			if(c.getParam(0) == "blom") {
 				sendHooked(AdcCommand(AdcCommand::SEV_FATAL, AdcCommand::ERROR_PROTOCOL_GENERIC,
 					"Too few parameters for blom", AdcCommand::TYPE_HUB));
@@ -756,7 +767,7 @@ void AdcHub::handle(AdcCommand::GET, AdcCommand& c) noexcept {
 void AdcHub::handle(AdcCommand::NAT, AdcCommand& c) noexcept {
 	ASSERT_DIRECT_TO_ME(c)
 	auto u = findUser(c.getFrom());
-	if (c.getParameters().size() < 3)
+	if (c.getParamCount() < 3)
 		return;
 
 	const string& protocol = c.getParam(0);
@@ -784,7 +795,7 @@ void AdcHub::handle(AdcCommand::RNT, AdcCommand& c) noexcept {
 	// Sent request for NAT traversal cooperation, which
 	// was acknowledged (with requisite local port information).
 	auto u = findUser(c.getFrom());
-	if(c.getParameters().size() < 3)
+	if(c.getParamCount() < 3)
 		return;
 
 	const string& protocol = c.getParam(0);
@@ -816,7 +827,7 @@ void AdcHub::handle(AdcCommand::TCP, AdcCommand& c) noexcept {
 	resetHBRI();
 
 	// Validate the command
-	if (c.getParameters().size() < 3 || c.getFrom() != AdcCommand::HUB_SID) {
+	if (c.getParamCount() < 3 || c.getFrom() != AdcCommand::HUB_SID) {
 		return;
 	}
 
@@ -1191,9 +1202,8 @@ void AdcHub::handleSearchExtensions(AdcCommand& c, const SearchPtr& aSearch, con
 		c_gr.setFeatures(c.getFeatures());
 		c_gr.addFeature(OnlineUser::SEGA_FEATURE, AdcCommand::FeatureType::REQUIRED);
 
-		const auto& params = c.getParameters();
-		for(const auto& p: params)
-			c_gr.addParam(p);
+		for (size_t i = 0; i < c.getParamCount(); ++i)
+			c_gr.addParam(string(c.getParamView(i)));
 
 		appendGroupInfo(c_gr);
 		sendSearch(c_gr);
@@ -1450,7 +1460,7 @@ void AdcHub::infoImpl() noexcept {
 	appendClientSupports(lastInfoMap, c, addV4, addV6);
 	appendConnectivity(lastInfoMap, c, addV4, addV6);
 
-	if(c.getParameters().size() > 0) {
+	if(c.getParamCount() > 0) {
 		sendHooked(c);
 	}
 }
@@ -1546,11 +1556,11 @@ void AdcHub::appendHubSupports(AdcCommand& cmd) {
 	}
 }
 
-void AdcHub::on(Line l, const string& aLine) noexcept {
+void AdcHub::on(Line l, string_view aLine) noexcept {
 	Client::on(l, aLine);
 
 	if(!Text::validateUtf8(aLine)) {
-		statusMessage(STRING(UTF_VALIDATION_ERROR) + "(" + Text::sanitizeUtf8(aLine) + ")", LogMessage::SEV_ERROR);
+		statusMessage(STRING(UTF_VALIDATION_ERROR) + "(" + Text::sanitizeUtf8(string(aLine)) + ")", LogMessage::SEV_ERROR);
 		return;
 	}
 
@@ -115,7 +115,7 @@ private:
 
 	// Returns the user and whether the user had to be created
 	pair<OnlineUser*, bool> parseInfUser(const AdcCommand& c) noexcept;
-	void updateInfUserProperties(OnlineUser* aUser, const StringList& aParams) noexcept;
+	void updateInfUserProperties(OnlineUser* aUser, const AdcCommand& aCmd) noexcept;
 	void recalculateConnectModes() noexcept;
 
 	void putUser(dcpp::SID aSID, bool aDisconnectTransfers) noexcept;
@@ -156,7 +156,7 @@ private:
 
 	bool v4only() const noexcept override { return false; }
 	void on(BufferedSocketListener::Connected) noexcept override;
-	void on(BufferedSocketListener::Line, const string& aLine) noexcept override;
+	void on(BufferedSocketListener::Line, string_view aLine) noexcept override;
 
 	void onErrorMessage(const AdcCommand& c, OnlineUser* aSender) noexcept;
 
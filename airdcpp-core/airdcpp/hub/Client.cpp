@@ -596,7 +596,7 @@ long Client::getDisplayCount(CountType aCountType) const noexcept {
 	return allCounts[aCountType];
 }
  
-void Client::on(BufferedSocketListener::Line, const string& aLine) noexcept {
+void Client::on(BufferedSocketListener::Line, string_view aLine) noexcept {
 	updateActivity();
 	COMMAND_DEBUG(aLine, ProtocolCommandManager::TYPE_HUB, ProtocolCommandManager::INCOMING, getIpPort());
 }
@@ -240,7 +240,7 @@ protected:
 	// BufferedSocketListener
 	virtual void on(BufferedSocketListener::Connecting) noexcept override;
 	virtual void on(BufferedSocketListener::Connected) noexcept override;
-	virtual void on(BufferedSocketListener::Line, const string& aLine) noexcept override;
+	virtual void on(BufferedSocketListener::Line, string_view aLine) noexcept override;
 	virtual void on(BufferedSocketListener::Failed, const string&) noexcept override;
 
 	// ShareManagerListener
@@ -658,29 +658,42 @@ ClientManager::ConnectResult ClientManager::connect(const HintedUser& aUser, con
 }
 
 bool ClientManager::sendUDPHooked(AdcCommand& cmd, const HintedUser& to, const OutgoingUDPCommandOptions& aOptions, string& error_) noexcept {
+	return sendUDPHooked(std::span<AdcCommand>(&cmd, 1), to, aOptions, error_) > 0;
+}
+
+size_t ClientManager::sendUDPHooked(std::span<AdcCommand> aCommands, const HintedUser& to, const OutgoingUDPCommandOptions& aOptions, string& error_) noexcept {
 	auto u = findOnlineUser(to);
 	if (!u) {
 		error_ = "User missing";
-		return false;
+		return 0;
 	}
 
 	if (u->getUser()->isNMDC()) {
 		error_ = "NMDC user";
-		return false;
+		return 0;
 	}
 
-	if (cmd.getType() == AdcCommand::TYPE_UDP && !u->getIdentity().isUdpActive()) {
-		if (aOptions.noPassive) {
-			error_ = "The user is passive";
-			return false;
-		}
+	size_t sent = 0;
+	auto ipPort = u->getIdentity().getUdpIp() + ":" + u->getIdentity().getUdpPort();
 
-		cmd.setType(AdcCommand::TYPE_DIRECT);
-		cmd.setTo(u->getIdentity().getSID());
+	StringList packets;
+	packets.reserve(aCommands.size());
+	for (auto& cmd: aCommands) {
+		if (cmd.getType() == AdcCommand::TYPE_UDP && !u->getIdentity().isUdpActive()) {
+			if (aOptions.noPassive) {
+				error_ = "The user is passive";
+				continue;
+			}
 
-		return u->getClient()->sendHooked(cmd, aOptions.owner, error_);
-	} else {
-		auto ipPort = u->getIdentity().getUdpIp() + ":" + u->getIdentity().getUdpPort();
+			cmd.setType(AdcCommand::TYPE_DIRECT);
+			cmd.setTo(u->getIdentity().getSID());
+
+			if (u->getClient()->sendHooked(cmd, aOptions.owner, error_)) {
+				sent++;
+			}
+
+			continue;
+		}
 
 		// Hooks
 		{
@@ -690,7 +703,7 @@ bool ClientManager::sendUDPHooked(AdcCommand& cmd, const HintedUser& to, const O
 				params = ActionHook<AdcCommand::ParamMap>::normalizeMap(results);
 			} catch (const HookRejectException& e) {
 				error_ = ActionHookRejection::formatError(e.getRejection());
-				return false;
+				continue;
 			}
 
 			cmd.addParams(params);
@@ -700,25 +713,30 @@ bool ClientManager::sendUDPHooked(AdcCommand& cmd, const HintedUser& to, const O
 		ProtocolCommandManager::getInstance()->fire(ProtocolCommandManagerListener::OutgoingUDPCommand(), cmd, ipPort, u);
 		COMMAND_DEBUG(cmd.toString(), ProtocolCommandManager::TYPE_CLIENT_UDP, ProtocolCommandManager::OUTGOING, ipPort);
 
-		// Send
-		try {
-			auto cmdStr = aOptions.noCID ? cmd.toString() : cmd.toString(getMyCID());
-			if (!aOptions.encryptionKey.empty() && Encoder::isBase32(aOptions.encryptionKey.c_str())) {
-				uint8_t keyChar[16];
-				Encoder::fromBase32(aOptions.encryptionKey.c_str(), keyChar, 16);
+		packets.push_back(aOptions.noCID ? cmd.toString() : cmd.toString(getMyCID()));
+	}
 
-				CryptoUtil::encryptSUDP(keyChar, cmdStr);
-			}
+	if (packets.empty()) {
+		return sent;
+	}
 
-			udp->writeTo(u->getIdentity().getUdpIp(), u->getIdentity().getUdpPort(), cmdStr);
-		} catch(const SocketException&) {
-			dcdebug("Socket exception sending ADC UDP command\n");
-			error_ = "Socket error";
-			return false;
-		}
+	// Send
+	if (!aOptions.encryptionKey.empty() && Encoder::isBase32(aOptions.encryptionKey.c_str())) {
+		uint8_t keyChar[16];
+		Encoder::fromBase32(aOptions.encryptionKey.c_str(), keyChar, 16);
+
+		CryptoUtil::encryptSUDP(keyChar, packets);
 	}
 
-	return true;
+	try {
+		udp->writeTo(u->getIdentity().getUdpIp(), u->getIdentity().getUdpPort(), packets);
+	} catch(const SocketException&) {
+		dcdebug("Socket exception sending ADC UDP command\n");
+		error_ = "Socket error";
+		return sent;
+	}
+
+	return sent + packets.size();
 }
 
 
@@ -34,6 +34,8 @@
 #include <airdcpp/core/Singleton.h>
 #include <airdcpp/core/timer/TimerManager.h>
 
+#include <span>
+
 
 namespace dcpp {
 
@@ -238,6 +240,10 @@ public:
 
 	bool sendUDPHooked(AdcCommand& c, const HintedUser& to, const OutgoingUDPCommandOptions& aOptions, string& error_) noexcept;
 
+	// Sends the commands to the same user in a single batch
+	// Returns the number of commands that were sent
+	size_t sendUDPHooked(std::span<AdcCommand> aCommands, const HintedUser& to, const OutgoingUDPCommandOptions& aOptions, string& error_) noexcept;
+
 	struct ConnectResult {
 		void onSuccess(const string_view& aHubHint) noexcept {
 			success = true;
@@ -95,7 +95,7 @@ bool HBRIValidator::HBRISocket::read(string& data_) {
 
 void HBRIValidator::validateHBRIResponse(const string& aResponse) {
 	AdcCommand responseCmd(aResponse);
-	if (responseCmd.getParameters().size() < 2) {
+	if (responseCmd.getParamCount() < 2) {
 		throw Exception(STRING(INVALID_HUB_RESPONSE));
 	}
 
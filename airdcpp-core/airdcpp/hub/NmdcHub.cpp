@@ -1155,9 +1155,9 @@ void NmdcHub::on(Connected) noexcept {
 	refreshLocalIp();
 }
 
-void NmdcHub::on(Line, const string& aLine) noexcept {
+void NmdcHub::on(Line, string_view aLine) noexcept {
 	Client::on(Line(), aLine);
-	onLine(aLine);
+	onLine(string(aLine));
 }
 
 void NmdcHub::on(Second, uint64_t aTick) noexcept {
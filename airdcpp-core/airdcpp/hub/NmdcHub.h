@@ -119,7 +119,7 @@ private:
 	void on(TimerManagerListener::Minute, uint64_t aTick) noexcept override;
 
 	void on(BufferedSocketListener::Connected) noexcept override;
-	void on(BufferedSocketListener::Line, const string& l) noexcept override;
+	void on(BufferedSocketListener::Line, string_view l) noexcept override;
 };
 
 } // namespace dcpp
@@ -433,10 +433,8 @@ void ADLSearchManager::MatchesFile(DestDirList& destDirVector, const DirectoryLi
 	// Add to any substructure being stored
 	for(auto& id: destDirVector) {
 		if(id.subdir) {
-			auto copyFile = make_shared<DirectoryListing::File>(*currentFile, this);
 			dcassert(id.subdir->isVirtual());
-
-			id.subdir->files.push_back(copyFile);
+			id.subdir->addFile(*currentFile);
 		}
 		id.fileAdded = false;	// Prepare for next stage
 	}
@@ -448,21 +446,22 @@ void ADLSearchManager::MatchesFile(DestDirList& destDirVector, const DirectoryLi
 
 	dcassert(PathUtil::isAdcDirectoryPath(aAdcPath));
 
+	const string name(currentFile->getName());
+
 	// Use NMDC path for matching due to compatibility reasons
-	const auto nmdcPath = PathUtil::toNmdcFile(aAdcPath + currentFile->getName());
+	const auto nmdcPath = PathUtil::toNmdcFile(aAdcPath + name);
 
 	// Match searches
 	for(auto& is: collection) {
 		if(destDirVector[is.ddIndex].fileAdded) {
 			continue;
 		}
-		if(is.matchesFile(currentFile->getName(), nmdcPath, currentFile->getSize())) {
-			auto copyFile = make_shared<DirectoryListing::File>(*currentFile, this);
-			destDirVector[is.ddIndex].dir->files.push_back(copyFile);
+		if(is.matchesFile(name, nmdcPath, currentFile->getSize())) {
+			destDirVector[is.ddIndex].dir->addFile(*currentFile);
 			destDirVector[is.ddIndex].fileAdded = true;
 
 			if (is.isAutoQueue){
-				auto fileInfo = BundleFileAddData(currentFile->getName(), currentFile->getTTH(), currentFile->getSize(), Priority::DEFAULT, currentFile->getRemoteDate());
+				auto fileInfo = BundleFileAddData(name, currentFile->getTTH(), currentFile->getSize(), Priority::DEFAULT, currentFile->getRemoteDate());
 				try {
 					auto options = BundleAddOptions(SETTING(DOWNLOAD_DIRECTORY), getUser(), this);
 					QueueManager::getInstance()->createFileBundleHooked(options, fileInfo);
@@ -480,16 +479,18 @@ void ADLSearchManager::MatchesFile(DestDirList& destDirVector, const DirectoryLi
 void ADLSearchManager::MatchesDirectory(DestDirList& destDirVector, const DirectoryListing::Directory::Ptr& currentDir, const string& aAdcPath) noexcept {
 	dcassert(PathUtil::isAdcDirectoryPath(aAdcPath));
 
+	const string name(currentDir->getName());
+
 	// Add to any substructure being stored
 	for (auto& id: destDirVector) {
 		if (id.subdir) {
-			auto newDir = DirectoryListing::VirtualDirectory::create(aAdcPath, id.subdir, currentDir->getName());
+			auto newDir = DirectoryListing::VirtualDirectory::create(aAdcPath, id.subdir, name);
 			id.subdir = newDir.get();
 		}
 	}
 
 	// Prepare to match searches
-	if(currentDir->getName().size() < 1) {
+	if(name.empty()) {
 		return;
 	}
 
@@ -498,8 +499,8 @@ void ADLSearchManager::MatchesDirectory(DestDirList& destDirVector, const Direct
 			continue;
 		}
 
-		if(is.matchesDirectory(currentDir->getName())) {
-			auto newDir = DirectoryListing::VirtualDirectory::create(aAdcPath, destDirVector[is.ddIndex].dir.get(), currentDir->getName());
+		if(is.matchesDirectory(name)) {
+			auto newDir = DirectoryListing::VirtualDirectory::create(aAdcPath, destDirVector[is.ddIndex].dir.get(), name);
 			destDirVector[is.ddIndex].subdir = newDir.get();
 			if(breakOnFirst) {
 				// Found a match, search no more
@@ -571,15 +572,15 @@ void ADLSearchManager::FinalizeDestinationDirectories(DestDirList& destDirs, Dir
 
 	// Add non-empty destination directories to the top level
 	for(auto& i: destDirs) {
-		if(i.dir->files.empty() && i.dir->directories.empty()) {
+		if(i.dir->getFiles().empty() && i.dir->getDirectories().empty()) {
 			continue;
 		} 
 		
-		if(Util::stricmp(i.dir->getName(), szDiscard) == 0) {
+		if(Util::stricmp(i.dir->getName().data(), szDiscard.c_str()) == 0) {
 			continue;
 		}
 
-		root->directories.try_emplace(&i.dir->getName(), i.dir);
+		root->addDirectory(i.dir);
 	}
 }
 
@@ -609,13 +610,13 @@ void ADLSearchManager::matchRecurse(DestDirList &aDestList, const DirectoryListi
 		throw AbortException();
 	}
 
-	for (const auto& dir: aDir->directories | views::values) {
-		auto subAdcPath = PathUtil::joinAdcDirectory(aAdcPath, dir->getName());
+	for (const auto& dir: aDir->getDirectories()) {
+		auto subAdcPath = PathUtil::joinAdcDirectory(aAdcPath, string(dir->getName()));
 		MatchesDirectory(aDestList, dir, subAdcPath);
 		matchRecurse(aDestList, dir, subAdcPath, aDirList);
 	}
 
-	for (const auto& file: aDir->files) {
+	for (const auto& file: aDir->getFiles()) {
 		MatchesFile(aDestList, file, aAdcPath);
 	}
 
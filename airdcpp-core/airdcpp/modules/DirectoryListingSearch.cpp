@@ -137,7 +137,7 @@ void DirectoryListingSearch::searchRecursive(const DirectoryListing::DirectoryPt
 	if (aDir->isVirtual())
 		return;
 
-	if (aStrings.matchesDirectory(aDir->getName())) {
+	if (aStrings.matchesDirectory(string(aDir->getName()))) {
 		auto path = aDir->getParent() ? aDir->getParent()->getAdcPathUnsafe() : ADC_ROOT_STR;
 		auto res = ranges::find(aResults, path);
 		if (res == aResults.end() && aStrings.matchesSize(aDir->getTotalSize(false))) {
@@ -145,14 +145,14 @@ void DirectoryListingSearch::searchRecursive(const DirectoryListing::DirectoryPt
 		}
 	}
 
-	for (const auto& f: aDir->files) {
-		if (aStrings.matchesFile(f->getName(), f->getSize(), f->getRemoteDate(), f->getTTH())) {
+	for (const auto& f: aDir->getFiles()) {
+		if (aStrings.matchesFile(string(f->getName()), f->getSize(), f->getRemoteDate(), f->getTTH())) {
 			aResults.insert(aDir->getAdcPathUnsafe());
 			break;
 		}
 	}
 
-	for (const auto& d : aDir->directories | views::values) {
+	for (const auto& d : aDir->getDirectories()) {
 		searchRecursive(d, aResults, aStrings);
 		if (aResults.size() >= aStrings.maxResults) return;
 	}
@@ -31,7 +31,7 @@ AdcCommand::AdcCommand(Severity sev, Error err, const string& desc, char aType /
 	addParam(desc);
 }
 
-AdcCommand::AdcCommand(const string& aLine, bool nmdc /* = false */) : cmdInt(0), type(TYPE_CLIENT) {
+AdcCommand::AdcCommand(const string_view& aLine, bool nmdc /* = false */) : cmdInt(0), type(TYPE_CLIENT) {
 	parse(aLine, nmdc);
 }
 
@@ -43,7 +43,7 @@ bool AdcCommand::isValidType(char aType) noexcept {
 	return true;
 }
 
-void AdcCommand::parse(const string& aLine, bool nmdc /* = false */) {
+void AdcCommand::parse(const string_view& aLine, bool nmdc /* = false */) {
 	string::size_type i = 5;
 
 	if(nmdc) {
@@ -74,85 +74,101 @@ void AdcCommand::parse(const string& aLine, bool nmdc /* = false */) {
 	}
 
 	string::size_type len = aLine.length();
-	const char* buf = aLine.c_str();
-	string cur;
-	cur.reserve(128);
+	const char* buf = aLine.data();
+
+	// The parameters are stored in a single buffer as escaped, only the escapes are validated here
+	parameters.clear();
+	paramSpans.clear();
+	paramBuffer.clear();
+	if (len > i) {
+		paramBuffer.reserve(len - i);
+	}
+
+	flatParams = true;
 
 	bool toSet = false;
 	bool featureSet = false;
 	bool fromSet = nmdc; // $ADCxxx never have a from CID...
 
-	while(i < len) {
-		switch(buf[i]) {
-		case '\\':
-			++i;
-			if(i == len)
-				throw ParseException("Escape at eol");
-			if(buf[i] == 's')
-				cur += ' ';
-			else if(buf[i] == 'n')
-				cur += '\n';
-			else if(buf[i] == '\\')
-				cur += '\\';
-			else if(buf[i] == ' ' && nmdc)	// $ADCGET escaping, leftover from old specs
-				cur += ' ';
-			else
-				throw ParseException("Unknown escape");
-			break;
-		case ' ': 
-			// New parameter...
-			{
-				if((type == TYPE_BROADCAST || type == TYPE_DIRECT || type == TYPE_ECHO || type == TYPE_FEATURE) && !fromSet) {
-					if(cur.length() != 4) {
-						throw ParseException("Invalid SID length");
-					}
-					from = toSID(cur);
-					fromSet = true;
-				} else if((type == TYPE_DIRECT || type == TYPE_ECHO) && !toSet) {
-					if(cur.length() != 4) {
-						throw ParseException("Invalid SID length");
-					}
-					to = toSID(cur);
-					toSet = true;
-				} else if(type == TYPE_FEATURE && !featureSet) {
-					if(cur.length() % 5 != 0) {
-						throw ParseException("Invalid feature length");
-					}
-					// Skip...
-					featureSet = true;
-				} else {
-					parameters.push_back(cur);
-				}
-				cur.clear();
-			}
-			break;
-		default:
-			cur += buf[i];
+	// Start of the current token in paramBuffer
+	size_t cur = 0;
+	bool escaped = false;
+
+	auto addToken = [&] {
+		auto token = string_view(paramBuffer).substr(cur);
+
+		auto isHeader = ((type == TYPE_BROADCAST || type == TYPE_DIRECT || type == TYPE_ECHO || type == TYPE_FEATURE) && !fromSet) ||
+			((type == TYPE_DIRECT || type == TYPE_ECHO) && !toSet) ||
+			(type == TYPE_FEATURE && !featureSet);
+
+		if (!isHeader) {
+			paramSpans.push_back({ static_cast<uint32_t>(cur), static_cast<uint32_t>(token.length()), PARAM_NONE, escaped });
+			cur = paramBuffer.size();
+			escaped = false;
+			return;
 		}
-		++i;
-	}
-	if(!cur.empty()) {
+
+		string unescaped;
+		if (escaped) {
+			unescaped = unescape(token);
+			token = unescaped;
+			escaped = false;
+		}
+
 		if((type == TYPE_BROADCAST || type == TYPE_DIRECT || type == TYPE_ECHO || type == TYPE_FEATURE) && !fromSet) {
-			if(cur.length() != 4) {
+			if(token.length() != 4) {
 				throw ParseException("Invalid SID length");
 			}
-			from = toSID(cur);
+			from = toSID(token);
 			fromSet = true;
 		} else if((type == TYPE_DIRECT || type == TYPE_ECHO) && !toSet) {
-			if(cur.length() != 4) {
+			if(token.length() != 4) {
 				throw ParseException("Invalid SID length");
 			}
-			to = toSID(cur);
+			to = toSID(token);
 			toSet = true;
 		} else if(type == TYPE_FEATURE && !featureSet) {
-			if(cur.length() % 5 != 0) {
+			if(token.length() % 5 != 0) {
 				throw ParseException("Invalid feature length");
 			}
 			// Skip...
 			featureSet = true;
+		}
+
+		// Header fields aren't stored
+		paramBuffer.resize(cur);
+	};
+
+	while(i < len) {
+		// Copy the unescaped characters at once
+		auto plainStart = i;
+		while(i < len && buf[i] != '\\' && buf[i] != ' ') {
+			++i;
+		}
+
+		paramBuffer.append(buf + plainStart, i - plainStart);
+		if(i == len)
+			break;
+
+		if(buf[i] == '\\') {
+			++i;
+			if(i == len)
+				throw ParseException("Escape at eol");
+			if(buf[i] != 's' && buf[i] != 'n' && buf[i] != '\\' && !(buf[i] == ' ' && nmdc)) // $ADCGET escaping, leftover from old specs
+				throw ParseException("Unknown escape");
+
+			paramBuffer += '\\';
+			paramBuffer += buf[i];
+			escaped = true;
 		} else {
-			parameters.push_back(cur);
+			// New parameter...
+			addToken();
 		}
+		++i;
+	}
+
+	if(paramBuffer.size() > cur) {
+		addToken();
 	}
 
 	if((type == TYPE_BROADCAST || type == TYPE_DIRECT || type == TYPE_ECHO || type == TYPE_FEATURE) && !fromSet) {
@@ -166,6 +182,186 @@ void AdcCommand::parse(const string& aLine, bool nmdc /* = false */) {
 	if((type == TYPE_DIRECT || type == TYPE_ECHO) && !toSet) {
 		throw ParseException("Missing to_sid");
 	}
+
+	indexParams();
+}
+
+void AdcCommand::indexParams() noexcept {
+	paramIndex.fill(PARAM_NONE);
+
+	// Commands with lots of parameters are searched linearly
+	indexedParams = paramSpans.size() < PARAM_NONE;
+	if (!indexedParams) {
+		return;
+	}
+
+	// Last parameter of each chain
+	array<uint8_t, PARAM_INDEX_SIZE> tails;
+	for (size_t n = 0; n < paramSpans.size(); ++n) {
+		auto& span = paramSpans[n];
+		span.next = PARAM_NONE;
+		if (span.escaped && memchr(paramBuffer.data() + span.offset, '\\', min<size_t>(span.length, 2))) {
+			// The code itself is escaped
+			unescapeParam(span);
+		}
+
+		if (span.length < 2) {
+			continue;
+		}
+
+		auto code = toCode(paramBuffer.data() + span.offset);
+		auto slot = getIndexSlot(code);
+		for (size_t probes = 0;; ++probes) {
+			if (probes == PARAM_INDEX_SIZE) {
+				// Too many different codes
+				indexedParams = false;
+				return;
+			}
+
+			auto first = paramIndex[slot];
+			if (first == PARAM_NONE) {
+				paramIndex[slot] = static_cast<uint8_t>(n);
+				tails[slot] = static_cast<uint8_t>(n);
+				break;
+			}
+
+			if (toCode(paramBuffer.data() + paramSpans[first].offset) == code) {
+				paramSpans[tails[slot]].next = static_cast<uint8_t>(n);
+				tails[slot] = static_cast<uint8_t>(n);
+				break;
+			}
+
+			slot = (slot + 1) & (PARAM_INDEX_SIZE - 1);
+		}
+	}
+}
+
+AdcCommand::ParamList& AdcCommand::getParameters() noexcept {
+	if (flatParams) {
+		// The list may be modified by the caller, switch to it permanently
+		parameters.clear();
+		parameters.reserve(paramSpans.size());
+		for (size_t n = 0; n < paramSpans.size(); ++n) {
+			parameters.emplace_back(getParamView(n));
+		}
+
+		flatParams = false;
+		indexedParams = false;
+		paramSpans.clear();
+		paramBuffer.clear();
+	}
+
+	return parameters;
+}
+
+string_view AdcCommand::getParamView(size_t n) const noexcept {
+	if (!flatParams) {
+		return n < parameters.size() ? string_view(parameters[n]) : string_view();
+	}
+
+	if (n >= paramSpans.size()) {
+		return string_view();
+	}
+
+	auto& span = paramSpans[n];
+	if (span.escaped) {
+		unescapeParam(span);
+	}
+
+	return string_view(paramBuffer).substr(span.offset, span.length);
+}
+
+void AdcCommand::unescapeParam(ParamSpan& aSpan) const noexcept {
+	// The escapes have been validated when parsing
+	auto p = paramBuffer.data() + aSpan.offset;
+	uint32_t out = 0;
+	for (uint32_t in = 0; in < aSpan.length; ++in) {
+		auto c = p[in];
+		if (c == '\\') {
+			c = p[++in];
+			if (c == 's') {
+				c = ' ';
+			} else if (c == 'n') {
+				c = '\n';
+			}
+		}
+
+		p[out++] = c;
+	}
+
+	aSpan.length = out;
+	aSpan.escaped = false;
+}
+
+string AdcCommand::unescape(string_view aStr) noexcept {
+	string ret;
+	ret.reserve(aStr.size());
+	for (size_t i = 0; i < aStr.size(); ++i) {
+		auto c = aStr[i];
+		if (c == '\\' && i + 1 < aStr.size()) {
+			c = aStr[++i];
+			if (c == 's') {
+				c = ' ';
+			} else if (c == 'n') {
+				c = '\n';
+			}
+		}
+
+		ret += c;
+	}
+
+	return ret;
+}
+
+void AdcCommand::removeParam(size_t n) noexcept {
+	if (!flatParams) {
+		if (n < parameters.size()) {
+			parameters.erase(parameters.begin() + n);
+		}
+		return;
+	}
+
+	if (n >= paramSpans.size()) {
+		return;
+	}
+
+	// The data is left in the buffer
+	paramSpans.erase(paramSpans.begin() + n);
+	indexParams();
+}
+
+size_t AdcCommand::findParam(const char* name, size_t start) const noexcept {
+	auto code = toCode(name);
+	if (!indexedParams) {
+		for (auto i = start; i < getParamCount(); ++i) {
+			auto param = getParamView(i);
+			if (param.length() >= 2 && toCode(param.data()) == code) {
+				return i;
+			}
+		}
+
+		return string::npos;
+	}
+
+	auto slot = getIndexSlot(code);
+	for (size_t probes = 0; probes < PARAM_INDEX_SIZE; ++probes) {
+		auto n = paramIndex[slot];
+		if (n == PARAM_NONE) {
+			break;
+		}
+
+		if (toCode(paramBuffer.data() + paramSpans[n].offset) == code) {
+			while (n != PARAM_NONE && n < start) {
+				n = paramSpans[n].next;
+			}
+
+			return n == PARAM_NONE ? string::npos : n;
+		}
+
+		slot = (slot + 1) & (PARAM_INDEX_SIZE - 1);
+	}
+
+	return string::npos;
 }
 
 AdcCommand& AdcCommand::addFeature(const string& feat, FeatureType aType) noexcept {
@@ -186,8 +382,8 @@ string AdcCommand::toString(dcpp::SID sid /* = 0 */, bool nmdc /* = false */) co
 	return getHeaderString(sid, nmdc) + getParamString(nmdc);
 }
 
-string AdcCommand::escape(const string& str, bool old) noexcept {
-	string tmp = str;
+string AdcCommand::escape(string_view str, bool old) noexcept {
+	string tmp(str);
 	string::size_type i = 0;
 	while( (i = tmp.find_first_of(" \n\\", i)) != string::npos) {
 		if(old) {
@@ -258,15 +454,15 @@ AdcCommand& AdcCommand::addParams(const ParamMap& aParams) noexcept {
 	return *this;
 }
 
-const string& AdcCommand::getParam(size_t n) const noexcept {
-	return getParameters().size() > n ? getParameters()[n] : Util::emptyString;
+string AdcCommand::getParam(size_t n) const noexcept {
+	return string(getParamView(n));
 }
 
 string AdcCommand::getParamString(bool nmdc) const noexcept {
 	string tmp;
-	for(const auto& i: getParameters()) {
+	for (size_t i = 0; i < getParamCount(); ++i) {
 		tmp += ' ';
-		tmp += escape(i, nmdc);
+		tmp += escape(getParamView(i), nmdc);
 	}
 	if(nmdc) {
 		tmp += '|';
@@ -277,30 +473,26 @@ string AdcCommand::getParamString(bool nmdc) const noexcept {
 }
 
 bool AdcCommand::getParam(const char* name, size_t start, string& ret) const noexcept {
-	for(string::size_type i = start; i < getParameters().size(); ++i) {
-		if(toCode(name) == toCode(getParameters()[i].c_str())) {
-			ret = getParameters()[i].substr(2);
-			return true;
-		}
+	auto n = findParam(name, start);
+	if (n == string::npos) {
+		return false;
 	}
-	return false;
+
+	ret = getParamView(n).substr(2);
+	return true;
 }
 
 bool AdcCommand::getParam(const char* name, size_t start, StringList& ret) const noexcept {
-	for(string::size_type i = start; i < getParameters().size(); ++i) {
-		if(toCode(name) == toCode(getParameters()[i].c_str())) {
-			ret.push_back(getParameters()[i].substr(2));
-		}
+	for (auto n = findParam(name, start); n != string::npos; n = findParam(name, n + 1)) {
+		ret.emplace_back(getParamView(n).substr(2));
 	}
 	return !ret.empty();
 }
 
 bool AdcCommand::hasFlag(const char* name, size_t start) const noexcept {
-	for(string::size_type i = start; i < getParameters().size(); ++i) {
-		if(toCode(name) == toCode(getParameters()[i].c_str()) && 
-			getParameters()[i].size() == 3 &&
-			getParameters()[i][2] == '1')
-		{
+	for (auto n = findParam(name, start); n != string::npos; n = findParam(name, n + 1)) {
+		auto param = getParamView(n);
+		if (param.size() == 3 && param[2] == '1') {
 			return true;
 		}
 	}
@@ -19,6 +19,8 @@
 #ifndef DCPLUSPLUS_DCPP_ADC_COMMAND_H
 #define DCPLUSPLUS_DCPP_ADC_COMMAND_H
 
+#include <array>
+
 #include <airdcpp/core/header/typedefs.h>
 
 #include <airdcpp/core/classes/Exception.h>
@@ -131,10 +133,10 @@ public:
 	explicit AdcCommand(Severity sev, Error err, const string& desc, char aType = TYPE_CLIENT) noexcept;
 
 	// Throws ParseException on errors
-	explicit AdcCommand(const string& aLine, bool nmdc = false);
+	explicit AdcCommand(const string_view& aLine, bool nmdc = false);
 
 	// Throws ParseException on errors
-	void parse(const string& aLine, bool nmdc = false);
+	void parse(const string_view& aLine, bool nmdc = false);
 
 	uint32_t getCommand() const noexcept { return cmdInt; }
 	char getType() const noexcept { return type; }
@@ -150,54 +152,99 @@ public:
 	};
 	AdcCommand& addFeature(const string& feat, FeatureType aType) noexcept;
 
-	ParamList& getParameters() noexcept { return parameters; }
-	const ParamList& getParameters() const noexcept { return parameters; }
+	// Parsed commands store the escaped parameters in a single buffer and they are unescaped when accessed
+	// for the first time (use getParamCount/getParamView for reading them)
+	// Converts the command to use a modifiable list permanently
+	ParamList& getParameters() noexcept;
 	AdcCommand& setParams(const ParamList& aParams) noexcept {
-		parameters = aParams; 
+		getParameters() = aParams;
 		return *this; 
 	}
 
+	size_t getParamCount() const noexcept { return flatParams ? paramSpans.size() : parameters.size(); }
+	string_view getParamView(size_t n) const noexcept;
+	void removeParam(size_t n) noexcept;
+
 	string toString() const noexcept;
 	string toString(const CID& aCID) const noexcept;
 	string toString(dcpp::SID sid, bool nmdc = false) const noexcept;
 
 	AdcCommand& addParam(const string& name, const string& value) noexcept {
-		parameters.push_back(name);
-		parameters.back() += value;
+		auto& params = getParameters();
+		params.push_back(name);
+		params.back() += value;
 		return *this;
 	}
 	AdcCommand& addParam(const string& str) noexcept {
-		parameters.push_back(str);
+		getParameters().push_back(str);
 		return *this;
 	}
 	AdcCommand& addParams(const ParamMap& aParams) noexcept;
-	const string& getParam(size_t n) const noexcept;
+	// Use getParamView when a copy isn't needed
+	string getParam(size_t n) const noexcept;
 	/** Return a named parameter where the name is a two-letter code */
 	bool getParam(const char* name, size_t start, string& ret) const noexcept;
 	bool getParam(const char* name, size_t start, StringList& ret) const noexcept;
 	bool hasFlag(const char* name, size_t start) const noexcept;
-	static uint16_t toCode(const char* x) noexcept { return *((uint16_t*)x); }
+	static uint16_t toCode(const char* x) noexcept { uint16_t code; memcpy(&code, x, sizeof(code)); return code; }
+
+	// Returns the position of the first named parameter at or after start (or string::npos)
+	size_t findParam(const char* name, size_t start) const noexcept;
 
 	static CommandType toCommand(const string& aCmd) noexcept;
 	static string fromCommand(CommandType x) noexcept;
 
 	bool operator==(uint32_t aCmd) const noexcept { return cmdInt == aCmd; }
 
-	static string escape(const string& str, bool old) noexcept;
+	static string escape(string_view str, bool old) noexcept;
 	dcpp::SID getTo() const noexcept { return to; }
 	AdcCommand& setTo(const dcpp::SID sid) noexcept { to = sid; return *this; }
 	dcpp::SID getFrom() const noexcept { return from; }
 	void setFrom(const dcpp::SID sid) noexcept { from = sid; }
 	static bool isValidType(char aType) noexcept;
 
-	static dcpp::SID toSID(const string& aSID) noexcept { return *reinterpret_cast<const dcpp::SID*>(aSID.data()); }
+	static dcpp::SID toSID(const string_view& aSID) noexcept { return *reinterpret_cast<const dcpp::SID*>(aSID.data()); }
 	static string fromSID(dcpp::SID aSID) noexcept { return string(reinterpret_cast<const char*>(&aSID), sizeof(aSID)); }
 private:
 	string getHeaderString(const CID& cid) const noexcept;
 	string getHeaderString() const noexcept;
 	string getHeaderString(dcpp::SID sid, bool nmdc) const noexcept;
 	string getParamString(bool nmdc) const noexcept;
+
+	// Flat parameter storage of parsed commands
+	struct ParamSpan {
+		uint32_t offset;
+		uint32_t length;
+
+		// Next parameter with the same two-letter code
+		uint8_t next;
+
+		// The parameter contains escape sequences that haven't been unescaped yet
+		bool escaped;
+	};
+
+	static constexpr size_t PARAM_INDEX_SIZE = 64;
+	static constexpr uint8_t PARAM_NONE = 0xFF;
+
+	void indexParams() noexcept;
+	static size_t getIndexSlot(uint16_t aCode) noexcept { return (static_cast<uint32_t>(aCode) * 0x9E3779B1U) >> 26; }
+
+	// Unescapes the parameter in place (the unescaped value is never longer)
+	// Const commands must not be read from multiple threads concurrently
+	void unescapeParam(ParamSpan& aSpan) const noexcept;
+	static string unescape(string_view aStr) noexcept;
+
+	mutable string paramBuffer;
+	mutable vector<ParamSpan> paramSpans;
+
+	// Two-letter code -> first parameter with the code (open addressing)
+	array<uint8_t, PARAM_INDEX_SIZE> paramIndex = {};
+	bool flatParams = false;
+	bool indexedParams = false;
+
+	// Used for built commands and parsed commands that have been modified
 	ParamList parameters;
+
 	string features;
 	union {
 		char cmdChar[4];
@@ -214,12 +261,12 @@ template<class T>
 class CommandHandler {
 public:
 	using OnCommandParsedF = std::function<void (const AdcCommand &)>;
-	inline void dispatch(const string& aLine, OnCommandParsedF&& aOnCommandParsedF) noexcept {
+	inline void dispatch(const string_view& aLine, OnCommandParsedF&& aOnCommandParsedF) noexcept {
 		dispatch(aLine, false, std::move(aOnCommandParsedF));
 	}
 
 	template<typename... ArgT>
-	void dispatch(const string& aLine, bool aNmdc, const OnCommandParsedF& aOnCommandParsedF, ArgT&&... args) noexcept {
+	void dispatch(const string_view& aLine, bool aNmdc, const OnCommandParsedF& aOnCommandParsedF, ArgT&&... args) noexcept {
 		try {
 			AdcCommand c(aLine, aNmdc);
 			if (!aNmdc && aOnCommandParsedF) {
@@ -228,7 +275,7 @@ public:
 
 			dispatch(c, std::forward<ArgT>(args)...);
 		} catch (const ParseException&) {
-			dcdebug("Invalid ADC command: %.50s\n", aLine.c_str());
+			dcdebug("Invalid ADC command: %.*s\n", static_cast<int>(std::min(aLine.size(), static_cast<size_t>(50))), aLine.data());
 			return;
 		}
 	}
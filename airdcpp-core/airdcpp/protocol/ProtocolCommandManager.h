@@ -55,8 +55,15 @@ class ProtocolCommandManager : public Singleton<ProtocolCommandManager>, public
 	friend class Singleton<ProtocolCommandManager>;
 	ProtocolCommandManager() { };
 public:
-	void SendCommandMessage(const string& aMess, uint8_t aType, uint8_t aDirection, const string& aIP) {
-		fire(ProtocolCommandManagerListener::DebugCommand(), aMess, aType, aDirection, aIP);
+	void SendCommandMessage(string_view aMess, uint8_t aType, uint8_t aDirection, const string& aIP) {
+		{
+			// Don't copy the incoming lines when nobody is listening
+			Lock l(listenerCS);
+			if (listeners.empty())
+				return;
+		}
+
+		fire(ProtocolCommandManagerListener::DebugCommand(), string(aMess), aType, aDirection, aIP);
 	}
 
 	~ProtocolCommandManager() { };
@@ -86,13 +86,13 @@ void FileQueue::matchListing(const DirectoryListing& dl, QueueItemList& ql_) con
 }
 
 void FileQueue::matchDir(const DirectoryListing::Directory::Ptr& aDir, QueueItemList& ql_) const noexcept {
-	for (const auto& d : aDir->directories | views::values) {
+	for (const auto& d : aDir->getDirectories()) {
 		if (!d->isVirtual()) {
 			matchDir(d, ql_);
 		}
 	}
 
-	for (const auto& f : aDir->files) {
+	for (const auto& f : aDir->getFiles()) {
 		auto tthRange = tthIndex.equal_range(const_cast<TTHValue*>(&f->getTTH()));
 
 		ranges::for_each(tthRange | pair_to_range, [&](const pair<TTHValue*, QueueItemPtr>& tqp) {
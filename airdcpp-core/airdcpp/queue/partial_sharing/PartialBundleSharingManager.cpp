@@ -62,7 +62,8 @@ void PartialBundleSharingManager::onPBD(const AdcCommand& aCmd, const UserPtr& f
 	string tth;
 	bool add = false, update = false, reply = false, notify = false, remove = false;
 
-	for (auto& str: aCmd.getParameters()) {
+	for (size_t i = 0; i < aCmd.getParamCount(); ++i) {
+		auto str = aCmd.getParamView(i);
 		if (str.compare(0, 2, "HI") == 0) {
 			hubIpPort = str.substr(2);
 		} else if (str.compare(0, 2, "BU") == 0) {
@@ -81,7 +82,7 @@ void PartialBundleSharingManager::onPBD(const AdcCommand& aCmd, const UserPtr& f
 		} else if (str.compare(0, 2, "RM") == 0) { //remove remote notifications for a selected user and bundle
 			remove = true;
 		} else {
-			dbgMsg("unknown param " + str, LogMessage::SEV_WARNING);
+			dbgMsg("unknown param " + string(str), LogMessage::SEV_WARNING);
 		}
 	}
 
@@ -322,7 +323,7 @@ void PartialBundleSharingManager::on(ProtocolCommandManagerListener::IncomingUDP
 		return;
 	}
 
-	if (aCmd.getParameters().empty())
+	if (aCmd.getParamCount() == 0)
 		return;
 
 	const auto& cid = aCmd.getParam(0);
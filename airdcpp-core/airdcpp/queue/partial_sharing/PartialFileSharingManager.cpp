@@ -76,7 +76,8 @@ void PartialFileSharingManager::onPSR(const AdcCommand& aCmd, UserPtr from, cons
 	string nick;
 	PartsInfo partialInfo;
 
-	for (auto& str: aCmd.getParameters()) {
+	for (size_t i = 0; i < aCmd.getParamCount(); ++i) {
+		auto str = aCmd.getParamView(i);
 		if (str.compare(0, 2, "U4") == 0) {
 			udpPort = str.substr(2);
 		} else if (str.compare(0, 2, "NI") == 0) {
@@ -86,9 +87,9 @@ void PartialFileSharingManager::onPSR(const AdcCommand& aCmd, UserPtr from, cons
 		} else if (str.compare(0, 2, "TR") == 0) {
 			tth = str.substr(2);
 		} else if (str.compare(0, 2, "PC") == 0) {
-			partialCount = Util::toUInt32(str.substr(2))*2;
+			partialCount = Util::toUInt32(string(str.substr(2)))*2;
 		} else if (str.compare(0, 2, "PI") == 0) {
-			StringTokenizer<string> tok(str.substr(2), ',');
+			StringTokenizer<string> tok(string(str.substr(2)), ',');
 			for (const auto& i: tok.getTokens()) {
 				partialInfo.push_back((uint16_t)Util::toInt(i));
 			}
@@ -192,7 +193,7 @@ void PartialFileSharingManager::on(ProtocolCommandManagerListener::IncomingUDPCo
 		return;
 	}
 
-	if (aCmd.getParameters().empty())
+	if (aCmd.getParamCount() == 0)
 		return;
 
 	const auto& cid = aCmd.getParam(0);
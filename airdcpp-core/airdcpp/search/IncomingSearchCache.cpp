@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include <airdcpp/search/IncomingSearchCache.h>
+
+#include <airdcpp/core/timer/TimerManager.h>
+
+namespace dcpp {
+
+optional<SearchResultList> IncomingSearchCache::get(const string& aKey) noexcept {
+	auto tick = GET_TICK();
+
+	Lock l(cs);
+	auto i = entries.find(aKey);
+	if (i == entries.end() || i->second.expires <= tick) {
+		misses++;
+		return nullopt;
+	}
+
+	hits++;
+	return i->second.results;
+}
+
+void IncomingSearchCache::put(const string& aKey, const SearchResultList& aResults, uint64_t aGeneration) noexcept {
+	auto tick = GET_TICK();
+
+	Lock l(cs);
+	if (aGeneration != generation) {
+		// The share has changed during the search
+		return;
+	}
+
+	if (entries.size() >= MAX_ENTRIES) {
+		removeExpiredUnsafe(tick);
+		if (entries.size() >= MAX_ENTRIES) {
+			// Bursts of unique searches, not worth caching
+			return;
+		}
+	}
+
+	entries.insert_or_assign(aKey, Entry({ aResults, tick + TTL }));
+}
+
+void IncomingSearchCache::removeExpired() noexcept {
+	auto tick = GET_TICK();
+
+	Lock l(cs);
+	removeExpiredUnsafe(tick);
+}
+
+void IncomingSearchCache::removeExpiredUnsafe(uint64_t aTick) noexcept {
+	std::erase_if(entries, [aTick](const auto& p) { return p.second.expires <= aTick; });
+}
+
+uint64_t IncomingSearchCache::getGeneration() const noexcept {
+	Lock l(cs);
+	return generation;
+}
+
+void IncomingSearchCache::clear() noexcept {
+	Lock l(cs);
+	entries.clear();
+	generation++;
+}
+
+IncomingSearchCache::Stats IncomingSearchCache::getStats() const noexcept {
+	Lock l(cs);
+
+	Stats ret;
+	ret.entries = entries.size();
+	ret.hits = hits;
+	ret.misses = misses;
+	return ret;
+}
+
+} // namespace dcpp
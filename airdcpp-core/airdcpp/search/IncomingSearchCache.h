@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_INCOMING_SEARCH_CACHE_H
+#define DCPLUSPLUS_DCPP_INCOMING_SEARCH_CACHE_H
+
+#include <airdcpp/core/header/typedefs.h>
+#include <airdcpp/forward.h>
+
+#include <airdcpp/core/thread/CriticalSection.h>
+
+namespace dcpp {
+
+// Short-lived cache for the results of incoming text searches
+// Auto search bots tend to send identical searches to many hubs within a short time
+class IncomingSearchCache {
+public:
+	struct Stats {
+		size_t entries = 0;
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+	};
+
+	static constexpr uint64_t TTL = 10 * 1000;
+	static constexpr size_t MAX_ENTRIES = 2000;
+
+	// Returns the cached results, if any
+	optional<SearchResultList> get(const string& aKey) noexcept;
+
+	// Results are ignored if the cache has been cleared after aGeneration was retrieved
+	void put(const string& aKey, const SearchResultList& aResults, uint64_t aGeneration) noexcept;
+	uint64_t getGeneration() const noexcept;
+
+	void removeExpired() noexcept;
+
+	// Called when the shared content changes
+	void clear() noexcept;
+
+	Stats getStats() const noexcept;
+private:
+	struct Entry {
+		SearchResultList results;
+		uint64_t expires;
+	};
+
+	void removeExpiredUnsafe(uint64_t aTick) noexcept;
+
+	mutable CriticalSection cs;
+	unordered_map<string, Entry> entries;
+
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t generation = 0;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_INCOMING_SEARCH_CACHE_H)
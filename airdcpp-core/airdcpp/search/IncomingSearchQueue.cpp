@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include <airdcpp/search/IncomingSearchQueue.h>
+
+#include <airdcpp/core/header/debug.h>
+
+#include <thread>
+
+namespace dcpp {
+
+constexpr size_t MAX_WORKERS = 4;
+
+IncomingSearchQueue::IncomingSearchQueue() {
+	auto count = std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, MAX_WORKERS);
+	for (size_t i = 0; i < count; ++i) {
+		auto worker = make_unique<Worker>(*this);
+		worker->start();
+		workers.push_back(std::move(worker));
+	}
+}
+
+IncomingSearchQueue::~IncomingSearchQueue() {
+	stop();
+}
+
+void IncomingSearchQueue::stop() noexcept {
+	{
+		Lock l(cs);
+		if (stopping) {
+			return;
+		}
+
+		stopping = true;
+		hubQueues.clear();
+		hubOrder.clear();
+		queued = 0;
+	}
+
+	for (size_t i = 0; i < workers.size(); ++i) {
+		s.signal();
+	}
+
+	for (const auto& w: workers) {
+		w->join();
+	}
+
+	workers.clear();
+}
+
+void IncomingSearchQueue::add(ClientToken aHub, Callback&& aTask) noexcept {
+	{
+		Lock l(cs);
+		if (stopping) {
+			return;
+		}
+
+		if (queued >= MAX_QUEUED) {
+			dropOldest();
+		}
+
+		auto& hubQueue = hubQueues[aHub];
+		if (hubQueue.empty()) {
+			hubOrder.push_back(aHub);
+		}
+
+		hubQueue.push_back({ nextId++, std::move(aTask) });
+		queued++;
+	}
+
+	s.signal();
+}
+
+void IncomingSearchQueue::dropOldest() noexcept {
+	auto oldest = hubQueues.end();
+	for (auto i = hubQueues.begin(); i != hubQueues.end(); ++i) {
+		if (oldest == hubQueues.end() || i->second.front().id < oldest->second.front().id) {
+			oldest = i;
+		}
+	}
+
+	if (oldest == hubQueues.end()) {
+		return;
+	}
+
+	oldest->second.pop_front();
+	if (oldest->second.empty()) {
+		std::erase(hubOrder, oldest->first);
+		hubQueues.erase(oldest);
+	}
+
+	queued--;
+	dropped++;
+}
+
+bool IncomingSearchQueue::runNext() noexcept {
+	s.wait();
+
+	Callback task;
+
+	{
+		Lock l(cs);
+		if (stopping) {
+			return false;
+		}
+
+		// The search may have been dropped
+		if (hubOrder.empty()) {
+			return true;
+		}
+
+		auto hub = hubOrder.front();
+		hubOrder.pop_front();
+
+		auto i = hubQueues.find(hub);
+		dcassert(i != hubQueues.end());
+
+		task = std::move(i->second.front().task);
+		i->second.pop_front();
+		if (i->second.empty()) {
+			hubQueues.erase(i);
+		} else {
+			hubOrder.push_back(hub);
+		}
+
+		queued--;
+	}
+
+	task();
+
+	{
+		Lock l(cs);
+		processed++;
+	}
+
+	return true;
+}
+
+int IncomingSearchQueue::Worker::run() {
+	while (queue.runNext()) {
+		// Continue
+	}
+
+	return 0;
+}
+
+IncomingSearchQueue::Stats IncomingSearchQueue::getStats() const noexcept {
+	Lock l(cs);
+
+	Stats ret;
+	ret.queued = queued;
+	ret.processed = processed;
+	ret.dropped = dropped;
+	return ret;
+}
+
+} // namespace dcpp
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_INCOMING_SEARCH_QUEUE_H
+#define DCPLUSPLUS_DCPP_INCOMING_SEARCH_QUEUE_H
+
+#include <airdcpp/core/header/typedefs.h>
+#include <airdcpp/forward.h>
+
+#include <airdcpp/core/thread/CriticalSection.h>
+#include <airdcpp/core/thread/Semaphore.h>
+#include <airdcpp/core/thread/Thread.h>
+
+namespace dcpp {
+
+// Handles incoming searches with worker threads so that slow share searches won't block the hub threads
+// Hubs are served in round-robin order and the oldest searches are dropped when the queue is full
+class IncomingSearchQueue {
+public:
+	struct Stats {
+		size_t queued = 0;
+		uint64_t processed = 0;
+		uint64_t dropped = 0;
+	};
+
+	static constexpr size_t MAX_QUEUED = 500;
+
+	IncomingSearchQueue();
+	~IncomingSearchQueue();
+
+	IncomingSearchQueue(const IncomingSearchQueue&) = delete;
+	IncomingSearchQueue& operator=(const IncomingSearchQueue&) = delete;
+
+	void add(ClientToken aHub, Callback&& aTask) noexcept;
+
+	// Stops the workers, queued searches are discarded
+	void stop() noexcept;
+
+	Stats getStats() const noexcept;
+private:
+	class Worker : public Thread {
+	public:
+		explicit Worker(IncomingSearchQueue& aQueue) : queue(aQueue) { }
+	private:
+		int run() override;
+		IncomingSearchQueue& queue;
+	};
+
+	struct QueuedSearch {
+		uint64_t id;
+		Callback task;
+	};
+
+	// Returns false if the queue is being stopped
+	bool runNext() noexcept;
+	void dropOldest() noexcept;
+
+	mutable CriticalSection cs;
+	Semaphore s;
+
+	map<ClientToken, deque<QueuedSearch>> hubQueues;
+
+	// Hubs with queued searches in the order they will be served
+	deque<ClientToken> hubOrder;
+
+	size_t queued = 0;
+	uint64_t nextId = 0;
+	uint64_t processed = 0;
+	uint64_t dropped = 0;
+
+	bool stopping = false;
+	vector<unique_ptr<Worker>> workers;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_INCOMING_SEARCH_QUEUE_H)
@@ -22,6 +22,7 @@
 #include <airdcpp/hub/ClientManager.h>
 #include <airdcpp/util/CryptoUtil.h>
 #include <airdcpp/events/LogManager.h>
+#include <airdcpp/search/IncomingSearchQueue.h>
 #include <airdcpp/util/PathUtil.h>
 #include <airdcpp/core/classes/ScopedFunctor.h>
 #include <airdcpp/search/SearchInstance.h>
@@ -29,6 +30,7 @@
 #include <airdcpp/search/SearchResult.h>
 #include <airdcpp/search/SearchTypes.h>
 #include <airdcpp/share/ShareManager.h>
+#include <airdcpp/share/profiles/ShareProfileManager.h>
 #include <airdcpp/core/timer/TimerManager.h>
 #include <airdcpp/connection/UDPServer.h>
 #include <airdcpp/util/ValueGenerator.h>
@@ -37,9 +39,11 @@ namespace dcpp {
 
 SearchManager::SearchManager() : 
 	searchTypes(make_unique<SearchTypes>([this]{ fire(SearchManagerListener::SearchTypesChanged()); })), 
-	udpServer(make_unique<UDPServer>()) 
+	udpServer(make_unique<UDPServer>()),
+	incomingSearchQueue(make_unique<IncomingSearchQueue>())
 {
 	TimerManager::getInstance()->addListener(this);
+	ShareManager::getInstance()->getProfileMgr().addListener(this);
 
 #ifdef _DEBUG
 	CryptoUtil::testSUDP();
@@ -48,6 +52,13 @@ SearchManager::SearchManager() :
 
 SearchManager::~SearchManager() {
 	TimerManager::getInstance()->removeListener(this);
+	ShareManager::getInstance()->getProfileMgr().removeListener(this);
+	incomingSearchQueue->stop();
+}
+
+void SearchManager::shutdown() noexcept {
+	// Queued searches would access the share and other managers that are being shut down
+	incomingSearchQueue->stop();
 }
 
 string SearchManager::normalizeWhitespace(const string& aString){
@@ -276,23 +287,24 @@ void SearchManager::onRES(const AdcCommand& cmd, const UserPtr& aFrom, const str
 	time_t date = 0;
 	int files = -1, folders = -1;
 
-	for(auto& str: cmd.getParameters()) {
+	for(size_t i = 0; i < cmd.getParamCount(); ++i) {
+		auto str = cmd.getParamView(i);
 		if (str.compare(0, 2, "FN") == 0) {
 			adcPath = str.substr(2);
 		} else if(str.compare(0, 2, "SL") == 0) {
-			freeSlots = Util::toInt(str.substr(2));
+			freeSlots = Util::toInt(string(str.substr(2)));
 		} else if(str.compare(0, 2, "SI") == 0) {
-			size = Util::toInt64(str.substr(2));
+			size = Util::toInt64(string(str.substr(2)));
 		} else if(str.compare(0, 2, "TR") == 0) {
 			tth = str.substr(2);
 		} else if(str.compare(0, 2, "TO") == 0) {
 			token = str.substr(2);
 		} else if(str.compare(0, 2, "DM") == 0) {
-			date = Util::parseRemoteFileItemDate(str.substr(2));
+			date = Util::parseRemoteFileItemDate(string(str.substr(2)));
 		} else if(str.compare(0, 2, "FI") == 0) {
-			files = Util::toInt(str.substr(2));
+			files = Util::toInt(string(str.substr(2)));
 		} else if(str.compare(0, 2, "FO") == 0) {
-			folders = Util::toInt(str.substr(2));
+			folders = Util::toInt(string(str.substr(2)));
 		}
 	}
 
@@ -352,6 +364,8 @@ void SearchManager::on(TimerManagerListener::Minute, uint64_t aTick) noexcept {
 		removeSearchInstance(id);
 	}
 
+	incomingSearchCache.removeExpired();
+
 	{
 		WLock l(cs);
 		for (auto i = searchKeys.begin(); i != searchKeys.end();) {
@@ -366,7 +380,87 @@ void SearchManager::on(TimerManagerListener::Minute, uint64_t aTick) noexcept {
 	}
 }
 
+void SearchManager::on(ShareProfileManagerListener::ProfileUpdated, ProfileToken, bool) noexcept {
+	incomingSearchCache.clear();
+}
+
+void SearchManager::on(ShareProfileManagerListener::ProfileRemoved, ProfileToken) noexcept {
+	incomingSearchCache.clear();
+}
+
 void SearchManager::respond(const AdcCommand& adc, Client* aClient, OnlineUser* aUser, bool aIsUdpActive, ProfileToken aProfile) noexcept {
+	// The online user keeps the client alive
+	incomingSearchQueue->add(aClient->getToken(), [this, adc, user = OnlineUserPtr(aUser), aIsUdpActive, aProfile] {
+		handleIncomingSearch(adc, user->getClient().get(), user.get(), aIsUdpActive, aProfile);
+	});
+}
+
+void SearchManager::respond(Client* aClient, const string& aSeeker, int aSearchType, int64_t aSize, int aFileType, const string& aString, bool aIsPassive) noexcept {
+	auto client = ClientManager::getInstance()->findClient(aClient->getToken());
+	if (!client) {
+		return;
+	}
+
+	incomingSearchQueue->add(aClient->getToken(), [=, this] {
+		handleIncomingSearch(client.get(), aSeeker, aSearchType, aSize, aFileType, aString, aIsPassive);
+	});
+}
+
+string SearchManager::getCacheKey(const AdcCommand& aCmd, ProfileToken aProfile, int aMaxResults) noexcept {
+	StringList params;
+	for (size_t i = 0; i < aCmd.getParamCount(); ++i) {
+		auto param = aCmd.getParamView(i);
+
+		// Unique for each search
+		if (param.starts_with("TO") || param.starts_with("KY")) {
+			continue;
+		}
+
+		// Terms and extensions are matched case-insensitively
+		if (param.starts_with("AN") || param.starts_with("NO") || param.starts_with("EX")) {
+			params.push_back(Text::toLower(string(param)));
+		} else {
+			params.emplace_back(param);
+		}
+	}
+
+	sort(params.begin(), params.end());
+	return "ADC " + Util::toString(aProfile) + " " + Util::toString(aMaxResults) + " " + Util::toString(" ", params);
+}
+
+void SearchManager::searchShare(SearchResultList& results_, ShareSearch& aSearch, const string& aCacheKey) {
+	// TTH searches are fast and the results may depend on the user (temp shares)
+	if (aSearch.search.root) {
+		ShareManager::getInstance()->search(results_, aSearch);
+		return;
+	}
+
+	if (auto cached = incomingSearchCache.get(aCacheKey); cached) {
+		results_ = std::move(*cached);
+		ShareManager::getInstance()->onCachedSearch(aSearch, !results_.empty());
+		return;
+	}
+
+	auto generation = incomingSearchCache.getGeneration();
+	ShareManager::getInstance()->search(results_, aSearch);
+	incomingSearchCache.put(aCacheKey, results_, generation);
+}
+
+SearchManager::IncomingSearchStats SearchManager::getIncomingSearchStats() const noexcept {
+	auto queueStats = incomingSearchQueue->getStats();
+	auto cacheStats = incomingSearchCache.getStats();
+
+	IncomingSearchStats ret;
+	ret.queued = queueStats.queued;
+	ret.processed = queueStats.processed;
+	ret.dropped = queueStats.dropped;
+	ret.cacheEntries = cacheStats.entries;
+	ret.cacheHits = cacheStats.hits;
+	ret.cacheMisses = cacheStats.misses;
+	return ret;
+}
+
+void SearchManager::handleIncomingSearch(const AdcCommand& adc, Client* aClient, OnlineUser* aUser, bool aIsUdpActive, ProfileToken aProfile) noexcept {
 	auto isDirect = adc.getType() == 'D';
 
 	string path = ADC_ROOT_STR;
@@ -383,7 +477,7 @@ void SearchManager::respond(const AdcCommand& adc, Client* aClient, OnlineUser*
 	}
 
 	SearchResultList results;
-	SearchQuery srch(adc.getParameters(), maxResults);
+	SearchQuery srch(adc, maxResults);
 
 	ScopedFunctor([&] {
 		fire(SearchManagerListener::IncomingSearch(), aClient, aUser, srch, results, aIsUdpActive);
@@ -395,7 +489,7 @@ void SearchManager::respond(const AdcCommand& adc, Client* aClient, OnlineUser*
 	ShareSearch shareSearch(srch, aProfile, aUser->getUser(), path);
 	shareSearch.isAutoSearch = token.find("/as") != string::npos;
 	try {
-		ShareManager::getInstance()->search(results, shareSearch);
+		searchShare(results, shareSearch, getCacheKey(adc, aProfile, maxResults));
 	} catch(const ShareException& e) {
 		if (replyDirect) {
 			//path not found (direct search)
@@ -412,16 +506,22 @@ void SearchManager::respond(const AdcCommand& adc, Client* aClient, OnlineUser*
 	if (!results.empty()) {
 		string sudpKey;
 		adc.getParam("KY", 0, sudpKey);
+
+		vector<AdcCommand> commands;
+		commands.reserve(results.size());
 		for (const auto& sr: results) {
 			AdcCommand cmd = sr->toRES(AdcCommand::TYPE_UDP);
 			if(!token.empty())
 				cmd.addParam("TO", token);
 
-			string error;
-			ClientManager::OutgoingUDPCommandOptions options(this, false);
-			options.encryptionKey = sudpKey;
-			ClientManager::getInstance()->sendUDPHooked(cmd, aUser->getHintedUser(), options, error);
+			commands.push_back(std::move(cmd));
 		}
+
+		// All results are sent in a single batch
+		string error;
+		ClientManager::OutgoingUDPCommandOptions options(this, false);
+		options.encryptionKey = sudpKey;
+		ClientManager::getInstance()->sendUDPHooked(commands, aUser->getHintedUser(), options, error);
 	}
 
 	if (replyDirect) {
@@ -436,7 +536,7 @@ void SearchManager::respond(const AdcCommand& adc, Client* aClient, OnlineUser*
 	}
 }
 
-void SearchManager::respond(Client* aClient, const string& aSeeker, int aSearchType, int64_t aSize, int aFileType, const string& aString, bool aIsPassive) noexcept {
+void SearchManager::handleIncomingSearch(Client* aClient, const string& aSeeker, int aSearchType, int64_t aSize, int aFileType, const string& aString, bool aIsPassive) noexcept {
 	SearchResultList results;
 
 	auto maxResults = aIsPassive ? 5 : 10;
@@ -444,7 +544,8 @@ void SearchManager::respond(Client* aClient, const string& aSeeker, int aSearchT
 	auto shareProfile = aClient->get(HubSettings::ShareProfile);
 
 	ShareSearch shareSearch(srch, shareProfile, nullptr, ADC_ROOT_STR);
-	ShareManager::getInstance()->search(results, shareSearch);
+	searchShare(results, shareSearch, "NMDC " + Util::toString(shareProfile) + " " + Util::toString(maxResults) + " " + Util::toString(aSearchType) + " " +
+		Util::toString(aSize) + " " + Util::toString(aFileType) + " " + Text::toLower(aString));
 
 	fire(SearchManagerListener::IncomingSearch(), aClient, nullptr, srch, results, !aIsPassive);
 
@@ -21,6 +21,7 @@
 
 #include <airdcpp/search/SearchManagerListener.h>
 #include <airdcpp/core/timer/TimerManagerListener.h>
+#include <airdcpp/share/profiles/ShareProfileManagerListener.h>
 
 #include <airdcpp/core/ActionHook.h>
 #include <airdcpp/protocol/AdcCommand.h>
@@ -30,14 +31,17 @@
 #include <airdcpp/core/Singleton.h>
 #include <airdcpp/core/Speaker.h>
 #include <airdcpp/connection/UDPServer.h>
+#include <airdcpp/search/IncomingSearchCache.h>
 #include <airdcpp/util/Util.h>
 
 
 namespace dcpp {
 
+class IncomingSearchQueue;
 class SearchTypes;
 class SocketException;
 class UDPServer;
+struct ShareSearch;
 
 struct SearchQueueInfo {
 	StringSet queuedHubUrls;
@@ -45,7 +49,7 @@ struct SearchQueueInfo {
 	string error;
 };
 
-class SearchManager : public Speaker<SearchManagerListener>, public Singleton<SearchManager>, private TimerManagerListener
+class SearchManager : public Speaker<SearchManagerListener>, public Singleton<SearchManager>, private TimerManagerListener, private ShareProfileManagerListener
 {
 public:
 	ActionHook<nullptr_t, const SearchResultPtr&> incomingSearchResultHook;
@@ -53,9 +57,25 @@ public:
 	SearchQueueInfo search(const SearchPtr& aSearch) noexcept;
 	SearchQueueInfo search(const StringList& aHubUrls, const SearchPtr& aSearch, void* aOwner = nullptr) noexcept;
 	
+	// Incoming searches are queued and handled asynchronously
 	void respond(const AdcCommand& cmd, Client* aClient, OnlineUser* aUser, bool aIsUdpActive, ProfileToken aProfile) noexcept;
 	void respond(Client* aClient, const string& aSeeker, int aSearchType, int64_t aSize, int aFileType, const string& aString, bool aIsPassive) noexcept;
 
+	struct IncomingSearchStats {
+		size_t queued = 0;
+		uint64_t processed = 0;
+		uint64_t dropped = 0;
+
+		size_t cacheEntries = 0;
+		uint64_t cacheHits = 0;
+		uint64_t cacheMisses = 0;
+	};
+
+	IncomingSearchStats getIncomingSearchStats() const noexcept;
+
+	// Stops handling incoming searches
+	void shutdown() noexcept;
+
 	const string& getPort() const;
 
 	void listen();
@@ -95,9 +115,24 @@ private:
 	
 	void on(TimerManagerListener::Minute, uint64_t aTick) noexcept override;
 
+	// ShareProfileManagerListener
+	// Share content changes are reported as profile updates
+	void on(ShareProfileManagerListener::ProfileUpdated, ProfileToken aProfile, bool aIsMajorChange) noexcept override;
+	void on(ShareProfileManagerListener::ProfileRemoved, ProfileToken aProfile) noexcept override;
+
 	const unique_ptr<SearchTypes> searchTypes;
 	const unique_ptr<UDPServer> udpServer;
 
+	void handleIncomingSearch(const AdcCommand& cmd, Client* aClient, OnlineUser* aUser, bool aIsUdpActive, ProfileToken aProfile) noexcept;
+	void handleIncomingSearch(Client* aClient, const string& aSeeker, int aSearchType, int64_t aSize, int aFileType, const string& aString, bool aIsPassive) noexcept;
+
+	// Text searches are answered from the cache when possible
+	void searchShare(SearchResultList& results_, ShareSearch& aSearch, const string& aCacheKey);
+	static string getCacheKey(const AdcCommand& aCmd, ProfileToken aProfile, int aMaxResults) noexcept;
+
+	const unique_ptr<IncomingSearchQueue> incomingSearchQueue;
+	IncomingSearchCache incomingSearchCache;
+
 	using SearchInstanceMap = map<SearchInstanceToken, SearchInstancePtr>;
 	SearchInstanceMap searchInstances;
 };
@@ -19,6 +19,7 @@
 #include "stdinc.h"
 
 #include <airdcpp/hub/AdcHub.h>
+#include <airdcpp/protocol/AdcCommand.h>
 #include <airdcpp/search/SearchQuery.h>
 #include <airdcpp/util/text/StringTokenizer.h>
 #include <airdcpp/util/Util.h>
@@ -234,12 +235,14 @@ SearchQuery::SearchQuery(const string& aSearch, const StringList& aExcluded, con
 	prepare();
 }
 
-SearchQuery::SearchQuery(const StringList& params, size_t aMaxResults) noexcept : maxResults(aMaxResults) {
-	for(const auto& p: params) {
-		if(p.length() <= 2)
+SearchQuery::SearchQuery(const AdcCommand& aAdcCmd, size_t aMaxResults) noexcept : maxResults(aMaxResults) {
+	for(size_t i = 0; i < aAdcCmd.getParamCount(); ++i) {
+		auto view = aAdcCmd.getParamView(i);
+		if(view.length() <= 2)
 			continue;
 
-		uint16_t cmd = toCode(p[0], p[1]);
+		uint16_t cmd = toCode(view[0], view[1]);
+		string p(view);
 		if(toCode('T', 'R') == cmd) {
 			root = TTHValue(p.substr(2));
 			return;
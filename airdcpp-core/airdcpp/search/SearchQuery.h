@@ -53,7 +53,7 @@ namespace dcpp {
 		explicit SearchQuery(const TTHValue& aRoot) noexcept;
 
 		// Protocol-specific
-		SearchQuery(const StringList& adcParams, size_t maxResults) noexcept;
+		SearchQuery(const AdcCommand& aAdcCmd, size_t maxResults) noexcept;
 		SearchQuery(const string& nmdcString, Search::SizeModes aSizeMode, int64_t aSize, Search::TypeModes aTypeMode, size_t maxResults) noexcept;
 
 		inline bool isExcluded(const string& str) const noexcept { return exclude.match_any(str); }
@@ -263,6 +263,8 @@ const string SettingsManager::settingTags[] =
 	"MaxRunningBundles", "DefaultShareProfile", "UpdateChannel",
 
 	"AutoSearchEvery", "ASDelayHours",
+	"HashParallelMinSize", "HashParallelThreads", "HashCacheSize",
+	"TaskPoolThreads",
 
 #ifdef HAVE_GUI
 	// Windows GUI
@@ -341,6 +343,7 @@ const string SettingsManager::settingTags[] =
 	"ClearDirectoryHistory", "ClearExcludeHistory", "ClearDirHistory", "NoIpOverride6", "IPUpdate6",
 	"SkipEmptyDirsShare", "RemoveExpiredAs", "AdcLogGroupCID", "ShareFollowSymlinks", "UseDefaultCertPaths", "StartupRefresh",
 	"FLReportDupeFiles", "UseUploadBundles", "LogIgnored", "RemoveFinishedBundles", "AlwaysCCPM",
+	"UseSocketReactor", "ShareSearchIndex",
 
 	"PopupBotPms", "PopupHubPms", "SortFavUsersFirst",
 #ifdef HAVE_GUI
@@ -616,11 +619,15 @@ SettingsManager::SettingsManager() : connectionRegex("(\\d+(\\.\\d+)?)")
 	setDefault(MAX_HASHING_THREADS, std::thread::hardware_concurrency());
 
 	setDefault(HASHERS_PER_VOLUME, 1);
+	setDefault(HASH_PARALLEL_MIN_SIZE, 1024);
+	setDefault(HASH_PARALLEL_THREADS, 4);
 
 	setDefault(MIN_DUPE_CHECK_SIZE, 512);
 	setDefault(SKIP_EMPTY_DIRS_SHARE, true);
 
 	setDefault(DB_CACHE_SIZE, 8);
+	setDefault(HASH_CACHE_SIZE, 32);
+	setDefault(TASK_POOL_THREADS, 0);
 	setDefault(CUR_REMOVED_TREES, 0);
 	setDefault(CUR_REMOVED_FILES, 0);
 
@@ -645,6 +652,8 @@ SettingsManager::SettingsManager() : connectionRegex("(\\d+(\\.\\d+)?)")
 	setDefault(LOG_IGNORED, true);
 	setDefault(REMOVE_FINISHED_BUNDLES, false);
 	setDefault(ALWAYS_CCPM, false);
+	setDefault(USE_SOCKET_REACTOR, false);
+	setDefault(SHARE_SEARCH_INDEX, true);
 
 	setDefault(MAX_RECENT_HUBS, 30);
 	setDefault(MAX_RECENT_PRIVATE_CHATS, 15);
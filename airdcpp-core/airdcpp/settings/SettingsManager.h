@@ -139,6 +139,8 @@ public:
 		MAX_RUNNING_BUNDLES, DEFAULT_SP, UPDATE_CHANNEL,
 
 		AUTOSEARCH_EVERY, AS_DELAY_HOURS,
+		HASH_PARALLEL_MIN_SIZE, HASH_PARALLEL_THREADS, HASH_CACHE_SIZE,
+		TASK_POOL_THREADS,
 
 #ifdef HAVE_GUI
 		// Windows GUI
@@ -217,6 +219,7 @@ public:
 		HISTORY_SEARCH_CLEAR, HISTORY_EXCLUDE_CLEAR, HISTORY_DIR_CLEAR, NO_IP_OVERRIDE6, IP_UPDATE6,
 		SKIP_EMPTY_DIRS_SHARE, REMOVE_EXPIRED_AS, PM_LOG_GROUP_CID, SHARE_FOLLOW_SYMLINKS, USE_DEFAULT_CERT_PATHS, STARTUP_REFRESH,
 		FL_REPORT_FILE_DUPES, USE_UPLOAD_BUNDLES, LOG_IGNORED, REMOVE_FINISHED_BUNDLES, ALWAYS_CCPM,
+		USE_SOCKET_REACTOR, SHARE_SEARCH_INDEX,
 
 		POPUP_BOT_PMS, POPUP_HUB_PMS, SORT_FAVUSERS_FIRST,
 #ifdef HAVE_GUI
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include <airdcpp/share/FilelistFragmentCache.h>
+
+#include <airdcpp/core/io/stream/FilteredFile.h>
+#include <airdcpp/util/text/Text.h>
+#include <airdcpp/util/Util.h>
+
+namespace dcpp {
+
+#define PARTIAL_LIST_CACHE_SIZE 32 * 1024 * 1024
+
+// Compressed fragments (a single fragment may use the whole space)
+#define FULL_LIST_CACHE_SIZE 128 * 1024 * 1024
+
+size_t FilelistFragmentCache::PartialListOutputStream::write(const void* aBuf, size_t aLen) {
+	if (cacheable) {
+		if (xml.size() + aLen > MAX_PARTIAL_LIST_SIZE) {
+			// Don't let a single list to evict everything else
+			cacheable = false;
+			string().swap(xml);
+		} else {
+			xml.append(static_cast<const char*>(aBuf), aLen);
+		}
+	}
+
+	return target.write(aBuf, aLen);
+}
+
+FilelistFragmentCache::PartialListPtr FilelistFragmentCache::PartialListOutputStream::releaseList() noexcept {
+	return cacheable ? make_shared<const string>(std::move(xml)) : nullptr;
+}
+
+string FilelistFragmentCache::getXmlPadding(int64_t aXmlSize) noexcept {
+	auto remainder = static_cast<size_t>(aXmlSize % TigerTree::BASE_BLOCK_SIZE);
+	return remainder == 0 ? Util::emptyString : string(TigerTree::BASE_BLOCK_SIZE - remainder, ' ');
+}
+
+FilelistFragmentCache::FullListFragmentPtr FilelistFragmentCache::createFullListFragment(const ShareDirectory::List& aRoots, const FilelistDirectory::DuplicateFileHandler& aDuplicateFileHandler) {
+	auto fragment = make_shared<FullListFragment>();
+
+	{
+		ParallelBZOutputStream bz;
+		CalcOutputStream<TTFilter<TigerTree::BASE_BLOCK_SIZE>, false> xml(&bz);
+
+		// The roots have the same virtual name so there will be a single list directory
+		auto listRoot = FilelistDirectory::generateRoot(ShareDirectory::List(), aRoots, true);
+
+		string tmp, indent = "\t";
+		for (const auto& ld : listRoot->getListDirectories() | views::values) {
+			ld->toXml(xml, indent, tmp, true, aDuplicateFileHandler);
+		}
+
+		xml.write(getXmlPadding(xml.getFilter().getSize()));
+		xml.flushBuffers(false);
+
+		fragment->xmlTree = xml.getFilter().getTree();
+		fragment->compressed = bz.releaseBlocks();
+	}
+
+	return fragment;
+}
+
+string FilelistFragmentCache::getFullListKey(const ShareDirectory::List& aRoots) noexcept {
+	dcassert(!aRoots.empty());
+
+	// The virtual name is taken from the first root
+	auto ret = aRoots.front()->getVirtualName();
+	for (const auto& d : aRoots) {
+		ret += '\n' + d->getRealPathUnsafe();
+	}
+
+	return ret;
+}
+
+string FilelistFragmentCache::getPartialListKey(const string& aVirtualPath, const OptionalProfileToken& aProfile, bool aRecursive) noexcept {
+	// The path isn't converted to lower case because it's included in the list
+	return (aProfile ? Util::toString(*aProfile) : "*") + (aRecursive ? "r" : "n") + aVirtualPath;
+}
+
+size_t FilelistFragmentCache::getFragmentSize(const FullListFragment& aFragment) noexcept {
+	return aFragment.compressed.data.size() + aFragment.xmlTree.getLeaves().size() * TigerTree::BYTES;
+}
+
+FilelistFragmentCache::FullListFragmentPtr FilelistFragmentCache::getFullListFragment(const ShareDirectory::List& aRoots) noexcept {
+	auto key = getFullListKey(aRoots);
+
+	Lock l(cs);
+	auto i = fullListFragments.find(key);
+	if (i == fullListFragments.end()) {
+		return nullptr;
+	}
+
+	i->second.lastUsed = ++fullListUsageCounter;
+	return i->second.fragment;
+}
+
+void FilelistFragmentCache::setFullListFragment(const ShareDirectory::List& aRoots, const FullListFragmentPtr& aFragment) noexcept {
+	auto size = getFragmentSize(*aFragment);
+	if (size > FULL_LIST_CACHE_SIZE) {
+		return;
+	}
+
+	FullListEntry entry{ aFragment, StringList(), size, 0 };
+	for (const auto& d : aRoots) {
+		entry.rootPaths.push_back(d->getRealPathUnsafe());
+	}
+
+	auto key = getFullListKey(aRoots);
+
+	Lock l(cs);
+	removeFullListFragment(key);
+
+	// Evict the least recently used fragments
+	while (!fullListFragments.empty() && fullListBytes + size > FULL_LIST_CACHE_SIZE) {
+		auto oldest = ranges::min_element(fullListFragments, {}, [](const auto& aItem) { return aItem.second.lastUsed; });
+		removeFullListFragment(oldest->first);
+	}
+
+	entry.lastUsed = ++fullListUsageCounter;
+	fullListFragments.emplace(key, std::move(entry));
+	fullListBytes += size;
+}
+
+FilelistFragmentCache::PartialListPtr FilelistFragmentCache::getPartialList(const string& aVirtualPath, const OptionalProfileToken& aProfile, bool aRecursive) noexcept {
+	auto key = getPartialListKey(aVirtualPath, aProfile, aRecursive);
+
+	Lock l(cs);
+	auto i = partialLists.find(key);
+	if (i == partialLists.end()) {
+		return nullptr;
+	}
+
+	i->second.lastUsed = ++partialListUsageCounter;
+	return i->second.xml;
+}
+
+void FilelistFragmentCache::setPartialList(const string& aVirtualPath, const OptionalProfileToken& aProfile, bool aRecursive, const PartialListPtr& aXml) noexcept {
+	if (aXml->size() > MAX_PARTIAL_LIST_SIZE) {
+		return;
+	}
+
+	auto pathLower = Text::toLower(aVirtualPath);
+	auto key = getPartialListKey(aVirtualPath, aProfile, aRecursive);
+
+	Lock l(cs);
+	removePartialList(key);
+
+	// Evict the least recently used lists
+	while (!partialLists.empty() && partialListBytes + aXml->size() > PARTIAL_LIST_CACHE_SIZE) {
+		auto oldest = ranges::min_element(partialLists, {}, [](const auto& aItem) { return aItem.second.lastUsed; });
+		removePartialList(oldest->first);
+	}
+
+	partialLists.emplace(key, PartialListEntry{ pathLower, aXml, ++partialListUsageCounter });
+	partialListBytes += aXml->size();
+}
+
+void FilelistFragmentCache::removePartialList(const string& aKey) noexcept {
+	auto i = partialLists.find(aKey);
+	if (i != partialLists.end()) {
+		partialListBytes -= i->second.xml->size();
+		partialLists.erase(i);
+	}
+}
+
+void FilelistFragmentCache::removeFullListFragment(const string& aKey) noexcept {
+	auto i = fullListFragments.find(aKey);
+	if (i != fullListFragments.end()) {
+		fullListBytes -= i->second.size;
+		fullListFragments.erase(i);
+	}
+}
+
+void FilelistFragmentCache::removeFullListFragments(const string& aRootPath) noexcept {
+	erase_if(fullListFragments, [&](const auto& aItem) {
+		if (ranges::any_of(aItem.second.rootPaths, [&aRootPath](const string& aPath) { return Util::stricmp(aPath, aRootPath) == 0; })) {
+			fullListBytes -= aItem.second.size;
+			return true;
+		}
+
+		return false;
+	});
+}
+
+void FilelistFragmentCache::onDirectoryChanged(const ShareDirectory& aDirectory, bool aSubtree) noexcept {
+	auto root = &aDirectory;
+	while (root->getParent()) {
+		root = root->getParent();
+	}
+
+	auto rootPath = root->getRealPathUnsafe();
+	auto pathLower = Text::toLower(aDirectory.getAdcPathUnsafe());
+
+	Lock l(cs);
+	removeFullListFragments(rootPath);
+
+	// Listings of the parents contain the size of this directory
+	erase_if(partialLists, [&](const auto& aItem) {
+		const auto& listPath = aItem.second.virtualPathLower;
+		if (pathLower.starts_with(listPath) || (aSubtree && listPath.starts_with(pathLower))) {
+			partialListBytes -= aItem.second.xml->size();
+			return true;
+		}
+
+		return false;
+	});
+}
+
+void FilelistFragmentCache::onRootChanged(const string& aRootPath) noexcept {
+	Lock l(cs);
+	removeFullListFragments(aRootPath);
+
+	// The virtual paths and profiles may change
+	partialLists.clear();
+	partialListBytes = 0;
+}
+
+} // namespace dcpp
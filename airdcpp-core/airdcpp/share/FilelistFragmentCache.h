@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_FILELIST_FRAGMENT_CACHE_H
+#define DCPLUSPLUS_DCPP_FILELIST_FRAGMENT_CACHE_H
+
+#include <airdcpp/core/io/compress/ParallelBZStream.h>
+#include <airdcpp/core/io/stream/StreamBase.h>
+#include <airdcpp/core/thread/CriticalSection.h>
+#include <airdcpp/hash/value/MerkleTree.h>
+#include <airdcpp/share/ShareDirectory.h>
+
+namespace dcpp {
+
+/**
+ * Serialized filelist content that is kept in memory until the related share directories are modified
+ *
+ * Full filelists are built from compressed fragments of each virtual root. The XML of the fragments
+ * is padded to full tiger tree base blocks so that the hash leaves can be reused in any position
+ * of the list, and the compressed blocks can be appended in the list without compressing them again.
+ *
+ * Both the fragments and the generated partial lists are evicted in least recently used order
+ * when their total size exceeds the limit.
+ *
+ * The invalidation functions must be called while holding the write lock of the share tree.
+ */
+class FilelistFragmentCache {
+public:
+	struct FullListFragment {
+		ParallelBZOutputStream::Blocks compressed;
+		TigerTree xmlTree;
+	};
+
+	using FullListFragmentPtr = shared_ptr<const FullListFragment>;
+	using PartialListPtr = shared_ptr<const string>;
+
+	// Lists larger than this aren't cached
+	static constexpr size_t MAX_PARTIAL_LIST_SIZE = 4 * 1024 * 1024;
+
+	// Writes the list in the target stream and keeps a copy of it for caching while the size is within the limit
+	class PartialListOutputStream : public OutputStream {
+	public:
+		explicit PartialListOutputStream(OutputStream& aTarget) noexcept : target(aTarget) { }
+		using OutputStream::write;
+
+		size_t flushBuffers(bool aForce) override { return target.flushBuffers(aForce); }
+		size_t write(const void* aBuf, size_t aLen) override;
+
+		// Returns nullptr if the list was too large
+		PartialListPtr releaseList() noexcept;
+	private:
+		OutputStream& target;
+		string xml;
+		bool cacheable = true;
+	};
+
+	// Whitespace that makes the XML size a multiple of the tiger tree base block size
+	static string getXmlPadding(int64_t aXmlSize) noexcept;
+
+	// Serializes and compresses the recursive listing of the virtual root directories
+	// Throws Exception in case of compression errors
+	static FullListFragmentPtr createFullListFragment(const ShareDirectory::List& aRoots, const FilelistDirectory::DuplicateFileHandler& aDuplicateFileHandler);
+
+	// Root directories sharing the same virtual name
+	FullListFragmentPtr getFullListFragment(const ShareDirectory::List& aRoots) noexcept;
+	void setFullListFragment(const ShareDirectory::List& aRoots, const FullListFragmentPtr& aFragment) noexcept;
+
+	// Returns nullptr if the list isn't cached
+	PartialListPtr getPartialList(const string& aVirtualPath, const OptionalProfileToken& aProfile, bool aRecursive) noexcept;
+	void setPartialList(const string& aVirtualPath, const OptionalProfileToken& aProfile, bool aRecursive, const PartialListPtr& aXml) noexcept;
+
+	// The content of the directory has changed
+	// Set aSubtree if the changes may also affect the child directories
+	void onDirectoryChanged(const ShareDirectory& aDirectory, bool aSubtree) noexcept;
+
+	// Root was added, removed or its virtual name/profiles have changed
+	void onRootChanged(const string& aRootPath) noexcept;
+private:
+	static string getFullListKey(const ShareDirectory::List& aRoots) noexcept;
+	static string getPartialListKey(const string& aVirtualPath, const OptionalProfileToken& aProfile, bool aRecursive) noexcept;
+
+	static size_t getFragmentSize(const FullListFragment& aFragment) noexcept;
+
+	void removeFullListFragments(const string& aRootPath) noexcept;
+	void removeFullListFragment(const string& aKey) noexcept;
+	void removePartialList(const string& aKey) noexcept;
+
+	struct FullListEntry {
+		FullListFragmentPtr fragment;
+		StringList rootPaths;
+		size_t size;
+		uint64_t lastUsed;
+	};
+
+	struct PartialListEntry {
+		string virtualPathLower;
+		PartialListPtr xml;
+		uint64_t lastUsed;
+	};
+
+	unordered_map<string, FullListEntry> fullListFragments;
+	size_t fullListBytes = 0;
+	uint64_t fullListUsageCounter = 0;
+
+	unordered_map<string, PartialListEntry> partialLists;
+	size_t partialListBytes = 0;
+	uint64_t partialListUsageCounter = 0;
+
+	mutable CriticalSection cs;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_FILELIST_FRAGMENT_CACHE_H)
@@ -0,0 +1,385 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include <airdcpp/share/ShareBinaryCache.h>
+
+#include <airdcpp/core/io/File.h>
+#include <airdcpp/core/io/MappedFile.h>
+#include <airdcpp/core/io/compress/ZUtils.h>
+#include <airdcpp/hash/HashedFile.h>
+#include <airdcpp/hash/HashManager.h>
+#include <airdcpp/share/ShareRefreshInfo.h>
+
+namespace dcpp {
+
+namespace {
+
+const char MAGIC[8] = { 'A', 'D', 'C', 'S', 'H', 'A', 'R', 'E' };
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct Header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t headerSize;
+	uint32_t checksum; // CRC32 of the content following the header
+
+	int64_t rootLastWrite;
+	uint64_t stringTableSize; // Padded to a multiple of 8 bytes
+	uint64_t directoryCount;
+	uint64_t fileCount;
+
+	uint32_t rootPathLength; // Stored at the beginning of the string table
+	uint32_t reserved;
+};
+
+struct DirectoryRecord {
+	uint64_t nameOffset;
+	uint32_t nameLength;
+	uint32_t parent;
+
+	int64_t lastWrite;
+
+	uint64_t firstFile;
+	uint64_t fileCount;
+};
+
+struct FileRecord {
+	uint64_t nameOffset;
+	uint32_t nameLength;
+	uint32_t reserved;
+
+	int64_t size;
+	uint64_t lastWrite;
+};
+
+static_assert(sizeof(Header) == 64 && sizeof(DirectoryRecord) == 40 && sizeof(FileRecord) == 32, "Unexpected record padding");
+
+// Converts a value between the native and the little-endian byte order (in either direction)
+template<typename T>
+void convertByteOrder(T& value_) noexcept {
+	if constexpr (std::endian::native == std::endian::big) {
+		auto bytes = reinterpret_cast<uint8_t*>(&value_);
+		std::reverse(bytes, bytes + sizeof(T));
+	}
+}
+
+void convertByteOrder(Header& header_) noexcept {
+	convertByteOrder(header_.version);
+	convertByteOrder(header_.byteOrder);
+	convertByteOrder(header_.headerSize);
+	convertByteOrder(header_.checksum);
+	convertByteOrder(header_.rootLastWrite);
+	convertByteOrder(header_.stringTableSize);
+	convertByteOrder(header_.directoryCount);
+	convertByteOrder(header_.fileCount);
+	convertByteOrder(header_.rootPathLength);
+}
+
+void convertByteOrder(DirectoryRecord& record_) noexcept {
+	convertByteOrder(record_.nameOffset);
+	convertByteOrder(record_.nameLength);
+	convertByteOrder(record_.parent);
+	convertByteOrder(record_.lastWrite);
+	convertByteOrder(record_.firstFile);
+	convertByteOrder(record_.fileCount);
+}
+
+void convertByteOrder(FileRecord& record_) noexcept {
+	convertByteOrder(record_.nameOffset);
+	convertByteOrder(record_.nameLength);
+	convertByteOrder(record_.size);
+	convertByteOrder(record_.lastWrite);
+}
+
+template<class T>
+void appendRecord(string& buffer_, T aRecord) noexcept {
+	convertByteOrder(aRecord);
+	buffer_.append(reinterpret_cast<const char*>(&aRecord), sizeof(T));
+}
+
+template<class T>
+T readRecord(const uint8_t* aData) noexcept {
+	T record;
+	memcpy(&record, aData, sizeof(T));
+	convertByteOrder(record);
+	return record;
+}
+
+// Files are checked from the hash database in batches (the keys are read in sorted order)
+const size_t CHECK_BATCH_SIZE = 32768;
+
+const uint32_t NO_PARENT = static_cast<uint32_t>(-1);
+
+uint64_t padSize(uint64_t aSize) noexcept {
+	return (aSize + 7) & ~static_cast<uint64_t>(7);
+}
+
+// Visits the directories in pre-order and calculates the record values
+template<class DirectoryF, class FileF>
+class TreeWalker {
+public:
+	TreeWalker(uint32_t aRootPathLength, DirectoryF&& aDirectoryF, FileF&& aFileF) : stringOffset(aRootPathLength), directoryF(aDirectoryF), fileF(aFileF) { }
+
+	void walk(const ShareDirectory& aDirectory, const string& aName, uint32_t aParent) {
+		DirectoryRecord record = {
+			stringOffset, static_cast<uint32_t>(aName.size()), aParent,
+			aDirectory.getLastWrite(),
+			fileIndex, aDirectory.getFiles().size()
+		};
+
+		stringOffset += aName.size();
+		directoryF(aDirectory, aName, record);
+
+		auto current = directoryIndex++;
+		for (const auto& f: aDirectory.getFiles()) {
+			const auto name = f->getName().getNormal();
+			FileRecord fileRecord = {
+				stringOffset, static_cast<uint32_t>(name.size()), 0,
+				f->getSize(),
+				static_cast<uint64_t>(f->getLastWrite())
+			};
+
+			stringOffset += name.size();
+			fileIndex++;
+			fileF(*f, name, fileRecord);
+		}
+
+		for (const auto& d: aDirectory.getDirectories()) {
+			walk(*d, d->getRealName().getNormal(), current);
+		}
+	}
+
+	uint64_t stringOffset;
+	uint32_t directoryIndex = 0;
+	uint64_t fileIndex = 0;
+private:
+	DirectoryF directoryF;
+	FileF fileF;
+};
+
+template<class DirectoryF, class FileF>
+TreeWalker<DirectoryF, FileF> walkTree(const ShareDirectory& aRoot, uint32_t aRootPathLength, DirectoryF&& aDirectoryF, FileF&& aFileF) {
+	TreeWalker<DirectoryF, FileF> walker(aRootPathLength, std::forward<DirectoryF>(aDirectoryF), std::forward<FileF>(aFileF));
+	walker.walk(aRoot, Util::emptyString, NO_PARENT);
+	return walker;
+}
+
+}
+
+ShareBinaryCache::Content ShareBinaryCache::serialize(const ShareDirectory::Ptr& aRoot) {
+	const auto& rootPath = aRoot->getRoot()->getPath();
+	const auto rootPathLength = static_cast<uint32_t>(rootPath.size());
+
+	Content content;
+	content.strings = rootPath;
+
+	// All sections are filled with a single walk
+	auto walker = walkTree(*aRoot, rootPathLength,
+		[&content](const ShareDirectory&, const string& aName, const DirectoryRecord& aRecord) {
+			content.strings += aName;
+			appendRecord(content.directories, aRecord);
+		},
+		[&content](const ShareDirectory::File& aFile, const string& aName, const FileRecord& aRecord) {
+			content.strings += aName;
+			appendRecord(content.files, aRecord);
+			content.tths.append(reinterpret_cast<const char*>(aFile.getTTH().data), TTHValue::BYTES);
+		}
+	);
+
+	Header header;
+	memset(&header, 0, sizeof(Header));
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.byteOrder = BYTE_ORDER_MARK;
+	header.headerSize = sizeof(Header);
+	header.rootLastWrite = aRoot->getLastWrite();
+	header.rootPathLength = rootPathLength;
+	header.stringTableSize = padSize(walker.stringOffset);
+	header.directoryCount = walker.directoryIndex;
+	header.fileCount = walker.fileIndex;
+
+	content.strings.resize(static_cast<size_t>(header.stringTableSize), '\0');
+
+	CRC32Filter crc;
+	for (const auto& section: { &content.strings, &content.directories, &content.files, &content.tths }) {
+		crc(section->data(), section->size());
+	}
+
+	header.checksum = crc.getValue();
+	appendRecord(content.header, header);
+	return content;
+}
+
+void ShareBinaryCache::save(const string& aPath, const Content& aContent) {
+	File f(aPath, File::WRITE, File::TRUNCATE | File::CREATE, File::BUFFER_SEQUENTIAL);
+	for (const auto& section: { &aContent.header, &aContent.strings, &aContent.directories, &aContent.files, &aContent.tths }) {
+		f.write(section->data(), section->size());
+	}
+}
+
+void ShareBinaryCache::load(const string& aPath, ShareRefreshInfo& info_) {
+	MappedFile file(aPath);
+
+	// Header
+	if (file.size() < sizeof(Header)) {
+		throw ShareCacheException("Truncated header");
+	}
+
+	auto header = readRecord<Header>(file.data());
+	if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.byteOrder != BYTE_ORDER_MARK || header.headerSize != sizeof(Header)) {
+		throw ShareCacheException("Unsupported format");
+	}
+
+	if (header.version != VERSION) {
+		throw ShareCacheException("Unsupported version");
+	}
+
+	// Sections
+	const auto contentSize = static_cast<uint64_t>(file.size() - sizeof(Header));
+	if (header.stringTableSize > contentSize || header.directoryCount > contentSize / sizeof(DirectoryRecord) || header.fileCount > contentSize / (sizeof(FileRecord) + TTHValue::BYTES)) {
+		throw ShareCacheException("Invalid section sizes");
+	}
+
+	const auto expectedSize = header.stringTableSize + header.directoryCount * sizeof(DirectoryRecord) + header.fileCount * (sizeof(FileRecord) + TTHValue::BYTES);
+	if (expectedSize != contentSize || header.directoryCount == 0 || header.rootPathLength > header.stringTableSize) {
+		throw ShareCacheException("Invalid section sizes");
+	}
+
+	const auto strings = reinterpret_cast<const char*>(file.data() + sizeof(Header));
+	const auto directories = file.data() + sizeof(Header) + header.stringTableSize;
+	const auto files = directories + header.directoryCount * sizeof(DirectoryRecord);
+	const auto tths = files + header.fileCount * sizeof(FileRecord);
+
+	{
+		// Checksum (zlib takes 32 bit lengths)
+		CRC32Filter crc;
+		const auto content = file.data() + sizeof(Header);
+		for (uint64_t pos = 0; pos < contentSize; ) {
+			auto len = static_cast<size_t>(min<uint64_t>(contentSize - pos, 1 << 30));
+			crc(content + pos, len);
+			pos += len;
+		}
+
+		if (crc.getValue() != header.checksum) {
+			throw ShareCacheException("Checksum mismatch");
+		}
+	}
+
+	auto getString = [&](uint64_t aOffset, uint32_t aLength) {
+		if (aOffset > header.stringTableSize || aLength > header.stringTableSize - aOffset) {
+			throw ShareCacheException("Invalid string reference");
+		}
+
+		return string(strings + aOffset, aLength);
+	};
+
+	if (getString(0, header.rootPathLength) != info_.path) {
+		throw ShareCacheException("Root path mismatch");
+	}
+
+	// Content
+	info_.newDirectory->setLastWrite(static_cast<time_t>(header.rootLastWrite));
+
+	ShareDirectory::List createdDirectories;
+	createdDirectories.reserve(static_cast<size_t>(header.directoryCount));
+
+	// Real paths of the created directories (normal, lower case)
+	vector<pair<string, string>> directoryPaths;
+	directoryPaths.reserve(static_cast<size_t>(header.directoryCount));
+
+	HashedFileCheckList checkList;
+
+	// Directory index and name of the files being checked
+	vector<pair<size_t, string>> checkFiles;
+
+	auto checkPendingFiles = [&] {
+		HashManager::getInstance()->checkTTHs(checkList);
+		for (size_t f = 0; f < checkList.size(); ++f) {
+			const auto& file = checkList[f];
+			if (file.found) {
+				auto& [directoryIndex, name] = checkFiles[f];
+				createdDirectories[directoryIndex]->addFile(std::move(name), file.info, info_, info_.stats.addedSize);
+			} else {
+				info_.stats.hashSize += file.info.getSize();
+			}
+		}
+
+		checkList.clear();
+		checkFiles.clear();
+	};
+
+	uint64_t nextFile = 0;
+	for (uint64_t i = 0; i < header.directoryCount; ++i) {
+		auto record = readRecord<DirectoryRecord>(directories + i * sizeof(DirectoryRecord));
+
+		ShareDirectory::Ptr directory;
+		if (i == 0) {
+			directory = info_.newDirectory;
+			directoryPaths.emplace_back(directory->getRoot()->getPath(), directory->getRoot()->getPathLower());
+		} else {
+			if (record.parent >= i) {
+				throw ShareCacheException("Invalid directory parent");
+			}
+
+			directory = ShareDirectory::createNormal(getString(record.nameOffset, record.nameLength), createdDirectories[record.parent], static_cast<time_t>(record.lastWrite), info_);
+			if (!directory) {
+				throw ShareCacheException("Duplicate directory name");
+			}
+
+			const auto& [parentPath, parentPathLower] = directoryPaths[record.parent];
+			directoryPaths.emplace_back(
+				parentPath + directory->getRealName().getNormal() + PATH_SEPARATOR,
+				parentPathLower + directory->getRealName().getLower() + PATH_SEPARATOR
+			);
+		}
+
+		createdDirectories.push_back(directory);
+
+		// Files
+		if (record.firstFile != nextFile || record.fileCount > header.fileCount - nextFile) {
+			throw ShareCacheException("Invalid file range");
+		}
+
+		if (record.fileCount == 0) {
+			continue;
+		}
+
+		const auto& [path, pathLower] = directoryPaths.back();
+		for (; nextFile < record.firstFile + record.fileCount; ++nextFile) {
+			auto fileRecord = readRecord<FileRecord>(files + nextFile * sizeof(FileRecord));
+
+			auto name = getString(fileRecord.nameOffset, fileRecord.nameLength);
+			checkList.emplace_back(path + name, pathLower + Text::toLower(name), HashedFile(TTHValue(tths + nextFile * TTHValue::BYTES), fileRecord.lastWrite, fileRecord.size));
+			checkFiles.emplace_back(static_cast<size_t>(i), std::move(name));
+		}
+
+		if (checkList.size() >= CHECK_BATCH_SIZE) {
+			checkPendingFiles();
+		}
+	}
+
+	if (nextFile != header.fileCount) {
+		throw ShareCacheException("Invalid file range");
+	}
+
+	checkPendingFiles();
+}
+
+} // namespace dcpp
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_SHARE_BINARY_CACHE_H
+#define DCPLUSPLUS_DCPP_SHARE_BINARY_CACHE_H
+
+#include <airdcpp/core/classes/Exception.h>
+#include <airdcpp/share/ShareDirectory.h>
+
+namespace dcpp {
+
+STANDARD_EXCEPTION(ShareCacheException);
+
+class ShareRefreshInfo;
+
+/**
+ * Binary cache of a single share root
+ *
+ * Layout: header, string table, directory records (pre-order, the root being the first one),
+ * file records (grouped by directory) and TTH roots (in the same order as the file records)
+ *
+ * The file is memory mapped when loading. All values are stored in little-endian byte order.
+ */
+class ShareBinaryCache {
+public:
+	static const uint32_t VERSION = 1;
+
+	// Serialized sections of a cache file
+	struct Content {
+		string header;
+		string strings;
+		string directories;
+		string files;
+		string tths;
+	};
+
+	// Serializes the directory tree in memory so that the file can be written without holding the tree lock
+	// The caller must hold the tree lock
+	static Content serialize(const ShareDirectory::Ptr& aRoot);
+
+	// Writes the serialized content in a file
+	// Throws FileException
+	static void save(const string& aPath, const Content& aContent);
+
+	// Loads the cache content in the new directory of the refresh info
+	// The file information is validated against the hash database, files that don't match it are queued for hashing
+	// Throws FileException, ShareCacheException
+	static void load(const string& aPath, ShareRefreshInfo& info_);
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_SHARE_BINARY_CACHE_H)
@@ -18,6 +18,7 @@
 
 #include "stdinc.h"
 #include <airdcpp/share/ShareDirectory.h>
+#include <airdcpp/share/ShareSearchIndex.h>
 
 #include <airdcpp/util/AppUtil.h>
 #include <airdcpp/core/io/File.h>
@@ -68,7 +69,7 @@ ShareDirectory::Ptr ShareDirectory::createNormal(DualString&& aRealName, const P
 		}
 	}
 
-	addDirName(dir, maps_.lowerDirNameMap, maps_.getBloom());
+	addDirName(dir, maps_);
 	return dir;
 }
 
@@ -80,7 +81,7 @@ ShareDirectory::Ptr ShareDirectory::createRoot(const string& aRootPath, const st
 	dcassert(maps_.rootPaths.find(dir->getRealPathUnsafe()) == maps_.rootPaths.end());
 	maps_.rootPaths[dir->getRealPathUnsafe()] = dir;
 
-	addDirName(dir, maps_.lowerDirNameMap, maps_.getBloom());
+	addDirName(dir, maps_);
 	return dir;
 }
 
@@ -158,14 +159,14 @@ void ShareDirectory::addFile(DualString&& aName, const HashedFile& aFileInfo, Sh
 		auto i = files.find(aName.getLower());
 		if (i != files.end()) {
 			// Get rid of false constness...
-			(*i)->cleanIndices(sharedSize_, maps_.tthIndex);
+			(*i)->cleanIndices(maps_, sharedSize_);
 			delete* i;
 			files.erase(i);
 		}
 	}
 
 	auto it = files.insert_sorted(new ShareDirectory::File(std::move(aName), this, aFileInfo)).first;
-	(*it)->updateIndices(maps_.getBloom(), sharedSize_, maps_.tthIndex);
+	(*it)->updateIndices(maps_, sharedSize_);
 
 	if (dirtyProfiles_) {
 		copyRootProfiles(*dirtyProfiles_, true);
@@ -326,8 +327,50 @@ bool ShareDirectory::hasProfile(const OptionalProfileToken& aProfile) const noex
 
 
 // INDEXES
-void ShareDirectory::cleanIndices(ShareDirectory& aDirectory, int64_t& sharedSize_, File::TTHMap& tthIndex_, ShareDirectory::MultiMap& dirNames_) noexcept {
-	aDirectory.cleanIndices(sharedSize_, tthIndex_, dirNames_);
+ShareTreeMaps::ShareTreeMaps(GetBloomF&& aGetBloomF) : getBloomF(std::move(aGetBloomF)) {
+	if (SETTING(SHARE_SEARCH_INDEX)) {
+		searchIndex = make_unique<ShareSearchIndex>();
+	}
+
+}
+
+ShareTreeMaps::~ShareTreeMaps() {
+
+}
+
+void ShareTreeMaps::mergeIndices(ShareTreeMaps& aOther) noexcept {
+	if (lowerDirNameMap.empty() && tthIndex.empty()) {
+		std::swap(lowerDirNameMap, aOther.lowerDirNameMap);
+		std::swap(tthIndex, aOther.tthIndex);
+		std::swap(searchIndex, aOther.searchIndex);
+		return;
+	}
+
+#ifdef _DEBUG
+	for (const auto& d : aOther.lowerDirNameMap | views::values) {
+		ShareDirectory::checkAddedDirNameDebug(d, lowerDirNameMap);
+	}
+
+	for (const auto& f : aOther.tthIndex | views::values) {
+		ShareDirectory::File::checkAddedTTHDebug(f, tthIndex);
+	}
+#endif
+
+	lowerDirNameMap.insert(aOther.lowerDirNameMap.begin(), aOther.lowerDirNameMap.end());
+	tthIndex.insert(aOther.tthIndex.begin(), aOther.tthIndex.end());
+	if (searchIndex && aOther.searchIndex) {
+		searchIndex->merge(*aOther.searchIndex);
+	} else {
+		// The setting was changed after the other tree was indexed, searches can't use a partial index
+		searchIndex.reset();
+	}
+
+	aOther.lowerDirNameMap.clear();
+	aOther.tthIndex.clear();
+}
+
+void ShareDirectory::cleanIndices(ShareDirectory& aDirectory, int64_t& sharedSize_, ShareTreeMaps& maps_) noexcept {
+	aDirectory.cleanIndices(sharedSize_, maps_);
 
 	if (aDirectory.parent) {
 		aDirectory.parent->directories.erase_key(aDirectory.realName.getLower());
@@ -335,60 +378,77 @@ void ShareDirectory::cleanIndices(ShareDirectory& aDirectory, int64_t& sharedSiz
 	}
 }
 
-void ShareDirectory::cleanIndices(int64_t& sharedSize_, ShareDirectory::File::TTHMap& tthIndex_, ShareDirectory::MultiMap& dirNames_) const noexcept {
+void ShareDirectory::cleanIndices(int64_t& sharedSize_, ShareTreeMaps& maps_) noexcept {
 	for (const auto& d : directories) {
-		d->cleanIndices(sharedSize_, tthIndex_, dirNames_);
+		d->cleanIndices(sharedSize_, maps_);
 	}
 
 	//remove from the name map
-	removeDirName(*this, dirNames_);
+	removeDirName(*this, maps_);
 
 	//remove all files
 	for (const auto& f : files) {
-		f->cleanIndices(sharedSize_, tthIndex_);
+		f->cleanIndices(maps_, sharedSize_);
 	}
 }
 
-void ShareDirectory::File::updateIndices(ShareBloom& bloom_, int64_t& sharedSize_, TTHMap& tthIndex_) noexcept {
+void ShareDirectory::File::updateIndices(ShareTreeMaps& maps_, int64_t& sharedSize_) noexcept {
 	parent->increaseSize(size, sharedSize_);
 
 #ifdef _DEBUG
-	checkAddedTTHDebug(this, tthIndex_);
+	checkAddedTTHDebug(this, maps_.tthIndex);
 #endif
-	tthIndex_.emplace(&tth, this);
-	bloom_.add(name.getLower());
+	maps_.tthIndex.emplace(&tth, this);
+	maps_.getBloom().add(name.getLower());
+
+	if (auto searchIndex = maps_.getSearchIndex(); searchIndex) {
+		searchIndex->addFile(*this);
+	}
 }
 
-void ShareDirectory::File::cleanIndices(int64_t& sharedSize_, File::TTHMap& tthIndex_) noexcept {
+void ShareDirectory::File::cleanIndices(ShareTreeMaps& maps_, int64_t& sharedSize_) noexcept {
 	parent->decreaseSize(size, sharedSize_);
 
-	auto flst = tthIndex_.equal_range(&tth);
+	auto flst = maps_.tthIndex.equal_range(&tth);
 	auto p = ranges::find(flst | pair_to_range | views::values, this);
 	if (p.base() != flst.second)
-		tthIndex_.erase(p.base());
+		maps_.tthIndex.erase(p.base());
 	else
 		dcassert(0);
+
+	if (auto searchIndex = maps_.getSearchIndex(); searchIndex) {
+		searchIndex->removeFile(*this);
+	}
 }
 
-void ShareDirectory::addDirName(const ShareDirectory::Ptr& aDir, ShareDirectory::MultiMap& aDirNames, ShareBloom& aBloom) noexcept {
+void ShareDirectory::addDirName(const ShareDirectory::Ptr& aDir, ShareTreeMaps& maps_) noexcept {
 	const auto& nameLower = aDir->getVirtualNameLower();
 
 #ifdef _DEBUG
-	checkAddedDirNameDebug(aDir, aDirNames);
+	checkAddedDirNameDebug(aDir, maps_.lowerDirNameMap);
 #endif
-	aDirNames.emplace(const_cast<string*>(&nameLower), aDir);
-	aBloom.add(nameLower);
+	maps_.lowerDirNameMap.emplace(const_cast<string*>(&nameLower), aDir);
+	maps_.getBloom().add(nameLower);
+
+	if (auto searchIndex = maps_.getSearchIndex(); searchIndex) {
+		searchIndex->addDirectory(*aDir);
+	}
 }
 
-void ShareDirectory::removeDirName(const ShareDirectory& aDir, ShareDirectory::MultiMap& aDirNames) noexcept {
-	auto directories = aDirNames.equal_range(const_cast<string*>(&aDir.getVirtualNameLower()));
+void ShareDirectory::removeDirName(ShareDirectory& aDir, ShareTreeMaps& maps_) noexcept {
+	if (auto searchIndex = maps_.getSearchIndex(); searchIndex) {
+		searchIndex->removeDirectory(aDir);
+	}
+
+	auto& dirNames = maps_.lowerDirNameMap;
+	auto directories = dirNames.equal_range(const_cast<string*>(&aDir.getVirtualNameLower()));
 	auto p = ranges::find_if(directories | pair_to_range | views::values, [&aDir](const ShareDirectory::Ptr& d) { return d.get() == &aDir; });
-	if (p.base() == aDirNames.end()) {
+	if (p.base() == dirNames.end()) {
 		dcassert(0);
 		return;
 	}
 
-	aDirNames.erase(p.base());
+	dirNames.erase(p.base());
 }
 
 #ifdef _DEBUG
@@ -433,7 +493,22 @@ ShareDirectory::SearchResultInfo::SearchResultInfo(const ShareDirectory* d, cons
 * but not the parents...
 */
 
-void ShareDirectory::search(SearchResultInfo::Set& results_, SearchQuery& aStrings, int aLevel) const noexcept {
+void ShareDirectory::search(SearchResultInfo::Set& results_, SearchQuery& aStrings, int aLevel, const SearchCandidates* aCandidates) const noexcept {
+	const SearchCandidates::Node* candidateNode = nullptr;
+	if (aCandidates) {
+		candidateNode = aCandidates->getNode(this);
+		if (!candidateNode) {
+			// Nothing can match here
+			return;
+		}
+
+		if (candidateNode->fullMatch) {
+			// Everything in this directory needs to be checked
+			aCandidates = nullptr;
+			candidateNode = nullptr;
+		}
+	}
+
 	const auto& dirName = getVirtualNameLower();
 	if (aStrings.isExcludedLower(dirName)) {
 		return;
@@ -480,20 +555,34 @@ void ShareDirectory::search(SearchResultInfo::Set& results_, SearchQuery& aStrin
 
 	// Match files
 	if (aStrings.itemType != SearchQuery::ItemType::DIRECTORY) {
-		for (const auto& f : files) {
-			if (!aStrings.matchesFileLower(f->getName().getLower(), f->getSize(), f->getLastWrite())) {
-				continue;
+		auto matchFiles = [&](const auto& aFiles) {
+			for (const auto& f : aFiles) {
+				if (!aStrings.matchesFileLower(f->getName().getLower(), f->getSize(), f->getLastWrite())) {
+					continue;
+				}
+
+				results_.emplace(f, aStrings, aLevel);
+				if (aStrings.addParents)
+					break;
 			}
+		};
 
-			results_.emplace(f, aStrings, aLevel);
-			if (aStrings.addParents)
-				break;
+		if (candidateNode) {
+			matchFiles(candidateNode->files);
+		} else {
+			matchFiles(files);
 		}
 	}
 
 	// Match directories
-	for (const auto& d : directories) {
-		d->search(results_, aStrings, aLevel);
+	if (candidateNode) {
+		for (const auto& d : candidateNode->directories) {
+			d->search(results_, aStrings, aLevel, aCandidates);
+		}
+	} else {
+		for (const auto& d : directories) {
+			d->search(results_, aStrings, aLevel);
+		}
 	}
 
 	// Moving to a lower level
@@ -504,6 +593,42 @@ void ShareDirectory::search(SearchResultInfo::Set& results_, SearchQuery& aStrin
 	aStrings.recursion = old;
 }
 
+void ShareDirectory::SearchCandidates::addDirectory(const ShareDirectory* aDirectory) noexcept {
+	nodes[aDirectory].fullMatch = true;
+	addParents(aDirectory);
+}
+
+void ShareDirectory::SearchCandidates::addFile(const File* aFile) noexcept {
+	nodes[aFile->getParent()].files.insert_sorted(aFile);
+	addParents(aFile->getParent());
+}
+
+void ShareDirectory::SearchCandidates::addParents(const ShareDirectory* aDirectory) noexcept {
+	for (auto cur = aDirectory; cur->parent; cur = cur->parent) {
+		auto& node = nodes[cur];
+		if (node.hasParent) {
+			// The rest of the path has been added already
+			break;
+		}
+
+		node.hasParent = true;
+		nodes[cur->parent].directories.push_back(cur);
+	}
+}
+
+void ShareDirectory::SearchCandidates::finalize() noexcept {
+	for (auto& node : nodes | views::values) {
+		ranges::sort(node.directories, [](const ShareDirectory* a, const ShareDirectory* b) {
+			return Compare()(a->realName.getLower(), b->realName.getLower()) < 0;
+		});
+	}
+}
+
+const ShareDirectory::SearchCandidates::Node* ShareDirectory::SearchCandidates::getNode(const ShareDirectory* aDirectory) const noexcept {
+	auto i = nodes.find(aDirectory);
+	return i != nodes.end() ? &i->second : nullptr;
+}
+
 void ShareDirectory::File::addSR(SearchResultList& aResults, bool aAddParent) const noexcept {
 	auto path = aAddParent ? parent->getAdcPathUnsafe() : getAdcPath();
 
@@ -523,40 +648,8 @@ void ShareDirectory::File::addSR(SearchResultList& aResults, bool aAddParent) co
 }
 
 
-// CACHE
-#define LITERAL(n) n, sizeof(n)-1
-void ShareDirectory::toCacheXmlList(OutputStream& xmlFile, string& indent, string& tmp) const {
-	xmlFile.write(indent);
-	xmlFile.write(LITERAL("<Directory Name=\""));
-	xmlFile.write(SimpleXML::escape(realName.lowerCaseOnly() ? realName.getLower() : realName.getNormal(), tmp, true));
-
-	xmlFile.write(LITERAL("\" Date=\""));
-	xmlFile.write(SimpleXML::escape(Util::toString(lastWrite), tmp, true));
-	xmlFile.write(LITERAL("\">\r\n"));
-
-	indent += '\t';
-	filesToCacheXmlList(xmlFile, indent, tmp);
-
-	for (const auto& d : directories) {
-		d->toCacheXmlList(xmlFile, indent, tmp);
-	}
-
-	indent.erase(indent.length() - 1);
-	xmlFile.write(indent);
-	xmlFile.write(LITERAL("</Directory>\r\n"));
-}
-
-void ShareDirectory::filesToCacheXmlList(OutputStream& xmlFile, string& indent, string& tmp2) const {
-	for (const auto& f : files) {
-		xmlFile.write(indent);
-		xmlFile.write(LITERAL("<File Name=\""));
-		xmlFile.write(SimpleXML::escape(f->getName().lowerCaseOnly() ? f->getName().getLower() : f->getName().getNormal(), tmp2, true));
-		xmlFile.write(LITERAL("\"/>\r\n"));
-	}
-}
-
-
 // FILELISTS
+#define LITERAL(n) n, sizeof(n)-1
 
 FilelistDirectory::FilelistDirectory(const string& aName, time_t aDate) : date(aDate), name(aName) { }
 
@@ -734,6 +827,10 @@ string ShareRoot::getCacheXmlPath() const noexcept {
 	return AppUtil::getPath(AppUtil::PATH_SHARECACHE) + "ShareCache_" + PathUtil::validateFileName(path) + ".xml";
 }
 
+string ShareRoot::getCacheBinaryPath() const noexcept {
+	return AppUtil::getPath(AppUtil::PATH_SHARECACHE) + "ShareCache_" + PathUtil::validateFileName(path) + ".bin";
+}
+
 void ShareRoot::setName(const string& aName) noexcept {
 	virtualName = make_unique<DualString>(aName);
 }
@@ -76,7 +76,9 @@ public:
 	}
 
 	void setName(const string& aName) noexcept;
+	// Legacy cache format, only used for converting
 	string getCacheXmlPath() const noexcept;
+	string getCacheBinaryPath() const noexcept;
 
 	ShareRoot(ShareRoot&) = delete;
 	ShareRoot& operator=(ShareRoot&) = delete;
@@ -89,6 +91,7 @@ private:
 };
 
 class ShareTreeMaps;
+class ShareSearchIndex;
 class FilelistDirectory;
 class ShareDirectory : public intrusive_ptr_base<ShareDirectory> {
 public:
@@ -127,8 +130,8 @@ public:
 		GETSET(time_t, lastWrite, LastWrite);
 		GETSET(TTHValue, tth, TTH);
 
-		void updateIndices(ShareBloom& aBloom_, int64_t& sharedSize_, File::TTHMap& tthIndex_) noexcept;
-		void cleanIndices(int64_t& sharedSize_, TTHMap& tthIndex_) noexcept;
+		void updateIndices(ShareTreeMaps& maps_, int64_t& sharedSize_) noexcept;
+		void cleanIndices(ShareTreeMaps& maps_, int64_t& sharedSize_) noexcept;
 
 #ifdef _DEBUG
 		// Checks that duplicate/incorrect files won't get through
@@ -139,7 +142,10 @@ public:
 			return name;
 		}
 	private:
+		friend class ShareSearchIndex;
+
 		DualString name;
+		uint32_t searchIndexId = 0;
 	};
 
 	class SearchResultInfo {
@@ -170,6 +176,32 @@ public:
 
 	typedef SortedVector<Ptr, std::vector, string, Compare, NameLower> Set;
 
+	// Directories and files that need to be visited when searching for a pattern that must be found
+	// from the item itself or from one of its parents
+	class SearchCandidates {
+	public:
+		// The whole subtree must be searched
+		void addDirectory(const ShareDirectory* aDirectory) noexcept;
+		void addFile(const File* aFile) noexcept;
+
+		// Sorts the added children in the same order as they are listed in their parent
+		void finalize() noexcept;
+
+		struct Node {
+			bool fullMatch = false;
+			bool hasParent = false;
+
+			vector<const ShareDirectory*> directories;
+			File::ConstSet files;
+		};
+
+		const Node* getNode(const ShareDirectory* aDirectory) const noexcept;
+	private:
+		void addParents(const ShareDirectory* aDirectory) noexcept;
+
+		unordered_map<const ShareDirectory*, Node> nodes;
+	};
+
 	static Ptr createNormal(DualString&& aRealName, const Ptr& aParent, time_t aLastWrite, ShareTreeMaps& maps_) noexcept;
 	static Ptr createRoot(const string& aRootPath, const string& aVname, const ProfileTokenSet& aProfiles, bool aIncoming, time_t aLastWrite, ShareTreeMaps& maps_, time_t aLastRefreshTime) noexcept;
 	static Ptr cloneRoot(const Ptr& aOldRoot, time_t aLastWrite, ShareTreeMaps& maps_) noexcept;
@@ -179,7 +211,7 @@ public:
 	static bool setParent(const ShareDirectory::Ptr& aDirectory, const ShareDirectory::Ptr& aParent) noexcept;
 
 	// Remove directory from possible parent and all shared containers
-	static void cleanIndices(ShareDirectory& aDirectory, int64_t& sharedSize_, File::TTHMap& tthIndex_, ShareDirectory::MultiMap& aDirNames_) noexcept;
+	static void cleanIndices(ShareDirectory& aDirectory, int64_t& sharedSize_, ShareTreeMaps& maps_) noexcept;
 
 	struct HasRootProfile {
 		HasRootProfile(const OptionalProfileToken& aProfile) : profile(aProfile) { }
@@ -217,13 +249,12 @@ public:
 
 	void getProfileInfo(ProfileToken aProfile, int64_t& totalSize_, size_t& filesCount_) const noexcept;
 
-	void search(SearchResultInfo::Set& aResults, SearchQuery& aStrings, int aLevel) const noexcept;
+	// Only the candidate items are visited if candidates are provided
+	void search(SearchResultInfo::Set& aResults, SearchQuery& aStrings, int aLevel, const SearchCandidates* aCandidates = nullptr) const noexcept;
 
 	void toTTHList(OutputStream& tthList, string& tmp2, bool aRecursive) const;
 
 	//for file list caching
-	void toCacheXmlList(OutputStream& xmlFile, string& indent, string& tmp) const;
-	void filesToCacheXmlList(OutputStream& xmlFile, string& indent, string& tmp2) const;
 
 	GETSET(time_t, lastWrite, LastWrite);
 
@@ -273,8 +304,8 @@ public:
 		const char separator;
 	};
 
-	static void addDirName(const ShareDirectory::Ptr& aDir, ShareDirectory::MultiMap& aDirNames, ShareBloom& aBloom) noexcept;
-	static void removeDirName(const ShareDirectory& aDir, ShareDirectory::MultiMap& aDirNames) noexcept;
+	static void addDirName(const ShareDirectory::Ptr& aDir, ShareTreeMaps& maps_) noexcept;
+	static void removeDirName(ShareDirectory& aDir, ShareTreeMaps& maps_) noexcept;
 
 #ifdef _DEBUG
 	// Checks that duplicate/incorrect directories won't get through
@@ -284,7 +315,7 @@ public:
 
 	void addFile(DualString&& aName, const HashedFile& fi, ShareTreeMaps& maps_, int64_t& sharedSize_, ProfileTokenSet* dirtyProfiles_ = nullptr) noexcept;
 
-	File::Set getFiles() const noexcept {
+	const File::Set& getFiles() const noexcept {
 		return files;
 	}
 
@@ -292,8 +323,10 @@ public:
 		return realName;
 	}
 private:
+	friend class ShareSearchIndex;
+
 	File::Set files;
-	void cleanIndices(int64_t& sharedSize_, File::TTHMap& tthIndex_, ShareDirectory::MultiMap& dirNames_) const noexcept;
+	void cleanIndices(int64_t& sharedSize_, ShareTreeMaps& maps_) noexcept;
 
 	ShareDirectory* parent;
 	Set directories;
@@ -307,12 +340,17 @@ private:
 
 	string getRealPath(const string& path) const noexcept;
 	DualString realName;
+	uint32_t searchIndexId = 0;
 };
 
 class ShareTreeMaps {
 public:
 	typedef std::function<ShareBloom*()> GetBloomF;
-	ShareTreeMaps(GetBloomF&& aGetBloomF) : getBloomF(aGetBloomF) {}
+	explicit ShareTreeMaps(GetBloomF&& aGetBloomF);
+	~ShareTreeMaps();
+
+	ShareTreeMaps(ShareTreeMaps&) = delete;
+	ShareTreeMaps& operator=(ShareTreeMaps&) = delete;
 
 	// Map real name to virtual name - multiple real names may be mapped to a single virtual one
 	ShareDirectory::Map rootPaths;
@@ -324,8 +362,23 @@ public:
 	ShareBloom& getBloom() noexcept {
 		return *getBloomF();
 	}
+
+	// Returns nullptr if the names aren't indexed for searching
+	ShareSearchIndex* getSearchIndex() noexcept {
+		return searchIndex.get();
+	}
+
+	const ShareSearchIndex* getSearchIndex() const noexcept {
+		return searchIndex.get();
+	}
+
+	// Moves the indexed directories and files from another instance (root paths are not handled)
+	// Indices of an empty instance are swapped in constant time
+	// The search index is dropped if only one of the instances has it
+	void mergeIndices(ShareTreeMaps& aOther) noexcept;
 private:
 	GetBloomF getBloomF;
+	unique_ptr<ShareSearchIndex> searchIndex;
 };
 
 class FilelistDirectory {
@@ -344,6 +397,8 @@ public:
 	GETPROP(time_t, date, Date);
 	GETPROP(Map, listDirectories, ListDirectories);
 
+	const ShareDirectory::List& getShareDirectories() const noexcept { return shareDirs; }
+
 	FilelistDirectory(const string& aName, time_t aDate);
 private:
 	void toFileList(const ShareDirectory::Ptr& aShareDirectory, bool aRecursive);
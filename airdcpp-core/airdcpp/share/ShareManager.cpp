@@ -20,7 +20,7 @@
 #include <airdcpp/share/ShareManager.h>
 
 #include <airdcpp/queue/Bundle.h>
-#include <airdcpp/core/io/compress/BZUtils.h>
+#include <airdcpp/core/io/compress/ParallelBZStream.h>
 #include <airdcpp/DCPlusPlus.h>
 #include <airdcpp/core/classes/ErrorCollector.h>
 #include <airdcpp/core/io/File.h>
@@ -32,6 +32,7 @@
 #include <airdcpp/search/SearchQuery.h>
 #include <airdcpp/search/SearchResult.h>
 #include <airdcpp/share/SharePathValidator.h>
+#include <airdcpp/share/ShareBinaryCache.h>
 #include <airdcpp/share/profiles/ShareProfileManager.h>
 #include <airdcpp/share/ShareTasks.h>
 #include <airdcpp/share/ShareTree.h>
@@ -148,9 +149,9 @@ static const string DATE = "Date";
 static const string SHARE = "Share";
 static const string SVERSION = "Version";
 
-struct ShareManager::ShareLoader : public SimpleXMLReader::ThreadedCallBack, public ShareRefreshInfo {
+// Cached content of a single root (the legacy XML cache format is parsed here as well)
+struct ShareManager::ShareLoader : public SimpleXMLReader::CallBack, public ShareRefreshInfo {
 	ShareLoader(const string& aPath, const ShareDirectory::Ptr& aOldRoot, ShareBloom& aBloom) :
-		ThreadedCallBack(aOldRoot->getRoot()->getCacheXmlPath()),
 		ShareRefreshInfo(aPath, aOldRoot, 0, aBloom),
 		curDirPathLower(aOldRoot->getRoot()->getPathLower()),
 		curDirPath(aOldRoot->getRoot()->getPath())
@@ -158,6 +159,16 @@ struct ShareManager::ShareLoader : public SimpleXMLReader::ThreadedCallBack, pub
 		cur = newDirectory;
 	}
 
+	// Throws Exception
+	void loadXml() {
+		File f(optionalOldDirectory->getRoot()->getCacheXmlPath(), File::READ, File::OPEN, File::BUFFER_SEQUENTIAL, false);
+		SimpleXMLReader(this).parse(f);
+		legacyCache = true;
+	}
+
+	// Loaded from an XML cache that should be converted
+	bool legacyCache = false;
+
 
 	void startTag(const string& aName, StringPairList& aAttribs, bool aSimple) override {
 		if(compare(aName, SDIRECTORY) == 0) {
@@ -232,27 +243,26 @@ bool ShareManager::loadCache(const ProgressFunction& progressF) noexcept {
 	AppUtil::migrate(AppUtil::getPath(AppUtil::PATH_SHARECACHE), "ShareCache_*");
 
 	LoaderList cacheLoaders;
+	StringSet cachePaths;
 
 	// Create loaders
 	for (const auto& [rootPath, rootDir] : tree->getRootPathsUnsafe()) {
-		try {
-			auto loader = std::make_shared<ShareLoader>(rootPath, rootDir, *tree->getBloom());
-			cacheLoaders.emplace_back(loader);
-		} catch (const FileException&) {
+		const auto& root = rootDir->getRoot();
+		if (!PathUtil::fileExists(root->getCacheBinaryPath()) && !PathUtil::fileExists(root->getCacheXmlPath())) {
 			log(STRING_F(SHARE_CACHE_FILE_MISSING, rootPath), LogMessage::SEV_ERROR);
 			return false;
 		}
+
+		cacheLoaders.push_back(std::make_shared<ShareLoader>(rootPath, rootDir, *tree->getBloom()));
+		cachePaths.insert(root->getCacheBinaryPath());
+		cachePaths.insert(root->getCacheXmlPath());
 	}
 
 	{
 		// Remove obsolete cache files
 		auto fileList = File::findFiles(AppUtil::getPath(AppUtil::PATH_SHARECACHE), "ShareCache_*", File::TYPE_FILE);
 		for (const auto& p: fileList) {
-			auto rp = find_if(cacheLoaders, [&p](const ShareLoaderPtr& aLoader) {
-				return p == aLoader->xmlPath;
-			});
-
-			if (rp == cacheLoaders.end()) {
+			if (!cachePaths.contains(p)) {
 				File::deleteFile(p);
 			}
 		}
@@ -265,25 +275,45 @@ bool ShareManager::loadCache(const ProgressFunction& progressF) noexcept {
 	{
 		const auto dirCount = cacheLoaders.size();
 
-		//ll.sort(SimpleXMLReader::ThreadedCallBack::SizeSort());
-
 		// Parse the actual cache files
 		atomic<long> loaded(0);
-		bool hasFailedCaches = false;
+		atomic<bool> hasFailedCaches = false;
 
 		try {
-			parallel_for_each(cacheLoaders.begin(), cacheLoaders.end(), [&](const ShareLoaderPtr& i) {
-				//log("Thread: " + Util::toString(::GetCurrentThreadId()) + "Size " + Util::toString(loader.size), LogMessage::SEV_INFO);
-				auto& loader = *i;
-				try {
-					SimpleXMLReader(&loader).parse(*loader.file);
-				} catch (SimpleXMLException& e) {
-					log(STRING_F(LOAD_FAILED_X, loader.xmlPath % e.getError()), LogMessage::SEV_ERROR);
-					hasFailedCaches = true;
-					File::deleteFile(loader.xmlPath);
-				} catch (...) {
-					hasFailedCaches = true;
-					File::deleteFile(loader.xmlPath);
+			parallel_for_each(cacheLoaders.begin(), cacheLoaders.end(), [&](ShareLoaderPtr& i) {
+				const auto binaryPath = i->optionalOldDirectory->getRoot()->getCacheBinaryPath();
+				const auto xmlPath = i->optionalOldDirectory->getRoot()->getCacheXmlPath();
+
+				auto loadXml = [&] {
+					try {
+						i->loadXml();
+					} catch (const Exception& e) {
+						log(STRING_F(LOAD_FAILED_X, xmlPath % e.getError()), LogMessage::SEV_ERROR);
+						hasFailedCaches = true;
+						File::deleteFile(xmlPath);
+					} catch (...) {
+						hasFailedCaches = true;
+						File::deleteFile(xmlPath);
+					}
+				};
+
+				if (PathUtil::fileExists(binaryPath)) {
+					try {
+						ShareBinaryCache::load(binaryPath, *i);
+					} catch (const Exception& e) {
+						log(STRING_F(LOAD_FAILED_X, binaryPath % e.getError()), LogMessage::SEV_ERROR);
+						File::deleteFile(binaryPath);
+
+						if (PathUtil::fileExists(xmlPath)) {
+							// Start over from the legacy cache
+							i = std::make_shared<ShareLoader>(i->path, i->optionalOldDirectory, *tree->getBloom());
+							loadXml();
+						} else {
+							hasFailedCaches = true;
+						}
+					}
+				} else {
+					loadXml();
 				}
 
 				if (progressF) {
@@ -304,6 +334,11 @@ bool ShareManager::loadCache(const ProgressFunction& progressF) noexcept {
 	// Apply the changes
 	ShareRefreshStats stats;
 	for (const auto& l : cacheLoaders) {
+		if (l->legacyCache) {
+			// Convert on the next save
+			l->newDirectory->getRoot()->setCacheDirty(true);
+		}
+
 		tree->applyRefreshChanges(*l, nullptr);
 		stats.merge(l->stats);
 	}
@@ -512,6 +547,10 @@ void ShareManager::search(SearchResultList& results_, ShareSearch& aSearch) {
 	tree->searchText(results_, aSearch, searchCounters);
 }
 
+void ShareManager::onCachedSearch(const ShareSearch& aSearch, bool aResponded) noexcept {
+	searchCounters.onCachedSearch(aSearch, aResponded);
+}
+
 MemoryInputStream* ShareManager::getTree(const string& aVirtualFile, ProfileToken aProfile) const noexcept {
 	TigerTree tigerTree;
 	if (aVirtualFile.compare(0, 4, "TTH/") == 0) {
@@ -619,19 +658,70 @@ optional<ShareItemStats> ShareManager::getShareItemStats() const noexcept {
 }
 
 ShareSearchStats ShareManager::getSearchMatchingStats() const noexcept {
-	return searchCounters.toStats();
+	auto stats = searchCounters.toStats();
+
+	auto bloomStats = tree->getBloomStats();
+	stats.bloomSize = bloomStats.bits / 8;
+	stats.bloomFillRatio = Util::countAverage(bloomStats.setBits, bloomStats.bits);
+	stats.bloomFalsePositiveRate = bloomStats.falsePositiveRate;
+
+	stats.searchIndexSize = tree->getSearchIndexSize();
+
+	auto readLockStats = tree->getCS().getSharedStats();
+	stats.readLocks = readLockStats.locks;
+	stats.contendedReadLocks = readLockStats.contendedLocks;
+	stats.averageReadLockWaitUs = Util::countAverage(readLockStats.totalWaitUs, readLockStats.contendedLocks);
+	stats.maxReadLockWaitUs = readLockStats.maxWaitUs;
+
+	auto writeLockStats = tree->getCS().getExclusiveStats();
+	stats.writeLocks = writeLockStats.locks;
+	stats.contendedWriteLocks = writeLockStats.contendedLocks;
+	stats.averageWriteLockWaitUs = Util::countAverage(writeLockStats.totalWaitUs, writeLockStats.contendedLocks);
+	stats.maxWriteLockWaitUs = writeLockStats.maxWaitUs;
+	return stats;
 }
 
 
 // REFRESH
-ShareManager::RefreshTaskHandler::ShareBuilder::ShareBuilder(const string& aPath, const ShareDirectory::Ptr& aOldRoot, time_t aLastWrite, ShareBloom& bloom_, ShareManager* aSm) :
-	sm(*aSm), ShareRefreshInfo(aPath, aOldRoot, aLastWrite, bloom_) {
+ShareManager::DeviceScanLimiter::Slot::Slot(DeviceScanLimiter& aLimiter, const string& aPath) noexcept : semaphore(aLimiter.getDevice(aPath)) {
+	semaphore.wait();
+}
+
+ShareManager::DeviceScanLimiter::Slot::~Slot() noexcept {
+	semaphore.signal();
+}
+
+Semaphore& ShareManager::DeviceScanLimiter::getDevice(const string& aPath) noexcept {
+	auto deviceId = File::getDeviceId(aPath);
+
+	Lock l(cs);
+	auto& device = devices[deviceId];
+	if (!device) {
+		device = make_unique<Semaphore>();
+
+		auto slots = File::isRotationalDevice(deviceId) ? ROTATIONAL_SLOTS : SOLID_STATE_SLOTS;
+		for (auto i = 0; i < slots; ++i) {
+			device->signal();
+		}
+	}
+
+	return *device;
+}
+
+ShareManager::RefreshTaskHandler::ShareBuilder::ShareBuilder(const string& aPath, const ShareDirectory::Ptr& aOldRoot, time_t aLastWrite, ShareBloom& bloom_, ShareManager* aSm, DeviceScanLimiter& aScanLimiter) :
+	ShareRefreshInfo(aPath, aOldRoot, aLastWrite, bloom_), sm(*aSm), scanLimiter(aScanLimiter) {
 
 }
 
-bool ShareManager::RefreshTaskHandler::ShareBuilder::buildTree(const bool& aStopping) noexcept {
+ShareManager::RefreshTaskHandler::ShareBuilder::ScannedDirectory::ScannedDirectory(DualString&& aName, time_t aLastWrite, const ShareDirectory::Ptr& aOldDirectory) noexcept :
+	name(std::move(aName)), lastWrite(aLastWrite), oldDirectory(aOldDirectory) {
+
+}
+
+bool ShareManager::RefreshTaskHandler::ShareBuilder::buildTree(const bool& aStopping, bool aMultithreaded) noexcept {
 	try {
-		buildTree(path, Text::toLower(path), newDirectory, optionalOldDirectory, aStopping);
+		ScannedDirectory root(DualString(newDirectory->getRealName().getNormal()), newDirectory->getLastWrite(), optionalOldDirectory);
+		buildDirectory(root, newDirectory, path, Text::toLower(path), aStopping, aMultithreaded);
 	} catch (const std::bad_alloc&) {
 		log(STRING_F(DIR_REFRESH_FAILED, path % STRING(OUT_OF_MEMORY)), LogMessage::SEV_ERROR);
 		return false;
@@ -664,92 +754,168 @@ bool ShareManager::RefreshTaskHandler::ShareBuilder::validateFileItem(const File
 	return true;
 }
 
-void ShareManager::RefreshTaskHandler::ShareBuilder::buildTree(const string& aPath, const string& aPathLower, const ShareDirectory::Ptr& aParent, const ShareDirectory::Ptr& aOldParent, const bool& aStopping) {
-	ErrorCollector errors;
-	FileFindIter end;
-	for(FileFindIter i(aPath, "*"); i != end && !aStopping; ++i) {
-		const auto name = i->getFileName();
-		if(name.empty()) {
-			return;
+void ShareManager::RefreshTaskHandler::ShareBuilder::checkFiles(ScannedDirectory& aDirectory, const string& aPath, const string& aPathLower) {
+	HashedFileCheckList checkList;
+	checkList.reserve(aDirectory.files.size());
+	for (const auto& f: aDirectory.files) {
+		checkList.emplace_back(aPath + f.name.getNormal(), aPathLower + f.name.getLower(), f.info);
+	}
+
+	HashManager::getInstance()->checkTTHs(checkList);
+
+	for (size_t i = 0; i < checkList.size(); ++i) {
+		auto& file = aDirectory.files[i];
+		file.info = checkList[i].info;
+		file.found = checkList[i].found;
+		if (!file.found) {
+			aDirectory.stats.hashSize += file.info.getSize();
 		}
+	}
+}
+
+void ShareManager::RefreshTaskHandler::ShareBuilder::buildDirectory(ScannedDirectory& aScanned, const ShareDirectory::Ptr& aDirectory, const string& aPath, const string& aPathLower, const bool& aStopping, bool aMultithreaded) {
+	scanDirectoryContent(aScanned, aPath, aPathLower, aStopping);
+	if (aStopping) {
+		return;
+	}
+
+	stats.merge(aScanned.stats);
+	addScannedFiles(aScanned, aDirectory);
+
+	ranges::sort(aScanned.directories, [](const ScannedDirectory::Ptr& a, const ScannedDirectory::Ptr& b) { return a->name.getLower() < b->name.getLower(); });
+
+	if (!aMultithreaded || aScanned.directories.size() <= 1) {
+		for (auto& child: aScanned.directories) {
+			// Release the memory after the subtree has been added
+			auto scannedDir = std::move(child);
 
-		const auto isDirectory = i->isDirectory();
-		if (!isDirectory) {
-			errors.increaseTotal();
+			auto curPath = aPath + scannedDir->name.getNormal() + PATH_SEPARATOR;
+			auto curPathLower = aPathLower + scannedDir->name.getLower() + PATH_SEPARATOR;
+			auto curDir = ShareDirectory::createNormal(std::move(scannedDir->name), aDirectory, scannedDir->lastWrite, *this);
+			if (!curDir) {
+				continue;
+			}
+
+			buildDirectory(*scannedDir, curDir, curPath, curPathLower, aStopping, aMultithreaded);
+			if (aStopping) {
+				return;
+			}
+
+			onScannedDirectoryAdded(*scannedDir, curDir);
 		}
 
-		DualString dualName(name);
-		auto curPath = aPath + name + (isDirectory ? PATH_SEPARATOR_STR : Util::emptyString);
-		auto curPathLower = aPathLower + dualName.getLower() + (isDirectory ? PATH_SEPARATOR_STR : Util::emptyString);
+		return;
+	}
+
+	// The subtrees need to be kept in memory until the whole batch has been listed
+	auto scanChild = [&](const ScannedDirectory::Ptr& aChild) {
+		if (!aStopping) {
+			scanDirectory(*aChild, aPath + aChild->name.getNormal() + PATH_SEPARATOR, aPathLower + aChild->name.getLower() + PATH_SEPARATOR, aStopping, aMultithreaded);
+		}
+	};
 
-		if (isDirectory) {
-			// Check whether it's shared already
-			ShareDirectory::Ptr oldDir = nullptr;
-			if (aOldParent) {
-				RLock l(sm.tree->getCS());
-				oldDir = aOldParent->findDirectoryLower(dualName.getLower());
+	for (auto batchStart = aScanned.directories.begin(); batchStart != aScanned.directories.end();) {
+		auto batchEnd = batchStart + min(PARALLEL_SCAN_BATCH_SIZE, static_cast<size_t>(distance(batchStart, aScanned.directories.end())));
+		parallel_for_each(batchStart, batchEnd, scanChild);
+		if (aStopping) {
+			return;
+		}
+
+		for (; batchStart != batchEnd; ++batchStart) {
+			auto scannedDir = std::move(*batchStart);
+			auto curDir = ShareDirectory::createNormal(std::move(scannedDir->name), aDirectory, scannedDir->lastWrite, *this);
+			if (!curDir) {
+				continue;
 			}
 
-			auto isNew = !oldDir;
+			addScannedContent(*scannedDir, curDir);
+			onScannedDirectoryAdded(*scannedDir, curDir);
+		}
+	}
+}
 
-			// Validations
-			{
-				auto newParent = !aOldParent;
-				if (!validateFileItem(*i, curPath, isNew, newParent, errors)) {
-					stats.skippedDirectoryCount++;
-					continue;
-				}
+void ShareManager::RefreshTaskHandler::ShareBuilder::scanDirectory(ScannedDirectory& aDirectory, const string& aPath, const string& aPathLower, const bool& aStopping, bool aMultithreaded) {
+	scanDirectoryContent(aDirectory, aPath, aPathLower, aStopping);
+	if (aStopping) {
+		return;
+	}
+
+	// Children
+	auto scanChild = [&](const ScannedDirectory::Ptr& aChild) {
+		if (!aStopping) {
+			scanDirectory(*aChild, aPath + aChild->name.getNormal() + PATH_SEPARATOR, aPathLower + aChild->name.getLower() + PATH_SEPARATOR, aStopping, aMultithreaded);
+		}
+	};
+
+	if (aMultithreaded && aDirectory.directories.size() > 1) {
+		parallel_for_each(aDirectory.directories.begin(), aDirectory.directories.end(), scanChild);
+	} else {
+		ranges::for_each(aDirectory.directories, scanChild);
+	}
+}
+
+void ShareManager::RefreshTaskHandler::ShareBuilder::scanDirectoryContent(ScannedDirectory& aDirectory, const string& aPath, const string& aPathLower, const bool& aStopping) {
+	const auto& oldParent = aDirectory.oldDirectory;
+	const auto newParent = !oldParent;
+
+	ErrorCollector errors;
 
+	{
+		DeviceScanLimiter::Slot slot(scanLimiter, aPath);
+
+		FileFindIter end;
+		for (FileFindIter i(aPath, "*"); i != end && !aStopping; ++i) {
+			const auto name = i->getFileName();
+			if (name.empty()) {
+				break;
 			}
 
-			// Add it
-			auto curDir = ShareDirectory::createNormal(std::move(dualName), aParent, i->getLastWriteTime(), *this);
-			if (curDir) {
-				buildTree(curPath, curPathLower, curDir, oldDir, aStopping);
-				if (checkContent(curDir)) {
-					if (isNew) {
-						stats.newDirectoryCount++;
-					} else {
-						stats.existingDirectoryCount++;
-					}
-				}
+			const auto isDirectory = i->isDirectory();
+			if (!isDirectory) {
+				errors.increaseTotal();
 			}
-		} else {
-			// Not a directory, assume it's a file...
 
-			{
+			DualString dualName(name);
+			auto curPath = aPath + name + (isDirectory ? PATH_SEPARATOR_STR : Util::emptyString);
+
+			if (isDirectory) {
 				// Check whether it's shared already
-				auto isNew = !aOldParent;
-				if (aOldParent) {
-					RLock l(sm.tree->getCS());
-					isNew = !aOldParent->findFileLower(dualName.getLower());
+				ShareDirectory::Ptr oldDir = nullptr;
+				if (oldParent) {
+					TimedRLock l(sm.tree->getCS());
+					oldDir = oldParent->findDirectoryLower(dualName.getLower());
+				}
+
+				// Validations
+				if (!validateFileItem(*i, curPath, !oldDir, newParent, errors)) {
+					aDirectory.stats.skippedDirectoryCount++;
+					continue;
 				}
 
+				aDirectory.directories.push_back(make_unique<ScannedDirectory>(std::move(dualName), i->getLastWriteTime(), oldDir));
+			} else {
+				// Not a directory, assume it's a file...
+
+				// Check whether it's shared already
+				auto isNew = newParent;
+				if (oldParent) {
+					TimedRLock l(sm.tree->getCS());
+					isNew = !oldParent->findFileLower(dualName.getLower());
+				}
 
 				// Validations
-				auto newParent = !aOldParent;
 				if (!validateFileItem(*i, curPath, isNew, newParent, errors)) {
-					stats.skippedFileCount++;
+					aDirectory.stats.skippedFileCount++;
 					continue;
 				}
 
 				if (isNew) {
-					stats.newFileCount++;
+					aDirectory.stats.newFileCount++;
 				} else {
-					stats.existingFileCount++;
+					aDirectory.stats.existingFileCount++;
 				}
-			}
 
-			// Add it
-			auto size = i->getSize();
-			try {
-				HashedFile fi(i->getLastWriteTime(), size);
-				if(HashManager::getInstance()->checkTTH(aPathLower + dualName.getLower(), aPath + name, fi)) {
-					aParent->addFile(std::move(dualName), fi, *this, stats.addedSize);
-				} else {
-					stats.hashSize += size;
-				}
-			} catch(const HashException&) {
+				aDirectory.files.push_back({ std::move(dualName), HashedFile(i->getLastWriteTime(), i->getSize()) });
 			}
 		}
 	}
@@ -758,6 +924,60 @@ void ShareManager::RefreshTaskHandler::ShareBuilder::buildTree(const string& aPa
 	if (!msg.empty()) {
 		log(STRING_F(SHARE_FILES_BLOCKED, aPath % msg), LogMessage::SEV_INFO);
 	}
+
+	if (aStopping) {
+		return;
+	}
+
+	if (!aDirectory.files.empty()) {
+		checkFiles(aDirectory, aPath, aPathLower);
+	}
+}
+
+void ShareManager::RefreshTaskHandler::ShareBuilder::addScannedFiles(ScannedDirectory& aScanned, const ShareDirectory::Ptr& aDirectory) noexcept {
+	// Files (sorted so that the resulting indices won't depend on the disk or scheduling order)
+	vector<size_t> fileOrder(aScanned.files.size());
+	iota(fileOrder.begin(), fileOrder.end(), 0);
+	ranges::sort(fileOrder, [&aScanned](size_t a, size_t b) { return aScanned.files[a].name.getLower() < aScanned.files[b].name.getLower(); });
+
+	for (auto i: fileOrder) {
+		auto& file = aScanned.files[i];
+		if (file.found) {
+			aDirectory->addFile(std::move(file.name), file.info, *this, stats.addedSize);
+		}
+	}
+
+	aScanned.files.clear();
+	aScanned.files.shrink_to_fit();
+}
+
+void ShareManager::RefreshTaskHandler::ShareBuilder::addScannedContent(ScannedDirectory& aScanned, const ShareDirectory::Ptr& aDirectory) noexcept {
+	stats.merge(aScanned.stats);
+	addScannedFiles(aScanned, aDirectory);
+
+	// Directories
+	ranges::sort(aScanned.directories, [](const ScannedDirectory::Ptr& a, const ScannedDirectory::Ptr& b) { return a->name.getLower() < b->name.getLower(); });
+	for (auto& child: aScanned.directories) {
+		// Release the memory after the subtree has been added
+		auto scannedDir = std::move(child);
+		auto curDir = ShareDirectory::createNormal(std::move(scannedDir->name), aDirectory, scannedDir->lastWrite, *this);
+		if (!curDir) {
+			continue;
+		}
+
+		addScannedContent(*scannedDir, curDir);
+		onScannedDirectoryAdded(*scannedDir, curDir);
+	}
+}
+
+void ShareManager::RefreshTaskHandler::ShareBuilder::onScannedDirectoryAdded(const ScannedDirectory& aScanned, const ShareDirectory::Ptr& aDirectory) noexcept {
+	if (checkContent(aDirectory)) {
+		if (!aScanned.oldDirectory) {
+			stats.newDirectoryCount++;
+		} else {
+			stats.existingDirectoryCount++;
+		}
+	}
 }
 
 optional<RefreshTaskQueueInfo> ShareManager::refreshVirtualName(const string& aVirtualName, ShareRefreshPriority aPriority) noexcept {
@@ -818,15 +1038,15 @@ bool ShareManager::handleRefreshPath(const string& aRefreshPath, const ShareRefr
 	ShareDirectory::Ptr optionalOldDirectory = nullptr;
 
 	{
-		RLock l(tree->getCS());
+		TimedRLock l(tree->getCS());
 		optionalOldDirectory = tree->findDirectoryUnsafe(aRefreshPath);
 	}
 
-	auto ri = RefreshTaskHandler::ShareBuilder(aRefreshPath, optionalOldDirectory, File::getLastModified(aRefreshPath), *bloom_, this);
+	auto ri = RefreshTaskHandler::ShareBuilder(aRefreshPath, optionalOldDirectory, File::getLastModified(aRefreshPath), *bloom_, this, scanLimiter);
 	setRefreshState(ri.path, ShareRootRefreshState::STATE_RUNNING, false, aTask.token);
 
 	// Build the tree
-	auto completed = ri.buildTree(aTask.canceled);
+	auto completed = ri.buildTree(aTask.canceled, aTask.isMultithreaded());
 
 	// Apply the changes
 	if (completed) {
@@ -1035,40 +1255,28 @@ FileList* ShareManager::generateXmlList(ProfileToken aProfile, bool forced /*fal
 		throw ShareException(UserConnection::FILE_NOT_AVAILABLE);
 	}
 
-	// The filelist generation code currently causes the filelist to get corrupted if the size is over 1 gigabytes, which has happened with a share of over 30 million files
-	// Uploading filelists of that size would get problematic, as loading them would most likely crash all 32 bit clients
-	// Limit the maximum file count to 20 million, to be somewhat safe
-	if (shareProfile->getSharedFiles() > 20000000) {
-		throw ShareException("The size of the filelist exceeds the maximum limit of 1 GB / 20 million files; please use a partial list instead");
-	}
-
 	auto fl = shareProfile->getProfileList();
 
 	{
 		Lock lFl(fl->cs);
 		if (fl->allowGenerateNew(forced)) {
-			auto tmpName = fl->getFileName().substr(0, fl->getFileName().length() - 4);
 			try {
 				{
-					File f(tmpName, File::RW, File::TRUNCATE | File::CREATE, File::BUFFER_SEQUENTIAL, false);
-
-					tree->toFilelist(f, ADC_ROOT_STR, aProfile, true, duplicateFilelistFileLogger);
-
-					fl->setXmlListLen(f.getSize());
-
+					// The XML is hashed and compressed while it's being generated (unchanged roots are read from the cache)
 					File bz(fl->getFileName(), File::WRITE, File::TRUNCATE | File::CREATE, File::BUFFER_SEQUENTIAL, false);
 					// We don't care about the leaves...
 					CalcOutputStream<TTFilter<1024 * 1024 * 1024>, false> bzTree(&bz);
-					FilteredOutputStream<BZFilter, false> bzipper(&bzTree);
-					CalcOutputStream<TTFilter<1024 * 1024 * 1024>, false> newXmlFile(&bzipper);
+					ParallelBZOutputStream bzipper(&bzTree);
+					TigerTree xmlTree;
 
-					newXmlFile.write(f.read());
-					newXmlFile.flushBuffers(false);
+					tree->toFullFilelist(bzipper, xmlTree, aProfile, duplicateFilelistFileLogger);
+					bzipper.flushBuffers(false);
 
-					newXmlFile.getFilter().getTree().finalize();
+					xmlTree.finalize();
 					bzTree.getFilter().getTree().finalize();
 
-					fl->setXmlRoot(newXmlFile.getFilter().getTree().getRoot());
+					fl->setXmlListLen(xmlTree.getFileSize());
+					fl->setXmlRoot(xmlTree.getRoot());
 					fl->setBzXmlRoot(bzTree.getFilter().getTree().getRoot());
 				}
 
@@ -1084,8 +1292,6 @@ FileList* ShareManager::generateXmlList(ProfileToken aProfile, bool forced /*fal
 					throw ShareException(UserConnection::FILE_NOT_AVAILABLE);
 				}
 			}
-
-			File::deleteFile(tmpName);
 		}
 	}
 	return fl;
@@ -1135,7 +1341,7 @@ void ShareManager::saveShareCache(const ProgressFunction& progressF /*nullptr*/)
 	if (progressF)
 		progressF(0);
 
-	int cur = 0;
+	atomic<int> cur = 0;
 	ShareDirectory::List dirtyDirs;
 
 	{
@@ -1145,19 +1351,16 @@ void ShareManager::saveShareCache(const ProgressFunction& progressF /*nullptr*/)
 
 		try {
 			parallel_for_each(dirtyDirs.begin(), dirtyDirs.end(), [&](const ShareDirectory::Ptr& d) {
-				string path = d->getRoot()->getCacheXmlPath();
+				string path = d->getRoot()->getCacheBinaryPath();
 				try {
-					{
-						string indent, tmp;
-
-						//create a backup first in case we get interrupted on creation.
-						File ff(path + ".tmp", File::WRITE, File::TRUNCATE | File::CREATE);
-						BufferedOutputStream<false> xmlFile(&ff);
-						tree->toCache(xmlFile, d);
-					}
+					//create a backup first in case we get interrupted on creation.
+					tree->toCache(path + ".tmp", d);
 
 					File::deleteFile(path);
 					File::renameFile(path + ".tmp", path);
+
+					// Converted
+					File::deleteFile(d->getRoot()->getCacheXmlPath());
 				} catch (Exception& e) {
 					log(STRING_F(SAVE_FAILED_X, path % e.getError()), LogMessage::SEV_WARNING);
 				}
@@ -1222,7 +1425,7 @@ void ShareManager::validatePathHooked(const string& aRealPath, bool aSkipQueueCh
 	auto isFileShared = false;
 
 	{
-		RLock l(tree->getCS());
+		TimedRLock l(tree->getCS());
 		baseDirectory = tree->findDirectoryUnsafe(!isDirectoryPath ? PathUtil::getFilePath(aRealPath) : aRealPath, tokens);
 		if (!baseDirectory) {
 			throw ShareException(STRING(DIRECTORY_NOT_FOUND));
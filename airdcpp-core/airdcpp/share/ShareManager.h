@@ -20,12 +20,15 @@
 #define DCPLUSPLUS_DCPP_SHARE_MANAGER_H
 
 
+#include <airdcpp/hash/HashedFile.h>
 #include <airdcpp/hash/HashManagerListener.h>
 #include <airdcpp/settings/SettingsManagerListener.h>
 #include <airdcpp/share/ShareManagerListener.h>
 #include <airdcpp/core/timer/TimerManagerListener.h>
 
 #include <airdcpp/core/types/DupeType.h>
+#include <airdcpp/core/thread/CriticalSection.h>
+#include <airdcpp/core/thread/Semaphore.h>
 #include <airdcpp/core/classes/Exception.h>
 #include <airdcpp/share/UploadFileProvider.h>
 #include <airdcpp/message/Message.h>
@@ -124,6 +127,9 @@ public:
 	// Throws ShareException in case an invalid path is provided
 	void search(SearchResultList& l, ShareSearch& aSearch);
 
+	// Updates the search statistics for a text search that was answered from the incoming search cache
+	void onCachedSearch(const ShareSearch& aSearch, bool aResponded) noexcept;
+
 	// Mostly for dupe check with size comparison (partial/exact dupe)
 	// You may also give a path in NMDC format and the relevant 
 	// directory (+ possible subdirectories) are detected automatically
@@ -244,6 +250,31 @@ private:
 	
 	bool shareCacheSaving = false;
 
+	// Limits the number of directories that are being listed concurrently from the same device
+	class DeviceScanLimiter {
+	public:
+		class Slot {
+		public:
+			Slot(DeviceScanLimiter& aLimiter, const string& aPath) noexcept;
+			~Slot() noexcept;
+
+			Slot(const Slot&) = delete;
+			Slot& operator=(const Slot&) = delete;
+		private:
+			Semaphore& semaphore;
+		};
+	private:
+		Semaphore& getDevice(const string& aPath) noexcept;
+
+		static const int ROTATIONAL_SLOTS = 2;
+		static const int SOLID_STATE_SLOTS = 8;
+
+		CriticalSection cs;
+		unordered_map<int64_t, unique_ptr<Semaphore>> devices;
+	};
+
+	DeviceScanLimiter scanLimiter;
+
 	struct RefreshTaskHandler : public ShareTasksManager::RefreshTaskHandler {
 		using PathRefreshF = function<bool (const string &, const ShareRefreshTask &, ShareRefreshStats &, ShareBloom *, ProfileTokenSet &)>;
 		using CompletionF = function<void (bool, const ShareRefreshTask &, const ShareRefreshStats &, ShareBloom *, ProfileTokenSet &)>;
@@ -262,16 +293,66 @@ private:
 
 		class ShareBuilder : public ShareRefreshInfo {
 		public:
-			ShareBuilder(const string& aPath, const ShareDirectory::Ptr& aOldRoot, time_t aLastWrite, ShareBloom& bloom_, ShareManager* sm);
+			ShareBuilder(const string& aPath, const ShareDirectory::Ptr& aOldRoot, time_t aLastWrite, ShareBloom& bloom_, ShareManager* sm, DeviceScanLimiter& aScanLimiter);
+
+			// Builds a new share tree from the path
+			// The directories are listed in parallel when multithreading is enabled but the tree is always built in sorted order
+			bool buildTree(const bool& aStopping, bool aMultithreaded) noexcept;
 
-			// Recursive function for building a new share tree from a path
-			bool buildTree(const bool& aStopping) noexcept;
+			// Maximum number of sibling directories that are scanned to memory at once when multithreading is enabled
+			static const size_t PARALLEL_SCAN_BATCH_SIZE = 8;
 		private:
-			void buildTree(const string& aPath, const string& aPathLower, const ShareDirectory::Ptr& aCurrentDirectory, const ShareDirectory::Ptr& aOldDirectory, const bool& aStopping);
+			// Content of a directory that has been read from the disk but not added in the tree yet
+			struct ScannedDirectory {
+				using Ptr = unique_ptr<ScannedDirectory>;
+
+				ScannedDirectory(DualString&& aName, time_t aLastWrite, const ShareDirectory::Ptr& aOldDirectory) noexcept;
+
+				DualString name;
+				const time_t lastWrite;
+				const ShareDirectory::Ptr oldDirectory;
+
+				struct File {
+					DualString name;
+					HashedFile info;
+					bool found = false;
+				};
+
+				// The full paths are only created for the hash lookup
+				vector<File> files;
+
+				vector<Ptr> directories;
+
+				// Statistics of the direct children
+				ShareRefreshStats stats;
+			};
+
+			// Recursive function that scans the directories and adds them in the new tree one by one
+			// Only the subdirectories that are scanned in parallel are kept in memory before adding them
+			void buildDirectory(ScannedDirectory& aScanned, const ShareDirectory::Ptr& aDirectory, const string& aPath, const string& aPathLower, const bool& aStopping, bool aMultithreaded);
+
+			// Recursive function for reading the directory content from the disk
+			void scanDirectory(ScannedDirectory& aDirectory, const string& aPath, const string& aPathLower, const bool& aStopping, bool aMultithreaded);
+
+			// Reads the direct children of the directory from the disk
+			void scanDirectoryContent(ScannedDirectory& aDirectory, const string& aPath, const string& aPathLower, const bool& aStopping);
+
+			// Gets the hash information for all files of the directory at once (files that aren't current will be queued for hashing)
+			static void checkFiles(ScannedDirectory& aDirectory, const string& aPath, const string& aPathLower);
+
+			// Recursive function for adding the scanned content in the new tree
+			void addScannedContent(ScannedDirectory& aScanned, const ShareDirectory::Ptr& aDirectory) noexcept;
+
+			// Adds the scanned files of the directory in the tree and releases them
+			void addScannedFiles(ScannedDirectory& aScanned, const ShareDirectory::Ptr& aDirectory) noexcept;
+
+			// Updates the statistics after all content of the subdirectory has been added
+			void onScannedDirectoryAdded(const ScannedDirectory& aScanned, const ShareDirectory::Ptr& aDirectory) noexcept;
 
 			bool validateFileItem(const FileItemInfoBase& aFileItem, const string& aPath, bool aIsNew, bool aNewParent, ErrorCollector& aErrorCollector) noexcept;
 
 			const ShareManager& sm;
+			DeviceScanLimiter& scanLimiter;
 		};
 
 		using ShareBuilderPtr = shared_ptr<ShareBuilder>;
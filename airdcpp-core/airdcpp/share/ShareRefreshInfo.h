@@ -55,10 +55,16 @@ public:
 	string path;
 
 	bool checkContent(const ShareDirectory::Ptr& aDirectory) noexcept;
-	void applyRefreshChanges(ShareDirectory::MultiMap& lowerDirNameMap_, ShareDirectory::Map& rootPaths_, ShareDirectory::File::TTHMap& tthIndex_, int64_t& sharedBytes_, ProfileTokenSet* dirtyProfiles) noexcept;
+	// Merges the new content in the indices of the main tree
+	void applyRefreshChanges(ShareTreeMaps& maps_, int64_t& sharedBytes_, ProfileTokenSet* dirtyProfiles) noexcept;
 
 	ShareRefreshInfo(ShareRefreshInfo&) = delete;
 	ShareRefreshInfo& operator=(ShareRefreshInfo&) = delete;
+private:
+	// Names are added in a separate filter while building the tree so that concurrent refreshes won't
+	// touch the shared filter (merged in the target when the changes are applied)
+	ShareBloom bloom;
+	ShareBloom& targetBloom;
 };
 
 }
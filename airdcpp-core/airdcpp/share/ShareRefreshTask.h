@@ -68,6 +68,9 @@ struct ShareRefreshTask : public Task {
 	const ShareRefreshType type;
 	const ShareRefreshPriority priority;
 
+	// Whether the refresh paths (and their content) should be scanned in parallel
+	bool isMultithreaded() const noexcept;
+
 	bool canceled = false;
 	bool running = false;
 };
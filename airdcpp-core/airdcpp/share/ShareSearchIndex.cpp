@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "stdinc.h"
+#include <airdcpp/share/ShareSearchIndex.h>
+
+#include <airdcpp/core/header/debug.h>
+
+namespace dcpp {
+
+namespace {
+
+const string& getNameLower(const ShareDirectory& aDirectory) noexcept {
+	return aDirectory.getVirtualNameLower();
+}
+
+const string& getNameLower(const ShareDirectory::File& aFile) noexcept {
+	return aFile.getName().getLower();
+}
+
+}
+
+ShareSearchIndex::TrigramList ShareSearchIndex::toTrigrams(const string& aNameLower) noexcept {
+	TrigramList ret;
+	if (aNameLower.size() < MIN_PATTERN_LENGTH) {
+		return ret;
+	}
+
+	ret.reserve(aNameLower.size() - 2);
+
+	auto p = reinterpret_cast<const uint8_t*>(aNameLower.data());
+	for (size_t i = 0; i + 2 < aNameLower.size(); ++i) {
+		ret.push_back((static_cast<Trigram>(p[i]) << 16) | (static_cast<Trigram>(p[i + 1]) << 8) | p[i + 2]);
+	}
+
+	ranges::sort(ret);
+	ret.erase(unique(ret.begin(), ret.end()), ret.end());
+	return ret;
+}
+
+void ShareSearchIndex::addDirectory(ShareDirectory& aDirectory) noexcept {
+	directories.add(aDirectory, aDirectory.getVirtualNameLower());
+}
+
+void ShareSearchIndex::removeDirectory(ShareDirectory& aDirectory) noexcept {
+	directories.remove(aDirectory);
+}
+
+void ShareSearchIndex::addFile(ShareDirectory::File& aFile) noexcept {
+	files.add(aFile, aFile.getName().getLower());
+}
+
+void ShareSearchIndex::removeFile(ShareDirectory::File& aFile) noexcept {
+	files.remove(aFile);
+}
+
+void ShareSearchIndex::merge(ShareSearchIndex& aOther) noexcept {
+	directories.merge(aOther.directories);
+	files.merge(aOther.files);
+}
+
+optional<size_t> ShareSearchIndex::estimateMatches(const string& aPatternLower) const noexcept {
+	if (aPatternLower.size() < MIN_PATTERN_LENGTH) {
+		return nullopt;
+	}
+
+	auto trigrams = toTrigrams(aPatternLower);
+	return directories.estimate(trigrams) + files.estimate(trigrams);
+}
+
+void ShareSearchIndex::findDirectories(const string& aPatternLower, vector<const ShareDirectory*>& directories_) const noexcept {
+	dcassert(aPatternLower.size() >= MIN_PATTERN_LENGTH);
+	directories.find(aPatternLower, toTrigrams(aPatternLower), directories_);
+}
+
+void ShareSearchIndex::findFiles(const string& aPatternLower, vector<const ShareDirectory::File*>& files_) const noexcept {
+	dcassert(aPatternLower.size() >= MIN_PATTERN_LENGTH);
+	files.find(aPatternLower, toTrigrams(aPatternLower), files_);
+}
+
+
+template<class T>
+void ShareSearchIndex::NameIndex<T>::add(T& aItem, const string& aNameLower) noexcept {
+	dcassert(aItem.searchIndexId == 0);
+
+	items.push_back(&aItem);
+	auto id = static_cast<ItemId>(items.size());
+	aItem.searchIndexId = id;
+
+	for (auto trigram : toTrigrams(aNameLower)) {
+		postings[trigram].push_back(id);
+	}
+}
+
+template<class T>
+void ShareSearchIndex::NameIndex<T>::remove(T& aItem) noexcept {
+	if (aItem.searchIndexId == 0) {
+		// Not indexed (e.g. removed while being refreshed)
+		return;
+	}
+
+	dcassert(items[aItem.searchIndexId - 1] == &aItem);
+	items[aItem.searchIndexId - 1] = nullptr;
+	aItem.searchIndexId = 0;
+	removedCount++;
+
+	if (removedCount >= MIN_COMPACT_COUNT && removedCount * 2 > items.size()) {
+		compact();
+	}
+}
+
+template<class T>
+void ShareSearchIndex::NameIndex<T>::merge(NameIndex& aOther) noexcept {
+	if (items.empty()) {
+		std::swap(items, aOther.items);
+		std::swap(postings, aOther.postings);
+		std::swap(removedCount, aOther.removedCount);
+		return;
+	}
+
+	// The merged items are placed after the existing ones so that the posting lists remain sorted
+	auto offset = static_cast<ItemId>(items.size());
+	for (const auto& item : aOther.items) {
+		if (item) {
+			item->searchIndexId += offset;
+		}
+
+		items.push_back(item);
+	}
+
+	for (const auto& [trigram, otherList] : aOther.postings) {
+		auto& list = postings[trigram];
+		list.reserve(list.size() + otherList.size());
+		for (auto id : otherList) {
+			list.push_back(id + offset);
+		}
+	}
+
+	removedCount += aOther.removedCount;
+
+	aOther.items.clear();
+	aOther.postings.clear();
+	aOther.removedCount = 0;
+
+	if (removedCount >= MIN_COMPACT_COUNT && removedCount * 2 > items.size()) {
+		compact();
+	}
+}
+
+template<class T>
+void ShareSearchIndex::NameIndex<T>::compact() noexcept {
+	// Assign new IDs for the remaining items (the order won't change)
+	vector<ItemId> newIds(items.size() + 1, 0);
+
+	vector<T*> newItems;
+	newItems.reserve(items.size() - removedCount);
+	for (size_t i = 0; i < items.size(); ++i) {
+		if (items[i]) {
+			newItems.push_back(items[i]);
+
+			auto newId = static_cast<ItemId>(newItems.size());
+			newIds[i + 1] = newId;
+			items[i]->searchIndexId = newId;
+		}
+	}
+
+	for (auto i = postings.begin(); i != postings.end();) {
+		auto& list = i->second;
+
+		PostingList newList;
+		for (auto id : list) {
+			if (auto newId = newIds[id]; newId != 0) {
+				newList.push_back(newId);
+			}
+		}
+
+		if (newList.empty()) {
+			i = postings.erase(i);
+		} else {
+			list = std::move(newList);
+			++i;
+		}
+	}
+
+	items = std::move(newItems);
+	removedCount = 0;
+}
+
+template<class T>
+const typename ShareSearchIndex::NameIndex<T>::PostingList* ShareSearchIndex::NameIndex<T>::getPostings(Trigram aTrigram) const noexcept {
+	auto i = postings.find(aTrigram);
+	return i != postings.end() ? &i->second : nullptr;
+}
+
+template<class T>
+size_t ShareSearchIndex::NameIndex<T>::estimate(const TrigramList& aTrigrams) const noexcept {
+	auto ret = items.size();
+	for (auto trigram : aTrigrams) {
+		auto list = getPostings(trigram);
+		ret = min(ret, list ? list->size() : 0);
+	}
+
+	return ret;
+}
+
+template<class T>
+void ShareSearchIndex::NameIndex<T>::find(const string& aPatternLower, const TrigramList& aTrigrams, vector<const T*>& items_) const noexcept {
+	vector<const PostingList*> lists;
+	for (auto trigram : aTrigrams) {
+		auto list = getPostings(trigram);
+		if (!list) {
+			return;
+		}
+
+		lists.push_back(list);
+	}
+
+	if (lists.empty()) {
+		return;
+	}
+
+	// Intersect starting from the shortest list
+	ranges::sort(lists, [](const PostingList* a, const PostingList* b) { return a->size() < b->size(); });
+
+	auto candidates = *lists.front();
+	for (auto i = lists.begin() + 1; i != lists.end() && !candidates.empty(); ++i) {
+		const auto& list = **i;
+		std::erase_if(candidates, [&list](ItemId aId) { return !binary_search(list.begin(), list.end(), aId); });
+	}
+
+	// Having all trigrams doesn't guarantee that the name contains the whole pattern
+	for (auto id : candidates) {
+		auto item = items[id - 1];
+		if (item && getNameLower(*item).find(aPatternLower) != string::npos) {
+			items_.push_back(item);
+		}
+	}
+}
+
+template<class T>
+size_t ShareSearchIndex::NameIndex<T>::getMemoryUsage() const noexcept {
+	// Hash nodes hold the next pointer and the cached hash in addition to the value
+	auto ret = items.capacity() * sizeof(T*) + postings.bucket_count() * sizeof(void*);
+	ret += postings.size() * (sizeof(typename decltype(postings)::value_type) + 2 * sizeof(void*));
+	for (const auto& list : postings | views::values) {
+		ret += list.capacity() * sizeof(ItemId);
+	}
+
+	return ret;
+}
+
+template class ShareSearchIndex::NameIndex<ShareDirectory>;
+template class ShareSearchIndex::NameIndex<ShareDirectory::File>;
+
+} // namespace dcpp
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2011-2024 AirDC++ Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_SHARE_SEARCH_INDEX_H
+#define DCPLUSPLUS_DCPP_SHARE_SEARCH_INDEX_H
+
+#include <airdcpp/core/header/typedefs.h>
+
+#include <airdcpp/share/ShareDirectory.h>
+
+namespace dcpp {
+
+// Trigram postings of the lowercase directory and file names in share
+// Used for picking the candidate items for recursive text searches before walking the tree
+// Access must be protected with the lock of the owning share tree (or the refresh task that builds it)
+class ShareSearchIndex {
+public:
+	// Shorter patterns can't be looked up from the index
+	static const size_t MIN_PATTERN_LENGTH = 3;
+
+	void addDirectory(ShareDirectory& aDirectory) noexcept;
+	void removeDirectory(ShareDirectory& aDirectory) noexcept;
+
+	void addFile(ShareDirectory::File& aFile) noexcept;
+	void removeFile(ShareDirectory::File& aFile) noexcept;
+
+	// Moves all items from another index without having to tokenize the names again
+	// The other index will be empty afterwards
+	void merge(ShareSearchIndex& aOther) noexcept;
+
+	// Returns the upper limit for the number of items whose name contains the pattern
+	// Returns nullopt if the pattern is too short
+	optional<size_t> estimateMatches(const string& aPatternLower) const noexcept;
+
+	// Finds all items whose name contains the pattern
+	// The pattern must be at least MIN_PATTERN_LENGTH characters long
+	void findDirectories(const string& aPatternLower, vector<const ShareDirectory*>& directories_) const noexcept;
+	void findFiles(const string& aPatternLower, vector<const ShareDirectory::File*>& files_) const noexcept;
+
+	size_t getDirectoryCount() const noexcept { return directories.getCount(); }
+	size_t getFileCount() const noexcept { return files.getCount(); }
+
+	// Approximate number of bytes allocated for the item lists and postings
+	size_t getMemoryUsage() const noexcept { return directories.getMemoryUsage() + files.getMemoryUsage(); }
+private:
+	typedef uint32_t Trigram;
+	typedef vector<Trigram> TrigramList;
+
+	static TrigramList toTrigrams(const string& aNameLower) noexcept;
+
+	template<class T>
+	class NameIndex {
+	public:
+		typedef uint32_t ItemId;
+		typedef vector<ItemId> PostingList;
+
+		void add(T& aItem, const string& aNameLower) noexcept;
+		void remove(T& aItem) noexcept;
+		void merge(NameIndex& aOther) noexcept;
+
+		size_t estimate(const TrigramList& aTrigrams) const noexcept;
+		void find(const string& aPatternLower, const TrigramList& aTrigrams, vector<const T*>& items_) const noexcept;
+
+		size_t getCount() const noexcept { return items.size() - removedCount; }
+		size_t getMemoryUsage() const noexcept;
+	private:
+		// Removed items are only dropped from the posting lists once there are enough of them
+		static const size_t MIN_COMPACT_COUNT = 1024;
+		void compact() noexcept;
+
+		const PostingList* getPostings(Trigram aTrigram) const noexcept;
+
+		// Item IDs start from 1, index 0 holds ID 1 (nullptr for removed items)
+		vector<T*> items;
+		size_t removedCount = 0;
+
+		// The IDs are increasing so that the lists are always sorted
+		unordered_map<Trigram, PostingList> postings;
+	};
+
+	NameIndex<ShareDirectory> directories;
+	NameIndex<ShareDirectory::File> files;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_SHARE_SEARCH_INDEX_H)
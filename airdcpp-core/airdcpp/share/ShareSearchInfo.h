@@ -48,9 +48,16 @@ struct ShareSearchCounters {
 	uint64_t searchTokenLength = 0;
 	uint64_t autoSearches = 0;
 
+	// Recursive searches that only visited the items picked from the search index
+	uint64_t indexedSearches = 0;
+
+	// Recursive searches answered from the incoming search cache (not included in the match time averages)
+	uint64_t cachedSearches = 0;
+
 	ShareSearchStats toStats() const noexcept;
 
 	Callback onMatchingRecursiveSearch(const SearchQuery& aSearch) noexcept;
+	void onCachedSearch(const ShareSearch& aSearch, bool aResponded) noexcept;
 };
 
 
@@ -35,7 +35,25 @@ struct ShareSearchStats {
 	double averageSearchTokenCount = 0;
 	double averageSearchTokenLength = 0;
 
-	uint64_t autoSearches = 0, tthSearches = 0;
+	uint64_t autoSearches = 0, tthSearches = 0, cachedSearches = 0;
+
+	// Trigram index used for picking the candidates for recursive searches
+	uint64_t indexedSearches = 0;
+	size_t searchIndexSize = 0;
+
+	// Name filter used for dropping non-matching searches
+	size_t bloomSize = 0;
+	double bloomFillRatio = 0;
+	double bloomFalsePositiveRate = 0;
+
+	// Time spent waiting for the share tree lock (searches and other readers/refreshes)
+	uint64_t readLocks = 0, contendedReadLocks = 0;
+	double averageReadLockWaitUs = 0;
+	uint64_t maxReadLockWaitUs = 0;
+
+	uint64_t writeLocks = 0, contendedWriteLocks = 0;
+	double averageWriteLockWaitUs = 0;
+	uint64_t maxWriteLockWaitUs = 0;
 };
 
 struct ShareItemStats {
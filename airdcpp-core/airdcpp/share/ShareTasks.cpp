@@ -53,7 +53,7 @@ ShareRefreshInfo::ShareRefreshInfo::~ShareRefreshInfo() {
 }
 
 ShareRefreshInfo::ShareRefreshInfo(const string& aPath, const ShareDirectory::Ptr& aOptionalOldShareDirectory, time_t aLastWrite, ShareBloom& bloom_) :
-	ShareTreeMaps([&bloom_] { return &bloom_; }), optionalOldDirectory(aOptionalOldShareDirectory), path(aPath) {
+	ShareTreeMaps([this] { return &bloom; }), optionalOldDirectory(aOptionalOldShareDirectory), path(aPath), bloom(bloom_.size()), targetBloom(bloom_) {
 
 	// Use a different directory for building the tree
 	if (optionalOldDirectory && optionalOldDirectory->isRoot()) {
@@ -68,7 +68,7 @@ ShareRefreshInfo::ShareRefreshInfo(const string& aPath, const ShareDirectory::Pt
 bool ShareRefreshInfo::checkContent(const ShareDirectory::Ptr& aDirectory) noexcept {
 	if (SETTING(SKIP_EMPTY_DIRS_SHARE) && aDirectory->getDirectories().empty() && aDirectory->getFiles().empty()) {
 		// Remove from parent
-		ShareDirectory::cleanIndices(*aDirectory.get(), stats.addedSize, tthIndex, lowerDirNameMap);
+		ShareDirectory::cleanIndices(*aDirectory.get(), stats.addedSize, *this);
 		return false;
 	}
 
@@ -76,25 +76,10 @@ bool ShareRefreshInfo::checkContent(const ShareDirectory::Ptr& aDirectory) noexc
 }
 
 
-void ShareRefreshInfo::applyRefreshChanges(ShareDirectory::MultiMap& lowerDirNameMap_, ShareDirectory::Map& rootPaths_, ShareDirectory::File::TTHMap& tthIndex_, int64_t& sharedBytes_, ProfileTokenSet* dirtyProfiles_) noexcept {
-#ifdef _DEBUG
-	for (const auto& d : lowerDirNameMap | views::values) {
-		ShareDirectory::checkAddedDirNameDebug(d, lowerDirNameMap_);
-	}
-
-	for (const auto& f : tthIndex | views::values) {
-		ShareDirectory::File::checkAddedTTHDebug(f, tthIndex_);
-	}
-#endif
-
-	lowerDirNameMap_.insert(lowerDirNameMap.begin(), lowerDirNameMap.end());
-	tthIndex_.insert(tthIndex.begin(), tthIndex.end());
-
-	// Add new roots
-	for (const auto& [p, rootDir] : rootPaths) {
-		//dcassert(rootPaths_.find(rp.first) == rootPaths_.end());
-		rootPaths_[p] = rootDir;
-	}
+void ShareRefreshInfo::applyRefreshChanges(ShareTreeMaps& maps_, int64_t& sharedBytes_, ProfileTokenSet* dirtyProfiles_) noexcept {
+	// The names have been indexed for searching already while building the tree
+	maps_.mergeIndices(*this);
+	targetBloom.merge(bloom);
 
 	sharedBytes_ += stats.addedSize;
 
@@ -103,8 +88,6 @@ void ShareRefreshInfo::applyRefreshChanges(ShareDirectory::MultiMap& lowerDirNam
 	}
 
 	// Save some memory
-	lowerDirNameMap.clear();
-	tthIndex.clear();
 	optionalOldDirectory = nullptr;
 	newDirectory = nullptr;
 }
@@ -130,6 +113,10 @@ void ShareTasks::shutdown() noexcept {
 ShareRefreshTask::ShareRefreshTask(ShareRefreshTaskToken aToken, const RefreshPathList& aDirs, const string& aDisplayName, ShareRefreshType aRefreshType, ShareRefreshPriority aPriority) :
 	token(aToken), dirs(aDirs), displayName(aDisplayName), type(aRefreshType), priority(aPriority) { }
 
+bool ShareRefreshTask::isMultithreaded() const noexcept {
+	return SETTING(REFRESH_THREADING) == SettingsManager::MULTITHREAD_ALWAYS || (SETTING(REFRESH_THREADING) == SettingsManager::MULTITHREAD_MANUAL && priority == ShareRefreshPriority::MANUAL);
+}
+
 void ShareTasks::validateRefreshTask(StringList& dirs_) noexcept {
 	Lock l(tasks.cs);
 	const auto& tq = tasks.getTasks();
@@ -339,20 +326,27 @@ Callback ShareTasks::runRefreshTask(const ShareRefreshTask& aTask, const Progres
 	atomic<long> progressCounter(0);
 
 	ShareRefreshStats totalStats;
-	bool allBuildersSucceed = true;
+	CriticalSection statsCS;
+	atomic<bool> allBuildersSucceed = true;
 
 	auto doRefresh = [&](const string& aRefreshPath) {
-		if (aTask.canceled || !taskHandler->refreshPath(aRefreshPath, aTask, totalStats)) {
+		ShareRefreshStats pathStats;
+		if (aTask.canceled || !taskHandler->refreshPath(aRefreshPath, aTask, pathStats)) {
 			allBuildersSucceed = false;
 		}
 
+		{
+			Lock l(statsCS);
+			totalStats.merge(pathStats);
+		}
+
 		if (progressF) {
 			progressF(static_cast<float>(progressCounter++) / static_cast<float>(refreshPaths.size()));
 		}
 	};
 
 	try {
-		if (SETTING(REFRESH_THREADING) == SettingsManager::MULTITHREAD_ALWAYS || (SETTING(REFRESH_THREADING) == SettingsManager::MULTITHREAD_MANUAL && aTask.priority == ShareRefreshPriority::MANUAL)) {
+		if (aTask.isMultithreaded()) {
 			TaskScheduler s;
 			parallel_for_each(refreshPaths.begin(), refreshPaths.end(), doRefresh);
 		} else {
@@ -370,7 +364,7 @@ Callback ShareTasks::runRefreshTask(const ShareRefreshTask& aTask, const Progres
 	// Fire completion only after the task has been removed from the list
 	return [
 		taskHandler, 
-		allBuildersSucceed, 
+		allBuildersSucceed = allBuildersSucceed.load(), 
 		aTask, 
 		totalStats
 	] {
@@ -23,13 +23,16 @@
 #include <airdcpp/util/DupeUtil.h>
 #include <airdcpp/core/io/File.h>
 #include <airdcpp/core/io/stream/FilteredFile.h>
+#include <airdcpp/core/io/stream/Streams.h>
 #include <airdcpp/util/PathUtil.h>
 #include <airdcpp/core/localization/ResourceManager.h>
 #include <airdcpp/search/SearchResult.h>
 #include <airdcpp/search/SearchQuery.h>
 #include <airdcpp/share/SharePathValidator.h>
+#include <airdcpp/share/ShareBinaryCache.h>
 #include <airdcpp/share/profiles/ShareProfile.h>
 #include <airdcpp/share/ShareRefreshInfo.h>
+#include <airdcpp/share/ShareSearchIndex.h>
 #include <airdcpp/core/io/xml/SimpleXML.h>
 #include <airdcpp/util/text/StringTokenizer.h>
 #include <airdcpp/connection/UserConnection.h>
@@ -42,24 +45,42 @@ using ranges::find_if;
 using ranges::copy;
 
 
-ShareTree::ShareTree() : bloom(make_unique<ShareBloom>(1 << 20)), ShareTreeMaps([this] { return bloom.get(); })
+ShareTree::ShareTree() : bloom(make_unique<ShareBloom>(1 << 20))
 {
 #if defined(_DEBUG) && defined(_WIN32)
 	testDualString();
 #endif
 }
 
+unique_ptr<ShareTreeMaps> ShareTree::createRootMaps() noexcept {
+	return make_unique<ShareTreeMaps>([this] { return bloom.get(); });
+}
+
+ShareTreeMaps* ShareTree::findRootMapsUnsafe(const ShareDirectory& aDirectory) const noexcept {
+	auto root = &aDirectory;
+	while (root->getParent()) {
+		root = root->getParent();
+	}
+
+	auto i = rootMaps.find(root);
+	return i != rootMaps.end() ? i->second.get() : nullptr;
+}
+
 void ShareTree::getRealPaths(const TTHValue& aTTH, StringList& paths_) const noexcept {
-	RLock l(cs);
-	const auto i = tthIndex.equal_range(const_cast<TTHValue*>(&aTTH));
-	for (const auto& f: i | pair_to_range | views::values) {
-		paths_.push_back(f->getRealPath());
+	TimedRLock l(cs);
+	for (const auto& maps : rootMaps | views::values) {
+		const auto i = maps->tthIndex.equal_range(const_cast<TTHValue*>(&aTTH));
+		for (const auto& f: i | pair_to_range | views::values) {
+			paths_.push_back(f->getRealPath());
+		}
 	}
 }
 
 bool ShareTree::isFileShared(const TTHValue& aTTH) const noexcept {
-	RLock l(cs);
-	return tthIndex.contains(const_cast<TTHValue*>(&aTTH));
+	TimedRLock l(cs);
+	return ranges::any_of(rootMaps | views::values, [&aTTH](const auto& aMaps) {
+		return aMaps->tthIndex.contains(const_cast<TTHValue*>(&aTTH));
+	});
 }
 
 bool ShareTree::toRealWithSize(const UploadFileQuery& aQuery, string& path_, int64_t& size_, bool& noAccess_) const noexcept {
@@ -67,16 +88,18 @@ bool ShareTree::toRealWithSize(const UploadFileQuery& aQuery, string& path_, int
 		return false;
 	}
 
-	RLock l(cs);
-	const auto flst = tthIndex.equal_range(const_cast<TTHValue*>(&aQuery.tth));
-	for(const auto& file: flst | pair_to_range | views::values) {
-		if (!aQuery.profiles || file->getParent()->hasProfile(*aQuery.profiles)) {
-			noAccess_ = false;
-			path_ = file->getRealPath();
-			size_ = file->getSize();
-			return true;
-		} else {
-			noAccess_ = true;
+	TimedRLock l(cs);
+	for (const auto& maps : rootMaps | views::values) {
+		const auto flst = maps->tthIndex.equal_range(const_cast<TTHValue*>(&aQuery.tth));
+		for (const auto& file: flst | pair_to_range | views::values) {
+			if (!aQuery.profiles || file->getParent()->hasProfile(*aQuery.profiles)) {
+				noAccess_ = false;
+				path_ = file->getRealPath();
+				size_ = file->getSize();
+				return true;
+			} else {
+				noAccess_ = true;
+			}
 		}
 	}
 
@@ -84,14 +107,16 @@ bool ShareTree::toRealWithSize(const UploadFileQuery& aQuery, string& path_, int
 }
 
 AdcCommand ShareTree::getFileInfo(const TTHValue& aTTH) const {
-	RLock l(cs);
-	if (auto i = tthIndex.find(const_cast<TTHValue*>(&aTTH)); i != tthIndex.end()) {
-		const ShareDirectory::File* f = i->second;
-		AdcCommand cmd(AdcCommand::CMD_RES);
-		cmd.addParam("FN", f->getAdcPath());
-		cmd.addParam("SI", Util::toString(f->getSize()));
-		cmd.addParam("TR", f->getTTH().toBase32());
-		return cmd;
+	TimedRLock l(cs);
+	for (const auto& maps : rootMaps | views::values) {
+		if (auto i = maps->tthIndex.find(const_cast<TTHValue*>(&aTTH)); i != maps->tthIndex.end()) {
+			const ShareDirectory::File* f = i->second;
+			AdcCommand cmd(AdcCommand::CMD_RES);
+			cmd.addParam("FN", f->getAdcPath());
+			cmd.addParam("SI", Util::toString(f->getSize()));
+			cmd.addParam("TR", f->getTTH().toBase32());
+			return cmd;
+		}
 	}
 
 	//not found throw
@@ -109,7 +134,7 @@ void ShareTree::getRealPaths(const string& aVirtualPath, StringList& realPaths_,
 
 	ShareDirectory::List dirs;
 
-	RLock l(cs);
+	TimedRLock l(cs);
 	getDirectoriesByVirtualUnsafe<OptionalProfileToken>(aVirtualPath, aProfile, dirs);
 
 	if (aVirtualPath.back() == ADC_SEPARATOR) {
@@ -131,7 +156,7 @@ void ShareTree::getRealPaths(const string& aVirtualPath, StringList& realPaths_,
 }
 
 string ShareTree::realToVirtualAdc(const string& aPath, const OptionalProfileToken& aToken) const noexcept{
-	RLock l(cs);
+	TimedRLock l(cs);
 	auto d = findDirectoryUnsafe(PathUtil::getFilePath(aPath));
 	if (!d || !d->hasProfile(aToken)) {
 		return Util::emptyString;
@@ -158,12 +183,14 @@ string ShareTree::validateVirtualName(const string& aVirt) const noexcept {
 }
 
 void ShareTree::countStats(time_t& totalAge_, size_t& totalDirs_, int64_t& totalSize_, size_t& totalFiles_, size_t& uniqueFiles, size_t& lowerCaseFiles_, size_t& totalStrLen_, size_t& roots_) const noexcept{
-	unordered_set<decltype(tthIndex)::key_type> uniqueTTHs;
+	unordered_set<ShareDirectory::File::TTHMap::key_type> uniqueTTHs;
 
-	RLock l(cs);
+	TimedRLock l(cs);
 
-	for (auto tth : tthIndex | views::keys) {
-		uniqueTTHs.insert(tth);
+	for (const auto& maps : rootMaps | views::values) {
+		for (auto tth : maps->tthIndex | views::keys) {
+			uniqueTTHs.insert(tth);
+		}
 	}
 
 	uniqueFiles = uniqueTTHs.size();
@@ -187,7 +214,7 @@ ShareDirectory::Ptr ShareTree::findRootUnsafe(const string& aPath) const noexcep
 ShareDirectory::List ShareTree::getRoots(const OptionalProfileToken& aProfile) const noexcept {
 	ShareDirectory::List dirs;
 	{
-		RLock l(cs);
+		TimedRLock l(cs);
 		getRootsUnsafe(aProfile, dirs);
 	}
 	return dirs;
@@ -218,7 +245,7 @@ void ShareTree::getRootsByVirtualUnsafe(const string& aVirtualName, const Profil
 DupeType ShareTree::getAdcDirectoryDupe(const string& aAdcPath, int64_t aSize) const noexcept{
 	ShareDirectory::List dirs;
 
-	RLock l(cs);
+	TimedRLock l(cs);
 	getDirectoriesByAdcNameUnsafe(aAdcPath, dirs);
 
 	if (dirs.empty())
@@ -232,7 +259,7 @@ StringList ShareTree::getAdcDirectoryDupePaths(const string& aAdcPath) const noe
 	ShareDirectory::List dirs;
 
 	{
-		RLock l(cs);
+		TimedRLock l(cs);
 		getDirectoriesByAdcNameUnsafe(aAdcPath, dirs);
 		for (const auto& dir : dirs) {
 			ret.push_back(dir->getRealPathUnsafe());
@@ -250,29 +277,30 @@ void ShareTree::getDirectoriesByAdcNameUnsafe(const string& aAdcPath, ShareDirec
 	auto [directoryName, subDirStart] = DupeUtil::getAdcDirectoryName(aAdcPath);
 
 	auto nameLower = Text::toLower(directoryName);
-	const auto directories = lowerDirNameMap.equal_range(&nameLower);
-	if (directories.first == directories.second)
-		return;
-
-	for (const auto& directory: directories | pair_to_range | views::values) {
-		if (subDirStart != string::npos) {
-			// confirm that we have the subdirectory as well
-			auto dir = directory->findDirectoryByPath(aAdcPath.substr(subDirStart), ADC_SEPARATOR);
-			if (dir) {
-				dirs_.push_back(dir);
+	for (const auto& maps : rootMaps | views::values) {
+		const auto directories = maps->lowerDirNameMap.equal_range(&nameLower);
+		for (const auto& directory: directories | pair_to_range | views::values) {
+			if (subDirStart != string::npos) {
+				// confirm that we have the subdirectory as well
+				auto dir = directory->findDirectoryByPath(aAdcPath.substr(subDirStart), ADC_SEPARATOR);
+				if (dir) {
+					dirs_.push_back(dir);
+				}
+			} else {
+				dirs_.push_back(directory);
 			}
-		} else {
-			dirs_.push_back(directory);
 		}
 	}
 }
 
 bool ShareTree::isFileShared(const TTHValue& aTTH, ProfileToken aProfile) const noexcept{
-	RLock l (cs);
-	const auto files = tthIndex.equal_range(const_cast<TTHValue*>(&aTTH));
-	for(auto f: files | pair_to_range | views::values) {
-		if (f->getParent()->hasProfile(aProfile)) {
-			return true;
+	TimedRLock l (cs);
+	for (const auto& maps : rootMaps | views::values) {
+		const auto files = maps->tthIndex.equal_range(const_cast<TTHValue*>(&aTTH));
+		for (auto f: files | pair_to_range | views::values) {
+			if (f->getParent()->hasProfile(aProfile)) {
+				return true;
+			}
 		}
 	}
 
@@ -296,10 +324,12 @@ ShareDirectory::File::ConstSet ShareTree::findFiles(const TTHValue& aTTH) const
 	ShareDirectory::File::ConstSet ret;
 
 	{
-		RLock l(cs);
-		auto files = tthIndex.equal_range(const_cast<TTHValue*>(&aTTH));
-		for (auto& f : files | pair_to_range | views::values) {
-			ret.insert_sorted(f);
+		TimedRLock l(cs);
+		for (const auto& maps : rootMaps | views::values) {
+			auto files = maps->tthIndex.equal_range(const_cast<TTHValue*>(&aTTH));
+			for (auto& f : files | pair_to_range | views::values) {
+				ret.insert_sorted(f);
+			}
 		}
 	}
 
@@ -309,7 +339,7 @@ ShareDirectory::File::ConstSet ShareTree::findFiles(const TTHValue& aTTH) const
 StringList ShareTree::getRootPathList() const noexcept {
 	StringList paths;
 
-	RLock l(cs);
+	TimedRLock l(cs);
 	ranges::copy(rootPaths | views::keys, back_inserter(paths));
 	return paths;
 }
@@ -317,13 +347,13 @@ StringList ShareTree::getRootPathList() const noexcept {
 ShareRootList ShareTree::getShareRoots() const noexcept {
 	ShareRootList roots;
 
-	RLock l(cs);
+	TimedRLock l(cs);
 	ranges::copy(rootPaths | views::values | views::transform(ShareDirectory::ToRoot), back_inserter(roots));
 	return roots;
 }
 
 ShareDirectory::Map ShareTree::getRootPaths() const noexcept {
-	RLock l(cs);
+	TimedRLock l(cs);
 	return rootPaths;
 }
 
@@ -331,7 +361,7 @@ ShareRoot::Ptr ShareTree::setRefreshState(const string& aRefreshPath, ShareRootR
 	ShareRoot::Ptr rootDir;
 
 	{
-		RLock l(cs);
+		TimedRLock l(cs);
 		auto p = find_if(rootPaths | views::values, [&](const ShareDirectory::Ptr& aDir) {
 			return PathUtil::isParentOrExactLocal(aDir->getRoot()->getPath(), aRefreshPath);
 		});
@@ -372,7 +402,7 @@ ShareRoot::Ptr ShareTree::addShareRoot(const string& aPath, const string& aVirtu
 	// dcassert(!aDirectoryInfo->profiles.empty());
 	// const auto& path = aDirectoryInfo->path;
 
-	WLock l(cs);
+	TimedWLock l(cs);
 	if (rootPaths.contains(aPath)) {
 		return nullptr;
 	}
@@ -380,15 +410,22 @@ ShareRoot::Ptr ShareTree::addShareRoot(const string& aPath, const string& aVirtu
 	dcassert(find_if(rootPaths | views::keys, IsParentOrExact(aPath, PATH_SEPARATOR)).base() == rootPaths.end());
 
 	// It's a new parent, will be handled in the task thread
-	auto root = ShareDirectory::createRoot(aPath, aVirtualName, aProfiles, aIncoming, aLastModified, *this, aLastRefreshed);
+	auto maps = createRootMaps();
+	auto root = ShareDirectory::createRoot(aPath, aVirtualName, aProfiles, aIncoming, aLastModified, *maps, aLastRefreshed);
+	rootPaths[aPath] = root;
+	rootMaps.emplace(root.get(), std::move(maps));
+	fragmentCache.onRootChanged(aPath);
 	return root->getRoot();
 }
 
 ShareRoot::Ptr ShareTree::removeShareRoot(const string& aPath) noexcept {
 	ShareDirectory::Ptr directory = nullptr;
 
+	// The indices are dropped as a whole after releasing the lock
+	unique_ptr<ShareTreeMaps> removedMaps;
+
 	{
-		WLock l(cs);
+		TimedWLock l(cs);
 		auto k = rootPaths.find(aPath);
 		if (k == rootPaths.end()) {
 			return nullptr;
@@ -397,11 +434,18 @@ ShareRoot::Ptr ShareTree::removeShareRoot(const string& aPath) noexcept {
 		directory = k->second;
 
 		rootPaths.erase(k);
+		fragmentCache.onRootChanged(aPath);
 
 		// Remove the root
-		ShareDirectory::cleanIndices(*directory, sharedSize, tthIndex, lowerDirNameMap);
+		auto m = rootMaps.find(directory.get());
+		dcassert(m != rootMaps.end());
+		removedMaps = std::move(m->second);
+		rootMaps.erase(m);
+
+		sharedSize -= directory->getTotalSize();
 	}
 
+	File::deleteFile(directory->getRoot()->getCacheBinaryPath());
 	File::deleteFile(directory->getRoot()->getCacheXmlPath());
 
 #ifdef _DEBUG
@@ -412,7 +456,7 @@ ShareRoot::Ptr ShareTree::removeShareRoot(const string& aPath) noexcept {
 }
 
 void ShareTree::removeProfile(ProfileToken aProfile, StringList& rootsToRemove_) noexcept {
-	WLock l(cs);
+	TimedWLock l(cs);
 	for (auto const& [path, root] : rootPaths) {
 		if (root->getRoot()->removeRootProfile(aProfile)) {
 			rootsToRemove_.push_back(path);
@@ -425,7 +469,7 @@ ShareRoot::Ptr ShareTree::updateShareRoot(const ShareDirectoryInfoPtr& aDirector
 
 	auto vName = validateVirtualName(aDirectoryInfo->virtualName);
 	{
-		WLock l(cs);
+		TimedWLock l(cs);
 		auto directory = findRootUnsafe(aDirectoryInfo->path);
 		if (!directory) {
 			return nullptr;
@@ -433,13 +477,16 @@ ShareRoot::Ptr ShareTree::updateShareRoot(const ShareDirectoryInfoPtr& aDirector
 
 		rootDirectory = directory->getRoot();
 
-		ShareDirectory::removeDirName(*directory, lowerDirNameMap);
+		auto& maps = *findRootMapsUnsafe(*directory);
+		ShareDirectory::removeDirName(*directory, maps);
 		rootDirectory->setName(vName);
-		ShareDirectory::addDirName(directory, lowerDirNameMap, *bloom.get());
-	}
+		ShareDirectory::addDirName(directory, maps);
 
-	rootDirectory->setIncoming(aDirectoryInfo->incoming);
-	rootDirectory->setRootProfiles(aDirectoryInfo->profiles);
+		rootDirectory->setIncoming(aDirectoryInfo->incoming);
+		rootDirectory->setRootProfiles(aDirectoryInfo->profiles);
+
+		fragmentCache.onRootChanged(aDirectoryInfo->path);
+	}
 
 #ifdef _DEBUG
 	validateDirectoryTreeDebug();
@@ -449,46 +496,72 @@ ShareRoot::Ptr ShareTree::updateShareRoot(const ShareDirectoryInfoPtr& aDirector
 }
 
 bool ShareTree::applyRefreshChanges(ShareRefreshInfo& ri, ProfileTokenSet* aDirtyProfiles) {
-	ShareDirectory::Ptr parent = nullptr;
+	// Replaced root trees are released only after the lock has been released
+	ShareDirectory::Ptr oldRoot;
+	unique_ptr<ShareTreeMaps> oldRootMaps;
+
+	TimedWLock l(cs);
+
+	if (ri.optionalOldDirectory && ri.optionalOldDirectory->isRoot()) {
+		// Root removed while refreshing?
+		auto m = rootMaps.find(ri.optionalOldDirectory.get());
+		if (m == rootMaps.end()) {
+			return false;
+		}
+
+		// The new tree has been indexed while refreshing, publish it by replacing the old root
+		oldRoot = ri.optionalOldDirectory;
+		oldRootMaps = std::move(m->second);
+		rootMaps.erase(m);
+
+		sharedSize -= oldRoot->getTotalSize();
 
-	WLock l(cs);
+		auto& maps = *rootMaps.emplace(ri.newDirectory.get(), createRootMaps()).first->second;
+		rootPaths[ri.path] = ri.newDirectory;
+		fragmentCache.onDirectoryChanged(*ri.newDirectory, true);
+		ri.applyRefreshChanges(maps, sharedSize, aDirtyProfiles);
+
+		dcdebug("Share changes applied for the root %s\n", ri.path.c_str());
+		return true;
+	}
+
+	ShareDirectory::Ptr parent = nullptr;
 
 	// Recursively remove the content of this dir from TTHIndex and directory name map
 	if (ri.optionalOldDirectory) {
-		// Root removed while refreshing?
-		if (ri.optionalOldDirectory->isRoot() && !findRootUnsafe(ri.path)) {
+		auto maps = findRootMapsUnsafe(*ri.optionalOldDirectory);
+		if (!maps) {
+			// Root removed while refreshing
 			return false;
 		}
 
 		parent = ri.optionalOldDirectory->getParent();
+		fragmentCache.onDirectoryChanged(*ri.optionalOldDirectory, true);
 
 		// Remove the old directory
-		ShareDirectory::cleanIndices(*ri.optionalOldDirectory, sharedSize, tthIndex, lowerDirNameMap);
+		ShareDirectory::cleanIndices(*ri.optionalOldDirectory, sharedSize, *maps);
 	}
 
-	// Set the parent for refreshed subdirectories
-	// (previous directory should always be available for roots)
-	if (!ri.optionalOldDirectory || !ri.optionalOldDirectory->isRoot()) {
-		// All content was removed?
-		if (!ri.checkContent(ri.newDirectory)) {
-			return false;
-		}
+	// All content was removed?
+	if (!ri.checkContent(ri.newDirectory)) {
+		return false;
+	}
 
+	if (!parent) {
+		// Create new parent
+		parent = ensureDirectoryUnsafe(PathUtil::getParentDir(ri.path));
 		if (!parent) {
-			// Create new parent
-			parent = ensureDirectoryUnsafe(PathUtil::getParentDir(ri.path));
-			if (!parent) {
-				return false;
-			}
-		}
-
-		// Set the parent
-		if (!ShareDirectory::setParent(ri.newDirectory, parent)) {
 			return false;
 		}
 	}
 
-	ri.applyRefreshChanges(lowerDirNameMap, rootPaths, tthIndex, sharedSize, aDirtyProfiles);
+	// Set the parent
+	if (!ShareDirectory::setParent(ri.newDirectory, parent)) {
+		return false;
+	}
+
+	fragmentCache.onDirectoryChanged(*ri.newDirectory, true);
+	ri.applyRefreshChanges(*findRootMapsUnsafe(*parent), sharedSize, aDirtyProfiles);
 	dcdebug("Share changes applied for the directory %s\n", ri.path.c_str());
 	return true;
 }
@@ -513,7 +586,7 @@ ShareDirectoryInfoPtr ShareTree::getRootInfoUnsafe(const ShareDirectory::Ptr& aD
 }
 
 ShareDirectoryInfoPtr ShareTree::getRootInfo(const string& aPath) const noexcept {
-	RLock l(cs);
+	TimedRLock l(cs);
 	if (auto directory = findRootUnsafe(aPath); directory) {
 		return getRootInfoUnsafe(directory);
 	}
@@ -524,7 +597,7 @@ ShareDirectoryInfoPtr ShareTree::getRootInfo(const string& aPath) const noexcept
 ShareDirectoryInfoList ShareTree::getRootInfos() const noexcept {
 	ShareDirectoryInfoList ret;
 
-	RLock l (cs);
+	TimedRLock l (cs);
 	for(const auto& d: rootPaths | views::values) {
 		ret.push_back(getRootInfoUnsafe(d));
 	}
@@ -533,10 +606,12 @@ ShareDirectoryInfoList ShareTree::getRootInfos() const noexcept {
 }
 		
 void ShareTree::getBloom(ProfileToken aToken, HashBloom& bloom_) const noexcept {
-	RLock l(cs);
-	for (const auto& [tth, file] : tthIndex) {
-		if (file->hasProfile(aToken)) {
-			bloom_.add(*tth);
+	TimedRLock l(cs);
+	for (const auto& maps : rootMaps | views::values) {
+		for (const auto& [tth, file] : maps->tthIndex) {
+			if (file->hasProfile(aToken)) {
+				bloom_.add(*tth);
+			}
 		}
 	}
 }
@@ -547,41 +622,58 @@ void ShareTree::getBloomFileCount(ProfileToken aToken, size_t& fileCount_) const
 }
 
 void ShareTree::setBloom(ShareBloom* aBloom) noexcept {
-	WLock l(cs);
+	TimedWLock l(cs);
 	bloom.reset(aBloom);
 }
 
-#define LITERAL(n) n, sizeof(n)-1
-void ShareTree::toCache(OutputStream& os_, const ShareDirectory::Ptr& aDirectory) const {
-	string indent, tmp;
+ShareBloom::Stats ShareTree::getBloomStats() const noexcept {
+	TimedRLock l(cs);
+	return bloom->getStats();
+}
 
-	os_.write(SimpleXML::utf8Header);
-	os_.write(LITERAL("<Share Version=\"" SHARE_CACHE_VERSION));
-	os_.write(LITERAL("\" Path=\""));
-	os_.write(SimpleXML::escape(aDirectory->getRoot()->getPath(), tmp, true));
+size_t ShareTree::getSearchIndexSize() const noexcept {
+	size_t ret = 0;
 
-	os_.write(LITERAL("\" Date=\""));
-	os_.write(SimpleXML::escape(Util::toString(aDirectory->getLastWrite()), tmp, true));
-	os_.write(LITERAL("\">\r\n"));
-	indent += '\t';
+	TimedRLock l(cs);
+	for (const auto& maps : rootMaps | views::values) {
+		if (auto searchIndex = maps->getSearchIndex(); searchIndex) {
+			ret += searchIndex->getMemoryUsage();
+		}
+	}
+
+	return ret;
+}
+
+void ShareTree::toCache(const string& aPath, const ShareDirectory::Ptr& aDirectory) const {
+	ShareBinaryCache::Content content;
 
 	{
-		RLock l(cs);
-		for (const auto& child : aDirectory->getDirectories()) {
-			child->toCacheXmlList(os_, indent, tmp);
-		}
-		aDirectory->filesToCacheXmlList(os_, indent, tmp);
+		TimedRLock l(cs);
+		content = ShareBinaryCache::serialize(aDirectory);
 	}
 
-	os_.write(LITERAL("</Share>"));
+	ShareBinaryCache::save(aPath, content);
+}
+
+string ShareTree::getFilelistHeader(const string& aVirtualPath, time_t aDate) noexcept {
+	string tmp;
+	return SimpleXML::utf8Header + R"(<FileListing Version="1" CID=")" + ClientManager::getInstance()->getMyCID().toBase32() +
+		"\" Base=\"" + SimpleXML::escape(aVirtualPath, tmp, false) +
+		"\" BaseDate=\"" + Util::toString(aDate) +
+		"\" Generator=\"" + shortVersionString + "\">\r\n";
 }
 
 void ShareTree::toFilelist(OutputStream& os_, const string& aVirtualPath, const OptionalProfileToken& aProfile, bool aRecursive, const FilelistDirectory::DuplicateFileHandler& aDuplicateFileHandler) const {
 	ShareDirectory::List currentDirectory, children;
 
-	dcdebug("Generating filelist for %s \n", aVirtualPath.c_str());
+	TimedRLock l(cs);
 
-	RLock l(cs);
+	if (auto cached = fragmentCache.getPartialList(aVirtualPath, aProfile, aRecursive); cached) {
+		os_.write(*cached);
+		return;
+	}
+
+	dcdebug("Generating filelist for %s \n", aVirtualPath.c_str());
 
 	// Get the directories
 	if (aVirtualPath == ADC_ROOT_STR) {
@@ -601,30 +693,66 @@ void ShareTree::toFilelist(OutputStream& os_, const string& aVirtualPath, const
 	}
 
 	auto listRoot = FilelistDirectory::generateRoot(currentDirectory, children, aRecursive);
+
+	// Write the XML directly in the output stream (a copy is kept for the cache unless the list is too large)
+	FilelistFragmentCache::PartialListOutputStream os(os_);
+	string tmp, indent = "\t";
+
+	os.write(getFilelistHeader(aVirtualPath, listRoot->getDate()));
+
+	for (const auto& ld : listRoot->getListDirectories() | views::values) {
+		ld->toXml(os, indent, tmp, aRecursive, aDuplicateFileHandler);
+	}
+	listRoot->filesToXml(os, indent, tmp, !aRecursive, aDuplicateFileHandler);
+
+	os.write("</FileListing>");
+
+	if (auto xml = os.releaseList(); xml) {
+		fragmentCache.setPartialList(aVirtualPath, aProfile, aRecursive, xml);
+	}
+}
+
+void ShareTree::toFullFilelist(ParallelBZOutputStream& bz_, TigerTree& xmlTree_, ProfileToken aProfile, const FilelistDirectory::DuplicateFileHandler& aDuplicateFileHandler) const {
+	ShareDirectory::List roots;
+
+	TimedRLock l(cs);
+	getRootsUnsafe(aProfile, roots);
+
+	// Merge the roots with the same virtual name
+	auto listRoot = FilelistDirectory::generateRoot(ShareDirectory::List(), roots, false);
+
+	// Everything except the end tag is written in full tiger tree base blocks so that the cached hash leaves can be appended
 	{
-		// Write the XML
-		string tmp, indent = "\t";
+		auto header = getFilelistHeader(ADC_ROOT_STR, listRoot->getDate());
+		header += FilelistFragmentCache::getXmlPadding(header.size());
+
+		xmlTree_.update(header.data(), header.size());
+		bz_.write(header);
+	}
 
-		os_.write(SimpleXML::utf8Header);
-		os_.write(R"(<FileListing Version="1" CID=")" + ClientManager::getInstance()->getMyCID().toBase32() +
-			"\" Base=\"" + SimpleXML::escape(aVirtualPath, tmp, false) +
-			"\" BaseDate=\"" + Util::toString(listRoot->getDate()) +
-			"\" Generator=\"" + shortVersionString + "\">\r\n");
+	for (const auto& ld : listRoot->getListDirectories() | views::values) {
+		const auto& virtualRoots = ld->getShareDirectories();
 
-		for (const auto& ld : listRoot->getListDirectories() | views::values) {
-			ld->toXml(os_, indent, tmp, aRecursive, aDuplicateFileHandler);
+		auto fragment = fragmentCache.getFullListFragment(virtualRoots);
+		if (!fragment) {
+			fragment = FilelistFragmentCache::createFullListFragment(virtualRoots, aDuplicateFileHandler);
+			fragmentCache.setFullListFragment(virtualRoots, fragment);
 		}
-		listRoot->filesToXml(os_, indent, tmp, !aRecursive, aDuplicateFileHandler);
+
+		xmlTree_.append(fragment->xmlTree);
+		bz_.write(fragment->compressed);
 	}
 
-	os_.write("</FileListing>");
+	const string footer = "</FileListing>";
+	xmlTree_.update(footer.data(), footer.size());
+	bz_.write(footer);
 }
 
 void ShareTree::toTTHList(OutputStream& os_, const string& aVirtualPath, bool aRecursive, ProfileToken aProfile) const noexcept {
 	ShareDirectory::List directories;
 	string tmp;
 
-	RLock l(cs);
+	TimedRLock l(cs);
 	try {
 		getDirectoriesByVirtualUnsafe<ProfileToken>(aVirtualPath, aProfile, directories);
 	} catch(...) {
@@ -671,12 +799,14 @@ bool ShareTree::addDirectoryResultUnsafe(const ShareDirectory* aDir, SearchResul
 }
 
 void ShareTree::search(SearchResultList& results, const TTHValue& aTTH, const ShareSearch& aSearchInfo) const noexcept {
-	RLock l(cs);
-	const auto i = tthIndex.equal_range(const_cast<TTHValue*>(&aTTH));
-	for (auto& f : i | pair_to_range | views::values) {
-		if (f->hasProfile(aSearchInfo.profile) && PathUtil::isParentOrExactAdc(aSearchInfo.virtualPath, f->getAdcPath())) {
-			f->addSR(results, aSearchInfo.search.addParents);
-			return;
+	TimedRLock l(cs);
+	for (const auto& maps : rootMaps | views::values) {
+		const auto i = maps->tthIndex.equal_range(const_cast<TTHValue*>(&aTTH));
+		for (auto& f : i | pair_to_range | views::values) {
+			if (f->hasProfile(aSearchInfo.profile) && PathUtil::isParentOrExactAdc(aSearchInfo.virtualPath, f->getAdcPath())) {
+				f->addSR(results, aSearchInfo.search.addParents);
+				return;
+			}
 		}
 	}
 }
@@ -684,7 +814,7 @@ void ShareTree::search(SearchResultList& results, const TTHValue& aTTH, const Sh
 void ShareTree::getProfileInfo(ProfileToken aProfile, int64_t& totalSize_, size_t& filesCount_) const noexcept {
 	ShareDirectory::List roots;
 
-	RLock l(cs);
+	TimedRLock l(cs);
 	getRootsUnsafe(aProfile, roots);
 	for (const auto& d : roots) {
 		d->getProfileInfo(aProfile, totalSize_, filesCount_);
@@ -715,21 +845,11 @@ void ShareTree::searchText(SearchResultList& results_, ShareSearch& aSearchInfo,
 
 	ShareDirectory::SearchResultInfo::Set resultInfos;
 
-	RLock l(cs);
+	TimedRLock l(cs);
 	{
 		auto endF = counters_.onMatchingRecursiveSearch(srch);
-
-		// Get the search roots
-		ShareDirectory::List roots;
-		if (aSearchInfo.virtualPath == ADC_ROOT_STR) {
-			getRootsUnsafe(aSearchInfo.profile, roots);
-		} else {
-			getDirectoriesByVirtualUnsafe<OptionalProfileToken>(aSearchInfo.virtualPath, aSearchInfo.profile, roots);
-		}
-
-		// go them through recursively
-		for (const auto& d: roots) {
-			d->search(resultInfos, srch, 0);
+		if (matchTextUnsafe(resultInfos, aSearchInfo, true)) {
+			counters_.indexedSearches++;
 		}
 
 		endF();
@@ -751,8 +871,91 @@ void ShareTree::searchText(SearchResultList& results_, ShareSearch& aSearchInfo,
 	}
 }
 
+void ShareTree::matchText(ShareDirectory::SearchResultInfo::Set& results_, const ShareSearch& aSearchInfo, bool aUseIndex) const {
+	TimedRLock l(cs);
+	matchTextUnsafe(results_, aSearchInfo, aUseIndex);
+}
+
+bool ShareTree::matchTextUnsafe(ShareDirectory::SearchResultInfo::Set& results_, const ShareSearch& aSearchInfo, bool aUseIndex) const {
+	auto& srch = aSearchInfo.search;
+
+	// Get the search roots
+	ShareDirectory::List roots;
+	if (aSearchInfo.virtualPath == ADC_ROOT_STR) {
+		getRootsUnsafe(aSearchInfo.profile, roots);
+	} else {
+		getDirectoriesByVirtualUnsafe<OptionalProfileToken>(aSearchInfo.virtualPath, aSearchInfo.profile, roots);
+	}
+
+	// go them through recursively
+	ShareDirectory::SearchCandidates candidates;
+	auto useCandidates = aUseIndex && getSearchCandidatesUnsafe(srch, candidates);
+	for (const auto& d: roots) {
+		d->search(results_, srch, 0, useCandidates ? &candidates : nullptr);
+	}
+
+	return useCandidates;
+}
+
+bool ShareTree::getSearchCandidatesUnsafe(const SearchQuery& aSearch, ShareDirectory::SearchCandidates& candidates_) const noexcept {
+	// Some roots were refreshed while the search index was disabled
+	if (ranges::any_of(rootMaps | views::values, [](const auto& aMaps) { return !aMaps->getSearchIndex(); })) {
+		return false;
+	}
+
+	// Each result must contain all patterns in its own name or in the name of a parent directory
+	// so it's enough to search for the subtrees of items matching the rarest pattern
+	const string* rarestPattern = nullptr;
+	size_t rarestMatches = 0;
+	for (const auto& p : aSearch.include.getPatterns()) {
+		optional<size_t> matches;
+		for (const auto& maps : rootMaps | views::values) {
+			if (auto rootMatches = maps->getSearchIndex()->estimateMatches(p.str()); rootMatches) {
+				matches = matches.value_or(0) + *rootMatches;
+			}
+		}
+
+		if (matches && (!rarestPattern || *matches < rarestMatches)) {
+			rarestPattern = &p.str();
+			rarestMatches = *matches;
+		}
+	}
+
+	size_t totalItems = 0;
+	for (const auto& maps : rootMaps | views::values) {
+		totalItems += maps->getSearchIndex()->getDirectoryCount() + maps->getSearchIndex()->getFileCount();
+	}
+
+	// Walking through the whole tree is cheaper for common patterns
+	if (!rarestPattern || rarestMatches > totalItems / 2) {
+		return false;
+	}
+
+	for (const auto& maps : rootMaps | views::values) {
+		const auto& searchIndex = *maps->getSearchIndex();
+		if (aSearch.itemType != SearchQuery::ItemType::FILE || aSearch.matchType == Search::MATCH_PATH_PARTIAL) {
+			vector<const ShareDirectory*> directories;
+			searchIndex.findDirectories(*rarestPattern, directories);
+			for (const auto& d : directories) {
+				candidates_.addDirectory(d);
+			}
+		}
+
+		if (aSearch.itemType != SearchQuery::ItemType::DIRECTORY) {
+			vector<const ShareDirectory::File*> files;
+			searchIndex.findFiles(*rarestPattern, files);
+			for (const auto& f : files) {
+				candidates_.addFile(f);
+			}
+		}
+	}
+
+	candidates_.finalize();
+	return true;
+}
+
 bool ShareTree::matchBloom(const SearchQuery& aSearch) const noexcept {
-	RLock l(cs);
+	TimedRLock l(cs);
 	auto matches = ranges::all_of(aSearch.include.getPatterns(), [this](auto& p) { return bloom->match(p.str()); });
 	return matches;
 }
@@ -768,6 +971,23 @@ Callback ShareSearchCounters::onMatchingRecursiveSearch(const SearchQuery& aSear
 	};
 }
 
+void ShareSearchCounters::onCachedSearch(const ShareSearch& aSearch, bool aResponded) noexcept {
+	totalSearches++;
+	if (aSearch.profile == SP_HIDDEN) {
+		return;
+	}
+
+	recursiveSearches++;
+	cachedSearches++;
+	if (aSearch.isAutoSearch) {
+		autoSearches++;
+	}
+
+	if (aResponded) {
+		recursiveSearchesResponded++;
+	}
+}
+
 ShareSearchStats ShareSearchCounters::toStats() const noexcept {
 	auto upseconds = static_cast<double>(GET_TICK()) / 1000.00;
 
@@ -780,12 +1000,15 @@ ShareSearchStats ShareSearchCounters::toStats() const noexcept {
 	stats.filteredSearches = filteredSearches;
 	stats.unfilteredRecursiveSearchesPerSecond = static_cast<double>(recursiveSearches - filteredSearches) / upseconds;
 
-	stats.averageSearchMatchMs = static_cast<uint64_t>(Util::countAverage(recursiveSearchTime, recursiveSearches - filteredSearches));
-	stats.averageSearchTokenCount = Util::countAverage(searchTokenCount, recursiveSearches - filteredSearches);
+	auto matchedSearches = recursiveSearches - filteredSearches - cachedSearches;
+	stats.averageSearchMatchMs = static_cast<uint64_t>(Util::countAverage(recursiveSearchTime, matchedSearches));
+	stats.averageSearchTokenCount = Util::countAverage(searchTokenCount, matchedSearches);
 	stats.averageSearchTokenLength = Util::countAverage(searchTokenLength, searchTokenCount);
 
 	stats.autoSearches = autoSearches;
 	stats.tthSearches = tthSearches;
+	stats.cachedSearches = cachedSearches;
+	stats.indexedSearches = indexedSearches;
 
 	return stats;
 }
@@ -829,16 +1052,17 @@ ShareDirectory::Ptr ShareTree::ensureDirectoryUnsafe(const string& aRealPath) no
 
 	// Create missing directories
 	// Tokens should have been validated earlier
+	auto& maps = *findRootMapsUnsafe(*curDir);
 	for (const auto& curName: tokens) {
 		curDir->updateModifyDate();
-		curDir = ShareDirectory::createNormal(DualString(curName), curDir, File::getLastModified(curDir->getRealPathUnsafe()), *this);
+		curDir = ShareDirectory::createNormal(DualString(curName), curDir, File::getLastModified(curDir->getRealPathUnsafe()), maps);
 	}
 
 	return curDir;
 }
 
 void ShareTree::validateRootPath(const string& aRealPath, const ProfileFormatter& aProfileFormatter) const {
-	RLock l(cs);
+	TimedRLock l(cs);
 	for (const auto& [rootPath, rootDirectory] : rootPaths) {
 		if (PathUtil::isParentOrExactLocal(rootPath, aRealPath)) {
 			if (Util::stricmp(rootPath, aRealPath) != 0) {
@@ -862,7 +1086,7 @@ ShareDirectory::Ptr ShareTree::findDirectoryUnsafe(const string& aRealPath) cons
 }
 
 bool ShareTree::findDirectoryByRealPath(const string& aPath, const ShareDirectoryCallback& aCallback) const noexcept {
-	RLock l(cs);
+	TimedRLock l(cs);
 	auto directory = findDirectoryUnsafe(aPath);
 	if (!directory) {
 		return false;
@@ -876,7 +1100,7 @@ bool ShareTree::findDirectoryByRealPath(const string& aPath, const ShareDirector
 }
 
 bool ShareTree::findFileByRealPath(const string& aPath, const ShareFileCallback& aCallback) const noexcept {
-	RLock l(cs);
+	TimedRLock l(cs);
 	auto file = findFileUnsafe(aPath);
 	if (!file) {
 		return false;
@@ -891,13 +1115,14 @@ bool ShareTree::findFileByRealPath(const string& aPath, const ShareFileCallback&
 
 
 void ShareTree::addHashedFile(const string& aRealPath, const HashedFile& aFileInfo, ProfileTokenSet* dirtyProfiles) noexcept {
-	WLock l(cs);
+	TimedWLock l(cs);
 	auto d = ensureDirectoryUnsafe(PathUtil::getFilePath(aRealPath));
 	if (!d) {
 		return;
 	}
 
-	d->addFile(PathUtil::getFileName(aRealPath), aFileInfo, *this, sharedSize, dirtyProfiles);
+	d->addFile(PathUtil::getFileName(aRealPath), aFileInfo, *findRootMapsUnsafe(*d), sharedSize, dirtyProfiles);
+	fragmentCache.onDirectoryChanged(*d, false);
 }
 
 
@@ -923,7 +1148,7 @@ void ShareTree::testDualString() {
 #endif
 
 void ShareTree::validateDirectoryTreeDebug() const noexcept {
-	RLock l(cs);
+	TimedRLock l(cs);
 	OrderedStringSet directories, files;
 
 	auto start = GET_TICK();
@@ -935,25 +1160,27 @@ void ShareTree::validateDirectoryTreeDebug() const noexcept {
 	auto end = GET_TICK();
 	dcdebug("Share tree checked in " U64_FMT " ms\n", end - start);
 
-	StringList filesDiff, directoriesDiff;
-	if (files.size() != tthIndex.size()) {
-		OrderedStringSet indexed;
-		for (const auto& f : tthIndex | views::values) {
-			indexed.insert(f->getRealPath());
-		}
+	dcassert(rootPaths.size() == rootMaps.size());
 
-		set_symmetric_difference(files.begin(), files.end(), indexed.begin(), indexed.end(), back_inserter(filesDiff));
-	}
+	OrderedStringSet indexedFiles, indexedDirectories;
+	for (const auto& maps : rootMaps | views::values) {
+		for (const auto& f : maps->tthIndex | views::values) {
+			indexedFiles.insert(f->getRealPath());
+		}
 
-	if (directories.size() != lowerDirNameMap.size()) {
-		OrderedStringSet indexed;
-		for (const auto& d : lowerDirNameMap | views::values) {
-			indexed.insert(d->getRealPathUnsafe());
+		for (const auto& d : maps->lowerDirNameMap | views::values) {
+			indexedDirectories.insert(d->getRealPathUnsafe());
 		}
 
-		set_symmetric_difference(directories.begin(), directories.end(), indexed.begin(), indexed.end(), back_inserter(directoriesDiff));
+		if (auto searchIndex = maps->getSearchIndex(); searchIndex) {
+			dcassert(searchIndex->getDirectoryCount() == maps->lowerDirNameMap.size() && searchIndex->getFileCount() == maps->tthIndex.size());
+		}
 	}
 
+	StringList filesDiff, directoriesDiff;
+	set_symmetric_difference(files.begin(), files.end(), indexedFiles.begin(), indexedFiles.end(), back_inserter(filesDiff));
+	set_symmetric_difference(directories.begin(), directories.end(), indexedDirectories.begin(), indexedDirectories.end(), back_inserter(directoriesDiff));
+
 	dcassert(directoriesDiff.empty() && filesDiff.empty());
 }
 
@@ -974,9 +1201,12 @@ void ShareTree::validateDirectoryRecursiveDebugUnsafe(const ShareDirectory::Ptr&
 		dcassert(bloom->match(aDir->getVirtualNameLower()));
 	}
 
+	const auto maps = findRootMapsUnsafe(*aDir);
+	dcassert(maps);
+
 	int64_t realDirectorySize = 0;
 	for (const auto& f : aDir->getFiles()) {
-		auto flst = tthIndex.equal_range(const_cast<TTHValue*>(&f->getTTH()));
+		auto flst = maps->tthIndex.equal_range(const_cast<TTHValue*>(&f->getTTH()));
 		dcassert(ranges::count_if(flst | pair_to_range | views::values, [&](const ShareDirectory::File* aFile) {
 			return aFile->getRealPath() == f->getRealPath();
 		}) == 1);
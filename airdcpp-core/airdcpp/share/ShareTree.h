@@ -28,6 +28,7 @@
 #include <airdcpp/core/classes/Pointer.h>
 #include <airdcpp/share/ShareDirectory.h>
 #include <airdcpp/share/ShareDirectoryInfo.h>
+#include <airdcpp/share/FilelistFragmentCache.h>
 #include <airdcpp/share/ShareStats.h>
 #include <airdcpp/core/classes/SortedVector.h>
 #include <airdcpp/share/UploadFileProvider.h>
@@ -43,7 +44,7 @@ class ShareRefreshInfo;
 
 #define SHARE_CACHE_VERSION "3"
 
-class ShareTree : public UploadFileProvider, private ShareTreeMaps {
+class ShareTree : public UploadFileProvider {
 public:
 	// Mostly for dupe check with size comparison (partial/exact dupe)
 	// You may also give a path in NMDC format and the relevant 
@@ -58,8 +59,14 @@ public:
 
 	void toTTHList(OutputStream& os_, const string& aVirtualPath, bool aRecursive, ProfileToken aProfile) const noexcept;
 
+	// Partial lists are cached until the listed directories are changed
 	void toFilelist(OutputStream& os_, const string& aVirtualPath, const OptionalProfileToken& aProfile, bool aRecursive, const FilelistDirectory::DuplicateFileHandler& aDuplicateFileHandler) const;
-	void toCache(OutputStream& os_, const ShareDirectory::Ptr& aDirectory) const;
+
+	// Writes the full filelist of the profile, only the modified virtual roots are serialized again
+	// Throws Exception in case of compression errors
+	void toFullFilelist(ParallelBZOutputStream& bz_, TigerTree& xmlTree_, ProfileToken aProfile, const FilelistDirectory::DuplicateFileHandler& aDuplicateFileHandler) const;
+	// Throws FileException
+	void toCache(const string& aPath, const ShareDirectory::Ptr& aDirectory) const;
 
 	// Throws ShareException
 	AdcCommand getFileInfo(const TTHValue& aTTH) const;
@@ -95,6 +102,11 @@ public:
 	// Throws ShareException in case an invalid path is provided
 	void searchText(SearchResultList& l, ShareSearch& aSearchInfo, ShareSearchCounters& counters_) const;
 
+	// Collects the items matching the text search without creating results
+	// The whole tree is walked if aUseIndex is false (used for verifying the search index)
+	// Throws ShareException in case an invalid path is provided
+	void matchText(ShareDirectory::SearchResultInfo::Set& results_, const ShareSearch& aSearchInfo, bool aUseIndex) const;
+
 	IGETSET(int64_t, sharedSize, SharedSize, 0);
 
 	// Convert real path to virtual path. Returns an empty string if not shared.
@@ -150,6 +162,10 @@ public:
 	}
 
 	void setBloom(ShareBloom* aBloom) noexcept;
+	ShareBloom::Stats getBloomStats() const noexcept;
+
+	// Approximate memory usage of the search indices in bytes
+	size_t getSearchIndexSize() const noexcept;
 
 	bool applyRefreshChanges(ShareRefreshInfo& ri, ProfileTokenSet* aDirtyProfiles);
 
@@ -171,14 +187,38 @@ public:
 	StringList getRootPathList() const noexcept;
 	ShareRootList getShareRoots() const noexcept;
 
-	SharedMutex& getCS() const noexcept { return cs; }
+	// Keeps track of the lock wait times
+	TimedSharedMutex& getCS() const noexcept { return cs; }
 private:
-	mutable SharedMutex cs;
+	mutable TimedSharedMutex cs;
+
+	// Map real name to virtual name - multiple real names may be mapped to a single virtual one
+	ShareDirectory::Map rootPaths;
+
+	// Each root has indices of its own so that refreshed roots can be built and indexed without holding the lock
+	// (the new version is published by replacing the root directory together with its indices)
+	unordered_map<const ShareDirectory*, unique_ptr<ShareTreeMaps>> rootMaps;
+
+	unique_ptr<ShareTreeMaps> createRootMaps() noexcept;
+
+	// Returns the indices of the root of the directory (nullptr if the directory isn't in share anymore)
+	ShareTreeMaps* findRootMapsUnsafe(const ShareDirectory& aDirectory) const noexcept;
 
 	bool matchBloom(const SearchQuery& aSearch) const noexcept;
 
 	unique_ptr<ShareBloom> bloom;
 
+	mutable FilelistFragmentCache fragmentCache;
+
+	static string getFilelistHeader(const string& aVirtualPath, time_t aDate) noexcept;
+
+	// Returns true if the search index was used for picking the visited items
+	bool matchTextUnsafe(ShareDirectory::SearchResultInfo::Set& results_, const ShareSearch& aSearchInfo, bool aUseIndex) const;
+
+	// Collects the items that may match the search based on its most selective pattern
+	// Returns false if the whole tree should be searched instead
+	bool getSearchCandidatesUnsafe(const SearchQuery& aSearch, ShareDirectory::SearchCandidates& candidates_) const noexcept;
+
 	ShareDirectoryInfoPtr getRootInfoUnsafe(const ShareDirectory::Ptr& aDir) const noexcept;
 
 	bool addDirectoryResultUnsafe(const ShareDirectory* aDir, SearchResultList& aResults, const OptionalProfileToken& aProfile, const SearchQuery& srch) const noexcept;
@@ -26,6 +26,7 @@
 #include <airdcpp/core/localization/ResourceManager.h>
 #include <airdcpp/user/User.h>
 #include <airdcpp/connection/UserConnection.h>
+#include <airdcpp/connection/ThrottleManager.h>
 
 #include <limits>
 #include <cmath>
@@ -378,6 +379,7 @@ void DownloadManager::startData(UserConnection* aSource, int64_t start, int64_t
 
 	d->setStart(GET_TICK());
 	d->tick();
+	aSource->setThrottleClass(ThrottleManager::getTransferClass(*d));
 	aSource->setState(UserConnection::STATE_RUNNING);
 
 	fire(DownloadManagerListener::Starting(), d);
@@ -604,7 +606,7 @@ void DownloadManager::on(UserConnectionListener::FileNotAvailable, UserConnectio
 
 /** @todo Handle errors better */
 void DownloadManager::on(AdcCommand::STA, UserConnection* aSource, const AdcCommand& cmd) noexcept {
-	if(cmd.getParameters().size() < 2) {
+	if(cmd.getParamCount() < 2) {
 		dcdebug("DM::AdcCommand::STA: not enough parameters (%s)\n", aSource->getConnectToken().c_str());
 		disconnect(aSource);
 		return;
@@ -26,6 +26,7 @@
 #include <airdcpp/queue/QueueManager.h>
 #include <airdcpp/core/localization/ResourceManager.h>
 #include <airdcpp/share/ShareManager.h>
+#include <airdcpp/core/io/stream/SharedFileStream.h>
 #include <airdcpp/core/io/stream/Streams.h>
 #include <airdcpp/transfer/upload/Upload.h>
 #include <airdcpp/connection/UserConnection.h>
@@ -126,7 +127,8 @@ Upload* UploadParser::toUpload(UserConnection& aSource, const UploadRequest& aRe
 			}
 
 			if (!is) {
-				auto f = make_unique<File>(sourceFile, File::READ, File::OPEN | File::SHARED_WRITE); // write for partial sharing
+				// Concurrent uploads of the same file share the handle
+				auto f = make_unique<SharedFileStream>(sourceFile, File::READ, File::OPEN | File::SHARED_WRITE); // write for partial sharing
 				is = std::move(f);
 			}
 
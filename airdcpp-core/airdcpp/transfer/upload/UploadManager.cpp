@@ -27,11 +27,14 @@
 #include <airdcpp/events/LogManager.h>
 #include <airdcpp/core/localization/ResourceManager.h>
 #include <airdcpp/share/ShareManager.h>
+#include <airdcpp/core/classes/ScopedFunctor.h>
+#include <airdcpp/core/io/stream/SharedFileStream.h>
 #include <airdcpp/core/io/stream/StreamBase.h>
 #include <airdcpp/transfer/upload/Upload.h>
 #include <airdcpp/transfer/upload/UploadFileParser.h>
 #include <airdcpp/transfer/upload/UploadQueueManager.h>
 #include <airdcpp/connection/UserConnection.h>
+#include <airdcpp/connection/ThrottleManager.h>
 
 
 namespace dcpp {
@@ -41,6 +44,8 @@ using ranges::find_if;
 UploadManager::UploadManager() noexcept : queue(make_unique<UploadQueueManager>([this] { return getFreeSlots(); })) {
 	TimerManager::getInstance()->addListener(this);
 
+	// Pooled upload handles would keep renamed/deleted files open
+	File::setPathModifiedHook(&SharedFileStream::closeIdleHandle);
 
 	SettingsManager::getInstance()->registerChangeHandler({
 		SettingsManager::FREE_SLOTS_EXTENSIONS
@@ -51,6 +56,7 @@ UploadManager::UploadManager() noexcept : queue(make_unique<UploadQueueManager>(
 
 UploadManager::~UploadManager() {
 	TimerManager::getInstance()->removeListener(this);
+	File::setPathModifiedHook(nullptr);
 
 	while (true) {
 		{
@@ -669,6 +675,7 @@ void UploadManager::startTransfer(Upload* aUpload) noexcept {
 	aUpload->tick();
 
 	auto& uc = aUpload->getUserConnection();
+	uc.setThrottleClass(ThrottleManager::getTransferClass(*aUpload));
 	uc.setState(UserConnection::STATE_RUNNING);
 	uc.transmitFile(aUpload->getStream());
 	fire(UploadManagerListener::Starting(), aUpload);
@@ -784,7 +791,7 @@ void UploadManager::on(AdcCommand::GFI, UserConnection* aSource, const AdcComman
 		return;
 	}
 	
-	if (c.getParameters().size() < 2) {
+	if (c.getParamCount() < 2) {
 		aSource->sendHooked(AdcCommand(AdcCommand::SEV_RECOVERABLE, AdcCommand::ERROR_PROTOCOL_GENERIC, "Missing parameters"));
 		return;
 	}
@@ -851,8 +858,9 @@ void UploadManager::checkExpiredDelayUploads() {
 }
 
 // TimerManagerListener
-void UploadManager::on(TimerManagerListener::Second, uint64_t /*aTick*/) noexcept {
+void UploadManager::on(TimerManagerListener::Second, uint64_t aTick) noexcept {
 	checkExpiredDelayUploads();
+	SharedFileStream::expireIdleHandles(aTick);
 
 	UploadList ticks;
 	{
@@ -883,6 +891,9 @@ void UploadManager::log(const string& aMsg, LogMessage::Severity aSeverity) noex
  * Abort upload of specific file
  */
 void UploadManager::abortUpload(const string& aFile, bool aWaitDisconnected) noexcept {
+	// Finished uploads may have left the file open
+	ScopedFunctor([&aFile] { SharedFileStream::closeIdleHandle(aFile); });
+
 	bool fileRunning = false;
 
 	{
@@ -92,13 +92,14 @@ void UploadBundleInfoReceiver::onUBN(const AdcCommand& cmd) {
 	float percent = -1;
 	string speedStr;
 
-	for (const auto& str: cmd.getParameters()) {
+	for (size_t i = 0; i < cmd.getParamCount(); ++i) {
+		auto str = cmd.getParamView(i);
 		if (str.compare(0, 2, "BU") == 0) {
 			bundleToken = str.substr(2);
 		} else if(str.compare(0, 2, "DS") == 0) {
 			speedStr = str.substr(2);
 		} else if (str.compare(0, 2, "PE") == 0) {
-			percent = Util::toFloat(str.substr(2));
+			percent = Util::toFloat(string(str.substr(2)));
 		} else {
 			// dbgMsg("unknown UBN param " + str + " received", LogMessage::SEV_WARNING);
 		}
@@ -133,17 +134,18 @@ void UploadBundleInfoReceiver::createBundle(const AdcCommand& cmd) {
 	int64_t size = 0, downloaded = 0;
 	bool singleUser = false;
 
-	for (const auto& str: cmd.getParameters()) {
+	for (size_t i = 0; i < cmd.getParamCount(); ++i) {
+		auto str = cmd.getParamView(i);
 		if (str.compare(0, 2, "BU") == 0) {
 			bundleToken = str.substr(2);
 		} else if(str.compare(0, 2, "TO") == 0) {
 			token = str.substr(2);
 		} else if(str.compare(0, 2, "SI") == 0) {
-			size = Util::toInt64(str.substr(2));
+			size = Util::toInt64(string(str.substr(2)));
 		} else if (str.compare(0, 2, "NA") == 0) {
 			name = str.substr(2);
 		} else if (str.compare(0, 2, "DL") == 0) {
-			downloaded = Util::toInt64(str.substr(2));
+			downloaded = Util::toInt64(string(str.substr(2)));
 		} else if (str.compare(0, 2, "SU") == 0) {
 			singleUser = true;
 		} else {
@@ -186,11 +188,12 @@ void UploadBundleInfoReceiver::updateBundleInfo(const AdcCommand& cmd) {
 	int64_t size = 0, downloaded = 0;
 	bool singleUser = false, multiUser = false;
 
-	for (const auto& str: cmd.getParameters()) {
+	for (size_t i = 0; i < cmd.getParamCount(); ++i) {
+		auto str = cmd.getParamView(i);
 		if (str.compare(0, 2, "BU") == 0) {
 			bundleToken = str.substr(2);
 		} else if(str.compare(0, 2, "SI") == 0) {
-			size = Util::toInt64(str.substr(2));
+			size = Util::toInt64(string(str.substr(2)));
 		} else if (str.compare(0, 2, "NA") == 0) {
 			name = str.substr(2);
 		}  else if (str.compare(0, 2, "SU") == 0) {
@@ -198,7 +201,7 @@ void UploadBundleInfoReceiver::updateBundleInfo(const AdcCommand& cmd) {
 		} else if (str.compare(0, 2, "MU") == 0) {
 			multiUser = true;
 		} else if (str.compare(0, 2, "DL") == 0) {
-			downloaded = Util::toInt64(str.substr(2));
+			downloaded = Util::toInt64(string(str.substr(2)));
 		} else {
 			// dbgMsg("unknown update param " + str + " received", LogMessage::SEV_WARNING);
 		}
@@ -237,7 +240,8 @@ void UploadBundleInfoReceiver::changeBundle(const AdcCommand& cmd) {
 	string bundleToken;
 	string token;
 
-	for(const auto& str: cmd.getParameters()) {
+	for (size_t i = 0; i < cmd.getParamCount(); ++i) {
+		auto str = cmd.getParamView(i);
 		if(str.compare(0, 2, "BU") == 0) {
 			bundleToken = str.substr(2);
 		} else if(str.compare(0, 2, "TO") == 0) {
@@ -265,7 +269,8 @@ void UploadBundleInfoReceiver::changeBundle(const AdcCommand& cmd) {
 void UploadBundleInfoReceiver::removeBundleConnection(const AdcCommand& cmd) {
 	string token;
 
-	for (const auto& str : cmd.getParameters()) {
+	for (size_t i = 0; i < cmd.getParamCount(); ++i) {
+		auto str = cmd.getParamView(i);
 		if (str.compare(0, 2, "TO") == 0) {
 			token = str.substr(2);
 		}
@@ -288,7 +293,8 @@ void UploadBundleInfoReceiver::removeBundleConnection(const AdcCommand& cmd) {
 void UploadBundleInfoReceiver::finishBundle(const AdcCommand& cmd) {
 	string bundleToken;
 
-	for (const auto& str: cmd.getParameters()) {
+	for (size_t i = 0; i < cmd.getParamCount(); ++i) {
+		auto str = cmd.getParamView(i);
 		if (str.compare(0, 2, "BU") == 0) {
 			bundleToken = str.substr(2);
 			break;
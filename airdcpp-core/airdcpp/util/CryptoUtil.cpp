@@ -146,38 +146,56 @@ void CryptoUtil::testSUDP() {
 #endif
 
 string CryptoUtil::encryptSUDP(const uint8_t* aKey, const string& aCmd) {
-	string inData = aCmd;
-	uint8_t ivd[16] = { };
+	StringList cmds = { aCmd };
+	encryptSUDP(aKey, cmds);
+	return std::move(cmds.front());
+}
 
-	// prepend 16 random bytes to message
-	RAND_bytes(ivd, 16);
-	inData.insert(0, (char*)ivd, 16);
+void CryptoUtil::encryptSUDP(const uint8_t* aKey, StringList& aCmds) {
+	if (aCmds.empty()) {
+		return;
+	}
 
-	// use PKCS#5 padding to align the message length to the cypher block size (16)
-	uint8_t pad = 16 - (aCmd.length() & 15);
-	inData.append(pad, (char)pad);
+	// 16 random bytes will be prepended to each message
+	ByteVector prefixes(aCmds.size() * 16);
+	RAND_bytes(prefixes.data(), static_cast<int>(prefixes.size()));
 
-	// encrypt it
-	boost::scoped_array<uint8_t> out(new uint8_t[inData.length()]);
-	memset(ivd, 0, 16);
-	auto commandLength = inData.length();
+	uint8_t ivd[16] = { };
+	ByteVector inData, out;
 
 #define CHECK(n) if(!(n)) { dcassert(0); }
 
-	int len, tmpLen;
+	// The key schedule is shared by all messages
 	auto ctx = EVP_CIPHER_CTX_new();
 	CHECK(EVP_CipherInit_ex(ctx, EVP_aes_128_cbc(), NULL, aKey, ivd, 1));
 	CHECK(EVP_CIPHER_CTX_set_padding(ctx, 0));
-	CHECK(EVP_EncryptUpdate(ctx, out.get(), &len, (unsigned char*)inData.c_str(), inData.length()));
-	CHECK(EVP_EncryptFinal_ex(ctx, out.get() + len, &tmpLen));
-	EVP_CIPHER_CTX_free(ctx);
-#undef CHECK
 
-	dcassert((commandLength & 15) == 0);
+	for (size_t i = 0; i < aCmds.size(); ++i) {
+		auto& cmd = aCmds[i];
+
+		// use PKCS#5 padding to align the message length to the cypher block size (16)
+		uint8_t pad = 16 - (cmd.length() & 15);
+
+		inData.assign(prefixes.begin() + i * 16, prefixes.begin() + (i + 1) * 16);
+		inData.insert(inData.end(), cmd.begin(), cmd.end());
+		inData.insert(inData.end(), pad, pad);
+		out.resize(inData.size());
 
-	inData.clear();
-	inData.insert(0, (char*)out.get(), commandLength);
-	return inData;
+		if (i > 0) {
+			// Restart the chain
+			CHECK(EVP_CipherInit_ex(ctx, NULL, NULL, NULL, ivd, 1));
+		}
+
+		int len, tmpLen;
+		CHECK(EVP_EncryptUpdate(ctx, out.data(), &len, inData.data(), static_cast<int>(inData.size())));
+		CHECK(EVP_EncryptFinal_ex(ctx, out.data() + len, &tmpLen));
+
+		dcassert((out.size() & 15) == 0);
+		cmd.assign(reinterpret_cast<const char*>(out.data()), out.size());
+	}
+
+	EVP_CIPHER_CTX_free(ctx);
+#undef CHECK
 }
 
 bool CryptoUtil::decryptSUDP(const uint8_t* aKey, const ByteVector& aData, size_t aDataLen, string& result_) {
@@ -34,6 +34,9 @@ public:
 
 	// SUDP
 	static string encryptSUDP(const uint8_t* aKey, const string& aCmd);
+
+	// Encrypts the commands in place
+	static void encryptSUDP(const uint8_t* aKey, StringList& aCmds);
 	static bool decryptSUDP(const uint8_t* aKey, const ByteVector& aData, size_t aDataLen, string& result_);
 
 	using SUDPKey = std::unique_ptr<uint8_t[]>;
@@ -88,13 +88,121 @@ size_t StringSearch::Pattern::matchLower(const string& aText, int aStartPos) con
 }
 
 
+void StringSearch::Automaton::clear() noexcept {
+	fill_n(byteClasses, 256, static_cast<uint16_t>(0));
+	classCount = 0;
+	transitions.clear();
+	outputOffsets.clear();
+	outputs.clear();
+	patternLengths.clear();
+}
+
+void StringSearch::Automaton::build(const PatternList& aPatterns) noexcept {
+	clear();
+
+	// Map the used bytes into classes to keep the transition table small
+	classCount = 1;
+	for (const auto& p : aPatterns) {
+		for (auto c : p.str()) {
+			auto& byteClass = byteClasses[static_cast<uint8_t>(c)];
+			if (byteClass == 0) {
+				byteClass = static_cast<uint16_t>(classCount++);
+			}
+		}
+	}
+
+	// Build the trie
+	const auto noState = numeric_limits<uint32_t>::max();
+	transitions.assign(classCount, noState);
+	vector<vector<uint16_t>> stateOutputs(1);
+
+	for (size_t i = 0; i < aPatterns.size(); ++i) {
+		const auto& pattern = aPatterns[i].str();
+		patternLengths.push_back(pattern.size());
+
+		uint32_t state = 0;
+		for (auto c : pattern) {
+			auto& next = transitions[state * classCount + byteClasses[static_cast<uint8_t>(c)]];
+			if (next == noState) {
+				next = static_cast<uint32_t>(stateOutputs.size());
+				stateOutputs.emplace_back();
+				transitions.resize(transitions.size() + classCount, noState);
+			}
+
+			// The reference may have been invalidated
+			state = transitions[state * classCount + byteClasses[static_cast<uint8_t>(c)]];
+		}
+
+		stateOutputs[state].push_back(static_cast<uint16_t>(i));
+	}
+
+	// Resolve the failure transitions in breadth-first order so that the automaton never needs to backtrack
+	vector<uint32_t> failures(stateOutputs.size(), 0);
+	deque<uint32_t> queue;
+	for (size_t c = 0; c < classCount; ++c) {
+		auto& next = transitions[c];
+		if (next == noState) {
+			next = 0;
+		} else {
+			queue.push_back(next);
+		}
+	}
+
+	while (!queue.empty()) {
+		auto state = queue.front();
+		queue.pop_front();
+
+		const auto& failureOutputs = stateOutputs[failures[state]];
+		stateOutputs[state].insert(stateOutputs[state].end(), failureOutputs.begin(), failureOutputs.end());
+
+		for (size_t c = 0; c < classCount; ++c) {
+			auto& next = transitions[state * classCount + c];
+			auto failureNext = transitions[failures[state] * classCount + c];
+			if (next == noState) {
+				next = failureNext;
+			} else {
+				failures[next] = failureNext;
+				queue.push_back(next);
+			}
+		}
+	}
+
+	// Flatten the outputs
+	outputOffsets.reserve(stateOutputs.size() + 1);
+	for (const auto& o : stateOutputs) {
+		outputOffsets.push_back(static_cast<uint32_t>(outputs.size()));
+		outputs.insert(outputs.end(), o.begin(), o.end());
+	}
+
+	outputOffsets.push_back(static_cast<uint32_t>(outputs.size()));
+}
+
 void StringSearch::addString(const string& aStr) {
-	if (!aStr.empty())
+	if (!aStr.empty()) {
 		patterns.emplace_back(Text::toLower(aStr));
+		if (patterns.size() > 1) {
+			automaton.build(patterns);
+		}
+	}
 }
 
 bool StringSearch::match_all(const string& aText) const {
 	auto text = Text::toLower(aText);
+	if (!automaton.empty()) {
+		vector<bool> found(patterns.size(), false);
+		size_t foundCount = 0;
+		automaton.scan(text, [&](size_t aPatternIndex, size_t) {
+			if (!found[aPatternIndex]) {
+				found[aPatternIndex] = true;
+				foundCount++;
+			}
+
+			return foundCount < patterns.size();
+		});
+
+		return foundCount == patterns.size();
+	}
+
 	for (const auto& p : patterns) {
 		if (p.matchLower(text) == string::npos) {
 			return false;
@@ -105,6 +213,16 @@ bool StringSearch::match_all(const string& aText) const {
 }
 
 bool StringSearch::match_any_lower(const string& aText) const {
+	if (!automaton.empty()) {
+		bool found = false;
+		automaton.scan(aText, [&found](size_t, size_t) {
+			found = true;
+			return false;
+		});
+
+		return found;
+	}
+
 	for (const auto& p : patterns) {
 		if (p.matchLower(aText) != string::npos) {
 			return true;
@@ -118,39 +236,79 @@ bool StringSearch::match_any(const string& aText) const {
 	return match_any_lower(Text::toLower(aText));
 }
 
+size_t StringSearch::findPreferred(const Pattern& aPattern, const string& aText, size_t aPreviousPos) noexcept {
+	size_t addPos = string::npos;
+	for (;;) {
+		size_t curPos = aPattern.matchLower(aText, addPos == string::npos ? 0 : addPos + 1);
+		if (curPos != string::npos && aPreviousPos != string::npos && aPreviousPos > curPos) {
+			addPos = curPos;
+			continue; // keep on searching
+		}
+
+		return curPos != string::npos ? curPos : addPos;
+	}
+}
+
 int StringSearch::matchLower(const string& aText, bool aResumeOnNoMatch, ResultList* results_) const {
+	// First and last match positions for each pattern from a single pass
+	// (avoid allocations with the usual pattern counts)
+	struct Matches {
+		size_t first = string::npos;
+		size_t last = string::npos;
+	};
+
+	std::array<Matches, 16> localMatches;
+	vector<Matches> allocatedMatches;
+
+	Matches* matchPositions = nullptr;
+	if (!automaton.empty()) {
+		if (patterns.size() <= localMatches.size()) {
+			matchPositions = localMatches.data();
+		} else {
+			allocatedMatches.resize(patterns.size());
+			matchPositions = allocatedMatches.data();
+		}
+
+		automaton.scan(aText, [matchPositions](size_t aPatternIndex, size_t aPos) {
+			auto& m = matchPositions[aPatternIndex];
+			if (m.first == string::npos) {
+				m.first = aPos;
+			}
+
+			m.last = aPos;
+			return true;
+		});
+	}
+
 	int matches = 0, listPos = 0;
 	for (const auto& p: patterns) {
+		// prefer sequential match order if this isn't the first pattern
+		auto previousPos = results_ && listPos > 0 ? (*results_)[listPos - 1] : string::npos;
+
 		size_t addPos = string::npos;
-		for (;;) {
-			size_t curPos = p.matchLower(aText, addPos == string::npos ? 0 : addPos + 1);
-			if (curPos != string::npos) {
-				if (results_ && listPos > 0) {
-					// prefer sequential match order if this isn't the first pattern
-					if ((*results_)[listPos - 1] != string::npos && (*results_)[listPos - 1] > curPos) {
-						addPos = curPos;
-						continue; // keep on searching
-					}
-				}
-
-				// use this match
-				addPos = curPos;
+		if (!matchPositions) {
+			addPos = findPreferred(p, aText, previousPos);
+		} else {
+			const auto& m = matchPositions[listPos];
+			addPos = m.first;
+			if (addPos != string::npos && previousPos != string::npos && previousPos > addPos) {
+				// Use the last match if there are no matches after the previous pattern
+				addPos = m.last < previousPos ? m.last : p.matchLower(aText, static_cast<int>(previousPos));
 			}
+		}
 
-			if (addPos != string::npos) {
-				matches++;
-				if (results_) {
-					(*results_)[listPos] = addPos;
-				}
-			} else if (!aResumeOnNoMatch) {
-				if (results_) {
-					fill_n((*results_).begin(), listPos, string::npos);
-				}
-				return 0;
+		if (addPos != string::npos) {
+			matches++;
+			if (results_) {
+				(*results_)[listPos] = addPos;
 			}
-
-			break;
+		} else if (!aResumeOnNoMatch) {
+			if (results_) {
+				fill_n((*results_).begin(), listPos, string::npos);
+			}
+			return 0;
 		}
+
 		listPos++;
 	}
 
@@ -159,6 +317,7 @@ int StringSearch::matchLower(const string& aText, bool aResumeOnNoMatch, ResultL
 
 void StringSearch::clear() {
 	patterns.clear();
+	automaton.clear();
 }
 
 string StringSearch::toString() const noexcept {
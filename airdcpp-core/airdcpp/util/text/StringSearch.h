@@ -28,7 +28,9 @@ namespace dcpp {
 * one pattern against many strings (currently Quick Search, a variant of
 * Boyer-Moore. Code based on "A very fast substring search algorithm" by
 * D. Sunday).
-* @todo Perhaps find an algo suitable for matching multiple substrings.
+*
+* Multiple patterns are matched with a single pass over the text by using an
+* Aho-Corasick automaton that is compiled when the patterns are added.
 */
 class StringSearch {
 public:
@@ -80,6 +82,47 @@ public:
 	StringList toStringList() const noexcept;
 private:
 	PatternList patterns;
+
+	// Position of the first match for a pattern that is preferably located after aPreviousPos
+	static size_t findPreferred(const Pattern& aPattern, const string& aText, size_t aPreviousPos) noexcept;
+
+	// Aho-Corasick automaton for the patterns
+	class Automaton {
+	public:
+		void build(const PatternList& aPatterns) noexcept;
+		void clear() noexcept;
+
+		bool empty() const noexcept { return transitions.empty(); }
+
+		// Calls the handler with the pattern index and the start position of each match (in the order of end positions)
+		// Stops if the handler returns false
+		template<class HandlerT>
+		void scan(const string& aText, const HandlerT& aHandler) const noexcept {
+			uint32_t state = 0;
+			for (size_t i = 0; i < aText.size(); ++i) {
+				state = transitions[state * classCount + byteClasses[static_cast<uint8_t>(aText[i])]];
+				for (auto o = outputOffsets[state]; o < outputOffsets[state + 1]; ++o) {
+					auto patternIndex = outputs[o];
+					if (!aHandler(patternIndex, i + 1 - patternLengths[patternIndex])) {
+						return;
+					}
+				}
+			}
+		}
+	private:
+		// Bytes that don't appear in any pattern share the class 0
+		uint16_t byteClasses[256] = { };
+		size_t classCount = 0;
+
+		vector<uint32_t> transitions;
+
+		vector<uint32_t> outputOffsets;
+		vector<uint16_t> outputs;
+		vector<size_t> patternLengths;
+	};
+
+	// Used only with multiple patterns
+	Automaton automaton;
 };
 
 } // namespace dcpp
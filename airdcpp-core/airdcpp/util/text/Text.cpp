@@ -170,11 +170,20 @@ string sanitizeUtf8(const string& str) noexcept {
 	return tgt;
 }
 
-bool validateUtf8(const string& str) noexcept {
+bool validateUtf8(string_view str) noexcept {
 	string::size_type i = 0;
 	while (i < str.length()) {
 		wchar_t dummy = 0;
-		int j = utf8ToWc(&str[i], dummy);
+		int j;
+		if (str.length() - i < 4) {
+			// Views aren't null-terminated, don't read past the end with truncated sequences
+			char tail[5] = { };
+			str.copy(tail, 4, i);
+			j = utf8ToWc(tail, dummy);
+		} else {
+			j = utf8ToWc(&str[i], dummy);
+		}
+
 		if (j < 0)
 			return false;
 		i += j;
@@ -102,7 +102,7 @@ namespace Text {
 	inline char asciiToLower(char c) { dcassert((((uint8_t)c) & 0x80) == 0); return (char)tolower(c); }
 
 	string sanitizeUtf8(const string& str) noexcept;
-	bool validateUtf8(const string& str) noexcept;
+	bool validateUtf8(string_view str) noexcept;
 
 	wchar_t toLower(wchar_t c) noexcept;
 	wchar_t toUpper(wchar_t c) noexcept;
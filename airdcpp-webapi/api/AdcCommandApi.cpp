@@ -416,13 +416,18 @@ boost::regex AdcCommandApi::supportReg(R"([A-Z][A-Z0-9]{3})");
 	}
 
 	json AdcCommandApi::serializeAdcCommand(const AdcCommand& aCmd) noexcept {
+		auto params = json::array();
+		for (size_t i = 0; i < aCmd.getParamCount(); ++i) {
+			params.push_back(aCmd.getParam(i));
+		}
+
 		// auto code = aCmd.getFourCC();
 		return {
 			// { "command", code.substr(1) },
 			{ "command", aCmd.getType() },
 			// { "type", string(1, code[0]) },
 			{ "type", serializeCommand(aCmd.getCommand()) },
-			{ "params", aCmd.getParameters() },
+			{ "params", std::move(params) },
 		};
 	}
 
@@ -143,12 +143,16 @@ namespace webserver {
 		{ "max_hash_speed", SettingsManager::MAX_HASH_SPEED, ResourceManager::SETTINGS_MAX_HASHER_SPEED, ApiSettingItem::TYPE_LAST, ResourceManager::Strings::MBPS },
 		{ "max_total_hashers", SettingsManager::MAX_HASHING_THREADS, ResourceManager::MAX_HASHING_THREADS },
 		{ "max_volume_hashers", SettingsManager::HASHERS_PER_VOLUME, ResourceManager::MAX_VOL_HASHERS },
+		{ "hash_parallel_min_size", SettingsManager::HASH_PARALLEL_MIN_SIZE, ResourceManager::SETTINGS_HASH_PARALLEL_MIN_SIZE, ApiSettingItem::TYPE_LAST, ResourceManager::Strings::MiB },
+		{ "hash_parallel_threads", SettingsManager::HASH_PARALLEL_THREADS, ResourceManager::SETTINGS_HASH_PARALLEL_THREADS },
+		{ "hash_cache_size", SettingsManager::HASH_CACHE_SIZE, ResourceManager::SETTINGS_HASH_CACHE_SIZE, ApiSettingItem::TYPE_LAST, ResourceManager::Strings::MiB },
 
 		//{ ResourceManager::REFRESH_OPTIONS },
 		{ "refresh_time", SettingsManager::AUTO_REFRESH_TIME, ResourceManager::SETTINGS_AUTO_REFRESH_TIME, ApiSettingItem::TYPE_LAST, ResourceManager::Strings::MINUTES_LOWER },
 		{ "refresh_time_incoming", SettingsManager::INCOMING_REFRESH_TIME, ResourceManager::SETTINGS_INCOMING_REFRESH_TIME, ApiSettingItem::TYPE_LAST, ResourceManager::Strings::MINUTES_LOWER },
 		{ "refresh_startup", SettingsManager::STARTUP_REFRESH, ResourceManager::SETTINGS_STARTUP_REFRESH },
 		{ "refresh_threading", SettingsManager::REFRESH_THREADING, ResourceManager::MULTITHREADED_REFRESH },
+		{ "task_pool_threads", SettingsManager::TASK_POOL_THREADS, ResourceManager::SETTINGS_TASK_POOL_THREADS },
 
 		//{ ResourceManager::SETTINGS_SHARING_OPTIONS },
 		{ "share_skiplist", SettingsManager::SKIPLIST_SHARE, ResourceManager::ST_SKIPLIST_SHARE },
@@ -158,6 +162,7 @@ namespace webserver {
 		{ "share_no_zero_byte", SettingsManager::NO_ZERO_BYTE, ResourceManager::SETTINGS_NO_ZERO_BYTE },
 		{ "share_max_size", SettingsManager::MAX_FILE_SIZE_SHARED, ResourceManager::DONT_SHARE_BIGGER_THAN, ApiSettingItem::TYPE_LAST, ResourceManager::Strings::MiB },
 		{ "share_follow_symlinks", SettingsManager::SHARE_FOLLOW_SYMLINKS, ResourceManager::FOLLOW_SYMLINKS },
+		{ "share_search_index", SettingsManager::SHARE_SEARCH_INDEX, ResourceManager::SETTINGS_SHARE_SEARCH_INDEX },
 
 		//{ ResourceManager::SETTINGS_LOGGING },
 		{ "log_directory", SettingsManager::LOG_DIRECTORY, ResourceManager::SETTINGS_LOG_DIR, ApiSettingItem::TYPE_DIRECTORY_PATH },
@@ -211,6 +216,7 @@ namespace webserver {
 		//{ ResourceManager::SETTINGS_ADVANCED },
 		{ "socket_read_buffer", SettingsManager::SOCKET_IN_BUFFER, ResourceManager::SETTINGS_SOCKET_IN_BUFFER, ApiSettingItem::TYPE_LAST, ResourceManager::Strings::B },
 		{ "socket_write_buffer", SettingsManager::SOCKET_OUT_BUFFER, ResourceManager::SETTINGS_SOCKET_OUT_BUFFER, ApiSettingItem::TYPE_LAST, ResourceManager::Strings::B },
+		{ "socket_reactor", SettingsManager::USE_SOCKET_REACTOR, ResourceManager::SETTINGS_SOCKET_REACTOR },
 		{ "buffer_size", SettingsManager::BUFFER_SIZE, ResourceManager::SETTINGS_WRITE_BUFFER, ApiSettingItem::TYPE_LAST, ResourceManager::Strings::KiB },
 		{ "compress_transfers", SettingsManager::COMPRESS_TRANSFERS, ResourceManager::SETTINGS_COMPRESS_TRANSFERS },
 		{ "max_compression", SettingsManager::MAX_COMPRESSION, ResourceManager::SETTINGS_MAX_COMPRESS },
@@ -244,11 +244,11 @@ namespace webserver {
 
 		{
 			WLock l(cs);
-			for (const auto& d : curDir->directories | views::values) {
+			for (const auto& d : curDir->getDirectories()) {
 				currentViewItems.emplace_back(std::make_shared<FilelistItemInfo>(d, dl->getShareProfile()));
 			}
 
-			for (const auto& f : curDir->files) {
+			for (const auto& f : curDir->getFiles()) {
 				currentViewItems.emplace_back(std::make_shared<FilelistItemInfo>(f, dl->getShareProfile()));
 			}
 
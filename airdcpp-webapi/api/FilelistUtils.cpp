@@ -78,7 +78,7 @@ namespace webserver {
 		switch (aPropertyName) {
 		case PROP_NAME: {
 			if (a->getType() == b->getType()) {
-				return Util::DefaultSort(a->getName(), b->getName());
+				return Util::DefaultSort(a->getName().data(), b->getName().data());
 			}
 
 			return a->isDirectory() ? -1 : 1;
@@ -93,7 +93,7 @@ namespace webserver {
 				return DirectoryContentInfo::Sort(a->dir->getContentInfo(), b->dir->getContentInfo());
 			}
 
-			return Util::DefaultSort(PathUtil::getFileExt(a->getName()), PathUtil::getFileExt(b->getName()));
+			return Util::DefaultSort(PathUtil::getFileExt(string(a->getName())), PathUtil::getFileExt(string(b->getName())));
 		}
 		default: dcassert(0); return 0;
 		}
@@ -101,7 +101,7 @@ namespace webserver {
 
 	std::string FilelistUtils::getStringInfo(const FilelistItemInfoPtr& aItem, int aPropertyName) noexcept {
 		switch (aPropertyName) {
-		case PROP_NAME: return aItem->getName();
+		case PROP_NAME: return string(aItem->getName());
 		case PROP_PATH: return aItem->getAdcPath();
 		case PROP_TYPE: {
 			if (aItem->isDirectory()) {
@@ -176,10 +176,20 @@ namespace webserver {
 	json HashApi::formatDbStatus(bool aMaintenanceRunning) noexcept {
 		int64_t indexSize = 0, storeSize = 0;
 		HashManager::getInstance()->getDbSizes(indexSize, storeSize);
+
+		auto cacheStats = HashManager::getInstance()->getCacheStats();
 		return{
 			{ "maintenance_running", aMaintenanceRunning },
 			{ "file_index_size", indexSize },
 			{ "hash_store_size", storeSize },
+			{ "cache", {
+				{ "size", cacheStats.treeBytes + cacheStats.fileBytes },
+				{ "max_size", cacheStats.maxBytes },
+				{ "tree_hits", cacheStats.treeHits },
+				{ "tree_misses", cacheStats.treeMisses },
+				{ "file_hits", cacheStats.fileHits },
+				{ "file_misses", cacheStats.fileMisses },
+			} },
 		};
 	}
 
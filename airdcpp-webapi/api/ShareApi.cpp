@@ -37,6 +37,7 @@
 #include <airdcpp/favorites/HubEntry.h>
 #include <airdcpp/core/classes/Magnet.h>
 #include <airdcpp/util/PathUtil.h>
+#include <airdcpp/search/SearchManager.h>
 #include <airdcpp/search/SearchQuery.h>
 #include <airdcpp/search/SearchResult.h>
 #include <airdcpp/share/ShareManager.h>
@@ -553,6 +554,7 @@ namespace webserver {
 
 		auto itemStats = *optionalItemStats;
 		auto searchStats = ShareManager::getInstance()->getSearchMatchingStats();
+		auto incomingStats = SearchManager::getInstance()->getIncomingSearchStats();
 
 		json j = {
 			{ "total_file_count", itemStats.totalFileCount },
@@ -568,6 +570,7 @@ namespace webserver {
 
 			{ "auto_searches", searchStats.autoSearches },
 			{ "tth_searches", searchStats.tthSearches },
+			{ "cached_searches", searchStats.cachedSearches },
 
 			{ "unfiltered_recursive_searches_per_second", searchStats.unfilteredRecursiveSearchesPerSecond },
 			{ "filtered_searches", searchStats.filteredSearches },
@@ -578,6 +581,29 @@ namespace webserver {
 
 			{ "average_search_token_count", searchStats.averageSearchTokenCount },
 			{ "average_search_token_length", searchStats.averageSearchTokenLength },
+
+			{ "bloom_size", searchStats.bloomSize },
+			{ "bloom_fill_ratio", searchStats.bloomFillRatio },
+			{ "bloom_false_positive_rate", searchStats.bloomFalsePositiveRate },
+
+			{ "indexed_searches", searchStats.indexedSearches },
+			{ "search_index_size", searchStats.searchIndexSize },
+
+			{ "read_locks", searchStats.readLocks },
+			{ "contended_read_locks", searchStats.contendedReadLocks },
+			{ "average_read_lock_wait_us", searchStats.averageReadLockWaitUs },
+			{ "max_read_lock_wait_us", searchStats.maxReadLockWaitUs },
+			{ "write_locks", searchStats.writeLocks },
+			{ "contended_write_locks", searchStats.contendedWriteLocks },
+			{ "average_write_lock_wait_us", searchStats.averageWriteLockWaitUs },
+			{ "max_write_lock_wait_us", searchStats.maxWriteLockWaitUs },
+
+			{ "incoming_search_queue_size", incomingStats.queued },
+			{ "incoming_searches_processed", incomingStats.processed },
+			{ "incoming_searches_dropped", incomingStats.dropped },
+			{ "incoming_search_cache_entries", incomingStats.cacheEntries },
+			{ "incoming_search_cache_hits", incomingStats.cacheHits },
+			{ "incoming_search_cache_misses", incomingStats.cacheMisses },
 		};
 
 		aRequest.setResponseBody(j);
@@ -29,6 +29,7 @@
 #include <airdcpp/connection/ConnectionManager.h>
 #include <airdcpp/queue/QueueManager.h>
 #include <airdcpp/connection/ThrottleManager.h>
+#include <airdcpp/core/io/stream/SharedFileStream.h>
 #include <airdcpp/transfer/TransferInfoManager.h>
 #include <airdcpp/transfer/upload/UploadManager.h>
 
@@ -59,6 +60,8 @@ namespace webserver {
 
 		METHOD_HANDLER(Access::TRANSFERS,	METHOD_GET,		(EXACT_PARAM("tranferred_bytes")),			TransferApi::handleGetTransferredBytes);
 		METHOD_HANDLER(Access::TRANSFERS,	METHOD_GET,		(EXACT_PARAM("stats")),						TransferApi::handleGetTransferStats);
+		METHOD_HANDLER(Access::TRANSFERS,	METHOD_GET,		(EXACT_PARAM("file_handles")),				TransferApi::handleGetFileHandleStats);
+		METHOD_HANDLER(Access::TRANSFERS,	METHOD_GET,		(EXACT_PARAM("throttle")),					TransferApi::handleGetThrottleStats);
 
 		timer->start(false);
 
@@ -131,6 +134,46 @@ namespace webserver {
 		return websocketpp::http::status_code::ok;
 	}
 
+	api_return TransferApi::handleGetFileHandleStats(ApiRequest& aRequest) {
+		auto stats = SharedFileStream::getStats();
+		aRequest.setResponseBody({
+			{ "open", stats.openHandles },
+			{ "idle", stats.idleHandles },
+			{ "peak", stats.peakHandles },
+			{ "max", SharedFileStream::MAX_OPEN_HANDLES },
+			{ "hits", stats.hits },
+			{ "misses", stats.misses },
+			{ "evictions", stats.evictions },
+		});
+
+		return websocketpp::http::status_code::ok;
+	}
+
+	api_return TransferApi::handleGetThrottleStats(ApiRequest& aRequest) {
+		auto serializeDirection = [](ThrottleConnection::Direction aDirection) {
+			auto ret = json::object();
+			for (auto i = 0; i < static_cast<int>(ThrottleClass::LAST); ++i) {
+				auto throttleClass = static_cast<ThrottleClass>(i);
+				auto stats = ThrottleManager::getInstance()->getClassStats(aDirection, throttleClass);
+				ret[ThrottleManager::getClassName(throttleClass)] = {
+					{ "bytes", stats.bytes },
+					{ "throttled", stats.throttled },
+					{ "connections", stats.connections },
+					{ "rate", stats.rate },
+				};
+			}
+
+			return ret;
+		};
+
+		aRequest.setResponseBody({
+			{ "download", serializeDirection(ThrottleConnection::DOWN) },
+			{ "upload", serializeDirection(ThrottleConnection::UP) },
+		});
+
+		return websocketpp::http::status_code::ok;
+	}
+
 	json TransferApi::serializeTransferStats() const noexcept {
 		auto resetSpeed = [](int transfers, int64_t speed) {
 			return (transfers == 0 && speed < 10 * 1024) || speed < 1024;
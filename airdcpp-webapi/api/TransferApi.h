@@ -42,6 +42,8 @@ namespace webserver {
 
 		api_return handleGetTransferredBytes(ApiRequest& aRequest);
 		api_return handleGetTransferStats(ApiRequest& aRequest);
+		api_return handleGetFileHandleStats(ApiRequest& aRequest);
+		api_return handleGetThrottleStats(ApiRequest& aRequest);
 		api_return handleForce(ApiRequest& aRequest);
 		api_return handleDisconnect(ApiRequest& aRequest);
 
@@ -203,6 +203,11 @@ namespace webserver {
 
 		{ SettingsManager::MAX_HASHING_THREADS, { 1, 100 } },
 		{ SettingsManager::HASHERS_PER_VOLUME, { 1, 100 } },
+		{ SettingsManager::HASH_PARALLEL_MIN_SIZE, { 0, MAX_INT_VALUE } },
+		{ SettingsManager::HASH_PARALLEL_THREADS, { 1, 64 } },
+		{ SettingsManager::HASH_CACHE_SIZE, { 0, 4096 } },
+
+		{ SettingsManager::TASK_POOL_THREADS, { 0, 256 } },
 
 		{ SettingsManager::MAX_COMPRESSION, { 0, 9 } },
 		{ SettingsManager::MINIMUM_SEARCH_INTERVAL, { 5, 1000 } },